@@ -24,6 +24,7 @@
 #include <vm/vm.h>
 
 #include <lib/counters.h>
+#include <lib/ktrace.h>
 
 #include <zircon/syscalls/exception.h>
 #include <zircon/types.h>
@@ -314,6 +315,11 @@ extern "C" uint32_t arm64_irq(struct arm64_iframe_short* iframe, uint exception_
     arch_set_in_int_handler(true);
     thread_preempt_disable();
 
+    // The short frame does not hold x29, but the assembly leaves it alone, so
+    // our caller's frame pointer is the interrupted one.
+    ktrace_profiler_irq_enter(iframe->elr, *reinterpret_cast<uintptr_t*>(__GET_FRAME(0)),
+                              exception_flags & ARM64_EXCEPTION_FLAG_LOWER_EL);
+
     kcounter_add(exceptions_irq, 1u);
     enum handler_return ret = platform_irq(iframe);
 
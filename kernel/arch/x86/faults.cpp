@@ -333,6 +333,9 @@ void x86_exception_handler(x86_iframe_t* frame) {
     // did we come from user or kernel space?
     bool from_user = is_from_user(frame);
 
+    if (frame->vector != X86_INT_NMI)
+        ktrace_profiler_irq_enter(frame->ip, frame->rbp, from_user);
+
     // deliver the interrupt
     enum handler_return ret = INT_NO_RESCHEDULE;
 
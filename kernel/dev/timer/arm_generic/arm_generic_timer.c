@@ -244,6 +244,16 @@ uint64_t current_ticks(void)
     return read_ct();
 }
 
+bool platform_get_ticks_to_time_ratio(struct fp_32_64* ratio)
+{
+    // User mode reads the virtual counter.
+    if (reg_procs != &cntv_procs) {
+        return false;
+    }
+    *ratio = ns_per_cntpct;
+    return true;
+}
+
 uint64_t ticks_per_second(void)
 {
     return u64_mul_u32_fp32_64(1000 * 1000 * 1000, cntpct_per_ns);
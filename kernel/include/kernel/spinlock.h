@@ -8,6 +8,7 @@
 #pragma once
 
 #include <arch/spinlock.h>
+#include <lib/lockstat.h>
 #include <zircon/compiler.h>
 #include <zircon/thread_annotations.h>
 
@@ -15,16 +16,26 @@ __BEGIN_CDECLS
 
 /* interrupts should already be disabled */
 static inline void spin_lock(spin_lock_t* lock) TA_ACQ(lock) {
+    if (unlikely(lockstat_enabled())) {
+        lockstat_spin_lock(lock);
+        return;
+    }
     arch_spin_lock(lock);
 }
 
 /* Returns 0 on success, non-0 on failure */
 static inline int spin_trylock(spin_lock_t* lock) TA_TRY_ACQ(false, lock) {
+    if (unlikely(lockstat_enabled()))
+        return lockstat_spin_trylock(lock);
     return arch_spin_trylock(lock);
 }
 
 /* interrupts should already be disabled */
 static inline void spin_unlock(spin_lock_t* lock) TA_REL(lock) {
+    if (unlikely(lockstat_enabled())) {
+        lockstat_spin_unlock(lock);
+        return;
+    }
     arch_spin_unlock(lock);
 }
 
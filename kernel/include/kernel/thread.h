@@ -63,6 +63,7 @@ typedef void (*thread_tls_callback_t)(void* tls_value);
 #define THREAD_SIGNAL_KILL                   (1 << 0)
 #define THREAD_SIGNAL_SUSPEND                (1 << 1)
 #define THREAD_SIGNAL_POLICY_EXCEPTION       (1 << 2)
+#define THREAD_SIGNAL_SAMPLE                 (1 << 3)
 // clang-format on
 
 #define THREAD_MAGIC (0x74687264) // 'thrd'
@@ -74,7 +75,7 @@ typedef void (*thread_tls_callback_t)(void* tls_value);
 #define THREAD_LINEBUFFER_LENGTH 128
 
 // Number of kernel tls slots.
-#define THREAD_MAX_TLS_ENTRY 2
+#define THREAD_MAX_TLS_ENTRY 3
 
 struct vmm_aspace;
 
@@ -153,6 +154,13 @@ typedef struct thread {
      * only be true if preempt_disable is also true. */
     bool preempt_pending;
 
+    /* Set between thread_handoff_begin() and thread_handoff_end(), or until
+     * the first thread woken in between is handed this thread's cpu. */
+    bool handoff_pending;
+
+    /* Set between thread_wake_affine_begin() and thread_wake_affine_end(). */
+    bool wake_affine;
+
     /* thread local storage, intialized to zero */
     void* tls[THREAD_MAX_TLS_ENTRY];
 
@@ -226,6 +234,11 @@ void thread_owner_name(thread_t* t, char out_name[THREAD_NAME_LENGTH]);
 // print the backtrace on the current thread
 void thread_print_current_backtrace(void);
 
+// fill |pcs| with up to |max| return addresses from the current thread's
+// kernel stack, innermost caller first. returns the number of entries
+// filled in, which is 0 if the kernel was built without frame pointers.
+size_t thread_get_current_backtrace(void** pcs, size_t max);
+
 // print the backtrace of the passed in thread, if possible
 zx_status_t thread_print_backtrace(thread_t* t);
 
@@ -375,6 +388,41 @@ static inline void thread_preempt_set_pending(void) {
     current_thread->preempt_pending = true;
 }
 
+/* thread_handoff_begin() and thread_handoff_end() bracket a wakeup that the
+ * current thread performs just before it blocks or reschedules, such as the
+ * two halves of a synchronous channel call.
+ *
+ * The first thread woken in between is put at the head of the current cpu's
+ * run queue instead of being sent to another (possibly idle) cpu, and is
+ * given whatever is left of the current thread's time slice, so that it runs
+ * here as soon as the current thread gives up the cpu. Threads woken from
+ * interrupt context, real time threads and threads whose affinity excludes
+ * the current cpu are woken normally. */
+static inline void thread_handoff_begin(void) {
+    get_current_thread()->handoff_pending = true;
+}
+
+static inline void thread_handoff_end(void) {
+    get_current_thread()->handoff_pending = false;
+}
+
+/* thread_wake_affine_begin() and thread_wake_affine_end() bracket wakeups
+ * where the woken threads are likely to touch the data the current thread
+ * just touched, such as a futex wake.
+ *
+ * In between, when there is no idle cpu to send a woken thread to, a thread
+ * that last ran on the current cpu stays on it (where its cache is still
+ * warm) instead of being pushed to some other busy cpu. Unlike a handoff the
+ * woken thread is queued normally and does not borrow the current thread's
+ * time slice. */
+static inline void thread_wake_affine_begin(void) {
+    get_current_thread()->wake_affine = true;
+}
+
+static inline void thread_wake_affine_end(void) {
+    get_current_thread()->wake_affine = false;
+}
+
 __END_CDECLS
 
 #ifdef __cplusplus
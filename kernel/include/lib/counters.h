@@ -55,3 +55,13 @@ static inline void kcounter_add(const struct k_counter_desc* var,
 }
 
 __END_CDECLS
+
+#ifdef __cplusplus
+#include <fbl/ref_ptr.h>
+
+class VmObject;
+
+// Returns the VMO that holds the counters, laid out as <zircon/kcounters.h>
+// describes, or null if it could not be set up.
+fbl::RefPtr<VmObject> kcounters_get_vmo();
+#endif
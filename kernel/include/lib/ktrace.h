@@ -62,6 +62,14 @@ static inline void ktrace(uint32_t tag, uint32_t a, uint32_t b, uint32_t c, uint
 void ktrace_name(uint32_t tag, uint32_t id, uint32_t arg, const char* name);
 int ktrace_read_user(void* ptr, uint32_t off, uint32_t len);
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr);
+
+// The sampling profiler. See lib/ktrace/profiler.cpp.
+zx_status_t ktrace_profiler_start(uint32_t period_us);
+void ktrace_profiler_stop(void);
+// Called on entry to an interrupt handler with the interrupted context.
+void ktrace_profiler_irq_enter(uintptr_t pc, uintptr_t fp, bool from_user);
+// Called by a thread that was sampled, before it returns to user mode.
+void ktrace_profiler_sample_user(void);
 #else
 static inline void* ktrace_open(uint32_t tag) { return NULL; }
 static inline void ktrace_tiny(uint32_t tag, uint32_t arg) {}
@@ -79,6 +87,12 @@ static inline ssize_t ktrace_read_user(void* ptr, uint32_t off, uint32_t len) {
 static inline zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     return ZX_ERR_NOT_SUPPORTED;
 }
+static inline zx_status_t ktrace_profiler_start(uint32_t period_us) {
+    return ZX_ERR_NOT_SUPPORTED;
+}
+static inline void ktrace_profiler_stop(void) {}
+static inline void ktrace_profiler_irq_enter(uintptr_t pc, uintptr_t fp, bool from_user) {}
+static inline void ktrace_profiler_sample_user(void) {}
 #endif
 
 #define KTRACE_DEFAULT_BUFSIZE 32 // MB
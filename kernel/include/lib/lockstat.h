@@ -0,0 +1,84 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/spinlock.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zircon/compiler.h>
+#include <zircon/thread_annotations.h>
+
+#if ARCH_X86
+#include <lib/code_patching.h>
+#endif
+
+__BEGIN_CDECLS
+
+// Lock statistics, for kernel mutexes (and so fbl::Mutex) and spin locks.
+// They are only kept when the kernel is booted with
+// kernel.lockstat.enable=true, and read through the "lockstat" console
+// command or ZX_INFO_LOCKSTAT.
+
+#if WITH_LIB_LOCKSTAT
+
+struct mutex;
+struct zx_info_lockstat;
+
+#if ARCH_X86
+// Each use is a "mov $0, %al" whose immediate is patched to 1 at boot if
+// lockstat is enabled, so that otherwise the locks only pay for a
+// never-taken branch.
+static inline bool lockstat_enabled(void) {
+    bool enabled;
+    __asm__("0: movb $0, %0\n"
+            LATE_CODE_PATCH_ENTRY("lockstat_patch_enabled", "0b", "2")
+            : "=a"(enabled));
+    return enabled;
+}
+#else
+extern bool lockstat_is_enabled;
+static inline bool lockstat_enabled(void) {
+    return lockstat_is_enabled;
+}
+#endif
+
+// These are called in place of the arch_spin_* functions.
+void lockstat_spin_lock(spin_lock_t* lock) TA_ACQ(lock);
+int lockstat_spin_trylock(spin_lock_t* lock) TA_TRY_ACQ(false, lock);
+void lockstat_spin_unlock(spin_lock_t* lock) TA_REL(lock);
+
+// Called by the mutex code once it holds |m|, having waited for
+// |wait_ticks| if it was contended, and just before it releases |m|.
+void lockstat_mutex_acquired(struct mutex* m, bool contended, uint64_t wait_ticks,
+                             uintptr_t caller);
+void lockstat_mutex_release(struct mutex* m);
+
+// Fills in |info| for the next lock at or after |*cursor|, which starts
+// at 0, and advances |*cursor| past it. Returns false after the last lock.
+bool lockstat_read(size_t* cursor, struct zx_info_lockstat* info);
+
+#else
+
+static inline bool lockstat_enabled(void) {
+    return false;
+}
+static inline void lockstat_spin_lock(spin_lock_t* lock) {}
+static inline int lockstat_spin_trylock(spin_lock_t* lock) {
+    return 0;
+}
+static inline void lockstat_spin_unlock(spin_lock_t* lock) {}
+static inline void lockstat_mutex_acquired(struct mutex* m, bool contended,
+                                           uint64_t wait_ticks, uintptr_t caller) {}
+static inline void lockstat_mutex_release(struct mutex* m) {}
+static inline bool lockstat_read(size_t* cursor, struct zx_info_lockstat* info) {
+    return false;
+}
+
+#endif
+
+__END_CDECLS
@@ -45,6 +45,12 @@ uint64_t ticks_per_second(void);
 /* high-precision timer current_ticks */
 uint64_t current_ticks(void);
 
+/* If current_time() is exactly the value returned by zx_ticks_get() in user
+ * mode multiplied by a fixed ratio, return true and store the ratio. The
+ * vDSO can then compute the time itself. */
+struct fp_32_64;
+bool platform_get_ticks_to_time_ratio(struct fp_32_64* ratio);
+
 /* super early platform initialization, before almost everything */
 void platform_early_init(void);
 
@@ -23,6 +23,8 @@
 #include <kernel/sched.h>
 #include <kernel/thread.h>
 #include <lib/ktrace.h>
+#include <lib/lockstat.h>
+#include <platform.h>
 #include <trace.h>
 #include <zircon/types.h>
 
@@ -68,15 +70,24 @@ void mutex_acquire(mutex_t* m) TA_NO_THREAD_SAFETY_ANALYSIS {
 
     thread_t* ct = get_current_thread();
     uintptr_t oldval;
+    uint64_t wait_start = 0;
 
 retry:
     // fast path: assume its unheld, try to grab it
     oldval = 0;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))) {
         // acquired it cleanly
+        if (unlikely(lockstat_enabled())) {
+            lockstat_mutex_acquired(m, wait_start != 0,
+                                    wait_start ? current_ticks() - wait_start : 0,
+                                    (uintptr_t)__GET_CALLER());
+        }
         return;
     }
 
+    if (unlikely(lockstat_enabled()) && wait_start == 0)
+        wait_start = current_ticks();
+
 #if LK_DEBUGLEVEL > 0
     if (unlikely(ct == mutex_holder(m)))
         panic("mutex_acquire: thread %p (%s) tried to acquire mutex %p it already owns.\n",
@@ -113,6 +124,11 @@ retry:
     DEBUG_ASSERT(ct == mutex_holder(m));
 
     THREAD_UNLOCK(state);
+
+    if (unlikely(lockstat_enabled())) {
+        lockstat_mutex_acquired(m, true, current_ticks() - wait_start,
+                                (uintptr_t)__GET_CALLER());
+    }
 }
 
 // shared implementation of release
@@ -121,6 +137,9 @@ static inline void mutex_release_internal(mutex_t* m, bool reschedule, bool thre
     thread_t* ct = get_current_thread();
     uintptr_t oldval;
 
+    if (unlikely(lockstat_enabled()))
+        lockstat_mutex_release(m);
+
     // in case there's no contention, try the fast path
     oldval = (uintptr_t)ct;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, 0))) {
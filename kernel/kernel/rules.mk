@@ -14,6 +14,7 @@ MODULE_DEPS := \
 	kernel/lib/debug \
 	kernel/lib/explicit-memory \
 	kernel/lib/heap \
+	kernel/lib/lockstat \
 	kernel/lib/libc \
 	kernel/lib/fbl \
 	kernel/vm
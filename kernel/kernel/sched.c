@@ -13,6 +13,7 @@
 #include <kernel/mp.h>
 #include <kernel/percpu.h>
 #include <kernel/thread.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
 #include <list.h>
 #include <platform.h>
@@ -54,6 +55,14 @@
 
 static bool local_migrate_if_needed(thread_t* curr_thread);
 
+KCOUNTER(sched_handoff_count, "kernel.sched.handoff");
+KCOUNTER(sched_wake_affine_count, "kernel.sched.wake_affine");
+KCOUNTER(sched_block_count, "kernel.sched.block");
+KCOUNTER(sched_unblock_count, "kernel.sched.unblock");
+KCOUNTER(sched_yield_count, "kernel.sched.yield");
+KCOUNTER(sched_preempt_count, "kernel.sched.preempt");
+KCOUNTER(sched_migrate_count, "kernel.sched.migrate");
+
 /* compute the effective priority of a thread */
 static int effec_priority(const thread_t* t) {
     int ep = t->base_priority + t->priority_boost;
@@ -172,6 +181,14 @@ static cpu_mask_t find_cpu_mask(thread_t* t) {
 
     /* no idle cpus in our affinity mask */
 
+    /* a waker that asked for affine wakeups (see thread_wake_affine_begin()) keeps a thread
+     * that last ran here on this cpu rather than bouncing it to a cold one */
+    if ((last_ran_cpu_mask == curr_cpu_mask) && (cpu_affinity & curr_cpu_mask) &&
+        get_current_thread()->wake_affine && !arch_in_int_handler()) {
+        kcounter_add(sched_wake_affine_count, 1u);
+        return curr_cpu_mask;
+    }
+
     /* if the last cpu it ran on is in the affinity mask and not the current cpu, pick that */
     if ((last_ran_cpu_mask & cpu_affinity & active_cpu_mask) &&
         last_ran_cpu_mask != curr_cpu_mask) {
@@ -257,11 +274,43 @@ void sched_block(void) {
     DEBUG_ASSERT(current_thread->state != THREAD_RUNNING);
 
     LOCAL_KTRACE0("sched_block");
+    kcounter_add(sched_block_count, 1u);
 
     /* we are blocking on something. the blocking code should have already stuck us on a queue */
     sched_resched_internal();
 }
 
+/* if the current thread is handing off its cpu (see thread_handoff_begin()), put the newly
+ * woken thread t at the head of the local run queue with the rest of the current thread's
+ * time slice. returns false if t should be placed normally.
+ */
+static bool try_handoff(thread_t* t) {
+    thread_t* current_thread = get_current_thread();
+    if (likely(!current_thread->handoff_pending))
+        return false;
+
+    cpu_num_t curr_cpu = arch_curr_cpu_num();
+    if (arch_in_int_handler() || thread_is_real_time_or_idle(t) ||
+        !(t->cpu_affinity & cpu_num_to_mask(curr_cpu)) || !mp_is_cpu_active(curr_cpu))
+        return false;
+
+    /* only the first thread woken gets the cpu */
+    current_thread->handoff_pending = false;
+
+    zx_duration_t used = current_time() - current_thread->last_started_running;
+    zx_duration_t left = current_thread->remaining_time_slice -
+                         MIN(used, current_thread->remaining_time_slice);
+    if (left > t->remaining_time_slice)
+        t->remaining_time_slice = left;
+
+    LOCAL_KTRACE2("sched_handoff", (uint32_t)t->user_tid, (uint32_t)left);
+    kcounter_add(sched_handoff_count, 1u);
+
+    t->curr_cpu = curr_cpu;
+    insert_in_run_queue_head(curr_cpu, t);
+    return true;
+}
+
 /* find a cpu to run the thread on, put it in the run queue for that cpu, and accumulate a list
  * of cpus we'll need to reschedule, including the local cpu.
  */
@@ -287,18 +336,37 @@ static void find_cpu_and_insert(thread_t* t, bool* local_resched, cpu_mask_t* ac
     }
 }
 
+/* record which thread woke |t|, so that trace tools can measure how long it
+ * waits to run. a wakeup from an interrupt handler has no waker; the current
+ * thread is just the one that was interrupted */
+static void trace_wakeup(thread_t* t) {
+    uint32_t flags = 0;
+    uint64_t waker = (uintptr_t)get_current_thread();
+    if (arch_in_int_handler()) {
+        flags |= KTRACE_WAKEUP_FROM_IRQ;
+        waker = 0;
+    }
+    ktrace(TAG_THREAD_WAKEUP, (uint32_t)(uintptr_t)t, (flags << 16) | arch_curr_cpu_num(),
+           (uint32_t)(waker >> 32), (uint32_t)waker);
+}
+
 bool sched_unblock(thread_t* t) {
     DEBUG_ASSERT(spin_lock_held(&thread_lock));
 
     DEBUG_ASSERT(t->magic == THREAD_MAGIC);
 
     LOCAL_KTRACE0("sched_unblock");
+    kcounter_add(sched_unblock_count, 1u);
 
     /* thread is being woken up, boost its priority */
     boost_thread(t);
 
     /* stuff the new thread in the run queue */
     t->state = THREAD_READY;
+    trace_wakeup(t);
+
+    if (try_handoff(t))
+        return true;
 
     bool local_resched = false;
     cpu_mask_t mask = 0;
@@ -323,11 +391,18 @@ bool sched_unblock_list(struct list_node* list) {
         DEBUG_ASSERT(t->magic == THREAD_MAGIC);
         DEBUG_ASSERT(!thread_is_idle(t));
 
+        kcounter_add(sched_unblock_count, 1u);
+
         /* thread is being woken up, boost its priority */
         boost_thread(t);
 
         /* stuff the new thread in the run queue */
         t->state = THREAD_READY;
+        trace_wakeup(t);
+        if (try_handoff(t)) {
+            local_resched = true;
+            continue;
+        }
         find_cpu_and_insert(t, &local_resched, &accum_cpu_mask);
     }
 
@@ -361,6 +436,7 @@ void sched_yield(void) {
     DEBUG_ASSERT(!thread_is_idle(current_thread));
 
     LOCAL_KTRACE0("sched_yield");
+    kcounter_add(sched_yield_count, 1u);
 
     /* consume the rest of the time slice, deboost ourself, and go to the end of a queue */
     current_thread->remaining_time_slice = 0;
@@ -385,6 +461,7 @@ void sched_preempt(void) {
     DEBUG_ASSERT(current_thread->curr_cpu == curr_cpu);
     DEBUG_ASSERT(current_thread->last_cpu == current_thread->curr_cpu);
     LOCAL_KTRACE0("sched_preempt");
+    kcounter_add(sched_preempt_count, 1u);
 
     current_thread->state = THREAD_READY;
 
@@ -450,6 +527,8 @@ static void migrate_current_thread(thread_t* current_thread) {
     bool local_resched = false;
     cpu_mask_t accum_cpu_mask = 0;
 
+    kcounter_add(sched_migrate_count, 1u);
+
     // current thread, so just shove ourself into another cpu's queue and reschedule locally
     current_thread->state = THREAD_READY;
     find_cpu_and_insert(current_thread, &local_resched, &accum_cpu_mask);
@@ -724,6 +724,14 @@ void thread_process_pending_signals(void) {
     if (likely(current_thread->signals == 0))
         return;
 
+    /* the profiler sets this from interrupt context, without the thread lock */
+    if (current_thread->signals & THREAD_SIGNAL_SAMPLE) {
+        atomic_and((volatile int*)&current_thread->signals, ~THREAD_SIGNAL_SAMPLE);
+        ktrace_profiler_sample_user();
+        if (current_thread->signals == 0)
+            return;
+    }
+
     /* grab the thread lock so we can safely look at the signal mask */
     THREAD_LOCK(state);
 
@@ -901,7 +909,7 @@ zx_status_t thread_sleep_etc(zx_time_t deadline, bool interruptable) {
     THREAD_LOCK(state);
 
     /* if we've been killed and going in interruptable, abort here */
-    if (interruptable && unlikely((current_thread->signals))) {
+    if (interruptable && unlikely((current_thread->signals & ~THREAD_SIGNAL_SAMPLE))) {
         if (current_thread->signals & THREAD_SIGNAL_KILL) {
             blocked_status = ZX_ERR_INTERNAL_INTR_KILLED;
         } else {
@@ -1313,7 +1321,7 @@ static zx_status_t thread_read_stack(thread_t* t, void* ptr, void* out, size_t s
     return ZX_OK;
 }
 
-static size_t thread_get_backtrace(thread_t* t, void* fp, thread_backtrace_t* tb) {
+static size_t thread_get_backtrace(thread_t* t, void* fp, void** pcs, size_t max) {
     // without frame pointers, dont even try
     // the compiler should optimize out the body of all the callers if it's not present
     if (!WITH_FRAME_POINTERS)
@@ -1324,11 +1332,11 @@ static size_t thread_get_backtrace(thread_t* t, void* fp, thread_backtrace_t* tb
         return 0;
     }
     size_t n = 0;
-    for (; n < THREAD_BACKTRACE_DEPTH; n++) {
+    for (; n < max; n++) {
         if (thread_read_stack(t, fp + 8, &pc, sizeof(void*))) {
             break;
         }
-        tb->pc[n] = pc;
+        pcs[n] = pc;
         if (thread_read_stack(t, fp, &fp, sizeof(void*))) {
             break;
         }
@@ -1342,7 +1350,7 @@ static zx_status_t _thread_print_backtrace(thread_t* t, void *fp) {
     }
 
     thread_backtrace_t tb;
-    size_t count = thread_get_backtrace(t, fp, &tb);
+    size_t count = thread_get_backtrace(t, fp, tb.pc, THREAD_BACKTRACE_DEPTH);
     if (count == 0) {
         return ZX_ERR_BAD_STATE;
     }
@@ -1360,6 +1368,11 @@ void thread_print_current_backtrace(void) {
     _thread_print_backtrace(get_current_thread(), __GET_FRAME(0));
 }
 
+// collect the return addresses of the current thread's callers
+size_t thread_get_current_backtrace(void** pcs, size_t max) {
+    return thread_get_backtrace(get_current_thread(), __GET_FRAME(0), pcs, max);
+}
+
 // print the backtrace of a passed in thread, if possible
 zx_status_t thread_print_backtrace(thread_t* t) {
     // get the starting point if it's in a usable state
@@ -7,17 +7,32 @@
 #include <arch/ops.h>
 #include <lib/code_patching.h>
 #include <lk/init.h>
+#include <zircon/compiler.h>
 
 extern const CodePatchInfo __start_code_patch_table[];
 extern const CodePatchInfo __stop_code_patch_table[];
+extern const CodePatchInfo __start_code_patch_late_table[] __WEAK;
+extern const CodePatchInfo __stop_code_patch_late_table[] __WEAK;
 
-static void apply_startup_code_patches(uint level) {
-    for (const CodePatchInfo* patch = __start_code_patch_table;
-         patch < __stop_code_patch_table; ++patch) {
+static void apply_code_patches(const CodePatchInfo* start, const CodePatchInfo* stop) {
+    for (const CodePatchInfo* patch = start; patch < stop; ++patch) {
         patch->apply_func(patch);
         arch_sync_cache_range((addr_t)patch->dest_addr, patch->dest_size);
     }
 }
 
+static void apply_startup_code_patches(uint level) {
+    apply_code_patches(__start_code_patch_table, __stop_code_patch_table);
+}
+
+// The late patches depend on the kernel command line, which is not read
+// until the platform's early init. They still apply before vm_init() makes
+// the kernel's code read-only, and while only this CPU is running.
+static void apply_late_code_patches(uint level) {
+    apply_code_patches(__start_code_patch_late_table, __stop_code_patch_late_table);
+}
+
 LK_INIT_HOOK(code_patching, apply_startup_code_patches,
              LK_INIT_LEVEL_ARCH_EARLY);
+LK_INIT_HOOK(code_patching_late, apply_late_code_patches,
+             LK_INIT_LEVEL_TARGET_EARLY);
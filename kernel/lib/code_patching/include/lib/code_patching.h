@@ -38,6 +38,20 @@
 
 #include <stdint.h>
 
+// LATE_CODE_PATCH_ENTRY("func", "loc", "size") is text for an extended asm
+// statement, asking for the code at |loc| to be filled in by func() at
+// LK_INIT_LEVEL_TARGET_EARLY, by which time func() can consult the kernel
+// command line. Until then, the code at |loc| runs as assembled.
+#define LATE_CODE_PATCH_ENTRY(patch_func, loc, size_in_bytes)      \
+    ".pushsection code_patch_late_table,\"a\",%%progbits\n"       \
+    ".balign 8\n"                                                  \
+    ".quad " patch_func "\n"                                       \
+    ".quad " loc "\n"                                              \
+    ".quad " size_in_bytes "\n"                                    \
+    ".popsection\n"
+
+#ifdef __cplusplus
+
 struct CodePatchInfo {
     void (*apply_func)(const CodePatchInfo* patch);
     uint8_t* dest_addr; // Destination code address to patch.
@@ -59,4 +73,6 @@ struct CodePatchInfo {
             #name "End:\n"                                         \
             ".popsection");
 
+#endif // __cplusplus
+
 #endif
@@ -11,6 +11,10 @@
 #include <arch/ops.h>
 #include <kernel/cmdline.h>
 #include <kernel/percpu.h>
+#include <kernel/spinlock.h>
+#include <vm/vm_aspace.h>
+#include <vm/vm_object_paged.h>
+#include <zircon/kcounters.h>
 
 #include <lk/init.h>
 
@@ -59,6 +63,78 @@ static void counters_init(unsigned level) {
     }
 }
 
+// The VMO that the counters live in once counters_publish() has run.
+static fbl::RefPtr<VmObject> counters_vmo;
+
+fbl::RefPtr<VmObject> kcounters_get_vmo() {
+    return counters_vmo;
+}
+
+// Moves the counters into a VMO laid out as <zircon/kcounters.h> describes,
+// which userboot hands to userspace. This runs before the secondary CPUs
+// start, so only this CPU's interrupt handlers can update them meanwhile.
+static void counters_publish(unsigned level) {
+    const size_t num_counters = get_num_counters();
+    const size_t desc_offset = sizeof(zx_kcounters_header_t);
+    const size_t arena_offset =
+        ROUNDUP(desc_offset + num_counters * sizeof(zx_kcounter_desc_t), PAGE_SIZE);
+    const size_t arena_size = SMP_MAX_CPUS * num_counters * sizeof(uint64_t);
+    const size_t size = arena_offset + ROUNDUP(arena_size, PAGE_SIZE);
+
+    // The pages are pinned for good, since counters are updated where page
+    // faults are not allowed and userspace must not be able to decommit them.
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, size, &vmo);
+    if (status == ZX_OK)
+        status = vmo->CommitRange(0, size, nullptr);
+    if (status == ZX_OK)
+        status = vmo->Pin(0, size);
+    if (status != ZX_OK) {
+        printf("counters: failed to create VMO: %d\n", status);
+        return;
+    }
+
+    // The mapping is never removed.
+    fbl::RefPtr<VmMapping> mapping;
+    status = VmAspace::kernel_aspace()->RootVmar()->CreateVmMapping(
+        0 /* ignored */, size, 0 /* align pow2 */, 0 /* vmar flags */, vmo, 0,
+        ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE, "kcounters", &mapping);
+    if (status == ZX_OK)
+        status = mapping->MapRange(0, size, /* commit= */ true);
+    if (status != ZX_OK) {
+        printf("counters: failed to map VMO: %d\n", status);
+        if (mapping)
+            mapping->Destroy();
+        vmo->Unpin(0, size);
+        return;
+    }
+
+    auto base = reinterpret_cast<uint8_t*>(mapping->base());
+    auto header = reinterpret_cast<zx_kcounters_header_t*>(base);
+    header->magic = ZX_KCOUNTERS_MAGIC;
+    header->num_counters = static_cast<uint32_t>(num_counters);
+    header->num_cpus = SMP_MAX_CPUS;
+    header->desc_offset = desc_offset;
+    header->arena_offset = arena_offset;
+
+    auto desc = reinterpret_cast<zx_kcounter_desc_t*>(base + desc_offset);
+    for (size_t ix = 0; ix != num_counters; ++ix)
+        strlcpy(desc[ix].name, kcountdesc_begin[ix].name, sizeof(desc[ix].name));
+
+    auto arena = reinterpret_cast<uint64_t*>(base + arena_offset);
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+    memcpy(arena, kcounters_arena, arena_size);
+    for (size_t ix = 0; ix != SMP_MAX_CPUS; ++ix) {
+        percpu[ix].counters = &arena[ix * num_counters];
+    }
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    static const char kName[] = "counters";
+    vmo->set_name(kName, sizeof(kName) - 1);
+    counters_vmo = fbl::move(vmo);
+}
+
 static void dump_counter(const k_counter_desc* desc) {
     size_t counter_index = kcounter_index(desc);
 
@@ -119,6 +195,7 @@ static int get_counter(int argc, const cmd_args* argv, uint32_t flags) {
 }
 
 LK_INIT_HOOK(kcounters, counters_init, LK_INIT_LEVEL_PLATFORM_EARLY);
+LK_INIT_HOOK(kcounters_publish, counters_publish, LK_INIT_LEVEL_KERNEL);
 
 STATIC_COMMAND_START
 STATIC_COMMAND("counters", "get counter", &get_counter)
@@ -191,15 +191,16 @@ void* Arena::Pool::Pop() {
             committed_max_ = committed_;
         }
     }
+    // Publish the new top only once the slot's memory is committed.
     char* slot = top_;
-    top_ += slot_size_;
+    __atomic_store_n(&top_, slot + slot_size_, __ATOMIC_RELEASE);
     return slot;
 }
 
 void Arena::Pool::Push(void* p) {
     // Can only push the most-recently-popped slot.
     ASSERT(reinterpret_cast<char*>(p) + slot_size_ == top_);
-    top_ -= slot_size_;
+    __atomic_store_n(&top_, top_ - slot_size_, __ATOMIC_RELEASE);
     if (static_cast<size_t>(committed_ - top_) >= kPoolDecommitThreshold) {
         char* nc = reinterpret_cast<char*>(
             ROUNDUP(reinterpret_cast<uintptr_t>(top_ + kPoolCommitIncrease),
@@ -34,6 +34,11 @@ public:
     zx_status_t Init(const char* name, size_t ob_size, size_t max_count);
     void* Alloc();
     void Free(void* addr);
+
+    // Returns true if |addr| is a slot that has been returned by Alloc(),
+    // whether or not it has been freed since. Slots are never given back to
+    // the data pool, so this may be called without serializing against
+    // Alloc() and Free().
     bool in_range(void* addr) const {
         return data_.InRange(static_cast<char*>(addr));
     }
@@ -84,7 +89,7 @@ private:
         // Returns true if |addr| could have been returned by Pop and has
         // not been reclaimed by Push.
         bool InRange(void* addr) const {
-            return (addr >= start_ && addr < top_);
+            return (addr >= start_ && addr < __atomic_load_n(&top_, __ATOMIC_ACQUIRE));
         }
 
         // The lowest address of the memory managed by this Pool.
@@ -105,6 +110,7 @@ private:
         size_t slot_size_;
         char* start_;
         char* top_;           // |start|..|top| contains all allocated slots.
+                              // Updated atomically for the sake of InRange().
         char* committed_;     // |start|..|mapped| is committed.
         char* committed_max_; // Largest committed_ value seen.
         char* end_;           // |mapped|..|end| is not committed.
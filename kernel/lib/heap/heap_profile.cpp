@@ -0,0 +1,400 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/heap_profile.h>
+
+#include "heap_profile_priv.h"
+
+#include <arch/ops.h>
+#include <assert.h>
+#include <err.h>
+#include <inttypes.h>
+#include <kernel/align.h>
+#include <kernel/atomic.h>
+#include <kernel/auto_lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <lib/heap.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vm/vm.h>
+
+bool heap_profile_sampling = false;
+bool heap_profile_tracking = false;
+
+namespace {
+
+// Number of caller frames kept per sample.
+constexpr size_t kMaxFrames = 16u;
+
+// Frames belonging to the profiler and heap wrapper themselves:
+// RecordSample(), heap_profile_alloc() and malloc() or one of its siblings.
+constexpr size_t kSkipFrames = 3u;
+
+// Number of distinct allocation stacks. Must be a power of 2.
+constexpr size_t kMaxSites = 1024u;
+
+static_assert((kMaxSites & (kMaxSites - 1)) == 0, "");
+static_assert((LiveTable::kCapacity & (LiveTable::kCapacity - 1)) == 0, "");
+static_assert((LiveTable::kFilterSize & (LiveTable::kFilterSize - 1)) == 0, "");
+
+struct Site {
+    uint64_t hash;
+    uint32_t depth;
+    void* pcs[kMaxFrames];
+
+    uint64_t alloc_count;
+    uint64_t alloc_bytes;
+    uint64_t live_count;
+    uint64_t live_bytes;
+};
+
+// Per-CPU sampling state. Accessed without locks; a thread that migrates
+// mid-update only perturbs the sampling interval.
+struct SampleState {
+    int64_t bytes_left;
+    uint64_t rng;
+} __CPU_ALIGN;
+
+SampleState sample_state[SMP_MAX_CPUS];
+
+spin_lock_t profile_lock = SPIN_LOCK_INITIAL_VALUE;
+
+// The tables are allocated the first time the profiler is started and
+// never freed.
+Site* sites TA_GUARDED(profile_lock) = nullptr;
+LiveTable live TA_GUARDED(profile_lock);
+
+size_t sample_interval TA_GUARDED(profile_lock) = HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL;
+size_t num_sites TA_GUARDED(profile_lock) = 0u;
+uint64_t dropped_samples TA_GUARDED(profile_lock) = 0u;
+
+uint64_t HashFrames(void* const* pcs, size_t depth) {
+    // FNV-1a.
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t ix = 0; ix != depth; ++ix) {
+        hash ^= reinterpret_cast<uintptr_t>(pcs[ix]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Returns a sampling interval uniformly distributed in
+// [interval / 2, interval * 3 / 2) so that allocation patterns which repeat
+// with the same period as the interval are not systematically missed.
+int64_t NextInterval(SampleState* state, size_t interval) {
+    // xorshift64.
+    uint64_t x = state->rng ? state->rng : (arch_cycle_count() | 1u);
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    state->rng = x;
+    return static_cast<int64_t>(interval / 2 + (x % (interval ? interval : 1)));
+}
+
+Site* FindOrAddSiteLocked(void* const* pcs, size_t depth) TA_REQ(profile_lock) {
+    uint64_t hash = HashFrames(pcs, depth);
+    size_t slot = static_cast<size_t>(hash) & (kMaxSites - 1);
+    for (size_t probe = 0; probe != kMaxSites; ++probe) {
+        Site* site = &sites[(slot + probe) & (kMaxSites - 1)];
+        if (site->depth == 0) {
+            site->hash = hash;
+            site->depth = static_cast<uint32_t>(depth);
+            memcpy(site->pcs, pcs, depth * sizeof(pcs[0]));
+            ++num_sites;
+            return site;
+        }
+        if (site->hash == hash && site->depth == depth &&
+            memcmp(site->pcs, pcs, depth * sizeof(pcs[0])) == 0) {
+            return site;
+        }
+    }
+    return nullptr;
+}
+
+__NO_INLINE void RecordSample(void* ptr, size_t size) {
+    void* pcs[kSkipFrames + kMaxFrames];
+    size_t depth = thread_get_current_backtrace(pcs, countof(pcs));
+    if (depth <= kSkipFrames) {
+        // Built without frame pointers; still attribute the bytes.
+        pcs[kSkipFrames] = nullptr;
+        depth = kSkipFrames + 1;
+    }
+
+    AutoSpinLockIrqSave lock(&profile_lock);
+    // Sampling may have been stopped, and the profile reset, since the
+    // caller checked. A sample recorded then would never be retired, since
+    // free() stops reporting once the profile is reset.
+    if (sites == nullptr || !heap_profile_sampling)
+        return;
+
+    Site* site = FindOrAddSiteLocked(&pcs[kSkipFrames], depth - kSkipFrames);
+    if (site == nullptr || !live.Add(ptr, size, static_cast<uint32_t>(site - sites))) {
+        ++dropped_samples;
+        return;
+    }
+    site->alloc_count++;
+    site->alloc_bytes += size;
+    site->live_count++;
+    site->live_bytes += size;
+}
+
+class Writer {
+public:
+    Writer(char* buf, size_t len) : buf_(buf), len_(len) {}
+
+    void Printf(const char* fmt, ...) __PRINTFLIKE(2, 3) {
+        va_list ap;
+        va_start(ap, fmt);
+        char* dst = (pos_ < len_) ? buf_ + pos_ : nullptr;
+        size_t avail = (pos_ < len_) ? len_ - pos_ : 0u;
+        int n = vsnprintf(dst, avail, fmt, ap);
+        va_end(ap);
+        if (n > 0)
+            pos_ += n;
+    }
+
+    size_t length() const { return pos_; }
+
+private:
+    char* const buf_;
+    const size_t len_;
+    size_t pos_ = 0u;
+};
+
+}  // namespace
+
+void LiveTable::Init(LiveAlloc* entries, int* filter) {
+    entries_ = entries;
+    filter_ = filter;
+    count_ = 0u;
+}
+
+size_t LiveTable::HomeSlot(const void* ptr) {
+    // Heap pointers are at least 8 byte aligned.
+    uintptr_t v = reinterpret_cast<uintptr_t>(ptr) >> 3;
+    return static_cast<size_t>((v * 0x9e3779b97f4a7c15ull) >> 32) & (kCapacity - 1);
+}
+
+size_t LiveTable::FilterSlot(const void* ptr) {
+    uintptr_t v = reinterpret_cast<uintptr_t>(ptr) >> 3;
+    return static_cast<size_t>((v * 0x9e3779b97f4a7c15ull) >> 32) & (kFilterSize - 1);
+}
+
+bool LiveTable::Add(void* ptr, size_t size, uint32_t site) {
+    if (count_ == kCapacity)
+        return false;
+    size_t slot = HomeSlot(ptr);
+    while (entries_[slot].ptr != nullptr)
+        slot = (slot + 1) & (kCapacity - 1);
+    entries_[slot] = {ptr, size, site};
+    ++count_;
+    atomic_add(&filter_[FilterSlot(ptr)], 1);
+    return true;
+}
+
+// Linear probing with backward-shift deletion, so that the table never
+// fills up with tombstones.
+bool LiveTable::Remove(void* ptr, LiveAlloc* out) {
+    size_t slot = HomeSlot(ptr);
+    for (;;) {
+        if (entries_[slot].ptr == nullptr)
+            return false;
+        if (entries_[slot].ptr == ptr)
+            break;
+        slot = (slot + 1) & (kCapacity - 1);
+    }
+    *out = entries_[slot];
+
+    // Empty the hole first: in a full table it is the only empty slot, and
+    // it is what ends the scan below.
+    entries_[slot].ptr = nullptr;
+    size_t hole = slot;
+    size_t next = slot;
+    for (;;) {
+        next = (next + 1) & (kCapacity - 1);
+        if (entries_[next].ptr == nullptr)
+            break;
+        size_t home = HomeSlot(entries_[next].ptr);
+        // Move |next| into the hole unless its home lies cyclically in
+        // (hole, next].
+        bool in_range = (hole <= next) ? (hole < home && home <= next)
+                                       : (hole < home || home <= next);
+        if (!in_range) {
+            entries_[hole] = entries_[next];
+            entries_[next].ptr = nullptr;
+            hole = next;
+        }
+    }
+    --count_;
+    atomic_add(&filter_[FilterSlot(ptr)], -1);
+    return true;
+}
+
+void LiveTable::Clear() {
+    memset(entries_, 0, kCapacity * sizeof(LiveAlloc));
+    for (size_t ix = 0; ix != kFilterSize; ++ix)
+        atomic_store(&filter_[ix], 0);
+    count_ = 0u;
+}
+
+bool LiveTable::MayContain(const void* ptr) const {
+    // Read before the table is set up; let the caller look under the lock.
+    if (filter_ == nullptr)
+        return true;
+    return atomic_load(&filter_[FilterSlot(ptr)]) != 0;
+}
+
+// Racy read of |sample_interval|; it only changes in heap_profile_start().
+void heap_profile_alloc(void* ptr, size_t size) TA_NO_THREAD_SAFETY_ANALYSIS {
+    if (ptr == nullptr)
+        return;
+
+    SampleState* state = &sample_state[arch_curr_cpu_num()];
+    state->bytes_left -= size;
+    if (likely(state->bytes_left > 0))
+        return;
+
+    state->bytes_left = NextInterval(state, sample_interval);
+    RecordSample(ptr, size);
+}
+
+// Only about one block in every |sample_interval| bytes is sampled, so most
+// frees are turned away by the live table's filter without taking the lock.
+void heap_profile_free(void* ptr) TA_NO_THREAD_SAFETY_ANALYSIS {
+    if (ptr == nullptr || !live.MayContain(ptr))
+        return;
+
+    AutoSpinLockIrqSave lock(&profile_lock);
+    if (!live.initialized() || live.count() == 0)
+        return;
+
+    LiveAlloc entry;
+    if (live.Remove(ptr, &entry)) {
+        Site* site = &sites[entry.site];
+        site->live_count--;
+        site->live_bytes -= entry.size;
+    }
+}
+
+zx_status_t heap_profile_start(size_t interval) {
+    if (interval == 0)
+        interval = HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL;
+
+    bool need_tables;
+    {
+        AutoSpinLockIrqSave lock(&profile_lock);
+        if (heap_profile_sampling)
+            return ZX_ERR_BAD_STATE;
+        need_tables = (sites == nullptr);
+    }
+
+    // Allocate outside the lock; sampling is not on yet so these calls do
+    // not re-enter the profiler's allocation hook.
+    Site* new_sites = nullptr;
+    LiveAlloc* new_live = nullptr;
+    int* new_filter = nullptr;
+    if (need_tables) {
+        new_sites = static_cast<Site*>(calloc(kMaxSites, sizeof(Site)));
+        new_live = static_cast<LiveAlloc*>(calloc(LiveTable::kCapacity, sizeof(LiveAlloc)));
+        new_filter = static_cast<int*>(calloc(LiveTable::kFilterSize, sizeof(int)));
+        if (new_sites == nullptr || new_live == nullptr || new_filter == nullptr) {
+            free(new_sites);
+            free(new_live);
+            free(new_filter);
+            return ZX_ERR_NO_MEMORY;
+        }
+    }
+
+    {
+        AutoSpinLockIrqSave lock(&profile_lock);
+        if (sites == nullptr) {
+            sites = new_sites;
+            live.Init(new_live, new_filter);
+            new_sites = nullptr;
+            new_live = nullptr;
+            new_filter = nullptr;
+        }
+        sample_interval = interval;
+        for (auto& state : sample_state)
+            state.bytes_left = static_cast<int64_t>(interval);
+        heap_profile_tracking = true;
+        heap_profile_sampling = true;
+    }
+
+    // Non-null only if we lost a race with another starter.
+    free(new_sites);
+    free(new_live);
+    free(new_filter);
+    return ZX_OK;
+}
+
+void heap_profile_stop(void) {
+    AutoSpinLockIrqSave lock(&profile_lock);
+    heap_profile_sampling = false;
+}
+
+zx_status_t heap_profile_reset(void) {
+    AutoSpinLockIrqSave lock(&profile_lock);
+    if (heap_profile_sampling)
+        return ZX_ERR_BAD_STATE;
+    if (sites != nullptr) {
+        memset(sites, 0, kMaxSites * sizeof(Site));
+        live.Clear();
+    }
+    num_sites = 0u;
+    dropped_samples = 0u;
+    heap_profile_tracking = false;
+    return ZX_OK;
+}
+
+size_t heap_profile_format(char* buf, size_t len) {
+    Writer w(buf, len);
+
+    AutoSpinLockIrqSave lock(&profile_lock);
+
+    uint64_t live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+    if (sites != nullptr) {
+        for (size_t ix = 0; ix != kMaxSites; ++ix) {
+            live_count += sites[ix].live_count;
+            live_bytes += sites[ix].live_bytes;
+            alloc_count += sites[ix].alloc_count;
+            alloc_bytes += sites[ix].alloc_bytes;
+        }
+    }
+
+    w.Printf("heap profile: %" PRIu64 ": %" PRIu64 " [%" PRIu64 ": %" PRIu64 "] @ heap_v2/%zu\n",
+             live_count, live_bytes, alloc_count, alloc_bytes, sample_interval);
+
+    if (sites != nullptr) {
+        for (size_t ix = 0; ix != kMaxSites; ++ix) {
+            const Site& site = sites[ix];
+            if (site.depth == 0)
+                continue;
+            w.Printf("%" PRIu64 ": %" PRIu64 " [%" PRIu64 ": %" PRIu64 "] @",
+                     site.live_count, site.live_bytes, site.alloc_count, site.alloc_bytes);
+            for (size_t f = 0; f != site.depth; ++f)
+                w.Printf(" 0x%" PRIxPTR, reinterpret_cast<uintptr_t>(site.pcs[f]));
+            w.Printf("\n");
+        }
+    }
+
+    // pprof uses this section to map addresses back to the kernel image.
+    w.Printf("\nMAPPED_LIBRARIES:\n");
+    w.Printf("%016" PRIxPTR "-%016" PRIxPTR " r-xp 00000000 00:00 0 zircon.elf\n",
+             reinterpret_cast<uintptr_t>(__code_start), reinterpret_cast<uintptr_t>(__code_end));
+
+    return w.length();
+}
+
+void heap_profile_dump_stats(void) {
+    AutoSpinLockIrqSave lock(&profile_lock);
+    printf("heap profile: sampling %s, interval %zu bytes\n",
+           heap_profile_sampling ? "on" : "off", sample_interval);
+    printf("\tsites %zu/%zu, live samples %zu/%zu, dropped samples %" PRIu64 "\n",
+           num_sites, kMaxSites, live.count(), LiveTable::kCapacity, dropped_samples);
+}
@@ -0,0 +1,67 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+// Internals of the heap profiler, shared with its unit tests.
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct LiveAlloc {
+    void* ptr; // nullptr when the slot is empty.
+    size_t size;
+    uint32_t site;
+};
+
+// The sampled allocations that have not been freed yet, keyed by address.
+// Not thread safe: the profiler calls everything but MayContain() with its
+// lock held.
+class LiveTable {
+public:
+    // Number of entries. Must be a power of 2.
+    static constexpr size_t kCapacity = 8192u;
+
+    // Number of counters in the filter consulted by MayContain(). Must be a
+    // power of 2.
+    static constexpr size_t kFilterSize = 2 * kCapacity;
+
+    // |entries| must hold kCapacity and |filter| kFilterSize elements, all
+    // zero. Both must outlive the table.
+    void Init(LiveAlloc* entries, int* filter);
+    bool initialized() const { return entries_ != nullptr; }
+
+    size_t count() const { return count_; }
+
+    // Returns false if the table is full.
+    bool Add(void* ptr, size_t size, uint32_t site);
+
+    // Removes |ptr| and returns its entry in |out|. Returns false if |ptr|
+    // is not in the table.
+    bool Remove(void* ptr, LiveAlloc* out);
+
+    // Empties the table.
+    void Clear();
+
+    // Returns false if |ptr| is certainly not in the table. May be called
+    // without the lock: no other thread adds or removes |ptr| itself while
+    // its block is being freed, and other entries only change the answer
+    // for pointers that share |ptr|'s filter counter.
+    bool MayContain(const void* ptr) const;
+
+    // The slot that |ptr| is stored in when there are no collisions.
+    static size_t HomeSlot(const void* ptr);
+
+private:
+    static size_t FilterSlot(const void* ptr);
+
+    LiveAlloc* entries_ = nullptr;
+    // The number of entries whose address maps to each counter, so that
+    // most frees can tell without the lock that their block was never
+    // sampled.
+    int* filter_ = nullptr;
+    size_t count_ = 0u;
+};
@@ -0,0 +1,147 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "heap_profile_priv.h"
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <unittest.h>
+
+namespace {
+
+// The table only hashes addresses, so the tests use made up ones.
+void* FakePtr(size_t n) {
+    return reinterpret_cast<void*>(0xffffff8000000000ull + n * 16u);
+}
+
+// Fills |out| with |count| distinct fake pointers whose home slot is |slot|.
+void FindPtrsForSlot(size_t slot, void** out, size_t count) {
+    size_t found = 0;
+    for (size_t n = 0; found < count; ++n) {
+        void* ptr = FakePtr(n);
+        if (LiveTable::HomeSlot(ptr) == slot)
+            out[found++] = ptr;
+    }
+}
+
+struct TestTable {
+    fbl::unique_ptr<LiveAlloc[]> entries;
+    fbl::unique_ptr<int[]> filter;
+    LiveTable table;
+};
+
+bool init_table(TestTable* t) {
+    fbl::AllocChecker ac;
+    t->entries.reset(new (&ac) LiveAlloc[LiveTable::kCapacity]());
+    if (!ac.check())
+        return false;
+    t->filter.reset(new (&ac) int[LiveTable::kFilterSize]());
+    if (!ac.check())
+        return false;
+    t->table.Init(t->entries.get(), t->filter.get());
+    return true;
+}
+
+bool contains(LiveTable* table, void* ptr, size_t size) {
+    // Remove and re-add, since there is no lookup.
+    LiveAlloc entry;
+    if (!table->Remove(ptr, &entry))
+        return false;
+    table->Add(entry.ptr, entry.size, entry.site);
+    return entry.size == size;
+}
+
+// Removing from the middle of a collision chain must leave the rest of the
+// chain reachable.
+bool live_table_collisions(void* context) {
+    BEGIN_TEST;
+    TestTable t;
+    REQUIRE_TRUE(init_table(&t), "out of memory");
+
+    void* ptrs[4];
+    FindPtrsForSlot(100, ptrs, fbl::count_of(ptrs));
+    for (size_t ix = 0; ix != fbl::count_of(ptrs); ++ix)
+        REQUIRE_TRUE(t.table.Add(ptrs[ix], ix + 1, 0), "add");
+    EXPECT_EQ(4u, t.table.count(), "");
+
+    LiveAlloc entry;
+    REQUIRE_TRUE(t.table.Remove(ptrs[1], &entry), "remove middle");
+    EXPECT_EQ(2u, entry.size, "");
+    EXPECT_FALSE(t.table.Remove(ptrs[1], &entry), "removed twice");
+    EXPECT_TRUE(contains(&t.table, ptrs[0], 1), "");
+    EXPECT_TRUE(contains(&t.table, ptrs[2], 3), "");
+    EXPECT_TRUE(contains(&t.table, ptrs[3], 4), "");
+
+    void* const rest[] = {ptrs[0], ptrs[2], ptrs[3]};
+    for (void* ptr : rest)
+        REQUIRE_TRUE(t.table.Remove(ptr, &entry), "remove");
+    EXPECT_EQ(0u, t.table.count(), "");
+    // Colliding pointers may share a filter counter, so it is only known to
+    // be clear once they are all gone.
+    for (void* ptr : ptrs)
+        EXPECT_FALSE(t.table.MayContain(ptr), "filter not cleared");
+    END_TEST;
+}
+
+// A chain that wraps past the end of the table, with an entry from the
+// start of the table behind it.
+bool live_table_wrap(void* context) {
+    BEGIN_TEST;
+    TestTable t;
+    REQUIRE_TRUE(init_table(&t), "out of memory");
+
+    void* last[3];
+    FindPtrsForSlot(LiveTable::kCapacity - 1, last, fbl::count_of(last));
+    void* first;
+    FindPtrsForSlot(0, &first, 1);
+
+    // Occupies slots kCapacity - 1, 0, 1 and then 2.
+    for (void* ptr : last)
+        REQUIRE_TRUE(t.table.Add(ptr, 8, 0), "add");
+    REQUIRE_TRUE(t.table.Add(first, 16, 0), "add");
+
+    LiveAlloc entry;
+    REQUIRE_TRUE(t.table.Remove(last[0], &entry), "remove head");
+    EXPECT_TRUE(contains(&t.table, last[1], 8), "");
+    EXPECT_TRUE(contains(&t.table, last[2], 8), "");
+    EXPECT_TRUE(contains(&t.table, first, 16), "");
+
+    REQUIRE_TRUE(t.table.Remove(last[2], &entry), "remove");
+    EXPECT_TRUE(contains(&t.table, first, 16), "");
+    EXPECT_TRUE(contains(&t.table, last[1], 8), "");
+    EXPECT_EQ(2u, t.table.count(), "");
+    END_TEST;
+}
+
+bool live_table_full(void* context) {
+    BEGIN_TEST;
+    TestTable t;
+    REQUIRE_TRUE(init_table(&t), "out of memory");
+
+    for (size_t n = 0; n != LiveTable::kCapacity; ++n)
+        REQUIRE_TRUE(t.table.Add(FakePtr(n), 8, 0), "add");
+    EXPECT_FALSE(t.table.Add(FakePtr(LiveTable::kCapacity), 8, 0), "added to a full table");
+
+    LiveAlloc entry;
+    REQUIRE_TRUE(t.table.Remove(FakePtr(17), &entry), "remove");
+    EXPECT_TRUE(t.table.Add(FakePtr(LiveTable::kCapacity), 8, 0), "add after remove");
+
+    t.table.Clear();
+    EXPECT_EQ(0u, t.table.count(), "");
+    EXPECT_FALSE(t.table.MayContain(FakePtr(0)), "filter not cleared");
+    EXPECT_FALSE(t.table.Remove(FakePtr(0), &entry), "table not cleared");
+    END_TEST;
+}
+
+} // namespace
+
+UNITTEST_START_TESTCASE(heap_profile_tests)
+UNITTEST("live table collisions", live_table_collisions)
+UNITTEST("live table wrap around", live_table_wrap)
+UNITTEST("live table full", live_table_full)
+UNITTEST_END_TESTCASE(heap_profile_tests, "heap_profile", "Heap profiler tests",
+                      nullptr, nullptr);
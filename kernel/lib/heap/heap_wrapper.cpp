@@ -19,6 +19,7 @@
 #include <vm/vm.h>
 #include <vm/pmm.h>
 #include <lib/cmpctmalloc.h>
+#include <lib/heap_profile.h>
 #include <lib/console.h>
 
 #define LOCAL_TRACE 0
@@ -55,6 +56,8 @@ void *malloc(size_t size)
     LTRACEF("size %zu\n", size);
 
     void *ptr = cmpct_alloc(size);
+    if (unlikely(heap_profile_sampling))
+        heap_profile_alloc(ptr, size);
     if (unlikely(heap_trace))
         printf("caller %p malloc %zu -> %p\n", __GET_CALLER(), size, ptr);
 
@@ -72,6 +75,8 @@ void *memalign(size_t boundary, size_t size)
     LTRACEF("boundary %zu, size %zu\n", boundary, size);
 
     void *ptr = cmpct_memalign(size, boundary);
+    if (unlikely(heap_profile_sampling))
+        heap_profile_alloc(ptr, size);
     if (unlikely(heap_trace))
         printf("caller %p memalign %zu, %zu -> %p\n", __GET_CALLER(), boundary, size, ptr);
 
@@ -93,6 +98,8 @@ void *calloc(size_t count, size_t size)
     void *ptr = cmpct_alloc(realsize);
     if (likely(ptr))
         memset(ptr, 0, realsize);
+    if (unlikely(heap_profile_sampling))
+        heap_profile_alloc(ptr, realsize);
     if (unlikely(heap_trace))
         printf("caller %p calloc %zu, %zu -> %p\n", __GET_CALLER(), count, size, ptr);
     return ptr;
@@ -105,6 +112,14 @@ void *realloc(void *ptr, size_t size)
     LTRACEF("ptr %p, size %zu\n", ptr, size);
 
     void *ptr2 = cmpct_realloc(ptr, size);
+    if (unlikely(heap_profile_tracking) && ptr2 != ptr) {
+        // A moved or freed block counts as freeing the old allocation and,
+        // possibly, sampling a new one.
+        if (ptr2 || size == 0)
+            heap_profile_free(ptr);
+        if (heap_profile_sampling)
+            heap_profile_alloc(ptr2, size);
+    }
     if (unlikely(heap_trace))
         printf("caller %p realloc %p, %zu -> %p\n", __GET_CALLER(), ptr, size, ptr2);
 
@@ -122,6 +137,8 @@ void free(void *ptr)
     LTRACEF("ptr %p\n", ptr);
     if (unlikely(heap_trace))
         printf("caller %p free %p\n", __GET_CALLER(), ptr);
+    if (unlikely(heap_profile_tracking))
+        heap_profile_free(ptr);
 
     cmpct_free(ptr);
 }
@@ -178,6 +195,42 @@ STATIC_COMMAND_START
 STATIC_COMMAND_MASKED("heap", "heap debug commands", &cmd_heap, CMD_AVAIL_ALWAYS)
 STATIC_COMMAND_END(heap);
 
+static int cmd_heap_profile(int argc, const cmd_args *argv)
+{
+    if (strcmp(argv[0].str, "start") == 0) {
+        zx_status_t status = heap_profile_start((argc >= 2) ? argv[1].u : 0);
+        if (status != ZX_OK)
+            printf("failed to start heap profile: %d\n", status);
+    } else if (strcmp(argv[0].str, "stop") == 0) {
+        heap_profile_stop();
+    } else if (strcmp(argv[0].str, "reset") == 0) {
+        if (heap_profile_reset() != ZX_OK)
+            printf("stop the heap profile first\n");
+    } else if (strcmp(argv[0].str, "stats") == 0) {
+        heap_profile_dump_stats();
+    } else if (strcmp(argv[0].str, "dump") == 0) {
+        // The profile can grow between sizing and formatting it; retry.
+        for (;;) {
+            size_t len = heap_profile_format(NULL, 0) + 1;
+            char *buf = (char *)malloc(len);
+            if (!buf) {
+                printf("no memory for heap profile\n");
+                return -1;
+            }
+            if (heap_profile_format(buf, len) < len) {
+                printf("%s", buf);
+                free(buf);
+                break;
+            }
+            free(buf);
+        }
+    } else {
+        printf("unrecognized profile command\n");
+        return -1;
+    }
+    return 0;
+}
+
 static int cmd_heap(int argc, const cmd_args *argv, uint32_t flags)
 {
     if (argc < 2) {
@@ -192,6 +245,8 @@ usage:
             printf("\t%s alloc <size> [alignment]\n", argv[0].str);
             printf("\t%s realloc <ptr> <size>\n", argv[0].str);
             printf("\t%s free <address>\n", argv[0].str);
+            printf("\t%s profile start [sample interval]\n", argv[0].str);
+            printf("\t%s profile stop|reset|stats|dump\n", argv[0].str);
         }
         return -1;
     }
@@ -219,6 +274,10 @@ usage:
         if (argc < 2) goto notenoughargs;
 
         free(argv[2].p);
+    } else if (!(flags & CMD_FLAG_PANIC) && strcmp(argv[1].str, "profile") == 0) {
+        if (argc < 3) goto notenoughargs;
+
+        return cmd_heap_profile(argc - 2, &argv[2]);
     } else {
         printf("unrecognized command\n");
         goto usage;
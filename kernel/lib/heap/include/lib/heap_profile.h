@@ -0,0 +1,58 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zircon/compiler.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// Sampling heap profiler.
+//
+// While sampling is on, roughly one allocation per |sample_interval| bytes
+// allocated is recorded along with its size and the kernel call stack that
+// made it. Samples are aggregated by call stack into a fixed size table, and
+// sampled allocations are tracked until they are freed so that the profile
+// reports both in-use and cumulative totals. The profile can be read out in
+// the text heap profile format understood by pprof.
+
+// The default average number of bytes between samples.
+#define HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL (512u * 1024u)
+
+// True while allocations are being sampled.
+extern bool heap_profile_sampling;
+
+// True once the profiler has been started, until it is reset. While set,
+// free() must report to the profiler so that sampled allocations are
+// retired.
+extern bool heap_profile_tracking;
+
+// Hooks called by the heap wrappers. Only call when the corresponding flag
+// above is set.
+void heap_profile_alloc(void *ptr, size_t size);
+void heap_profile_free(void *ptr);
+
+// Starts sampling. |sample_interval| of 0 selects the default.
+zx_status_t heap_profile_start(size_t sample_interval);
+
+// Stops sampling. Samples already taken are kept.
+void heap_profile_stop(void);
+
+// Discards all samples. Sampling must be stopped.
+zx_status_t heap_profile_reset(void);
+
+// Formats the profile into |buf|, writing at most |len| bytes including the
+// terminating NUL. Returns the length of the full profile, not counting the
+// NUL, which may be larger than |len|.
+size_t heap_profile_format(char *buf, size_t len);
+
+// Prints the profiler's state and table occupancy to the console.
+void heap_profile_dump_stats(void);
+
+__END_CDECLS
@@ -12,9 +12,13 @@ KERNEL_INCLUDES += $(LOCAL_DIR)/include
 MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS += \
+	$(LOCAL_DIR)/heap_profile.cpp \
+	$(LOCAL_DIR)/heap_profile_tests.cpp \
 	$(LOCAL_DIR)/heap_wrapper.cpp
 
 # use the cmpctmalloc heap implementation
 MODULE_DEPS := kernel/lib/heap/cmpctmalloc
 
+MODULE_DEPS += kernel/lib/unittest
+
 include make/module.mk
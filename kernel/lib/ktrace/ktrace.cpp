@@ -11,6 +11,7 @@
 
 #include <arch/ops.h>
 #include <arch/user_copy.h>
+#include <kernel/align.h>
 #include <kernel/cmdline.h>
 #include <vm/vm_aspace.h>
 #include <lib/ktrace.h>
@@ -18,6 +19,8 @@
 #include <zircon/thread_annotations.h>
 #include <object/thread_dispatcher.h>
 
+#include "ktrace_priv.h"
+
 #define ktrace_timestamp() current_ticks();
 #define ktrace_ticks_per_ms() (ticks_per_second() / 1000)
 
@@ -76,84 +79,197 @@ static void ktrace_report_probes(void) {
     }
 }
 
-typedef struct ktrace_state {
-    // where the next record will be written
-    int offset;
+static ktrace_state_t KTRACE_STATE;
 
-    // mask of groups we allow, 0 == tracing disabled
-    int grpmask;
+void* ktrace_reserve_in(ktrace_state_t* ks, ktrace_cpu_buffer_t* cb, uint32_t len) {
+    int64_t head = atomic_load_64(&cb->head);
+    for (;;) {
+        uint64_t off = (uint64_t)head;
+        // The buffer is a whole number of blocks, so a full buffer always
+        // ends exactly on a block boundary.
+        if (!ks->circular && off >= ks->cpu_bufsize) {
+            return nullptr;
+        }
+        uint32_t pos = (uint32_t)(off % kBlockSize);
+        if (pos + len <= kBlockSize) {
+            if (atomic_cmpxchg_64(&cb->head, &head, head + len)) {
+                return cb->buffer + (off % ks->cpu_bufsize);
+            }
+        } else {
+            // Move the head to the start of the next block and pad the
+            // bytes skipped, so that no byte of a block is left without
+            // a record. The padding is shorter than |len|, so its length
+            // fits in the tag.
+            if (atomic_cmpxchg_64(&cb->head, &head, head + (kBlockSize - pos))) {
+                *(uint32_t*)(cb->buffer + (off % ks->cpu_bufsize)) =
+                    KTRACE_TAG_PAD(kBlockSize - pos);
+                head += kBlockSize - pos;
+            }
+        }
+        // A failed exchange has reloaded |head|.
+    }
+}
+
+// Returns space for a |len| byte record in the current CPU's buffer.
+static void* ktrace_reserve(ktrace_state_t* ks, uint32_t len) {
+    // If the thread migrates after this, it writes to the old CPU's buffer,
+    // which is fine since the space is reserved atomically.
+    return ktrace_reserve_in(ks, &ks->cpu[arch_curr_cpu_num()], len);
+}
 
-    // total size of the trace buffer
-    uint32_t bufsize;
+// ktrace_read_user() presents the trace as one stream: the names buffer,
+// followed by the records of every CPU merged by timestamp. Reads are
+// almost always sequential, so the merge carries over from one call to the
+// next and only starts over when asked for an earlier offset or when the
+// buffers have been started, stopped or rewound since.
+static fbl::Mutex reader_lock;
+
+static struct ktrace_reader {
+    // what the buffers looked like when the reader was last reset
+    int generation;
+    uint32_t names_len;
+    uint32_t size;
+    uint64_t heads[SMP_MAX_CPUS];
+
+    KtraceStream streams[SMP_MAX_CPUS];
+
+    // the next record to hand out and its offset in the merged stream
+    const ktrace_header_t* record;
+    uint32_t offset;
+} KTRACE_READER TA_GUARDED(reader_lock);
+
+// Moves |rd| to the oldest record left in any stream.
+static void ktrace_reader_advance(ktrace_state_t* ks, ktrace_reader* rd) TA_REQ(reader_lock) {
+    if (rd->record) {
+        rd->offset += KTRACE_LEN(rd->record->tag);
+    }
+    KtraceStream* oldest = nullptr;
+    for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+        const ktrace_header_t* hdr = rd->streams[ix].Peek();
+        if (hdr && (!oldest || hdr->ts < oldest->Peek()->ts)) {
+            oldest = &rd->streams[ix];
+        }
+    }
+    rd->record = oldest ? oldest->Peek() : nullptr;
+    if (oldest) {
+        oldest->Next();
+    }
+}
 
-    // offset where tracing was stopped, 0 if tracing active
-    uint32_t marker;
+// Goes back to the start of the merged stream.
+static void ktrace_reader_rewind(ktrace_state_t* ks, ktrace_reader* rd) TA_REQ(reader_lock) {
+    for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+        rd->streams[ix].Init(ks, ix, rd->heads[ix]);
+    }
+    rd->record = nullptr;
+    rd->offset = rd->names_len;
+    ktrace_reader_advance(ks, rd);
+}
 
-    // raw trace buffer
-    uint8_t* buffer;
-} ktrace_state_t;
+// Takes a new snapshot of the buffers.
+static void ktrace_reader_reset(ktrace_state_t* ks, ktrace_reader* rd) TA_REQ(reader_lock) {
+    rd->generation = atomic_load(&ks->generation);
+    rd->names_len = atomic_load(&ks->names_offset);
+    for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+        rd->heads[ix] = atomic_load_64(&ks->cpu[ix].head);
+    }
+    ktrace_reader_rewind(ks, rd);
 
-static ktrace_state_t KTRACE_STATE;
+    uint64_t size = rd->names_len;
+    for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+        size += rd->streams[ix].Remaining();
+    }
+    rd->size = size > INT32_MAX ? INT32_MAX : (uint32_t)size;
+}
 
 int ktrace_read_user(void* ptr, uint32_t off, uint32_t len) {
     ktrace_state_t* ks = &KTRACE_STATE;
+    if (ks->cpu_bufsize == 0) {
+        return ptr == nullptr ? 0 : ZX_ERR_BAD_STATE;
+    }
 
-    // Buffer size is limited by the marker if set,
-    // otherwise limited by offset (last written point).
-    // Offset can end up pointing past the end, so clip
-    // it to the actual buffer size to be safe.
-    uint32_t max;
-    if (ks->marker) {
-        max = ks->marker;
-    } else {
-        max = ks->offset;
-        if (max > ks->bufsize) {
-            max = ks->bufsize;
-        }
+    fbl::AutoLock lock(&reader_lock);
+    ktrace_reader* rd = &KTRACE_READER;
+    if (rd->generation != atomic_load(&ks->generation) || ptr == nullptr) {
+        ktrace_reader_reset(ks, rd);
+    } else if (off >= rd->names_len && off < rd->offset) {
+        ktrace_reader_rewind(ks, rd);
     }
 
     // null read is a query for trace buffer size
     if (ptr == nullptr) {
-        return max;
+        return rd->size;
     }
 
     // constrain read to available buffer
-    if (off >= max) {
+    if (off >= rd->size) {
         return 0;
     }
-    if (len > (max - off)) {
-        len = max - off;
+    if (len > (rd->size - off)) {
+        len = rd->size - off;
     }
 
-    if (arch_copy_to_user(ptr, ks->buffer + off, len) != ZX_OK) {
-        return ZX_ERR_INVALID_ARGS;
+    uint8_t* dst = static_cast<uint8_t*>(ptr);
+    uint32_t done = 0;
+    while (done < len) {
+        const uint8_t* src;
+        uint32_t avail;
+        if (off < rd->names_len) {
+            src = ks->names + off;
+            avail = rd->names_len - off;
+        } else {
+            while (rd->record && off >= rd->offset + KTRACE_LEN(rd->record->tag)) {
+                ktrace_reader_advance(ks, rd);
+            }
+            if (!rd->record) {
+                break;
+            }
+            src = reinterpret_cast<const uint8_t*>(rd->record) + (off - rd->offset);
+            avail = rd->offset + KTRACE_LEN(rd->record->tag) - off;
+        }
+        uint32_t n = avail < len - done ? avail : len - done;
+        if (arch_copy_to_user(dst + done, src, n) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        done += n;
+        off += n;
     }
-    return len;
+    return done;
 }
 
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     ktrace_state_t* ks = &KTRACE_STATE;
     switch (action) {
     case KTRACE_ACTION_START:
+    case KTRACE_ACTION_START_CIRCULAR:
+        if (ks->cpu_bufsize == 0) {
+            return ZX_ERR_BAD_STATE;
+        }
         options = KTRACE_GRP_TO_MASK(options);
-        ks->marker = 0;
+        if (ks->circular != (action == KTRACE_ACTION_START_CIRCULAR)) {
+            // Records kept in one mode cannot be read back in the other.
+            for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+                atomic_store_64(&ks->cpu[ix].head, 0);
+            }
+            ks->circular = (action == KTRACE_ACTION_START_CIRCULAR);
+        }
+        atomic_add(&ks->generation, 1);
         atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
         ktrace_report_live_processes();
         ktrace_report_live_threads();
         break;
-    case KTRACE_ACTION_STOP: {
+    case KTRACE_ACTION_STOP:
+        ktrace_profiler_stop();
         atomic_store(&ks->grpmask, 0);
-        uint32_t n = ks->offset;
-        if (n > ks->bufsize) {
-            ks->marker = ks->bufsize;
-        } else {
-            ks->marker = n;
-        }
+        atomic_add(&ks->generation, 1);
         break;
-    }
     case KTRACE_ACTION_REWIND:
         // roll back to just after the metadata
-        atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+        for (uint32_t ix = 0; ix < ks->num_cpus; ix++) {
+            atomic_store_64(&ks->cpu[ix].head, 0);
+        }
+        atomic_store(&ks->names_offset, KTRACE_RECSIZE * 2);
+        atomic_add(&ks->generation, 1);
         ktrace_report_syscalls(kt_syscall_info);
         ktrace_report_probes();
         break;
@@ -172,6 +288,16 @@ zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
         ktrace_add_probe(probe);
         return probe->num;
     }
+    case KTRACE_ACTION_PROFILE_START:
+        // The samples only go to the buffer while the PROFILE group is
+        // being traced.
+        if (ks->cpu_bufsize == 0) {
+            return ZX_ERR_BAD_STATE;
+        }
+        return ktrace_profiler_start(options);
+    case KTRACE_ACTION_PROFILE_STOP:
+        ktrace_profiler_stop();
+        break;
     default:
         return ZX_ERR_INVALID_ARGS;
     }
@@ -185,6 +311,7 @@ void ktrace_init(unsigned level) {
 
     uint32_t mb = cmdline_get_uint32("ktrace.bufsize", KTRACE_DEFAULT_BUFSIZE);
     uint32_t grpmask = cmdline_get_uint32("ktrace.grpmask", KTRACE_DEFAULT_GRPMASK);
+    ks->circular = cmdline_get_bool("ktrace.circular", false);
 
     if (mb == 0) {
         dprintf(INFO, "ktrace: disabled\n");
@@ -193,19 +320,36 @@ void ktrace_init(unsigned level) {
 
     mb *= (1024*1024);
 
+    // A sixteenth of the space goes to names, the rest is shared out
+    // among the CPUs.
+    uint32_t num_cpus = arch_max_num_cpus();
+    uint32_t names_bufsize = ROUNDUP(mb / 16, PAGE_SIZE);
+    uint32_t cpu_bufsize = ROUNDDOWN((mb - names_bufsize) / num_cpus, kBlockSize);
+    if (cpu_bufsize < 2 * kBlockSize) {
+        dprintf(INFO, "ktrace: buffer too small for %u cpus\n", num_cpus);
+        return;
+    }
+    mb = names_bufsize + cpu_bufsize * num_cpus;
+
     zx_status_t status;
+    uint8_t* buffer;
     VmAspace* aspace = VmAspace::kernel_aspace();
-    if ((status = aspace->Alloc("ktrace", mb, (void**)&ks->buffer, 0, VmAspace::VMM_FLAG_COMMIT,
+    if ((status = aspace->Alloc("ktrace", mb, (void**)&buffer, 0, VmAspace::VMM_FLAG_COMMIT,
                                 ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE)) < 0) {
         dprintf(INFO, "ktrace: cannot alloc buffer %d\n", status);
         return;
     }
 
-    // The last packet written can overhang the end of the buffer,
-    // so we reduce the reported size by the max size of a record
-    ks->bufsize = mb - 256;
+    ks->names = buffer;
+    ks->names_bufsize = names_bufsize;
+    for (uint32_t ix = 0; ix < num_cpus; ix++) {
+        ks->cpu[ix].buffer = buffer + names_bufsize + ix * cpu_bufsize;
+    }
+    ks->num_cpus = num_cpus;
+    ks->cpu_bufsize = cpu_bufsize;
 
-    dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+    dprintf(INFO, "ktrace: buffer at %p (%u bytes, %u per cpu%s)\n", buffer, mb, cpu_bufsize,
+            ks->circular ? ", circular" : "");
 
     // register all static probes
     {
@@ -219,7 +363,7 @@ void ktrace_init(unsigned level) {
 
     // write metadata to the first two event slots
     uint64_t n = ktrace_ticks_per_ms();
-    ktrace_rec_32b_t* rec = (ktrace_rec_32b_t*) ks->buffer;
+    ktrace_rec_32b_t* rec = (ktrace_rec_32b_t*) ks->names;
     rec[0].tag = TAG_VERSION;
     rec[0].a = KTRACE_VERSION;
     rec[1].tag = TAG_TICKS_PER_MS;
@@ -227,7 +371,7 @@ void ktrace_init(unsigned level) {
     rec[1].b = (uint32_t)(n >> 32);
 
     // enable tracing
-    atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    atomic_store(&ks->names_offset, KTRACE_RECSIZE * 2);
     ktrace_report_syscalls(kt_syscall_info);
     ktrace_report_probes();
     atomic_store(&ks->grpmask, KTRACE_GRP_TO_MASK(grpmask));
@@ -246,12 +390,8 @@ void ktrace_tiny(uint32_t tag, uint32_t arg) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (tag & atomic_load(&ks->grpmask)) {
         tag = (tag & 0xFFFFFFF0) | 2;
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_HDRSIZE)) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
+        ktrace_header_t* hdr = (ktrace_header_t*) ktrace_reserve(ks, KTRACE_HDRSIZE);
+        if (hdr) {
             hdr->ts = ktrace_timestamp();
             hdr->tag = tag;
             hdr->tid = arg;
@@ -265,14 +405,11 @@ void* ktrace_open(uint32_t tag) {
         return nullptr;
     }
 
-    int off;
-    if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-        // if we arrive at the end, stop
-        atomic_store(&ks->grpmask, 0);
+    ktrace_header_t* hdr = (ktrace_header_t*) ktrace_reserve(ks, KTRACE_LEN(tag));
+    if (!hdr) {
         return nullptr;
     }
 
-    ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
     hdr->ts = ktrace_timestamp();
     hdr->tag = tag;
     hdr->tid = (uint32_t)get_current_thread()->user_tid;
@@ -287,18 +424,20 @@ static void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char*
         // set size to: sizeof(hdr) + len + 1, round up to multiple of 8
         tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
-            rec->tag = tag;
-            rec->id = id;
-            rec->arg = arg;
-            memcpy(rec->name, name, len);
-            rec->name[len] = 0;
-        }
+        // names are never overwritten, so drop them once the buffer is full
+        int off = atomic_load(&ks->names_offset);
+        do {
+            if (off + KTRACE_LEN(tag) > ks->names_bufsize) {
+                return;
+            }
+        } while (!atomic_cmpxchg(&ks->names_offset, &off, off + KTRACE_LEN(tag)));
+
+        ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->names + off);
+        rec->tag = tag;
+        rec->id = id;
+        rec->arg = arg;
+        memcpy(rec->name, name, len);
+        rec->name[len] = 0;
     }
 }
 
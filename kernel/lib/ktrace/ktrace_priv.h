@@ -0,0 +1,127 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/defines.h>
+#include <kernel/align.h>
+#include <lib/ktrace.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Records go to a buffer per CPU, so that writers on different CPUs do not
+// share a cache line. Each buffer is split into blocks and a record never
+// straddles two blocks: a writer whose record would cross into the next
+// block fills the rest of the current one with a padding record (group 0)
+// and tries again. That way every block starts with a record, which is what
+// lets a circular buffer be read back from its oldest intact block.
+static constexpr uint32_t kBlockSize = 4 * PAGE_SIZE;
+
+#define KTRACE_TAG_PAD(len) KTRACE_TAG(0, 0, len)
+
+typedef struct ktrace_cpu_buffer {
+    // total bytes reserved since the last rewind; the next record goes
+    // at (head % cpu_bufsize)
+    volatile int64_t head;
+
+    // raw trace buffer of cpu_bufsize bytes
+    uint8_t* buffer;
+} __CPU_ALIGN ktrace_cpu_buffer_t;
+
+typedef struct ktrace_state {
+    // mask of groups we allow, 0 == tracing disabled
+    int grpmask;
+
+    // when set, full buffers wrap around and overwrite their oldest
+    // blocks instead of stopping the trace
+    bool circular;
+
+    // bumped whenever the buffers are started, stopped or rewound, so that
+    // ktrace_read_user() knows to take a new snapshot of them
+    volatile int generation;
+
+    // Names and metadata are kept apart from the per-CPU records so that
+    // a circular trace never loses them. They are not timestamped, and
+    // once this buffer is full further names are dropped.
+    int names_offset;
+    uint32_t names_bufsize;
+    uint8_t* names;
+
+    // size of each per-CPU buffer, a multiple of kBlockSize
+    uint32_t cpu_bufsize;
+    uint32_t num_cpus;
+    ktrace_cpu_buffer_t cpu[SMP_MAX_CPUS];
+} ktrace_state_t;
+
+// Returns space for a |len| byte record in |cb|, or nullptr if the buffer
+// is full. Only that CPU stops recording when its buffer fills; the others
+// carry on until theirs do too or the trace is stopped.
+void* ktrace_reserve_in(ktrace_state_t* ks, ktrace_cpu_buffer_t* cb, uint32_t len);
+
+// Walks one CPU's records, oldest first, skipping padding.
+class KtraceStream {
+public:
+    // |head| is a snapshot of the CPU's head.
+    void Init(const ktrace_state_t* ks, uint32_t cpu, uint64_t head) {
+        ks_ = ks;
+        buffer_ = ks->cpu[cpu].buffer;
+        end_ = head;
+        if (!ks->circular || end_ <= ks->cpu_bufsize) {
+            pos_ = 0u;
+            if (end_ > ks->cpu_bufsize) {
+                end_ = ks->cpu_bufsize;
+            }
+        } else {
+            // The block being written has overwritten the oldest one, so
+            // start with the block after it.
+            pos_ = ROUNDDOWN(end_, kBlockSize) + kBlockSize - ks->cpu_bufsize;
+        }
+        SkipPadding();
+    }
+
+    // Returns the next record, or nullptr at the end of the stream.
+    const ktrace_header_t* Peek() const {
+        return pos_ < end_ ? Record() : nullptr;
+    }
+
+    void Next() {
+        pos_ += KTRACE_LEN(Record()->tag);
+        SkipPadding();
+    }
+
+    // Returns the number of bytes left in the stream, not counting padding.
+    uint64_t Remaining() const {
+        uint64_t bytes = 0u;
+        for (KtraceStream s = *this; s.Peek(); s.Next()) {
+            bytes += KTRACE_LEN(s.Record()->tag);
+        }
+        return bytes;
+    }
+
+private:
+    const ktrace_header_t* Record() const {
+        return reinterpret_cast<const ktrace_header_t*>(buffer_ + (pos_ % ks_->cpu_bufsize));
+    }
+
+    void SkipPadding() {
+        while (pos_ < end_) {
+            uint32_t tag = Record()->tag;
+            if (KTRACE_LEN(tag) == 0u || pos_ + KTRACE_LEN(tag) > end_) {
+                // A record that was reserved but never written.
+                pos_ = end_;
+            } else if (KTRACE_GROUP(tag) == 0u) {
+                pos_ += KTRACE_LEN(tag);
+            } else {
+                break;
+            }
+        }
+    }
+
+    const ktrace_state_t* ks_;
+    const uint8_t* buffer_;
+    uint64_t pos_;
+    uint64_t end_;
+};
@@ -0,0 +1,144 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "ktrace_priv.h"
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <kernel/atomic.h>
+#include <kernel/thread.h>
+#include <lib/ktrace.h>
+#include <string.h>
+#include <unittest.h>
+
+namespace {
+
+constexpr uint32_t kTestBlocks = 4;
+
+// Record sizes that do not divide the block size, so that records keep
+// landing on block boundaries.
+constexpr uint32_t kRecordSizes[] = {16, 24, 40, 120};
+
+struct TestBuffer {
+    fbl::unique_ptr<ktrace_state_t> ks;
+    fbl::unique_ptr<uint8_t[]> buffer;
+};
+
+bool init_buffer(TestBuffer* tb, bool circular) {
+    fbl::AllocChecker ac;
+    tb->ks.reset(new (&ac) ktrace_state_t{});
+    if (!ac.check()) {
+        return false;
+    }
+    tb->buffer.reset(new (&ac) uint8_t[kTestBlocks * kBlockSize]);
+    if (!ac.check()) {
+        return false;
+    }
+    memset(tb->buffer.get(), 0, kTestBlocks * kBlockSize);
+    tb->ks->circular = circular;
+    tb->ks->num_cpus = 1;
+    tb->ks->cpu_bufsize = kTestBlocks * kBlockSize;
+    tb->ks->cpu[0].buffer = tb->buffer.get();
+    return true;
+}
+
+// Writes record |n|, whose timestamp is |n|. Returns false if the buffer
+// is full.
+bool write_record(TestBuffer* tb, uint64_t n) {
+    uint32_t len = kRecordSizes[n % fbl::count_of(kRecordSizes)];
+    ktrace_header_t* hdr =
+        static_cast<ktrace_header_t*>(ktrace_reserve_in(tb->ks.get(), &tb->ks->cpu[0], len));
+    if (!hdr) {
+        return false;
+    }
+    hdr->tag = KTRACE_TAG(1, 1, len);
+    hdr->tid = 0;
+    hdr->ts = n;
+    return true;
+}
+
+// Checks that the stream holds records |first| to |last| in order.
+bool check_stream(TestBuffer* tb, uint64_t first, uint64_t last) {
+    BEGIN_TEST;
+    KtraceStream stream;
+    stream.Init(tb->ks.get(), 0, atomic_load_64(&tb->ks->cpu[0].head));
+    uint64_t expected = first;
+    for (const ktrace_header_t* hdr; (hdr = stream.Peek()) != nullptr; stream.Next()) {
+        if (hdr->ts != expected) {
+            EXPECT_EQ(expected, hdr->ts, "record missing from stream");
+            break;
+        }
+        EXPECT_EQ(kRecordSizes[expected % fbl::count_of(kRecordSizes)], KTRACE_LEN(hdr->tag),
+                  "record length");
+        expected++;
+    }
+    EXPECT_EQ(last + 1, expected, "stream ends early");
+    END_TEST;
+}
+
+bool fill_linear_buffer() {
+    BEGIN_TEST;
+    TestBuffer tb;
+    REQUIRE_TRUE(init_buffer(&tb, false), "no memory");
+
+    uint64_t n = 0;
+    while (write_record(&tb, n)) {
+        n++;
+    }
+    EXPECT_GT(n, (kTestBlocks - 1) * kBlockSize / 120, "buffer filled too soon");
+    EXPECT_EQ((int64_t)(kTestBlocks * kBlockSize), atomic_load_64(&tb.ks->cpu[0].head),
+              "full buffer ends on a block boundary");
+    EXPECT_FALSE(write_record(&tb, n), "full buffer takes no more records");
+    EXPECT_TRUE(check_stream(&tb, 0, n - 1), "");
+    END_TEST;
+}
+
+bool wrap_circular_buffer() {
+    BEGIN_TEST;
+    TestBuffer tb;
+    REQUIRE_TRUE(init_buffer(&tb, true), "no memory");
+
+    // Go round the buffer a few times.
+    uint64_t n = 0;
+    while (atomic_load_64(&tb.ks->cpu[0].head) < 3 * kTestBlocks * kBlockSize + kBlockSize / 2) {
+        REQUIRE_TRUE(write_record(&tb, n), "circular buffer never fills");
+        n++;
+    }
+
+    // Everything from the oldest intact block on is there.
+    KtraceStream stream;
+    stream.Init(tb.ks.get(), 0, atomic_load_64(&tb.ks->cpu[0].head));
+    REQUIRE_NONNULL(stream.Peek(), "empty stream");
+    uint64_t first = stream.Peek()->ts;
+    EXPECT_GT(n - first, (kTestBlocks - 1) * kBlockSize / 120, "too few records kept");
+    EXPECT_TRUE(check_stream(&tb, first, n - 1), "");
+    END_TEST;
+}
+
+// Runs the sampling profiler for a few periods, twice, to check that its
+// timers can be started and stopped.
+bool profiler_start_stop(void* context) {
+    BEGIN_TEST;
+    EXPECT_EQ(ZX_ERR_INVALID_ARGS, ktrace_profiler_start(1), "period too short");
+    for (int i = 0; i < 2; i++) {
+        REQUIRE_EQ(ZX_OK, ktrace_profiler_start(100), "start");
+        EXPECT_EQ(ZX_ERR_BAD_STATE, ktrace_profiler_start(100), "already running");
+        thread_sleep_relative(ZX_MSEC(2));
+        ktrace_profiler_stop();
+    }
+    // Stopping a stopped profiler does nothing.
+    ktrace_profiler_stop();
+    END_TEST;
+}
+
+} // namespace
+
+UNITTEST_START_TESTCASE(ktrace_tests)
+UNITTEST("fill a linear buffer across blocks", fill_linear_buffer)
+UNITTEST("wrap a circular buffer", wrap_circular_buffer)
+UNITTEST("start and stop the profiler", profiler_start_stop)
+UNITTEST_END_TESTCASE(ktrace_tests, "ktrace", "ktrace buffer and profiler tests", nullptr, nullptr);
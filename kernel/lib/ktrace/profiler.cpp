@@ -0,0 +1,218 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+// A statistical profiler which samples whatever each CPU is running from a
+// per-CPU timer and writes the samples to the ktrace buffer.
+//
+// The timer fires in interrupt context, so it can only walk the kernel
+// stack. When the interrupted thread is a user thread, it is also asked to
+// write its user stack on its way back to user mode, where faulting on the
+// user stack is safe. Readers pair that record with the thread's preceding
+// samples.
+
+#include <lib/ktrace.h>
+
+#include <arch/debugger.h>
+#include <arch/ops.h>
+#include <arch/user_copy.h>
+#include <err.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
+#include <kernel/align.h>
+#include <kernel/atomic.h>
+#include <kernel/mp.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <platform.h>
+#include <string.h>
+#include <zircon/syscalls/debug.h>
+#include <zircon/thread_annotations.h>
+
+namespace {
+
+constexpr uint32_t kDefaultPeriodUs = 1000;
+constexpr uint32_t kMinPeriodUs = 50;
+
+// A sample record holds the pid and the tid, followed by as many PCs as fit
+// in the largest ktrace record.
+constexpr size_t kMaxFrames =
+    (KTRACE_LEN(0xF) - KTRACE_HDRSIZE - 2 * sizeof(uint64_t)) / sizeof(uint64_t);
+
+struct profiler_cpu {
+    timer_t timer;
+
+    // Where the interrupt being handled on this CPU came from.
+    uintptr_t irq_pc;
+    uintptr_t irq_fp;
+    bool irq_from_user;
+} __CPU_ALIGN;
+
+profiler_cpu cpu_state[SMP_MAX_CPUS];
+
+// Read from interrupt context without the lock.
+volatile int profiler_active;
+zx_duration_t profiler_period;
+
+fbl::Mutex profiler_lock;
+bool profiler_running TA_GUARDED(profiler_lock);
+bool timers_initialized TA_GUARDED(profiler_lock);
+
+void write_sample(uint32_t tag, thread_t* thread, const uint64_t* frames, size_t num_frames) {
+    size_t size = KTRACE_HDRSIZE + (2 + num_frames) * sizeof(uint64_t);
+    auto rec = static_cast<uint64_t*>(ktrace_open((tag & 0xFFFFFFF0) | (uint32_t)(size >> 3)));
+    if (rec) {
+        // Kernel threads are named by address, as in KTHREAD_NAME.
+        rec[0] = thread->user_pid;
+        rec[1] = thread->user_tid ? thread->user_tid : (uint32_t)(uintptr_t)thread;
+        memcpy(&rec[2], frames, num_frames * sizeof(uint64_t));
+    }
+}
+
+// Follows the chain of frame pointers from |fp|, as long as it stays on
+// |thread|'s kernel stack and heads towards its base.
+size_t walk_kernel_stack(thread_t* thread, uintptr_t fp, uint64_t* frames, size_t max) {
+    if (!WITH_FRAME_POINTERS)
+        return 0;
+
+    const uintptr_t stack_base = reinterpret_cast<uintptr_t>(thread->stack);
+    const uintptr_t stack_top = stack_base + thread->stack_size;
+    size_t n = 0;
+    while (n < max && fp >= stack_base && fp <= stack_top - 2 * sizeof(uintptr_t) &&
+           (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        if (frame[1] == 0)
+            break;
+        frames[n++] = frame[1];
+        if (frame[0] <= fp)
+            break;
+        fp = frame[0];
+    }
+    return n;
+}
+
+void profiler_timer_callback(timer_t* timer, zx_time_t now, void* arg) {
+    if (!atomic_load(&profiler_active))
+        return;
+
+    profiler_cpu* cpu = &cpu_state[arch_curr_cpu_num()];
+    thread_t* thread = get_current_thread();
+
+    // The kernel stack of a sample taken in user mode is empty.
+    uint64_t frames[kMaxFrames];
+    size_t num_frames = 0;
+    if (!cpu->irq_from_user) {
+        frames[num_frames++] = cpu->irq_pc;
+        num_frames += walk_kernel_stack(thread, cpu->irq_fp, &frames[num_frames],
+                                        kMaxFrames - num_frames);
+    }
+    write_sample(TAG_PROFILE_SAMPLE, thread, frames, num_frames);
+
+    if (thread->user_thread) {
+        // Other CPUs only change the signals under the thread lock, which
+        // cannot be taken here, and at worst this loses the request.
+        atomic_or(reinterpret_cast<volatile int*>(&thread->signals), THREAD_SIGNAL_SAMPLE);
+    }
+
+    timer_set(timer, now + profiler_period, TIMER_SLACK_CENTER, profiler_period / 10,
+              profiler_timer_callback, nullptr);
+}
+
+void profiler_start_cpu(void* arg) {
+    profiler_cpu* cpu = &cpu_state[arch_curr_cpu_num()];
+    timer_set(&cpu->timer, current_time() + profiler_period, TIMER_SLACK_CENTER,
+              profiler_period / 10, profiler_timer_callback, nullptr);
+}
+
+void profiler_stop_cpu(void* arg) {
+    timer_cancel(&cpu_state[arch_curr_cpu_num()].timer);
+}
+
+} // namespace
+
+void ktrace_profiler_irq_enter(uintptr_t pc, uintptr_t fp, bool from_user) {
+    if (likely(!atomic_load(&profiler_active)))
+        return;
+    profiler_cpu* cpu = &cpu_state[arch_curr_cpu_num()];
+    cpu->irq_pc = pc;
+    cpu->irq_fp = fp;
+    cpu->irq_from_user = from_user;
+}
+
+void ktrace_profiler_sample_user(void) {
+    thread_t* thread = get_current_thread();
+
+#if ARCH_X86_64
+    zx_x86_64_general_regs_t regs;
+#elif ARCH_ARM64
+    zx_arm64_general_regs_t regs;
+#endif
+    uint32_t size = sizeof(regs);
+    if (arch_get_regset(thread, 0, &regs, &size) != ZX_OK)
+        return;
+
+    uint64_t frames[kMaxFrames];
+    size_t num_frames = 0;
+#if ARCH_X86_64
+    frames[num_frames++] = regs.rip;
+    uintptr_t fp = regs.rbp;
+#elif ARCH_ARM64
+    frames[num_frames++] = regs.pc;
+    uintptr_t fp = regs.r[29];
+#endif
+
+    // Reading the user stack may fault.
+    bool ints_disabled = arch_ints_disabled();
+    if (ints_disabled)
+        arch_enable_ints();
+    while (num_frames < kMaxFrames && fp != 0 && (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        uintptr_t frame[2];
+        if (arch_copy_from_user(frame, reinterpret_cast<const void*>(fp), sizeof(frame)) != ZX_OK)
+            break;
+        if (frame[1] == 0)
+            break;
+        frames[num_frames++] = frame[1];
+        if (frame[0] <= fp)
+            break;
+        fp = frame[0];
+    }
+    if (ints_disabled)
+        arch_disable_ints();
+
+    write_sample(TAG_PROFILE_USER_STACK, thread, frames, num_frames);
+}
+
+zx_status_t ktrace_profiler_start(uint32_t period_us) {
+    if (period_us == 0)
+        period_us = kDefaultPeriodUs;
+    if (period_us < kMinPeriodUs)
+        return ZX_ERR_INVALID_ARGS;
+
+    fbl::AutoLock lock(&profiler_lock);
+    if (profiler_running)
+        return ZX_ERR_BAD_STATE;
+    profiler_running = true;
+    if (!timers_initialized) {
+        for (profiler_cpu& cpu : cpu_state)
+            timer_init(&cpu.timer);
+        timers_initialized = true;
+    }
+
+    profiler_period = ZX_USEC(period_us);
+    atomic_store(&profiler_active, 1);
+    mp_sync_exec(MP_IPI_TARGET_ALL, 0, profiler_start_cpu, nullptr);
+    return ZX_OK;
+}
+
+void ktrace_profiler_stop(void) {
+    fbl::AutoLock lock(&profiler_lock);
+    if (!profiler_running)
+        return;
+    profiler_running = false;
+
+    // The callbacks stop re-arming their timers once they see this.
+    atomic_store(&profiler_active, 0);
+    mp_sync_exec(MP_IPI_TARGET_ALL, 0, profiler_stop_cpu, nullptr);
+}
@@ -9,6 +9,11 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS += \
-	$(LOCAL_DIR)/ktrace.cpp
+	$(LOCAL_DIR)/ktrace.cpp \
+	$(LOCAL_DIR)/profiler.cpp \
+	$(LOCAL_DIR)/ktrace_tests.cpp
+
+MODULE_DEPS += \
+	kernel/lib/unittest
 
 include make/module.mk
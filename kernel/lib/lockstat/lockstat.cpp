@@ -0,0 +1,302 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/lockstat.h>
+
+#include <assert.h>
+#include <err.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <inttypes.h>
+#include <kernel/atomic.h>
+#include <kernel/cmdline.h>
+#include <kernel/mutex.h>
+#include <lib/console.h>
+#include <lk/init.h>
+#include <platform.h>
+#include <string.h>
+#include <zircon/syscalls/object.h>
+
+// Locks have no names or classes of their own, so statistics are kept per
+// lock address. A lock that is destroyed shares its statistics with the
+// next lock at its address. Once the table is full, all other locks share
+// the overflow entry, which has a lock address of 0.
+//
+// Nothing here may take a lock, because it runs under every spin lock,
+// including the thread lock.
+//
+// The overflow entry's hold times are approximate, since its locks share
+// one acquisition time.
+
+namespace {
+
+constexpr size_t kNumEntries = 1024;
+constexpr size_t kMaxProbes = 32;
+constexpr size_t kNumCallers = ZX_LOCKSTAT_NUM_CALLERS;
+
+struct lockstat_entry {
+    uint64_t lock;
+    uint64_t type;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_ticks;
+    uint64_t max_wait_ticks;
+    uint64_t hold_ticks;
+    uint64_t max_hold_ticks;
+
+    // Written only by the lock's holder.
+    uint64_t acquired_at;
+
+    // The contending call sites, counted as the "space saving" algorithm
+    // does: a site that does not fit replaces the least counted one, and
+    // takes over its count, so the counts may overestimate. The frequent
+    // sites are the ones that stay.
+    uint64_t caller_pc[kNumCallers];
+    uint64_t caller_count[kNumCallers];
+};
+
+lockstat_entry entries[kNumEntries];
+lockstat_entry overflow_entry;
+
+lockstat_entry* get_entry(const void* lock, uint32_t type) {
+    const uint64_t key = reinterpret_cast<uintptr_t>(lock);
+    size_t ix = (key >> 3) * 0x9E3779B97F4A7C15ull >> (64 - 10);
+    static_assert(kNumEntries == 1u << 10, "");
+
+    for (size_t probe = 0; probe < kMaxProbes; probe++) {
+        lockstat_entry* entry = &entries[(ix + probe) % kNumEntries];
+        uint64_t current = atomic_load_u64_relaxed(&entry->lock);
+        if (current == key)
+            return entry;
+        if (current == 0) {
+            if (atomic_cmpxchg_u64(&entry->lock, &current, key)) {
+                entry->type = type;
+                return entry;
+            }
+            if (current == key)
+                return entry;
+        }
+    }
+    return &overflow_entry;
+}
+
+void update_max(uint64_t* max, uint64_t value) {
+    uint64_t current = atomic_load_u64_relaxed(max);
+    while (value > current && !atomic_cmpxchg_u64(max, &current, value)) {
+    }
+}
+
+void record_caller(lockstat_entry* entry, uintptr_t pc) {
+    size_t min_ix = 0;
+    uint64_t min_count = UINT64_MAX;
+    for (size_t i = 0; i < kNumCallers; i++) {
+        if (atomic_load_u64_relaxed(&entry->caller_pc[i]) == pc) {
+            atomic_add_u64(&entry->caller_count[i], 1);
+            return;
+        }
+        uint64_t count = atomic_load_u64_relaxed(&entry->caller_count[i]);
+        if (count < min_count) {
+            min_ix = i;
+            min_count = count;
+        }
+    }
+    // Losing the race to replace the slot just drops this sample.
+    uint64_t old_pc = atomic_load_u64_relaxed(&entry->caller_pc[min_ix]);
+    if (atomic_cmpxchg_u64(&entry->caller_pc[min_ix], &old_pc, pc))
+        atomic_add_u64(&entry->caller_count[min_ix], 1);
+}
+
+void record_acquire(lockstat_entry* entry, bool contended, uint64_t wait_ticks,
+                    uintptr_t caller) {
+    atomic_add_u64(&entry->acquisitions, 1);
+    if (contended) {
+        atomic_add_u64(&entry->contended, 1);
+        atomic_add_u64(&entry->wait_ticks, wait_ticks);
+        update_max(&entry->max_wait_ticks, wait_ticks);
+        record_caller(entry, caller);
+    }
+    entry->acquired_at = current_ticks();
+}
+
+void record_release(lockstat_entry* entry) {
+    // Locks taken before lockstat was enabled have no start time.
+    uint64_t acquired_at = entry->acquired_at;
+    if (acquired_at == 0)
+        return;
+    entry->acquired_at = 0;
+    uint64_t hold_ticks = current_ticks() - acquired_at;
+    atomic_add_u64(&entry->hold_ticks, hold_ticks);
+    update_max(&entry->max_hold_ticks, hold_ticks);
+}
+
+uint64_t ticks_to_ns(uint64_t ticks) {
+    const uint64_t tps = ticks_per_second();
+    return ticks / tps * ZX_SEC(1) + ticks % tps * ZX_SEC(1) / tps;
+}
+
+void fill_info(const lockstat_entry* entry, zx_info_lockstat_t* info) {
+    *info = {};
+    info->lock = atomic_load_u64_relaxed(const_cast<uint64_t*>(&entry->lock));
+    info->type = static_cast<uint32_t>(entry->type);
+    info->acquisitions = entry->acquisitions;
+    info->contended = entry->contended;
+    info->wait_ns = ticks_to_ns(entry->wait_ticks);
+    info->max_wait_ns = ticks_to_ns(entry->max_wait_ticks);
+    info->hold_ns = ticks_to_ns(entry->hold_ticks);
+    info->max_hold_ns = ticks_to_ns(entry->max_hold_ticks);
+    for (size_t i = 0; i < kNumCallers; i++) {
+        info->caller_pc[i] = entry->caller_pc[i];
+        info->caller_count[i] = entry->caller_count[i];
+    }
+}
+
+} // namespace
+
+#if ARCH_X86
+extern "C" void lockstat_patch_enabled(const CodePatchInfo* patch) {
+    // Turn "mov $0, %al" into "mov $1, %al".
+    DEBUG_ASSERT(patch->dest_size == 2);
+    DEBUG_ASSERT(patch->dest_addr[0] == 0xb0);
+    patch->dest_addr[1] = cmdline_get_bool("kernel.lockstat.enable", false);
+}
+#else
+bool lockstat_is_enabled;
+
+static void lockstat_init(uint level) {
+    lockstat_is_enabled = cmdline_get_bool("kernel.lockstat.enable", false);
+}
+
+LK_INIT_HOOK(lockstat, lockstat_init, LK_INIT_LEVEL_TARGET_EARLY);
+#endif
+
+void lockstat_spin_lock(spin_lock_t* lock) TA_NO_THREAD_SAFETY_ANALYSIS {
+    const uintptr_t caller = reinterpret_cast<uintptr_t>(__GET_CALLER());
+    uint64_t wait_ticks = 0;
+    bool contended = arch_spin_trylock(lock) != 0;
+    if (contended) {
+        const uint64_t start = current_ticks();
+        arch_spin_lock(lock);
+        wait_ticks = current_ticks() - start;
+    }
+    record_acquire(get_entry(lock, ZX_LOCKSTAT_TYPE_SPIN), contended, wait_ticks, caller);
+}
+
+int lockstat_spin_trylock(spin_lock_t* lock) TA_NO_THREAD_SAFETY_ANALYSIS {
+    int ret = arch_spin_trylock(lock);
+    if (ret == 0)
+        record_acquire(get_entry(lock, ZX_LOCKSTAT_TYPE_SPIN), false, 0, 0);
+    return ret;
+}
+
+void lockstat_spin_unlock(spin_lock_t* lock) TA_NO_THREAD_SAFETY_ANALYSIS {
+    record_release(get_entry(lock, ZX_LOCKSTAT_TYPE_SPIN));
+    arch_spin_unlock(lock);
+}
+
+void lockstat_mutex_acquired(mutex_t* m, bool contended, uint64_t wait_ticks, uintptr_t caller) {
+    record_acquire(get_entry(m, ZX_LOCKSTAT_TYPE_MUTEX), contended, wait_ticks, caller);
+}
+
+void lockstat_mutex_release(mutex_t* m) {
+    record_release(get_entry(m, ZX_LOCKSTAT_TYPE_MUTEX));
+}
+
+bool lockstat_read(size_t* cursor, zx_info_lockstat_t* info) {
+    for (; *cursor <= kNumEntries; ++*cursor) {
+        const lockstat_entry* entry = *cursor < kNumEntries ? &entries[*cursor] : &overflow_entry;
+        if (atomic_load_u64_relaxed(const_cast<uint64_t*>(&entry->acquisitions)) != 0) {
+            fill_info(entry, info);
+            ++*cursor;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void lockstat_reset(void) {
+    // Only the counts are cleared, so that the holders of locks still find
+    // their entries.
+    for (size_t i = 0; i <= kNumEntries; i++) {
+        lockstat_entry* entry = i < kNumEntries ? &entries[i] : &overflow_entry;
+        atomic_store_u64(&entry->acquisitions, 0);
+        atomic_store_u64(&entry->contended, 0);
+        atomic_store_u64(&entry->wait_ticks, 0);
+        atomic_store_u64(&entry->max_wait_ticks, 0);
+        atomic_store_u64(&entry->hold_ticks, 0);
+        atomic_store_u64(&entry->max_hold_ticks, 0);
+        for (size_t j = 0; j < kNumCallers; j++) {
+            atomic_store_u64(&entry->caller_count[j], 0);
+        }
+    }
+}
+
+static void lockstat_dump(size_t max_locks, bool by_hold) {
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<zx_info_lockstat_t[]> infos(new (&ac) zx_info_lockstat_t[kNumEntries + 1]);
+    if (!ac.check()) {
+        printf("lockstat: out of memory\n");
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i <= kNumEntries; i++) {
+        const lockstat_entry* entry = i < kNumEntries ? &entries[i] : &overflow_entry;
+        if (entry->acquisitions != 0)
+            fill_info(entry, &infos[n++]);
+    }
+    auto key = [by_hold](const zx_info_lockstat_t& info) {
+        return by_hold ? info.hold_ns : info.wait_ns;
+    };
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j > 0 && key(infos[j]) > key(infos[j - 1]); j--) {
+            zx_info_lockstat_t tmp = infos[j];
+            infos[j] = infos[j - 1];
+            infos[j - 1] = tmp;
+        }
+    }
+
+    printf("%-18s %-5s %12s %12s %14s %12s %14s %12s\n", "lock", "type", "acquired",
+           "contended", "wait us", "max wait us", "hold us", "max hold us");
+    for (size_t i = 0; i < n && i < max_locks; i++) {
+        const zx_info_lockstat_t& info = infos[i];
+        printf("%#18" PRIx64 " %-5s %12" PRIu64 " %12" PRIu64 " %14" PRIu64 " %12" PRIu64
+               " %14" PRIu64 " %12" PRIu64 "\n",
+               info.lock, info.type == ZX_LOCKSTAT_TYPE_SPIN ? "spin" : "mutex",
+               info.acquisitions, info.contended, info.wait_ns / 1000, info.max_wait_ns / 1000,
+               info.hold_ns / 1000, info.max_hold_ns / 1000);
+        for (size_t j = 0; j < kNumCallers; j++) {
+            if (info.caller_count[j] != 0) {
+                printf("    contended from %#" PRIx64 ": %" PRIu64 "\n",
+                       info.caller_pc[j], info.caller_count[j]);
+            }
+        }
+    }
+}
+
+static int cmd_lockstat(int argc, const cmd_args* argv, uint32_t flags) {
+    if (!lockstat_enabled()) {
+        printf("lockstat is off; boot with kernel.lockstat.enable=true\n");
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    if (argc >= 2 && !strcmp(argv[1].str, "reset")) {
+        lockstat_reset();
+        return ZX_OK;
+    }
+    if (argc >= 2 && strcmp(argv[1].str, "wait") && strcmp(argv[1].str, "hold")) {
+        printf("usage:\n");
+        printf("%s [wait|hold] [count] : the locks with the most wait or hold time\n",
+               argv[0].str);
+        printf("%s reset               : clear the statistics\n", argv[0].str);
+        return ZX_ERR_INVALID_ARGS;
+    }
+    bool by_hold = argc >= 2 && !strcmp(argv[1].str, "hold");
+    size_t count = argc >= 3 ? argv[2].u : 20;
+    lockstat_dump(count, by_hold);
+    return ZX_OK;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("lockstat", "lock contention statistics", &cmd_lockstat)
+STATIC_COMMAND_END(lockstat);
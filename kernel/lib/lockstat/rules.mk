@@ -0,0 +1,22 @@
+# Copyright 2018 The Fuchsia Authors
+#
+# Use of this source code is governed by a MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/lockstat.cpp
+
+MODULE_DEPS += \
+	kernel/lib/console \
+	kernel/lib/fbl
+
+ifeq ($(ARCH),x86)
+MODULE_DEPS += kernel/lib/code_patching
+endif
+
+include make/module.mk
@@ -0,0 +1,83 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <stdlib.h>
+
+#include "lib/mtrace.h"
+#include "trace.h"
+
+#include <fbl/unique_free_ptr.h>
+#include <lib/heap_profile.h>
+#include <zircon/mtrace.h>
+
+#define LOCAL_TRACE 0
+
+// Formats the heap profile into a freshly allocated buffer. The profile can
+// grow between sizing it and formatting it, so retry until it fits.
+static zx_status_t format_profile(fbl::unique_free_ptr<char>* out, size_t* out_len) {
+    for (;;) {
+        size_t len = heap_profile_format(nullptr, 0) + 1;
+        fbl::unique_free_ptr<char> buf(static_cast<char*>(malloc(len)));
+        if (!buf)
+            return ZX_ERR_NO_MEMORY;
+        size_t actual = heap_profile_format(buf.get(), len);
+        if (actual < len) {
+            *out = fbl::move(buf);
+            *out_len = actual + 1;
+            return ZX_OK;
+        }
+    }
+}
+
+zx_status_t mtrace_heap_control(uint32_t action, uint32_t options,
+                                user_inout_ptr<void> arg, uint32_t size) {
+    LTRACEF("action %u, options 0x%x, arg %p, size 0x%x\n",
+            action, options, arg.get(), size);
+
+    switch (action) {
+    case MTRACE_HEAP_START:
+        if (size != 0)
+            return ZX_ERR_INVALID_ARGS;
+        return heap_profile_start(options);
+
+    case MTRACE_HEAP_STOP:
+        if (options != 0 || size != 0)
+            return ZX_ERR_INVALID_ARGS;
+        heap_profile_stop();
+        return ZX_OK;
+
+    case MTRACE_HEAP_RESET:
+        if (options != 0 || size != 0)
+            return ZX_ERR_INVALID_ARGS;
+        return heap_profile_reset();
+
+    case MTRACE_HEAP_GET_PROFILE_SIZE: {
+        if (options != 0)
+            return ZX_ERR_INVALID_ARGS;
+        uint32_t profile_size;
+        if (size != sizeof(profile_size))
+            return ZX_ERR_INVALID_ARGS;
+        profile_size = static_cast<uint32_t>(heap_profile_format(nullptr, 0) + 1);
+        return arg.reinterpret<uint32_t>().copy_to_user(profile_size);
+    }
+
+    case MTRACE_HEAP_GET_PROFILE: {
+        if (options != 0)
+            return ZX_ERR_INVALID_ARGS;
+        fbl::unique_free_ptr<char> buf;
+        size_t len;
+        zx_status_t status = format_profile(&buf, &len);
+        if (status != ZX_OK)
+            return status;
+        if (len > size)
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        return arg.reinterpret<char>().copy_array_to_user(buf.get(), len);
+    }
+
+    default:
+        return ZX_ERR_INVALID_ARGS;
+    }
+}
@@ -22,6 +22,8 @@
 zx_status_t mtrace_control(uint32_t kind, uint32_t action, uint32_t options,
                            user_inout_ptr<void> arg, uint32_t size) {
     switch (kind) {
+    case MTRACE_KIND_HEAP:
+        return mtrace_heap_control(action, options, arg, size);
 #ifdef __x86_64__
     case MTRACE_KIND_IPM:
         return mtrace_ipm_control(action, options, arg, size);
@@ -10,6 +10,7 @@ MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS += \
 	$(LOCAL_DIR)/mtrace.cpp \
+	$(LOCAL_DIR)/mtrace-heap.cpp \
 	$(LOCAL_DIR)/mtrace-ipm.cpp \
 	$(LOCAL_DIR)/mtrace-ipt.cpp
 
@@ -0,0 +1,84 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <lib/user_copy/user_ptr.h>
+#include <zircon/types.h>
+
+// Walks an array of zx_iovec_t, already copied in from user space, as if the
+// buffers it describes were one contiguous user buffer. Each copy picks up
+// where the last one left off.
+class UserIovecCursor {
+public:
+    UserIovecCursor(const zx_iovec_t* vectors, size_t count)
+        : vectors_(vectors), count_(count) {}
+
+    // Sets |*total| to the combined capacity of the buffers. Returns false if
+    // that does not fit in a size_t.
+    static bool TotalCapacity(const zx_iovec_t* vectors, size_t count, size_t* total) {
+        size_t sum = 0u;
+        for (size_t i = 0; i < count; i++) {
+            if (vectors[i].capacity > SIZE_MAX - sum)
+                return false;
+            sum += vectors[i].capacity;
+        }
+        *total = sum;
+        return true;
+    }
+
+    // Copies |len| bytes from |src| into the next |len| bytes of the buffers.
+    zx_status_t CopyToUser(const void* src, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        return Consume(len, [&bytes](void* buffer, size_t chunk) {
+            zx_status_t status = make_user_out_ptr(buffer).copy_array_to_user(bytes, chunk);
+            bytes += chunk;
+            return status;
+        });
+    }
+
+    // Copies the next |len| bytes of the buffers into |dst|.
+    zx_status_t CopyFromUser(void* dst, size_t len) {
+        uint8_t* bytes = static_cast<uint8_t*>(dst);
+        return Consume(len, [&bytes](void* buffer, size_t chunk) {
+            zx_status_t status = make_user_in_ptr(static_cast<const void*>(buffer))
+                                     .copy_array_from_user(bytes, chunk);
+            bytes += chunk;
+            return status;
+        });
+    }
+
+private:
+    // Calls |fn(buffer, chunk)| for each run of the next |len| bytes that
+    // lies within a single buffer.
+    template <typename Fn>
+    zx_status_t Consume(size_t len, Fn fn) {
+        while (len > 0u) {
+            if (index_ == count_)
+                return ZX_ERR_OUT_OF_RANGE;
+            const zx_iovec_t& vec = vectors_[index_];
+            size_t chunk = vec.capacity - offset_;
+            if (chunk > len)
+                chunk = len;
+            if (chunk > 0u) {
+                zx_status_t status =
+                    fn(static_cast<uint8_t*>(vec.buffer) + offset_, chunk);
+                if (status != ZX_OK)
+                    return status;
+                offset_ += chunk;
+                len -= chunk;
+            }
+            if (offset_ == vec.capacity) {
+                index_++;
+                offset_ = 0u;
+            }
+        }
+        return ZX_OK;
+    }
+
+    const zx_iovec_t* const vectors_;
+    const size_t count_;
+    size_t index_ = 0u;
+    size_t offset_ = 0u;
+};
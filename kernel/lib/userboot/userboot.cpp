@@ -181,6 +181,7 @@ enum bootstrap_handle_index {
     BOOTSTRAP_JOB,
     BOOTSTRAP_VMAR_ROOT,
     BOOTSTRAP_CRASHLOG,
+    BOOTSTRAP_COUNTERS,
 #if ENABLE_ENTROPY_COLLECTOR_TEST
     BOOTSTRAP_ENTROPY_FILE,
 #endif
@@ -240,9 +241,12 @@ static fbl::unique_ptr<MessagePacket> prepare_bootstrap_message() {
         case BOOTSTRAP_CRASHLOG:
             info = PA_HND(PA_VMO_KERNEL_FILE, 0);
             break;
+        case BOOTSTRAP_COUNTERS:
+            info = PA_HND(PA_VMO_KERNEL_FILE, 1);
+            break;
 #if ENABLE_ENTROPY_COLLECTOR_TEST
         case BOOTSTRAP_ENTROPY_FILE:
-            info = PA_HND(PA_VMO_KERNEL_FILE, 1);
+            info = PA_HND(PA_VMO_KERNEL_FILE, 2);
             break;
 #endif
         case BOOTSTRAP_HANDLES:
@@ -325,6 +329,9 @@ static zx_status_t attempt_userboot() {
     if (status == ZX_OK)
         status = get_vmo_handle(crashlog_vmo, true, nullptr,
                                 &handles[BOOTSTRAP_CRASHLOG]);
+    if (status == ZX_OK)
+        status = get_vmo_handle(kcounters_get_vmo(), true, nullptr,
+                                &handles[BOOTSTRAP_COUNTERS]);
     if (status == ZX_OK)
         status = get_resource_handle(&handles[BOOTSTRAP_RESOURCE_ROOT]);
 
@@ -14,6 +14,9 @@
 #define VDSO_CONSTANTS_SIZE (4 * 4 + 2 * 8)
 #define VDSO_CONSTANTS_ALIGN 8
 
+#define VDSO_TIME_VALUES_SIZE (6 * 4 + 8)
+#define VDSO_TIME_VALUES_ALIGN 8
+
 #ifndef __ASSEMBLER__
 
 #include <stdint.h>
@@ -46,4 +49,32 @@ static_assert(VDSO_CONSTANTS_SIZE == sizeof(vdso_constants),
 static_assert(VDSO_CONSTANTS_ALIGN == alignof(vdso_constants),
               "Need to adjust VDSO_CONSTANTS_ALIGN");
 
+// This struct lets the vDSO compute zx_clock_get() results without
+// entering the kernel.  Unlike vdso_constants, the kernel can change it
+// at any time, so it is alone on a page that is never copied into the
+// vDSO variants.  Readers take a snapshot under the sequence lock |seq|,
+// which is odd while the kernel is writing.
+struct vdso_time_values {
+    uint32_t seq;
+
+    // Nonzero if ZX_CLOCK_MONOTONIC is zx_ticks_get() multiplied by the
+    // 32.64 fixed point value ticks_to_mono_{l0,l32,l64}.  This never
+    // changes after boot.
+    uint32_t ticks_to_mono_valid;
+    uint32_t ticks_to_mono_l0;
+    uint32_t ticks_to_mono_l32;
+    uint32_t ticks_to_mono_l64;
+
+    uint32_t reserved;
+
+    // The offset of ZX_CLOCK_UTC from ZX_CLOCK_MONOTONIC, as last set by
+    // zx_clock_adjust().
+    int64_t utc_offset;
+};
+
+static_assert(VDSO_TIME_VALUES_SIZE == sizeof(vdso_time_values),
+              "Need to adjust VDSO_TIME_VALUES_SIZE");
+static_assert(VDSO_TIME_VALUES_ALIGN == alignof(vdso_time_values),
+              "Need to adjust VDSO_TIME_VALUES_ALIGN");
+
 #endif // __ASSEMBLER__
@@ -10,6 +10,7 @@
 #include <vm/vm_object.h>
 
 class VmMapping;
+struct vdso_time_values;
 
 class VDso : public RoDso {
 public:
@@ -24,6 +25,10 @@ public:
         return instance_->RoDso::valid_code_mapping(vmo_offset, size);
     }
 
+    // Publish the offset of ZX_CLOCK_UTC from ZX_CLOCK_MONOTONIC to the
+    // vDSO's zx_clock_get().
+    static void SetUtcOffset(int64_t offset);
+
     // Given VmAspace::vdso_code_mapping_, return the vDSO base address or 0.
     static uintptr_t base_address(const fbl::RefPtr<VmMapping>& code_mapping);
 
@@ -73,4 +78,7 @@ private:
         static_cast<size_t>(Variant::COUNT) - 1];
 
     static const VDso* instance_;
+
+    // The kernel's mapping of the vDSO's time values page.
+    static vdso_time_values* time_values_;
 };
@@ -10,6 +10,8 @@
 #include <fbl/alloc_checker.h>
 #include <fbl/type_support.h>
 #include <kernel/cmdline.h>
+#include <kernel/spinlock.h>
+#include <lib/fixed_point.h>
 #include <object/handle.h>
 #include <platform.h>
 #include <vm/pmm.h>
@@ -202,6 +204,10 @@ void blacklist_##category##_syscalls(VDsoDynSymWindow& dynsym_window, \
 } // anonymous namespace
 
 const VDso* VDso::instance_ = NULL;
+vdso_time_values* VDso::time_values_ = NULL;
+
+// Serializes writers of time_values_.
+static spin_lock_t time_values_lock = SPIN_LOCK_INITIAL_VALUE;
 
 // Private constructor, can only be called by Create (below).
 VDso::VDso() : RoDso("vdso/full", vdso_image,
@@ -236,7 +242,9 @@ const VDso* VDso::Create() {
 
     // If ticks_per_second has not been calibrated, it will return 0. In this
     // case, use soft_ticks instead.
-    if (per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false)) {
+    const bool soft_ticks =
+        per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false);
+    if (soft_ticks) {
         // Make zx_ticks_per_second return nanoseconds per second.
         constants_window.data()->ticks_per_second = ZX_SEC(1);
 
@@ -245,6 +253,25 @@ const VDso* VDso::Create() {
         REDIRECT_SYSCALL(dynsym_window, zx_ticks_get, soft_ticks_get);
     }
 
+    // The time values are updated for as long as the system runs, so this
+    // window is never destroyed.
+    static_assert(sizeof(vdso_time_values) == VDSO_DATA_TIME_VALUES_SIZE,
+                  "gen-rodso-code.sh is suspect");
+    auto time_window = new (&ac) KernelVmoWindow<vdso_time_values>(
+        "vDSO time values", vdso->vmo()->vmo(), VDSO_DATA_TIME_VALUES);
+    ASSERT(ac.check());
+    time_values_ = time_window->data();
+
+    // With soft ticks, zx_ticks_get() is itself zx_clock_get(), so the
+    // vDSO must leave ZX_CLOCK_MONOTONIC to the kernel.
+    struct fp_32_64 ratio;
+    if (!soft_ticks && platform_get_ticks_to_time_ratio(&ratio)) {
+        time_values_->ticks_to_mono_l0 = ratio.l0;
+        time_values_->ticks_to_mono_l32 = ratio.l32;
+        time_values_->ticks_to_mono_l64 = ratio.l64;
+        time_values_->ticks_to_mono_valid = 1;
+    }
+
     for (size_t v = static_cast<size_t>(Variant::FULL) + 1;
          v < static_cast<size_t>(Variant::COUNT);
          ++v)
@@ -254,6 +281,22 @@ const VDso* VDso::Create() {
     return instance_;
 }
 
+// The vDSO reads the offset under the sequence lock, retrying if |seq| is
+// odd or changes while it reads.
+void VDso::SetUtcOffset(int64_t offset) {
+    DEBUG_ASSERT(time_values_);
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&time_values_lock, state);
+
+    uint32_t seq = time_values_->seq;
+    __atomic_store_n(&time_values_->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&time_values_->utc_offset, offset, __ATOMIC_RELAXED);
+    __atomic_store_n(&time_values_->seq, seq + 2, __ATOMIC_RELEASE);
+
+    spin_unlock_irqrestore(&time_values_lock, state);
+}
+
 uintptr_t VDso::base_address(const fbl::RefPtr<VmMapping>& code_mapping) {
     return code_mapping ? code_mapping->base() - VDSO_CODE_START : 0;
 }
@@ -13,6 +13,8 @@
 #include <trace.h>
 
 #include <kernel/event.h>
+#include <kernel/thread.h>
+#include <lib/counters.h>
 #include <platform.h>
 #include <object/handle.h>
 #include <object/message_packet.h>
@@ -29,6 +31,11 @@ using fbl::AutoLock;
 
 #define LOCAL_TRACE 0
 
+KCOUNTER(channel_msg_written_count, "kernel.channel.messages_written");
+KCOUNTER(channel_msg_read_count, "kernel.channel.messages_read");
+
+DEFINE_SLAB_CACHED_NEW_DELETE(ChannelDispatcher, "channel", 4096u)
+
 // static
 zx_status_t ChannelDispatcher::Create(fbl::RefPtr<Dispatcher>* dispatcher0,
                                       fbl::RefPtr<Dispatcher>* dispatcher1,
@@ -156,6 +163,7 @@ zx_status_t ChannelDispatcher::Read(uint32_t* msg_size,
 
     *msg = messages_.pop_front();
     message_count_--;
+    kcounter_add(channel_msg_read_count, 1u);
 
     if (messages_.is_empty())
         UpdateState(ZX_CHANNEL_READABLE, 0u);
@@ -163,6 +171,53 @@ zx_status_t ChannelDispatcher::Read(uint32_t* msg_size,
     return rv;
 }
 
+zx_status_t ChannelDispatcher::ReadMany(zx_channel_msg_t* limits, uint32_t count,
+                                        MessageList* msgs) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    if (messages_.is_empty())
+        return other_ ? ZX_ERR_SHOULD_WAIT : ZX_ERR_PEER_CLOSED;
+
+    uint32_t ix = 0;
+    for (; ix != count && !messages_.is_empty(); ++ix) {
+        const MessagePacket& front = messages_.front();
+        if (front.data_size() > limits[ix].num_bytes ||
+            front.num_handles() > limits[ix].num_handles) {
+            if (ix != 0)
+                break;
+            limits[0].num_bytes = front.data_size();
+            limits[0].num_handles = front.num_handles();
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        }
+        msgs->push_back(messages_.pop_front());
+        message_count_--;
+    }
+    kcounter_add(channel_msg_read_count, ix);
+
+    if (messages_.is_empty())
+        UpdateState(ZX_CHANNEL_READABLE, 0u);
+
+    return ZX_OK;
+}
+
+void ChannelDispatcher::Unread(MessageList* msgs) {
+    canary_.Assert();
+
+    if (msgs->is_empty())
+        return;
+
+    AutoLock lock(&lock_);
+    bool was_empty = messages_.is_empty();
+    while (!msgs->is_empty()) {
+        messages_.push_front(msgs->pop_back());
+        message_count_++;
+    }
+    if (was_empty)
+        UpdateState(0u, ZX_CHANNEL_READABLE);
+}
+
 zx_status_t ChannelDispatcher::Write(fbl::unique_ptr<MessagePacket> msg) {
     canary_.Assert();
 
@@ -184,6 +239,28 @@ zx_status_t ChannelDispatcher::Write(fbl::unique_ptr<MessagePacket> msg) {
     return ZX_OK;
 }
 
+zx_status_t ChannelDispatcher::WriteMany(MessageList* msgs) {
+    canary_.Assert();
+
+    fbl::RefPtr<ChannelDispatcher> other;
+    {
+        AutoLock lock(&lock_);
+        if (!other_) {
+            // As in Write(), keep the handles alive so that the caller can
+            // put them back into the process table.
+            for (auto& msg : *msgs)
+                msg.set_owns_handles(false);
+            return ZX_ERR_PEER_CLOSED;
+        }
+        other = other_;
+    }
+
+    if (other->WriteSelfMany(msgs) > 0)
+        thread_reschedule();
+
+    return ZX_OK;
+}
+
 zx_status_t ChannelDispatcher::Call(fbl::unique_ptr<MessagePacket> msg,
                                     zx_time_t deadline, bool* return_handles,
                                     fbl::unique_ptr<MessagePacket>* reply) {
@@ -216,8 +293,12 @@ zx_status_t ChannelDispatcher::Call(fbl::unique_ptr<MessagePacket> msg,
         waiters_.push_back(waiter);
     }
 
-    // (1) Write outbound message to opposing endpoint.
+    // (1) Write outbound message to opposing endpoint. We are about to
+    // block, so if this wakes a server thread let it run on this cpu
+    // rather than waking it elsewhere.
+    thread_handoff_begin();
     other->WriteSelf(fbl::move(msg));
+    thread_handoff_end();
 
     // Reuse the code from the half-call used for retrying a Call after thread
     // suspend.
@@ -263,6 +344,21 @@ int ChannelDispatcher::WriteSelf(fbl::unique_ptr<MessagePacket> msg) {
     canary_.Assert();
 
     AutoLock lock(&lock_);
+    return WriteSelfLocked(fbl::move(msg));
+}
+
+int ChannelDispatcher::WriteSelfMany(MessageList* msgs) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+    int woken = 0;
+    while (!msgs->is_empty())
+        woken += WriteSelfLocked(msgs->pop_front());
+    return woken;
+}
+
+int ChannelDispatcher::WriteSelfLocked(fbl::unique_ptr<MessagePacket> msg) {
+    kcounter_add(channel_msg_written_count, 1u);
 
     if (!waiters_.is_empty()) {
         // If the far side is waiting for replies to messages
@@ -274,8 +370,14 @@ int ChannelDispatcher::WriteSelf(fbl::unique_ptr<MessagePacket> msg) {
             // Remove waiter from list.
             if (waiter.get_txid() == txid) {
                 waiters_.erase(waiter);
+                // The caller is blocked in Call() waiting for exactly this
+                // reply, so hand it our cpu, the way Call() handed its cpu
+                // to us. Write() reschedules right after this returns.
+                thread_handoff_begin();
                 // we return how many threads have been woken up, or zero.
-                return waiter.Deliver(fbl::move(msg));
+                int woken = waiter.Deliver(fbl::move(msg));
+                thread_handoff_end();
+                return woken;
             }
         }
     }
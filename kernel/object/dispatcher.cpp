@@ -145,28 +145,70 @@ zx_status_t Dispatcher::user_signal(uint32_t clear_mask, uint32_t set_mask, bool
     return ZX_OK;
 }
 
-namespace {
+void Dispatcher::InsertObserverLocked(StateObserver* observer) {
+    const zx_signals_t watched = observer->watched_signals();
+
+    // Join the group that watches the same signals, or else claim an empty
+    // group, falling back to the last group when there is neither.
+    uint32_t index = kObserverGroups - 1u;
+    for (uint32_t ix = 0u; ix < kObserverGroups - 1u; ++ix) {
+        const ObserverGroup& group = observer_groups_[ix];
+        if (group.observers.is_empty()) {
+            if (index == kObserverGroups - 1u)
+                index = ix;
+        } else if (group.watched == watched) {
+            index = ix;
+            break;
+        }
+    }
+
+    ObserverGroup& group = observer_groups_[index];
+    group.watched |= watched;
+    group.observers.push_front(observer);
+    observer->observer_group_ = index;
+}
+
+StateObserver* Dispatcher::EraseObserverLocked(StateObserver* observer) {
+    ObserverGroup& group = observer_groups_[observer->observer_group_];
+    group.observers.erase(*observer);
+    if (group.observers.is_empty())
+        group.watched = 0u;
+    return observer;
+}
+
+template <typename Func>
+StateObserver::Flags Dispatcher::WalkGroupLocked(ObserverGroup* group,
+                                                 ObserverList* obs_to_remove, Func func) {
+    StateObserver::Flags flags = 0;
+    zx_signals_t watched = 0u;
+
+    for (auto it = group->observers.begin(); it != group->observers.end();) {
+        StateObserver* observer = it.CopyPointer();
+        ++it;
+        StateObserver::Flags it_flags = func(observer);
+        flags |= it_flags;
+        if (it_flags & StateObserver::kNeedRemoval) {
+            obs_to_remove->push_back(group->observers.erase(*observer));
+        } else {
+            watched |= observer->watched_signals();
+        }
+    }
+
+    // Having seen every observer, tighten the last group's mask.
+    group->watched = watched;
+    return flags;
+}
 
 template <typename Func>
-StateObserver::Flags CancelWithFunc(Dispatcher::ObserverList* observers,
-                                    fbl::Mutex* observer_lock, Func f) {
+StateObserver::Flags Dispatcher::CancelWithFunc(Func func) {
     StateObserver::Flags flags = 0;
 
     Dispatcher::ObserverList obs_to_remove;
 
     {
-        AutoLock lock(observer_lock);
-        for (auto it = observers->begin(); it != observers->end();) {
-            StateObserver::Flags it_flags = f(it.CopyPointer());
-            flags |= it_flags;
-            if (it_flags & StateObserver::kNeedRemoval) {
-                auto to_remove = it;
-                ++it;
-                obs_to_remove.push_back(observers->erase(to_remove));
-            } else {
-                ++it;
-            }
-        }
+        AutoLock lock(&lock_);
+        for (ObserverGroup& group : observer_groups_)
+            flags |= WalkGroupLocked(&group, &obs_to_remove, func);
     }
 
     while (!obs_to_remove.is_empty()) {
@@ -177,12 +219,10 @@ StateObserver::Flags CancelWithFunc(Dispatcher::ObserverList* observers,
     return flags & (~StateObserver::kNeedRemoval);
 }
 
-}  // namespace
-
 // Since this conditionally takes the dispatcher's |lock_|, based on
 // the type of Mutex (either fbl::Mutex or fbl::NullLock), the thread
 // safety analysis is unable to prove that the accesses to |signals_|
-// and to |observers_| are always protected.
+// and to |observer_groups_| are always protected.
 template <typename Mutex>
 void Dispatcher::AddObserverHelper(StateObserver* observer,
                                    const StateObserver::CountInfo* cinfo,
@@ -196,7 +236,7 @@ void Dispatcher::AddObserverHelper(StateObserver* observer,
 
         flags = observer->OnInitialize(signals_, cinfo);
         if (!(flags & StateObserver::kNeedRemoval))
-            observers_.push_front(observer);
+            InsertObserverLocked(observer);
     }
     if (flags & StateObserver::kNeedRemoval)
         observer->OnRemoved();
@@ -215,18 +255,28 @@ void Dispatcher::AddObserverLocked(StateObserver* observer, const StateObserver:
     AddObserverHelper(observer, cinfo, &mutex);
 }
 
-void Dispatcher::RemoveObserver(StateObserver* observer) {
+zx_signals_t Dispatcher::RemoveObserver(StateObserver* observer) {
     ZX_DEBUG_ASSERT(has_state_tracker());
 
     AutoLock lock(&lock_);
     DEBUG_ASSERT(observer != nullptr);
-    observers_.erase(*observer);
+    EraseObserverLocked(observer);
+    return signals_;
+}
+
+zx_status_t Dispatcher::PollSignals(zx_signals_t* signals) {
+    if (!has_state_tracker())
+        return ZX_ERR_NOT_SUPPORTED;
+
+    AutoLock lock(&lock_);
+    *signals = signals_;
+    return ZX_OK;
 }
 
 bool Dispatcher::Cancel(Handle* handle) {
     ZX_DEBUG_ASSERT(has_state_tracker());
 
-    StateObserver::Flags flags = CancelWithFunc(&observers_, &lock_, [handle](StateObserver* obs) {
+    StateObserver::Flags flags = CancelWithFunc([handle](StateObserver* obs) {
         return obs->OnCancel(handle);
     });
 
@@ -241,7 +291,7 @@ bool Dispatcher::Cancel(Handle* handle) {
 bool Dispatcher::CancelByKey(Handle* handle, const void* port, uint64_t key) {
     ZX_DEBUG_ASSERT(has_state_tracker());
 
-    StateObserver::Flags flags = CancelWithFunc(&observers_, &lock_, [handle, port, key](StateObserver* obs) {
+    StateObserver::Flags flags = CancelWithFunc([handle, port, key](StateObserver* obs) {
         return obs->OnCancelByKey(handle, port, key);
     });
 
@@ -358,16 +408,17 @@ StateObserver::Flags Dispatcher::UpdateInternalLocked(ObserverList* obs_to_remov
 
     StateObserver::Flags flags = 0;
 
-    for (auto it = observers_.begin(); it != observers_.end();) {
-        StateObserver::Flags it_flags = it->OnStateChange(signals);
-        flags |= it_flags;
-        if (it_flags & StateObserver::kNeedRemoval) {
-            auto to_remove = it;
-            ++it;
-            obs_to_remove->push_back(observers_.erase(to_remove));
-        } else {
-            ++it;
-        }
+    // Groups with no observer watching an asserted signal are skipped
+    // without visiting their observers.
+    for (ObserverGroup& group : observer_groups_) {
+        if (!(group.watched & signals))
+            continue;
+        flags |= WalkGroupLocked(&group, obs_to_remove, [signals](StateObserver* obs) {
+            // Only the last group can hold observers that watch other signals.
+            if (!(obs->watched_signals() & signals))
+                return StateObserver::Flags(0);
+            return obs->OnStateChange(signals);
+        });
     }
 
     // Filter out NeedRemoval flag because we processed that here
@@ -13,6 +13,8 @@
 
 constexpr uint32_t kUserSignalMask = ZX_EVENT_SIGNALED | ZX_USER_SIGNAL_ALL;
 
+DEFINE_SLAB_CACHED_NEW_DELETE(EventDispatcher, "event", 4096u)
+
 zx_status_t EventDispatcher::Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
                                     zx_rights_t* rights) {
     fbl::AllocChecker ac;
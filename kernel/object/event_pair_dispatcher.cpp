@@ -15,6 +15,8 @@
 
 constexpr uint32_t kUserSignalMask = ZX_EVENT_SIGNALED | ZX_USER_SIGNAL_ALL;
 
+DEFINE_SLAB_CACHED_NEW_DELETE(EventPairDispatcher, "eventpair", 4096u)
+
 zx_status_t EventPairDispatcher::Create(fbl::RefPtr<Dispatcher>* dispatcher0,
                                         fbl::RefPtr<Dispatcher>* dispatcher1,
                                         zx_rights_t* rights) {
@@ -12,9 +12,89 @@
 #include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
 #include <object/handle.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+#include <vm/vm_object_paged.h>
 
 using fbl::AutoLock;
 
+namespace {
+
+uint32_t load_acquire(const uint32_t* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void store_release(uint32_t* p, uint32_t value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+// A waiting flag is set and the ring then checked again, while the other
+// side updates the ring and then checks the flag. Sequentially consistent
+// ordering on both sides means at least one of them sees the other.
+void store_seq_cst(uint32_t* p, uint32_t value) {
+    __atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+uint32_t load_seq_cst(const uint32_t* p) {
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+bool take_flag(uint32_t* p) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(p, __ATOMIC_RELAXED) != 0u &&
+           __atomic_exchange_n(p, 0u, __ATOMIC_SEQ_CST) != 0u;
+}
+
+}  // namespace
+
+// static
+zx_status_t FifoDispatcher::SharedBuffer::Create(fbl::RefPtr<SharedBuffer>* out) {
+    fbl::AllocChecker ac;
+    auto buffer = fbl::AdoptRef(new (&ac) SharedBuffer());
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, ZX_FIFO_SHARED_VMO_SIZE,
+                                               &buffer->vmo_);
+    if (status != ZX_OK)
+        return status;
+
+    // The kernel reads and writes the rings through the physmap, so the
+    // pages must stay put for as long as the fifo exists.
+    status = buffer->vmo_->CommitRange(0, ZX_FIFO_SHARED_VMO_SIZE, nullptr);
+    if (status != ZX_OK)
+        return status;
+    status = buffer->vmo_->Pin(0, ZX_FIFO_SHARED_VMO_SIZE);
+    if (status != ZX_OK)
+        return status;
+    buffer->pinned_ = true;
+
+    auto lookup_fn = [](void* context, size_t offset, size_t index, paddr_t pa) {
+        static_cast<uint8_t**>(context)[index] = static_cast<uint8_t*>(paddr_to_physmap(pa));
+        return ZX_OK;
+    };
+    status = buffer->vmo_->Lookup(0, ZX_FIFO_SHARED_VMO_SIZE, 0, lookup_fn, buffer->pages_);
+    if (status != ZX_OK)
+        return status;
+
+    // Neither consumer has looked at its ring yet, so the first entries
+    // written in each direction must ring the doorbell.
+    for (uint32_t n = 0; n < 2; ++n)
+        buffer->ring(n)->consumer_waiting = 1u;
+
+    *out = fbl::move(buffer);
+    return ZX_OK;
+}
+
+FifoDispatcher::SharedBuffer::~SharedBuffer() {
+    if (pinned_)
+        vmo_->Unpin(0, ZX_FIFO_SHARED_VMO_SIZE);
+}
+
+zx_fifo_shared_ring_t* FifoDispatcher::SharedBuffer::ring(uint32_t n) const {
+    return reinterpret_cast<zx_fifo_shared_ring_t*>(pages_[0] + ZX_FIFO_SHARED_RING_OFFSET(n));
+}
+
 // static
 zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t options,
                                    fbl::RefPtr<Dispatcher>* dispatcher0,
@@ -28,21 +108,33 @@ zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t o
         ((count * elemsize) > kMaxSizeBytes)) {
         return ZX_ERR_OUT_OF_RANGE;
     }
+    if (options & ~ZX_FIFO_SHARED)
+        return ZX_ERR_INVALID_ARGS;
 
     fbl::AllocChecker ac;
-    auto data0 = fbl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-    if (!ac.check())
-        return ZX_ERR_NO_MEMORY;
-
-    auto fifo0 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, fbl::move(data0)));
-    if (!ac.check())
-        return ZX_ERR_NO_MEMORY;
+    fbl::RefPtr<SharedBuffer> shared;
+    fbl::unique_ptr<uint8_t[]> data0;
+    fbl::unique_ptr<uint8_t[]> data1;
+    if (options & ZX_FIFO_SHARED) {
+        zx_status_t status = SharedBuffer::Create(&shared);
+        if (status != ZX_OK)
+            return status;
+    } else {
+        data0.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return ZX_ERR_NO_MEMORY;
+        data1.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return ZX_ERR_NO_MEMORY;
+    }
 
-    auto data1 = fbl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
+    auto fifo0 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                        fbl::move(data0), shared, 0u));
     if (!ac.check())
         return ZX_ERR_NO_MEMORY;
 
-    auto fifo1 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, fbl::move(data1)));
+    auto fifo1 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                        fbl::move(data1), fbl::move(shared), 1u));
     if (!ac.check())
         return ZX_ERR_NO_MEMORY;
 
@@ -56,10 +148,12 @@ zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t o
 }
 
 FifoDispatcher::FifoDispatcher(uint32_t /*options*/, uint32_t count, uint32_t elem_size,
-                               fbl::unique_ptr<uint8_t[]> data)
+                               fbl::unique_ptr<uint8_t[]> data, fbl::RefPtr<SharedBuffer> shared,
+                               uint32_t endpoint)
     : Dispatcher(ZX_FIFO_WRITABLE),
       elem_count_(count), elem_size_(elem_size), mask_(count - 1),
-      peer_koid_(0u), head_(0u), tail_(0u), data_(fbl::move(data)) {
+      peer_koid_(0u), head_(0u), tail_(0u), data_(fbl::move(data)),
+      shared_(fbl::move(shared)), endpoint_(endpoint) {
 }
 
 FifoDispatcher::~FifoDispatcher() {
@@ -75,7 +169,12 @@ void FifoDispatcher::Init(fbl::RefPtr<FifoDispatcher> other) TA_NO_THREAD_SAFETY
 zx_status_t FifoDispatcher::user_signal(uint32_t clear_mask, uint32_t set_mask, bool peer) {
     canary_.Assert();
 
-    if ((set_mask & ~ZX_USER_SIGNAL_ALL) || (clear_mask & ~ZX_USER_SIGNAL_ALL))
+    // The peers of a shared fifo ring each other's doorbells by setting
+    // ZX_FIFO_READABLE and ZX_FIFO_WRITABLE themselves.
+    uint32_t allowed = ZX_USER_SIGNAL_ALL;
+    if (shared_)
+        allowed |= ZX_FIFO_READABLE | ZX_FIFO_WRITABLE;
+    if ((set_mask & ~allowed) || (clear_mask & ~allowed))
         return ZX_ERR_INVALID_ARGS;
 
     if (!peer) {
@@ -120,9 +219,26 @@ void FifoDispatcher::OnPeerZeroHandles() {
     UpdateState(ZX_FIFO_WRITABLE, ZX_FIFO_PEER_CLOSED);
 }
 
+zx_status_t FifoDispatcher::GetSharedVmo(fbl::RefPtr<VmObject>* vmo, uint32_t* endpoint) const {
+    canary_.Assert();
+
+    if (!shared_)
+        return ZX_ERR_NOT_SUPPORTED;
+    *vmo = shared_->vmo();
+    *endpoint = endpoint_;
+    return ZX_OK;
+}
+
 zx_status_t FifoDispatcher::WriteFromUser(user_in_ptr<const uint8_t> ptr, size_t len, uint32_t* actual) {
     canary_.Assert();
 
+    if (shared_) {
+        size_t count = len / elem_size_;
+        if (count == 0)
+            return ZX_ERR_OUT_OF_RANGE;
+        return WriteShared(ptr, count, actual);
+    }
+
     fbl::RefPtr<FifoDispatcher> other;
     {
         AutoLock lock(&lock_);
@@ -199,6 +315,9 @@ zx_status_t FifoDispatcher::ReadToUser(user_out_ptr<uint8_t> ptr, size_t bytelen
     if (count == 0)
         return ZX_ERR_OUT_OF_RANGE;
 
+    if (shared_)
+        return ReadShared(ptr, count, actual);
+
     AutoLock lock(&lock_);
 
     uint32_t old_tail = tail_;
@@ -249,3 +368,128 @@ zx_status_t FifoDispatcher::ReadToUser(user_out_ptr<uint8_t> ptr, size_t bytelen
     *actual = (tail_ - old_tail);
     return ZX_OK;
 }
+
+zx_status_t FifoDispatcher::WriteShared(user_in_ptr<const uint8_t> ptr, size_t count,
+                                        uint32_t* actual) {
+    AutoLock lock(&lock_);
+
+    if (!other_)
+        return ZX_ERR_PEER_CLOSED;
+
+    zx_fifo_shared_ring_t* ring = shared_->ring(endpoint_);
+    uint8_t* data = shared_->data(endpoint_);
+
+    uint32_t head = load_acquire(&ring->head);
+    uint32_t used = head - load_acquire(&ring->tail);
+    if (used > elem_count_)
+        return ZX_ERR_BAD_STATE;
+
+    if (used == elem_count_) {
+        // Go to sleep on ZX_FIFO_WRITABLE, unless the consumer made room
+        // before it could see that we want to be woken.
+        UpdateState(ZX_FIFO_WRITABLE, 0u);
+        store_seq_cst(&ring->producer_waiting, 1u);
+        used = head - load_seq_cst(&ring->tail);
+        if (used > elem_count_)
+            return ZX_ERR_BAD_STATE;
+        if (used == elem_count_)
+            return ZX_ERR_SHOULD_WAIT;
+        UpdateState(0u, ZX_FIFO_WRITABLE);
+    }
+
+    size_t avail = elem_count_ - used;
+    if (count > avail)
+        count = avail;
+
+    uint32_t new_head = head;
+    while (count > 0) {
+        uint32_t offset = (new_head & mask_);
+
+        // number of slots from target to end, inclusive
+        uint32_t n = elem_count_ - offset;
+
+        // number of slots we can actually copy
+        size_t to_copy = (count > n) ? n : count;
+
+        // Nothing has been published yet, so there is nothing to roll back.
+        zx_status_t status = ptr.copy_array_from_user(&data[offset * elem_size_],
+                                                      to_copy * elem_size_);
+        if (status != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+
+        new_head += static_cast<uint32_t>(to_copy);
+        count -= to_copy;
+        ptr = ptr.byte_offset(to_copy * elem_size_);
+    }
+
+    store_release(&ring->head, new_head);
+    if (take_flag(&ring->consumer_waiting))
+        other_->UpdateState(0u, ZX_FIFO_READABLE);
+
+    *actual = new_head - head;
+    return ZX_OK;
+}
+
+zx_status_t FifoDispatcher::ReadShared(user_out_ptr<uint8_t> ptr, size_t count,
+                                       uint32_t* actual) {
+    AutoLock lock(&lock_);
+
+    uint32_t peer_endpoint = endpoint_ ^ 1u;
+    zx_fifo_shared_ring_t* ring = shared_->ring(peer_endpoint);
+    const uint8_t* data = shared_->data(peer_endpoint);
+
+    uint32_t tail = load_acquire(&ring->tail);
+    uint32_t used = load_acquire(&ring->head) - tail;
+    if (used > elem_count_)
+        return ZX_ERR_BAD_STATE;
+
+    if (used == 0) {
+        // The mirror image of a full ring in WriteShared().
+        UpdateState(ZX_FIFO_READABLE, 0u);
+        store_seq_cst(&ring->consumer_waiting, 1u);
+        used = load_seq_cst(&ring->head) - tail;
+        if (used > elem_count_)
+            return ZX_ERR_BAD_STATE;
+        if (used == 0)
+            return ZX_ERR_SHOULD_WAIT;
+        UpdateState(0u, ZX_FIFO_READABLE);
+    }
+
+    if (count > used)
+        count = used;
+
+    uint32_t new_tail = tail;
+    while (count > 0) {
+        uint32_t offset = (new_tail & mask_);
+
+        // number of slots from target to end, inclusive
+        uint32_t n = elem_count_ - offset;
+
+        // number of slots we can actually copy
+        size_t to_copy = (count > n) ? n : count;
+
+        zx_status_t status = ptr.copy_array_to_user(&data[offset * elem_size_],
+                                                    to_copy * elem_size_);
+        if (status != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+
+        new_tail += static_cast<uint32_t>(to_copy);
+        count -= to_copy;
+        ptr = ptr.byte_offset(to_copy * elem_size_);
+    }
+
+    store_release(&ring->tail, new_tail);
+    if (take_flag(&ring->producer_waiting) && other_)
+        other_->UpdateState(0u, ZX_FIFO_WRITABLE);
+
+    // Like the classic fifo, stay readable exactly as long as entries remain.
+    if (new_tail - tail == used) {
+        UpdateState(ZX_FIFO_READABLE, 0u);
+        store_seq_cst(&ring->consumer_waiting, 1u);
+        if (load_seq_cst(&ring->head) != new_tail)
+            UpdateState(0u, ZX_FIFO_READABLE);
+    }
+
+    *actual = new_tail - tail;
+    return ZX_OK;
+}
@@ -26,7 +26,18 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (auto& bucket : buckets_) {
+        AutoLock lock(&bucket.lock);
+        DEBUG_ASSERT(bucket.table.is_empty());
+    }
+}
+
+FutexContext::Bucket* FutexContext::BucketFor(uintptr_t futex_key) {
+    // Futexes are often packed next to each other (or share a cache line
+    // with the data they protect), so mix the address bits rather than
+    // using the low bits directly.
+    uint64_t hash = static_cast<uint64_t>(futex_key >> 2) * 0x9e3779b97f4a7c15ull;
+    return &buckets_[(hash >> 32) % kNumBuckets];
 }
 
 zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int current_value, zx_time_t deadline) {
@@ -44,16 +55,17 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    lock_.Acquire();
+    Bucket* bucket = BucketFor(futex_key);
+    bucket->lock.Acquire();
 
     int value;
     zx_status_t result = value_ptr.copy_from_user(&value);
     if (result != ZX_OK) {
-        lock_.Release();
+        bucket->lock.Release();
         return result;
     }
     if (value != current_value) {
-        lock_.Release();
+        bucket->lock.Release();
         return ZX_ERR_BAD_STATE;
     }
 
@@ -62,10 +74,11 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     node->set_hash_key(futex_key);
     node->SetAsSingletonList();
 
-    QueueNodesLocked(node);
+    QueueNodesLocked(bucket, node);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
-    result = node->BlockThread(&lock_, deadline);
+    // Block current thread.  This releases the bucket lock and does not
+    // reacquire it.
+    result = node->BlockThread(&bucket->lock, deadline);
     if (result == ZX_OK) {
         DEBUG_ASSERT(!node->IsInQueue());
         // All the work necessary for removing us from the hash table was done by FutexWake()
@@ -78,8 +91,7 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    AutoLock lock(&lock_);
-    if (UnqueueNodeLocked(node)) {
+    if (UnqueueNode(node)) {
         return result;
     }
     // The current thread was not found on the wait queue.  This means
@@ -114,22 +126,28 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    Bucket* bucket = BucketFor(futex_key);
+    AutoLock lock(&bucket->lock);
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = bucket->table.erase(futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
     }
     DEBUG_ASSERT(node->GetKey() == futex_key);
 
+    // The woken threads are about to look at the futex and whatever it
+    // protects, which we most likely just wrote, so let them stay on this
+    // cpu if it is where they last ran.
     bool any_woken = false;
+    thread_wake_affine_begin();
     FutexNode* remaining_waiters =
         FutexNode::WakeThreads(node, count, futex_key, &any_woken);
+    thread_wake_affine_end();
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        bucket->table.insert(remaining_waiters);
     }
 
     if (any_woken) {
@@ -141,37 +159,57 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
 }
 
 zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t wake_count, int current_value,
-                                       user_in_ptr<const int> requeue_ptr, uint32_t requeue_count) {
+                                       user_in_ptr<const int> requeue_ptr, uint32_t requeue_count)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACE_ENTRY;
 
     if ((requeue_ptr.get() == nullptr) && requeue_count)
         return ZX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
-
-    int value;
-    zx_status_t result = wake_ptr.copy_from_user(&value);
-    if (result != ZX_OK) return result;
-    if (value != current_value) return ZX_ERR_BAD_STATE;
-
     uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
     uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
     if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
     if (wake_key % sizeof(int) || requeue_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
+    // Requeued nodes move between the two futexes' buckets, so both locks
+    // are needed. They are always taken in address order to avoid deadlock
+    // with a concurrent requeue in the other direction.
+    Bucket* wake_bucket = BucketFor(wake_key);
+    Bucket* requeue_bucket = BucketFor(requeue_key);
+    Bucket* first = wake_bucket < requeue_bucket ? wake_bucket : requeue_bucket;
+    Bucket* second = wake_bucket < requeue_bucket ? requeue_bucket : wake_bucket;
+    first->lock.Acquire();
+    if (second != first)
+        second->lock.Acquire();
+    auto release_locks = [first, second]() TA_NO_THREAD_SAFETY_ANALYSIS {
+        if (second != first)
+            second->lock.Release();
+        first->lock.Release();
+    };
+
+    int value;
+    zx_status_t result = wake_ptr.copy_from_user(&value);
+    if (result != ZX_OK || value != current_value) {
+        release_locks();
+        return result != ZX_OK ? result : ZX_ERR_BAD_STATE;
+    }
+
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
-    // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    // nodes below, because operations on the bucket tables look at the
+    // GetKey field of the list head nodes for wake_key and requeue_key.
+    FutexNode* node = wake_bucket->table.erase(wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
+        release_locks();
         return ZX_OK;
     }
 
     bool any_woken = false;
     if (wake_count > 0) {
+        thread_wake_affine_begin();
         node = FutexNode::WakeThreads(node, wake_count, wake_key, &any_woken);
+        thread_wake_affine_end();
     }
 
     // node is now the head of wake_ptr futex after possibly removing some threads to wake
@@ -184,26 +222,25 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            QueueNodesLocked(requeue_bucket, requeue_head);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        wake_bucket->table.insert(node);
     }
 
-    if (any_woken) {
-        lock.release();
+    release_locks();
+    if (any_woken)
         thread_reschedule();
-    }
 
     return ZX_OK;
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.IsHeld());
+void FutexContext::QueueNodesLocked(Bucket* bucket, FutexNode* head) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
 
     FutexNode::HashTable::iterator iter;
 
@@ -211,29 +248,37 @@ void FutexContext::QueueNodesLocked(FutexNode* head) {
     // succeeds, then the current thread is first to block on this futex and we
     // are finished.  If the insert fails, then there is already a thread
     // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    if (!bucket->table.insert_or_find(head, &iter))
         iter->AppendList(head);
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.IsHeld());
-
-    if (!node->IsInQueue())
-        return false;
-
-    // Note: When UnqueueNode() is called from FutexWait(), it might be
-    // tempting to reuse the futex key that was passed to FutexWait().
-    // However, that could be out of date if the thread was requeued by
-    // FutexRequeue(), so we need to re-get the hash table key here.
-    uintptr_t futex_key = node->GetKey();
-
-    FutexNode* old_head = futex_table_.erase(futex_key);
-    DEBUG_ASSERT(old_head);
-    FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
-    if (new_head)
-        futex_table_.insert(new_head);
-    return true;
+bool FutexContext::UnqueueNode(FutexNode* node) {
+    for (;;) {
+        // Note: When UnqueueNode() is called from FutexWait(), it might be
+        // tempting to reuse the futex key that was passed to FutexWait().
+        // However, that could be out of date if the thread was requeued by
+        // FutexRequeue(), so we need to re-get the hash table key here.
+        uintptr_t futex_key = node->GetKey();
+        Bucket* bucket = BucketFor(futex_key);
+        AutoLock lock(&bucket->lock);
+
+        // The key can only change while both the old and the new futex's
+        // buckets are locked, so once it matches the bucket we hold it is
+        // stable. If a requeue moved the node before we got here, chase it.
+        if (node->GetKey() != futex_key)
+            continue;
+
+        if (!node->IsInQueue())
+            return false;
+
+        FutexNode* old_head = bucket->table.erase(futex_key);
+        DEBUG_ASSERT(old_head);
+        FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
+        if (new_head)
+            bucket->table.insert(new_head);
+        return true;
+    }
 }
@@ -6,8 +6,13 @@
 
 #include <object/handle.h>
 
+#include <arch/ops.h>
+#include <kernel/align.h>
+#include <kernel/auto_lock.h>
+#include <kernel/spinlock.h>
 #include <object/dispatcher.h>
 #include <fbl/arena.h>
+#include <fbl/atomic.h>
 #include <fbl/auto_lock.h>
 #include <fbl/mutex.h>
 #include <pow2.h>
@@ -46,6 +51,25 @@ static_assert(((3 << 30) ^ kHandleGenerationMask ^ kHandleIndexMask) ==
                   0xffffffffu,
               "Masks do not agree");
 
+// Each cpu keeps up to kSlotCacheSize free arena slots, and moves
+// kSlotCacheBatch at a time to or from the arena when it runs out or
+// overflows, so that creating and closing handles rarely takes
+// Handle::mutex_.
+constexpr size_t kSlotCacheSize = 32u;
+constexpr size_t kSlotCacheBatch = kSlotCacheSize / 2;
+
+struct SlotCache {
+    SpinLock lock;
+    size_t count TA_GUARDED(lock) = 0u;
+    void* slots[kSlotCacheSize] TA_GUARDED(lock);
+} __CPU_ALIGN;
+
+SlotCache slot_caches[SMP_MAX_CPUS];
+
+// The number of live handles. Arena::DiagnosticCount() also counts the
+// slots sitting in the caches.
+fbl::atomic<size_t> outstanding_handles(0u);
+
 }  // namespace
 
 fbl::Mutex Handle::mutex_;
@@ -58,7 +82,7 @@ void Handle::Init() TA_NO_THREAD_SAFETY_ANALYSIS {
 // Returns a new |base_value| based on the value stored in the free
 // arena slot pointed to by |addr|. The new value will be different
 // from the last |base_value| used by this slot.
-uint32_t Handle::GetNewBaseValue(void* addr) TA_REQ(mutex_) {
+uint32_t Handle::GetNewBaseValue(void* addr) {
     // Get the index of this slot within the arena.
     uint32_t handle_index = HandleToIndex(reinterpret_cast<Handle*>(addr));
     DEBUG_ASSERT((handle_index & ~kHandleIndexMask) == 0);
@@ -76,33 +100,109 @@ uint32_t Handle::GetNewBaseValue(void* addr) TA_REQ(mutex_) {
     return (handle_index | new_gen);
 }
 
+// Takes a free slot from the current cpu's cache, refilling the cache from
+// the arena if it is empty.
+void* Handle::AllocSlot() {
+    {
+        SlotCache& cache = slot_caches[arch_curr_cpu_num()];
+        AutoSpinLockIrqSave lock(&cache.lock);
+        if (likely(cache.count > 0u))
+            return cache.slots[--cache.count];
+    }
+
+    void* batch[kSlotCacheBatch];
+    size_t n = 0u;
+    {
+        AutoLock lock(&mutex_);
+        while (n < kSlotCacheBatch && (batch[n] = arena_.Alloc()) != nullptr)
+            ++n;
+        if (unlikely(n == 0u)) {
+            // The arena is exhausted, but other cpus may be holding on to
+            // free slots. Take them all back and try once more.
+            FlushSlotCaches();
+            batch[0] = arena_.Alloc();
+            if (batch[0] == nullptr)
+                return nullptr;
+            n = 1u;
+        }
+    }
+
+    // Keep the rest of the batch for later. We may have migrated to a cpu
+    // whose cache has filled up in the meantime; slots that do not fit go
+    // back to the arena.
+    {
+        SlotCache& cache = slot_caches[arch_curr_cpu_num()];
+        AutoSpinLockIrqSave lock(&cache.lock);
+        while (n > 1u && cache.count < kSlotCacheSize)
+            cache.slots[cache.count++] = batch[--n];
+    }
+    if (unlikely(n > 1u)) {
+        AutoLock lock(&mutex_);
+        while (n > 1u)
+            arena_.Free(batch[--n]);
+    }
+    return batch[0];
+}
+
+// Puts a free slot in the current cpu's cache, moving half of the cache
+// back to the arena if it is full.
+void Handle::FreeSlot(void* addr) {
+    void* batch[kSlotCacheBatch];
+    {
+        SlotCache& cache = slot_caches[arch_curr_cpu_num()];
+        AutoSpinLockIrqSave lock(&cache.lock);
+        if (likely(cache.count < kSlotCacheSize)) {
+            cache.slots[cache.count++] = addr;
+            return;
+        }
+        cache.count -= kSlotCacheBatch;
+        memcpy(batch, &cache.slots[cache.count], sizeof(batch));
+        cache.slots[cache.count++] = addr;
+    }
+
+    AutoLock lock(&mutex_);
+    for (size_t i = 0u; i < kSlotCacheBatch; ++i)
+        arena_.Free(batch[i]);
+}
+
+void Handle::FlushSlotCaches() {
+    for (auto& cache : slot_caches) {
+        // Arena::Free() may need to commit memory, so it can't be called
+        // with the cache's spinlock held.
+        void* slots[kSlotCacheSize];
+        size_t n;
+        {
+            AutoSpinLockIrqSave lock(&cache.lock);
+            n = cache.count;
+            memcpy(slots, cache.slots, n * sizeof(void*));
+            cache.count = 0u;
+        }
+        for (size_t i = 0u; i < n; ++i)
+            arena_.Free(slots[i]);
+    }
+}
+
 // Allocate space for a Handle from the arena, but don't instantiate the
 // object.  |base_value| gets the value for Handle::base_value_.  |what|
 // says whether this is allocation or duplication, for the error message.
 void* Handle::Alloc(const fbl::RefPtr<Dispatcher>& dispatcher,
                     const char* what, uint32_t* base_value) {
-    size_t outstanding_handles;
-    {
-        AutoLock lock(&mutex_);
-        void* addr = arena_.Alloc();
-        outstanding_handles = arena_.DiagnosticCount();
-        if (likely(addr)) {
-            if (outstanding_handles > kHighHandleCount) {
-                // TODO: Avoid calling this for every handle after
-                // kHighHandleCount; printfs are slow and we're
-                // holding the mutex.
-                printf("WARNING: High handle count: %zu handles\n",
-                       outstanding_handles);
-            }
-            dispatcher->increment_handle_count();
-            *base_value = GetNewBaseValue(addr);
-            return addr;
-        }
+    void* addr = AllocSlot();
+    if (unlikely(!addr)) {
+        printf("WARNING: Could not allocate %s handle (%zu outstanding)\n",
+               what, outstanding_handles.load(fbl::memory_order_relaxed));
+        return nullptr;
     }
 
-    printf("WARNING: Could not allocate %s handle (%zu outstanding)\n",
-           what, outstanding_handles);
-    return nullptr;
+    size_t count = outstanding_handles.fetch_add(1u, fbl::memory_order_relaxed) + 1u;
+    if (unlikely(count > kHighHandleCount)) {
+        // TODO: Avoid calling this for every handle after
+        // kHighHandleCount; printfs are slow.
+        printf("WARNING: High handle count: %zu handles\n", count);
+    }
+    dispatcher->increment_handle_count();
+    *base_value = GetNewBaseValue(addr);
+    return addr;
 }
 
 HandleOwner Handle::Make(fbl::RefPtr<Dispatcher> dispatcher,
@@ -174,12 +274,9 @@ void Handle::Delete() {
 
     TearDown();
 
-    bool zero_handles = false;
-    {
-        AutoLock lock(&mutex_);
-        zero_handles = disp->decrement_handle_count();
-        arena_.Free(this);
-    }
+    bool zero_handles = disp->decrement_handle_count();
+    outstanding_handles.fetch_sub(1u, fbl::memory_order_relaxed);
+    FreeSlot(this);
 
     if (zero_handles)
         disp->on_zero_handles();
@@ -189,27 +286,30 @@ void Handle::Delete() {
 }
 
 Handle* Handle::FromU32(uint32_t value) TA_NO_THREAD_SAFETY_ANALYSIS {
+    // Arena::in_range() does not need |mutex_|: arena slots stay mapped,
+    // so at worst we read a slot that is free or owned by another process,
+    // which the base_value and process_id checks reject.
     Handle* handle = IndexToHandle(value & kHandleIndexMask);
-    {
-        AutoLock lock(&mutex_);
-        if (unlikely(!arena_.in_range(handle)))
-            return nullptr;
-    }
+    if (unlikely(!arena_.in_range(handle)))
+        return nullptr;
     return likely(handle->base_value() == value) ? handle : nullptr;
 }
 
 uint32_t Handle::Count(const fbl::RefPtr<const Dispatcher>& dispatcher) {
-    // Handle::mutex_ also guards Dispatcher::handle_count_.
-    AutoLock lock(&mutex_);
     return dispatcher->current_handle_count();
 }
 
 size_t Handle::diagnostics::OutstandingHandles() {
-    AutoLock lock(&mutex_);
-    return arena_.DiagnosticCount();
+    return outstanding_handles.load(fbl::memory_order_relaxed);
 }
 
-void Handle::diagnostics::DumpTableInfo() {
+void Handle::diagnostics::DumpTableInfo() TA_NO_THREAD_SAFETY_ANALYSIS {
+    // Racy read of the cache sizes, good enough for diagnostics.
+    size_t cached = 0u;
+    for (const auto& cache : slot_caches)
+        cached += cache.count;
+    printf("per-cpu cached free handle slots: %zu\n", cached);
+
     AutoLock lock(&mutex_);
     arena_.Dump();
 }
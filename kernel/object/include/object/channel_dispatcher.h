@@ -11,6 +11,7 @@
 #include <kernel/event.h>
 #include <object/dispatcher.h>
 #include <object/message_packet.h>
+#include <object/slab_cache.h>
 
 #include <zircon/types.h>
 #include <fbl/canary.h>
@@ -22,10 +23,13 @@
 class ChannelDispatcher final : public Dispatcher {
 public:
     class MessageWaiter;
+    using MessageList = fbl::DoublyLinkedList<fbl::unique_ptr<MessagePacket>>;
 
     static zx_status_t Create(fbl::RefPtr<Dispatcher>* dispatcher0,
                               fbl::RefPtr<Dispatcher>* dispatcher1, zx_rights_t* rights);
 
+    DECLARE_SLAB_CACHED_NEW_DELETE();
+
     ~ChannelDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_CHANNEL; }
     bool has_state_tracker() const final { return true; }
@@ -45,8 +49,27 @@ public:
                      fbl::unique_ptr<MessagePacket>* msg,
                      bool may_disard);
 
+    // Batched Read(). Moves up to |count| messages into |msgs| under a single
+    // acquisition of the lock. Message i must fit within the |num_bytes| and
+    // |num_handles| of |limits[i]|; reading stops at the first message that
+    // does not. If that is the first message, its size is written back into
+    // |limits[0]| and ZX_ERR_BUFFER_TOO_SMALL is returned. Otherwise returns
+    // ZX_OK if at least one message was read.
+    zx_status_t ReadMany(zx_channel_msg_t* limits, uint32_t count, MessageList* msgs);
+
+    // Puts messages taken by ReadMany() that could not be handed to the
+    // caller back at the front of the queue, in order.
+    void Unread(MessageList* msgs);
+
     // Write to the opposing endpoint's message queue.
     zx_status_t Write(fbl::unique_ptr<MessagePacket> msg);
+
+    // Batched Write(). Queues all of |msgs| on the opposing endpoint under a
+    // single acquisition of its lock. On failure |msgs| is left untouched and
+    // the packets no longer own their handles, so the caller can put them
+    // back into the process.
+    zx_status_t WriteMany(MessageList* msgs);
+
     zx_status_t Call(fbl::unique_ptr<MessagePacket> msg,
                      zx_time_t deadline, bool* return_handles,
                      fbl::unique_ptr<MessagePacket>* reply);
@@ -93,7 +116,6 @@ public:
     };
 
 private:
-    using MessageList = fbl::DoublyLinkedList<fbl::unique_ptr<MessagePacket>>;
     using WaiterList = fbl::DoublyLinkedList<MessageWaiter*>;
 
     void RemoveWaiter(MessageWaiter* waiter);
@@ -101,6 +123,8 @@ private:
     ChannelDispatcher();
     void Init(fbl::RefPtr<ChannelDispatcher> other);
     int WriteSelf(fbl::unique_ptr<MessagePacket> msg);
+    int WriteSelfMany(MessageList* msgs);
+    int WriteSelfLocked(fbl::unique_ptr<MessagePacket> msg) TA_REQ(lock_);
     zx_status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
     void OnPeerZeroHandles();
 
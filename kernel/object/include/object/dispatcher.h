@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdint.h>
 
+#include <fbl/atomic.h>
 #include <fbl/canary.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_single_list.h>
@@ -72,21 +73,19 @@ public:
 
     zx_koid_t get_koid() const { return koid_; }
 
-    // Must be called under the handle table lock.
+    // Only called by Handle.
     void increment_handle_count() {
-        ++handle_count_;
+        handle_count_.fetch_add(1u, fbl::memory_order_relaxed);
     }
 
-    // Must be called under the handle table lock.
+    // Only called by Handle.
     // Returns true exactly when the handle count goes to zero.
     bool decrement_handle_count() {
-        --handle_count_;
-        return handle_count_ == 0u;
+        return handle_count_.fetch_sub(1u, fbl::memory_order_acq_rel) == 1u;
     }
 
-    // Must be called under the handle table lock.
     uint32_t current_handle_count() const {
-        return handle_count_;
+        return handle_count_.load(fbl::memory_order_relaxed);
     }
 
     // The following are only to be called when |has_state_tracker| reports true.
@@ -97,8 +96,12 @@ public:
     void AddObserver(StateObserver* observer, const StateObserver::CountInfo* cinfo);
     void AddObserverLocked(StateObserver* observer, const StateObserver::CountInfo* cinfo) TA_REQ(lock_);
 
-    // Remove an observer (which must have been added).
-    void RemoveObserver(StateObserver* observer);
+    // Remove an observer (which must have been added). Returns the signals asserted at the time.
+    zx_signals_t RemoveObserver(StateObserver* observer);
+
+    // Reads the signals currently asserted, which lets a wait that is already satisfied skip
+    // adding an observer. Returns ZX_ERR_NOT_SUPPORTED if the object cannot be waited on.
+    zx_status_t PollSignals(zx_signals_t* signals);
 
     // Called when observers of the handle's state (e.g., waits on the handle) should be
     // "cancelled", i.e., when a handle (for the object that owns this StateTracker) is being
@@ -180,8 +183,33 @@ private:
     // Returns flag kHandled if one of the observers have been signaled.
     StateObserver::Flags UpdateInternalLocked(ObserverList* obs_to_remove, zx_signals_t signals) TA_REQ(lock_);
 
+    // Observers are split into a few groups so that a state change only visits the observers
+    // of groups that watch one of the asserted signals. Each group but the last holds observers
+    // that watch exactly the same signals, and the last takes any observer that does not fit.
+    static constexpr uint32_t kObserverGroups = 4u;
+
+    struct ObserverGroup {
+        // The union of the signals watched by |observers|. For the last group this may be a
+        // superset until the group is next walked.
+        zx_signals_t watched = 0u;
+        ObserverList observers;
+    };
+
+    void InsertObserverLocked(StateObserver* observer) TA_REQ(lock_);
+    StateObserver* EraseObserverLocked(StateObserver* observer) TA_REQ(lock_);
+
+    // Calls |func| on each observer in |group|, moving those that ask for removal
+    // to |obs_to_remove|. Returns the union of the flags |func| returned.
+    template <typename Func>
+    StateObserver::Flags WalkGroupLocked(ObserverGroup* group, ObserverList* obs_to_remove,
+                                         Func func) TA_REQ(lock_);
+
+    // The common implementation of Cancel and CancelByKey.
+    template <typename Func>
+    StateObserver::Flags CancelWithFunc(Func func);
+
     const zx_koid_t koid_;
-    uint32_t handle_count_;
+    fbl::atomic<uint32_t> handle_count_;
 
     // TODO(kulakowski) Make signals_ TA_GUARDED(lock_).
     // Right now, signals_ is almost entirely accessed under the
@@ -192,8 +220,8 @@ private:
     // or the more specific object lock.
     zx_signals_t signals_;
 
-    // Active observers are elements in |observers_|.
-    ObserverList observers_ TA_GUARDED(lock_);
+    // Active observers are elements of the lists in |observer_groups_|.
+    ObserverGroup observer_groups_[kObserverGroups] TA_GUARDED(lock_);
 
     // Used to store this dispatcher on the dispatcher deleter list.
     fbl::SinglyLinkedListNodeState<Dispatcher*> deleter_ll_;
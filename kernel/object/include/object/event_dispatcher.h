@@ -9,6 +9,7 @@
 #include <zircon/types.h>
 #include <fbl/canary.h>
 #include <object/dispatcher.h>
+#include <object/slab_cache.h>
 
 #include <sys/types.h>
 
@@ -17,6 +18,8 @@ public:
     static zx_status_t Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
                               zx_rights_t* rights);
 
+    DECLARE_SLAB_CACHED_NEW_DELETE();
+
     ~EventDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_EVENT; }
     bool has_state_tracker() const final { return true; }
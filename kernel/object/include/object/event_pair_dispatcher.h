@@ -11,6 +11,7 @@
 #include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
 #include <object/dispatcher.h>
+#include <object/slab_cache.h>
 #include <sys/types.h>
 
 class EventPairDispatcher final : public Dispatcher {
@@ -19,6 +20,8 @@ public:
                               fbl::RefPtr<Dispatcher>* dispatcher1,
                               zx_rights_t* rights);
 
+    DECLARE_SLAB_CACHED_NEW_DELETE();
+
     ~EventPairDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_EVENT_PAIR; }
     bool has_state_tracker() const final { return true; }
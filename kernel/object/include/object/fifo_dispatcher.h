@@ -10,12 +10,15 @@
 
 #include <object/dispatcher.h>
 
+#include <zircon/syscalls/fifo.h>
 #include <zircon/types.h>
 #include <fbl/canary.h>
 #include <fbl/mutex.h>
 #include <fbl/ref_counted.h>
 #include <lib/user_copy/user_ptr.h>
 
+class VmObject;
+
 class FifoDispatcher final : public Dispatcher {
 public:
     static zx_status_t Create(uint32_t elem_count, uint32_t elem_size, uint32_t options,
@@ -34,13 +37,43 @@ public:
     zx_status_t WriteFromUser(user_in_ptr<const uint8_t> src, size_t len, uint32_t* actual);
     zx_status_t ReadToUser(user_out_ptr<uint8_t> dst, size_t len, uint32_t* actual);
 
+    // Returns the VMO holding the rings of a ZX_FIFO_SHARED fifo and the
+    // index of this endpoint's ring within it.
+    zx_status_t GetSharedVmo(fbl::RefPtr<VmObject>* vmo, uint32_t* endpoint) const;
+
 private:
+    // The pinned VMO behind a ZX_FIFO_SHARED fifo, shared by both endpoints.
+    class SharedBuffer : public fbl::RefCounted<SharedBuffer> {
+    public:
+        static zx_status_t Create(fbl::RefPtr<SharedBuffer>* out);
+        ~SharedBuffer();
+
+        const fbl::RefPtr<VmObject>& vmo() const { return vmo_; }
+        zx_fifo_shared_ring_t* ring(uint32_t n) const;
+        uint8_t* data(uint32_t n) const { return pages_[n + 1]; }
+
+    private:
+        static constexpr size_t kNumPages = ZX_FIFO_SHARED_VMO_SIZE / PAGE_SIZE;
+
+        fbl::RefPtr<VmObject> vmo_;
+        bool pinned_ = false;
+        // Physmap addresses of the VMO's pages.
+        uint8_t* pages_[kNumPages] = {};
+    };
+
     FifoDispatcher(uint32_t options, uint32_t elem_count, uint32_t elem_size,
-                   fbl::unique_ptr<uint8_t[]> data);
+                   fbl::unique_ptr<uint8_t[]> data, fbl::RefPtr<SharedBuffer> shared,
+                   uint32_t endpoint);
     void Init(fbl::RefPtr<FifoDispatcher> other);
     zx_status_t WriteSelf(user_in_ptr<const uint8_t> ptr, size_t len, uint32_t* actual);
     zx_status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
 
+    // The ZX_FIFO_SHARED versions of WriteFromUser() and ReadToUser(). These
+    // follow the same protocol as a peer working on the mapped rings, and
+    // never trust the indices they find there.
+    zx_status_t WriteShared(user_in_ptr<const uint8_t> ptr, size_t count, uint32_t* actual);
+    zx_status_t ReadShared(user_out_ptr<uint8_t> ptr, size_t count, uint32_t* actual);
+
     void OnPeerZeroHandles();
 
     fbl::Canary<fbl::magic("FIFO")> canary_;
@@ -55,5 +88,10 @@ private:
     uint32_t tail_ TA_GUARDED(lock_);
     fbl::unique_ptr<uint8_t[]> data_ TA_GUARDED(lock_);
 
+    // Only set for ZX_FIFO_SHARED fifos, where the rings live here instead of
+    // in |data_| and the kernel serializes its own accesses under |lock_|.
+    const fbl::RefPtr<SharedBuffer> shared_;
+    const uint32_t endpoint_;
+
     static constexpr uint32_t kMaxSizeBytes = PAGE_SIZE;
 };
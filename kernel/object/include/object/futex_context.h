@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <arch/defines.h>
 #include <lib/user_copy/user_ptr.h>
+#include <stdlib.h>
 #include <zircon/types.h>
 #include <fbl/mutex.h>
 #include <object/futex_node.h>
@@ -23,6 +25,9 @@
 // When the thread at the head of the futex's blocked thread list is resumed,
 // The FutexNode for the new head of the blocked thread list is set as the hash table value
 // for the futex.
+// The hash table is split into a fixed number of buckets selected by futex address, each
+// with its own lock, so that threads operating on unrelated futexes in the same process
+// do not contend with each other.
 class FutexContext {
 public:
     FutexContext();
@@ -51,14 +56,29 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    static constexpr size_t kNumBuckets = 32u;
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    struct Bucket {
+        // protects table
+        fbl::Mutex lock;
 
-    // protects futex_table_
-    fbl::Mutex lock_;
+        // Key is futex address, value is the FutexNode for the head of futex's blocked
+        // thread list.
+        FutexNode::HashTable table TA_GUARDED(lock);
+    };
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+    // Buckets are padded out to whole cache lines so that the locks of neighbouring
+    // buckets do not share a line. (FutexContext lives inside the heap allocated
+    // ProcessDispatcher, where __CPU_ALIGN would not be honored.)
+    struct PaddedBucket : Bucket {
+        char padding[ROUNDUP(sizeof(Bucket), MAX_CACHE_LINE) - sizeof(Bucket)];
+    };
+
+    Bucket* BucketFor(uintptr_t futex_key);
+
+    static void QueueNodesLocked(Bucket* bucket, FutexNode* head) TA_REQ(bucket->lock);
+
+    bool UnqueueNode(FutexNode* node);
+
+    PaddedBucket buckets_[kNumBuckets];
 };
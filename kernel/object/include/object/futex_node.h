@@ -10,6 +10,7 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <zircon/types.h>
+#include <fbl/atomic.h>
 #include <fbl/intrusive_hash_table.h>
 #include <fbl/mutex.h>
 
@@ -17,7 +18,11 @@
 // Intended to be embedded within a ThreadDispatcher Instance
 class FutexNode : public fbl::SinglyLinkedListable<FutexNode*> {
 public:
-    using HashTable = fbl::HashTable<uintptr_t, FutexNode*>;
+    // FutexContext spreads its futexes over many small tables, each of which
+    // only ever holds the few active futexes that hash to it, so one chain
+    // per table is enough.
+    using HashTable = fbl::HashTable<uintptr_t, FutexNode*,
+                                     fbl::SinglyLinkedList<FutexNode*>, size_t, 1>;
 
     FutexNode();
     ~FutexNode();
@@ -45,11 +50,11 @@ public:
     zx_status_t BlockThread(fbl::Mutex* mutex, zx_time_t deadline) TA_REL(mutex);
 
     void set_hash_key(uintptr_t key) {
-        hash_key_ = key;
+        hash_key_.store(key, fbl::memory_order_relaxed);
     }
 
     // Trait implementation for fbl::HashTable
-    uintptr_t GetKey() const { return hash_key_; }
+    uintptr_t GetKey() const { return hash_key_.load(fbl::memory_order_relaxed); }
     static size_t GetHash(uintptr_t key) { return (key >> 3); }
 
 private:
@@ -66,7 +71,10 @@ private:
     //  * Additionally, when this FutexNode is the head of a futex wait
     //    queue, this field is used by the HashTable (because it uses
     //    intrusive SinglyLinkedLists).
-    uintptr_t hash_key_;
+    // While the node is queued it only changes with the FutexContext bucket
+    // locks for both the old and the new key held (see FutexRequeue()), but
+    // FutexWait() reads it without a lock to find out which bucket to lock.
+    fbl::atomic<uintptr_t> hash_key_;
 
     // Used for waking the thread corresponding to the FutexNode.
     wait_queue_t wait_queue_;
@@ -114,6 +114,9 @@ public:
     static void Init();
 
     // Maps an integer obtained by Handle::base_value() back to a Handle.
+    // Does not take any lock; the caller must hold the handle table lock of
+    // the process the Handle is expected to belong to and check
+    // process_id() before using the result.
     static Handle* FromU32(uint32_t value);
 
     // Get the number of outstanding handles for a given dispatcher.
@@ -147,6 +150,11 @@ private:
                        uint32_t* base_value);
     static uint32_t GetNewBaseValue(void* addr);
 
+    // Get and return arena slots through the per-cpu slot caches.
+    static void* AllocSlot() TA_EXCL(mutex_);
+    static void FreeSlot(void* addr) TA_EXCL(mutex_);
+    static void FlushSlotCaches() TA_REQ(mutex_);
+
     // Handle should never be destroyed by anything other than Delete,
     // which uses TearDown to do the actual destruction.
     ~Handle() = default;
@@ -164,7 +172,8 @@ private:
     const zx_rights_t rights_;
     const uint32_t base_value_;
 
-    // The handle arena and its mutex; also guards Dispatcher::handle_count_.
+    // The handle arena and its mutex. Free slots are cached per cpu, so the
+    // mutex is only taken when a cache needs refilling or flushing.
     static fbl::Mutex mutex_;
     static fbl::Arena TA_GUARDED(mutex_) arena_;
 
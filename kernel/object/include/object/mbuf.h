@@ -8,7 +8,9 @@
 
 #include <stdint.h>
 
+#include <arch/defines.h>
 #include <lib/user_copy/user_ptr.h>
+#include <vm/page.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_single_list.h>
 
@@ -19,22 +21,27 @@ public:
 
     zx_status_t WriteStream(user_in_ptr<const void> src, size_t len, size_t* written);
     zx_status_t WriteDatagram(user_in_ptr<const void> src, size_t len, size_t* written);
+
+    // Stream data that was written in whole pages is moved, rather than
+    // copied, into the VMO behind |dst| where |dst| is page aligned.
     size_t Read(user_out_ptr<void> dst, size_t len, bool datagram);
     bool is_full() const;
     bool is_empty() const;
     size_t size() const { return size_; }
 
 private:
-    // An MBuf is a small fixed-size chainable memory buffer.
+    // An MBuf is a chainable memory buffer. Most MBufs are InlineMBufs, small
+    // fixed-size buffers that hold their payload themselves. Large stream
+    // writes instead fill page MBufs, whose payload is a single physical page
+    // that can be handed to the reader whole.
     struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
-        // 8 for the linked list and 4 for the explicit uint32_t fields.
-        static constexpr size_t kHeaderSize = 8 + (4 * 4);
-        // 16 is for the malloc header.
-        static constexpr size_t kMallocSize = 2048 - 16;
-        static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
-
         size_t rem() const;
 
+        // The payload, either inline or the page's physmap address.
+        char* data_ = nullptr;
+        // The page holding the payload of a page MBuf, null for an InlineMBuf.
+        vm_page_t* page_ = nullptr;
+        uint32_t cap_ = 0u;
         uint32_t off_ = 0u;
         uint32_t len_ = 0u;
         // pkt_len_ is set to the total number of bytes in a packet
@@ -43,16 +50,40 @@ private:
         //
         // Always 0 in ZX_SOCKET_STREAM mode.
         uint32_t pkt_len_ = 0u;
-        uint32_t unused_;
-        char data_[kPayloadSize] = {0};
-        // TODO: maybe union data_ with char* blocks for large messages
     };
-    static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
-    static constexpr size_t kSizeMax = 128 * MBuf::kPayloadSize;
+    struct InlineMBuf : public MBuf {
+        // 16 is for the malloc header.
+        static constexpr size_t kMallocSize = 2048 - 16;
+        static constexpr size_t kPayloadSize = kMallocSize - sizeof(MBuf);
+
+        InlineMBuf() {
+            data_ = storage_;
+            cap_ = kPayloadSize;
+        }
+
+        char storage_[kPayloadSize] = {0};
+    };
+    static_assert(sizeof(InlineMBuf) == InlineMBuf::kMallocSize, "");
+    static_assert(InlineMBuf::kPayloadSize != PAGE_SIZE, "");
+
+    // Page MBufs are told apart by their capacity, since page_ is cleared
+    // once the page has been moved to a reader.
+    static bool IsInline(const MBuf* buf) { return buf->cap_ == InlineMBuf::kPayloadSize; }
+
+    static constexpr size_t kSizeMax = 128 * InlineMBuf::kPayloadSize;
 
     MBuf* AllocMBuf();
+    MBuf* AllocPageMBuf();
     void FreeMBuf(MBuf* buf);
+    static void DeleteMBuf(MBuf* buf);
+
+    // Moves the run of full page MBufs at the front of the chain into the
+    // mapping at |dst|, up to |len| bytes. Returns the number of bytes moved.
+    size_t MovePages(user_out_ptr<void> dst, size_t len);
+
+    // Pops the MBuf at the front of the chain.
+    MBuf* PopFront();
 
     fbl::SinglyLinkedList<MBuf*> freelist_;
     fbl::SinglyLinkedList<MBuf*> tail_;
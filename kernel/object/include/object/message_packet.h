@@ -11,6 +11,7 @@
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_double_list.h>
+#include <fbl/ref_ptr.h>
 #include <fbl/unique_ptr.h>
 
 constexpr uint32_t kMaxMessageSize = 65536u;
@@ -21,6 +22,7 @@ static_assert(ZX_CHANNEL_MAX_MSG_BYTES == kMaxMessageSize, "");
 static_assert(ZX_CHANNEL_MAX_MSG_HANDLES == kMaxMessageHandles, "");
 
 class Handle;
+class VmObject;
 
 class MessagePacket : public fbl::DoublyLinkedListable<fbl::unique_ptr<MessagePacket>> {
 public:
@@ -38,9 +40,13 @@ public:
 
     // Copies the packet's |data_size()| bytes to |buf|.
     // Returns an error if |buf| points to a bad user address.
-    zx_status_t CopyDataTo(user_out_ptr<void> buf) const {
-        return buf.copy_array_to_user(data(), data_size_);
-    }
+    //
+    // Large payloads are held in pages rather than inline; when |buf| is
+    // page aligned, whole pages are moved into the receiver's VMO instead of
+    // being copied, so this may only be called once per packet. If |buf|
+    // is a bad address, the packet is left as it was, so the message can
+    // still be read.
+    zx_status_t CopyDataTo(user_out_ptr<void> buf);
 
     uint32_t num_handles() const { return num_handles_; }
     Handle* const* handles() const { return handles_; }
@@ -50,35 +56,36 @@ public:
 
     // zx_channel_call treats the leading bytes of the payload as
     // a transaction id of type zx_txid_t.
-    zx_txid_t get_txid() const {
-        if (data_size_ < sizeof(zx_txid_t)) {
-            return 0;
-        } else {
-            return *(reinterpret_cast<const zx_txid_t*>(data()));
-        }
-    }
+    zx_txid_t get_txid() const;
 
 private:
     MessagePacket(uint32_t data_size, uint32_t num_handles, Handle** handles);
     ~MessagePacket();
 
     // Allocates a new packet that can hold the specified amount of
-    // data/handles.
-    static zx_status_t NewPacket(uint32_t data_size, uint32_t num_handles,
+    // data/handles. If |inline_data| is false, no space is reserved for the
+    // payload and the caller must supply |vmo_|.
+    static zx_status_t NewPacket(uint32_t data_size, uint32_t num_handles, bool inline_data,
                                  fbl::unique_ptr<MessagePacket>* msg);
 
-    // Create() uses malloc(), so we must delete using free().
-    static void operator delete(void* ptr) {
-        free(ptr);
-    }
+    // Create() uses either the small packet slab cache or malloc(), so we
+    // must delete using the matching free routine.
+    static void operator delete(void* ptr);
     friend class fbl::unique_ptr<MessagePacket>;
 
+    // Moves the first |len| bytes of |vmo_|, a multiple of the page size,
+    // into the VMO mapped at |buf|. Sets |moved| to the number of bytes
+    // transferred, which is 0 if the mapping can't take the pages.
+    zx_status_t MovePagesTo(user_out_ptr<void> buf, size_t len, size_t* moved);
+
     // Handles and data are stored in the same buffer: num_handles_ Handle*
-    // entries first, then the data buffer.
+    // entries first, then the data buffer. Not valid if |vmo_| is set.
     void* data() const { return static_cast<void*>(handles_ + num_handles_); }
 
     Handle** const handles_;
     const uint32_t data_size_;
     const uint16_t num_handles_;
     bool owns_handles_;
+    // Holds the payload instead of the inline buffer for large messages.
+    fbl::RefPtr<VmObject> vmo_;
 };
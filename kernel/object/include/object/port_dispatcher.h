@@ -7,6 +7,7 @@
 #pragma once
 
 #include <object/dispatcher.h>
+#include <object/slab_cache.h>
 #include <object/semaphore.h>
 #include <object/state_observer.h>
 
@@ -114,6 +115,8 @@ public:
                  uint64_t key, zx_signals_t signals);
     ~PortObserver() = default;
 
+    DECLARE_SLAB_CACHED_NEW_DELETE();
+
 private:
     PortObserver(const PortObserver&) = delete;
     PortObserver& operator=(const PortObserver&) = delete;
@@ -124,6 +127,7 @@ private:
     Flags OnCancel(const Handle* handle) final;
     Flags OnCancelByKey(const Handle* handle, const void* port, uint64_t key) final;
     void OnRemoved() final;
+    zx_signals_t watched_signals() const final { return trigger_; }
 
     // The following method can only be called from
     // OnInitialize(), OnStateChange() and OnCancel().
@@ -143,6 +147,8 @@ public:
     static zx_status_t Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
                               zx_rights_t* rights);
 
+    DECLARE_SLAB_CACHED_NEW_DELETE();
+
     ~PortDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_PORT; }
 
@@ -152,6 +158,13 @@ public:
     zx_status_t QueueUser(const zx_port_packet_t& packet);
     zx_status_t Dequeue(zx_time_t deadline, zx_port_packet_t* packet);
 
+    // Like Dequeue(), but takes up to |max_packets| packets, as many as are
+    // queued, while holding the port lock once. Blocks until at least one
+    // packet is available or |deadline| passes. |packets| may be null, in
+    // which case the packets are discarded.
+    zx_status_t DequeueMany(zx_time_t deadline, zx_port_packet_t* packets,
+                            size_t max_packets, size_t* actual);
+
     // Decides who is going to destroy the observer. If it returns |true| it
     // is the duty of the caller. If it is false it is the duty of the port.
     bool CanReap(PortObserver* observer, PortPacket* port_packet);
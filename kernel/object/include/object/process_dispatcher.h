@@ -17,7 +17,9 @@
 
 #include <zircon/syscalls/object.h>
 #include <zircon/types.h>
+#include <zircon/zx-syscall-numbers.h>
 #include <fbl/array.h>
+#include <fbl/atomic.h>
 #include <fbl/canary.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/mutex.h>
@@ -199,6 +201,16 @@ public:
 
     zx_status_t GetThreads(fbl::Array<zx_koid_t>* threads);
 
+    // Accounts for a call to syscall |num|, which took |ticks|.
+    void AddSyscallStats(uint32_t num, uint64_t ticks) {
+        syscall_stats_[num].count.fetch_add(1, fbl::memory_order_relaxed);
+        syscall_stats_[num].ticks.fetch_add(ticks, fbl::memory_order_relaxed);
+    }
+    void GetSyscallStats(uint32_t num, uint64_t* count, uint64_t* ticks) const {
+        *count = syscall_stats_[num].count.load(fbl::memory_order_relaxed);
+        *ticks = syscall_stats_[num].ticks.load(fbl::memory_order_relaxed);
+    }
+
     // exception handling support
     zx_status_t SetExceptionPort(fbl::RefPtr<ExceptionPort> eport);
     // Returns true if a port had been set.
@@ -334,6 +346,13 @@ private:
     // This is a cache of aspace()->vdso_code_address().
     uintptr_t vdso_code_address_ = 0;
 
+    // How many times each syscall was made, and for how long.
+    struct SyscallStats {
+        fbl::atomic<uint64_t> count{0};
+        fbl::atomic<uint64_t> ticks{0};
+    };
+    SyscallStats syscall_stats_[ZX_SYS_COUNT];
+
     // The user-friendly process name. For debug purposes only. That
     // is, there is no mechanism to mint a handle to a process via this name.
     fbl::Name<ZX_MAX_NAME_LEN> name_;
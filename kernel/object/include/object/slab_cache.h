@@ -0,0 +1,175 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <kernel/align.h>
+#include <kernel/spinlock.h>
+#include <lib/counters.h>
+
+#include <fbl/alloc_checker.h>
+#include <fbl/macros.h>
+#include <fbl/mutex.h>
+#include <fbl/slab_allocator.h>
+
+// SlabCache is a fixed-size object cache for the kernel objects that are
+// created and destroyed on syscall fast paths (dispatchers, port observers,
+// small channel messages).
+//
+// Memory comes from an fbl::SlabAllocator, so it is carved out of 16KB slabs
+// instead of being requested from the heap one object at a time. In front of
+// the slab allocator each CPU keeps a short free list so that the common
+// alloc/free pair does not touch the slab allocator's mutex either; only
+// per-CPU list misses and overflows go to the shared slabs.
+//
+// Slabs are never returned to the heap; a cache keeps the memory of its
+// busiest moment for reuse. The |max_slabs| limit each cache is created
+// with is therefore also the most memory it will ever hold on to.
+//
+// Each cache reports its activity through kcounters (see
+// SLAB_CACHE_COUNTERS below) and can be inspected with the "kstats" console
+// command.
+
+struct SlabCacheCounters {
+    const k_counter_desc* alloc;
+    const k_counter_desc* free;
+    const k_counter_desc* cpu_hit;
+    const k_counter_desc* fail;
+};
+
+// Defines the kcounters for a slab cache named |name| and a
+// SlabCacheCounters |var| that refers to them. |name| must be a string
+// literal; the counters are named "kernel.slab.<name>.*".
+#define SLAB_CACHE_COUNTERS(var, name)                                  \
+    KCOUNTER(var##_alloc, "kernel.slab." name ".alloc");                \
+    KCOUNTER(var##_free, "kernel.slab." name ".free");                  \
+    KCOUNTER(var##_cpu_hit, "kernel.slab." name ".cpu_hit");            \
+    KCOUNTER(var##_fail, "kernel.slab." name ".fail");                  \
+    static const SlabCacheCounters var = {                              \
+        var##_alloc, var##_free, var##_cpu_hit, var##_fail }
+
+namespace internal {
+
+// Non-templated portion of SlabCache: the per-CPU free lists, the kcounter
+// bookkeeping and the list of all caches used by "kstats".
+class SlabCacheBase {
+public:
+    // Dumps the state of every slab cache using printf().
+    static void DumpAll();
+
+protected:
+    SlabCacheBase(const char* name, size_t object_size, size_t objects_per_slab,
+                  size_t max_slabs, const SlabCacheCounters& counters);
+    ~SlabCacheBase() = default;
+
+    void* Alloc();
+    void Free(void* ptr);
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(SlabCacheBase);
+
+    // The number of free objects each CPU is allowed to hold on to before
+    // they are given back to the shared slabs.
+    static constexpr size_t kMaxCachedPerCpu = 32u;
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct PerCpu {
+        SpinLock lock;
+        FreeNode* head TA_GUARDED(lock) = nullptr;
+        size_t count TA_GUARDED(lock) = 0u;
+    } __CPU_ALIGN;
+
+    // Implemented by SlabCache<> on top of its fbl::SlabAllocator.
+    virtual void* AllocFromSlab() = 0;
+    virtual void FreeToSlab(void* ptr) = 0;
+
+    void Dump();
+
+    const char* const name_;
+    const size_t object_size_;
+    const size_t objects_per_slab_;
+    const size_t max_slabs_;
+    const SlabCacheCounters counters_;
+
+    PerCpu cpu_[SMP_MAX_CPUS];
+
+    // Singly-linked list of every cache, see DumpAll().
+    SlabCacheBase* next_cache_ = nullptr;
+};
+
+}  // namespace internal
+
+// A cache of |kObjectSize| byte objects. Caches are expected to be global
+// objects that live for the lifetime of the kernel.
+template <size_t kObjectSize,
+          size_t kSlabSize = fbl::DEFAULT_SLAB_ALLOCATOR_SLAB_SIZE>
+class SlabCache final : public internal::SlabCacheBase {
+public:
+    // Alignment guaranteed for every object handed out by the cache.
+    static constexpr size_t kAlignment = 16u;
+
+    SlabCache(const char* name, size_t max_slabs, const SlabCacheCounters& counters)
+        : SlabCacheBase(name, kObjectSize, AllocatorType::AllocsPerSlab, max_slabs, counters),
+          allocator_(max_slabs) {}
+
+    // Returns uninitialized storage for one object, or nullptr if the cache
+    // has reached its slab limit (or the heap is exhausted).
+    void* Alloc() { return SlabCacheBase::Alloc(); }
+
+    // Returns storage obtained from Alloc() to the cache.
+    void Free(void* ptr) { SlabCacheBase::Free(ptr); }
+
+private:
+    struct Block;
+    using Traits = fbl::ManualDeleteSlabAllocatorTraits<Block*, kSlabSize>;
+    using AllocatorType = fbl::SlabAllocator<Traits>;
+
+    struct Block : public fbl::SlabAllocated<Traits> {
+        alignas(kAlignment) uint8_t storage[kObjectSize];
+    };
+
+    void* AllocFromSlab() final { return allocator_.New(); }
+    void FreeToSlab(void* ptr) final { allocator_.Delete(static_cast<Block*>(ptr)); }
+
+    AllocatorType allocator_;
+};
+
+// Routes a class's operator new/delete through a SlabCache. Place
+// DECLARE_SLAB_CACHED_NEW_DELETE() inside the class definition and
+// DEFINE_SLAB_CACHED_NEW_DELETE() in the .cpp file that implements it.
+// Only final classes may be slab cached, since the cache is sized for
+// exactly sizeof(T).
+//
+// Objects are still created with the usual
+//
+//     fbl::AllocChecker ac;
+//     auto obj = new (&ac) T(...);
+//
+// and destroyed with delete (directly or via RefPtr/unique_ptr).
+#define DECLARE_SLAB_CACHED_NEW_DELETE()                                \
+    static void* operator new(size_t size, fbl::AllocChecker* ac) noexcept; \
+    static void operator delete(void* ptr)
+
+#define DEFINE_SLAB_CACHED_NEW_DELETE(T, name, max_slabs)               \
+    SLAB_CACHE_COUNTERS(T##_slab_counters, name);                       \
+    static SlabCache<sizeof(T)> T##_slab_cache(name, max_slabs,         \
+                                               T##_slab_counters);      \
+    static_assert(alignof(T) <= SlabCache<sizeof(T)>::kAlignment, "");  \
+    void* T::operator new(size_t size, fbl::AllocChecker* ac) noexcept { \
+        DEBUG_ASSERT(size == sizeof(T));                                \
+        void* mem = T##_slab_cache.Alloc();                             \
+        ac->arm(size, mem != nullptr);                                  \
+        return mem;                                                     \
+    }                                                                   \
+    void T::operator delete(void* ptr) {                                \
+        T##_slab_cache.Free(ptr);                                       \
+    }
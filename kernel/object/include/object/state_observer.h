@@ -69,6 +69,10 @@ public:
     // is safe to delete the observer.
     virtual void OnRemoved() {}
 
+    // The signals this observer acts on. OnStateChange() is only called for changes that leave
+    // at least one of them asserted, so it must not change while the observer is on a list.
+    virtual zx_signals_t watched_signals() const { return ~0u; }
+
 protected:
     ~StateObserver() {}
 
@@ -77,6 +81,10 @@ private:
 
     friend struct StateObserverListTraits;
     fbl::DoublyLinkedListNodeState<StateObserver*> state_observer_list_node_state_;
+
+    // The dispatcher's observer group this observer is on.
+    friend class Dispatcher;
+    uint32_t observer_group_ = 0u;
 };
 
 // For use by StateTracker to maintain a list of StateObservers. (We don't use the default traits so
@@ -14,6 +14,7 @@
 
 #include <sys/types.h>
 
+class UserIovecCursor;
 class VmObject;
 class VmAspace;
 
@@ -33,6 +34,10 @@ public:
                      uint64_t offset, size_t* actual);
     zx_status_t Write(user_in_ptr<const void> user_data, size_t length,
                       uint64_t offset, size_t* actual);
+    zx_status_t ReadVector(UserIovecCursor* cursor, size_t length,
+                           uint64_t offset, size_t* actual);
+    zx_status_t WriteVector(UserIovecCursor* cursor, size_t length,
+                            uint64_t offset, size_t* actual);
     zx_status_t SetSize(uint64_t);
     zx_status_t GetSize(uint64_t* size);
     zx_status_t RangeOp(uint32_t op, uint64_t offset, uint64_t size, user_inout_ptr<void> buffer,
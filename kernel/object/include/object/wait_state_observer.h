@@ -40,6 +40,7 @@ private:
     Flags OnInitialize(zx_signals_t initial_state, const StateObserver::CountInfo* cinfo) final;
     Flags OnStateChange(zx_signals_t new_state) final;
     Flags OnCancel(const Handle* handle) final;
+    zx_signals_t watched_signals() const final { return watched_signals_; }
 
     fbl::Canary<fbl::magic("WTSO")> canary_;
 
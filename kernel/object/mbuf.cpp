@@ -7,26 +7,30 @@
 #include <object/mbuf.h>
 
 #include <lib/user_copy/user_ptr.h>
+#include <object/process_dispatcher.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+#include <vm/vm_aspace.h>
+#include <vm/vm_object_paged.h>
 
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
 
 #define LOCAL_TRACE 0
 
-constexpr size_t MBufChain::MBuf::kHeaderSize;
-constexpr size_t MBufChain::MBuf::kMallocSize;
-constexpr size_t MBufChain::MBuf::kPayloadSize;
+constexpr size_t MBufChain::InlineMBuf::kMallocSize;
+constexpr size_t MBufChain::InlineMBuf::kPayloadSize;
 constexpr size_t MBufChain::kSizeMax;
 
 size_t MBufChain::MBuf::rem() const {
-    return kPayloadSize - (off_ + len_);
+    return cap_ - (off_ + len_);
 }
 
 MBufChain::~MBufChain() {
     while (!tail_.is_empty())
-        delete tail_.pop_front();
+        DeleteMBuf(tail_.pop_front());
     while (!freelist_.is_empty())
-        delete freelist_.pop_front();
+        DeleteMBuf(freelist_.pop_front());
 }
 
 bool MBufChain::is_full() const {
@@ -42,8 +46,18 @@ size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
         len = tail_.front().pkt_len_;
 
     size_t pos = 0;
+    bool try_move = !datagram;
     while (pos < len && !tail_.is_empty()) {
         MBuf& cur = tail_.front();
+        if (try_move && cur.page_ != nullptr) {
+            size_t moved = MovePages(dst.byte_offset(pos), len - pos);
+            if (moved > 0) {
+                pos += moved;
+                continue;
+            }
+            // Don't keep retrying for every page of an unsuitable buffer.
+            try_move = false;
+        }
         char* src = cur.data_ + cur.off_;
         size_t copy_len = MIN(cur.len_, len - pos);
         if (dst.byte_offset(pos).copy_array_to_user(src, copy_len) != ZX_OK)
@@ -54,31 +68,66 @@ size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
         size_ -= copy_len;
         if (cur.len_ == 0 || datagram) {
             size_ -= cur.len_;
-            if (head_ == &cur)
-                head_ = nullptr;
-            FreeMBuf(tail_.pop_front());
+            FreeMBuf(PopFront());
         }
     }
     if (datagram) {
         // Drain any leftover mbufs in the datagram packet.
         while (!tail_.is_empty() && tail_.front().pkt_len_ == 0) {
-            MBuf* cur = tail_.pop_front();
-            size_ -= cur->len_;
-            if (head_ == cur)
-                head_ = nullptr;
-            FreeMBuf(cur);
+            size_ -= tail_.front().len_;
+            FreeMBuf(PopFront());
         }
     }
     return pos;
 }
 
+size_t MBufChain::MovePages(user_out_ptr<void> dst, size_t len) {
+    if (!IS_PAGE_ALIGNED(dst.get()))
+        return 0u;
+
+    // Gather the full pages at the front of the chain that fit in |len|.
+    // The MBufs keep their pages until the move has succeeded.
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    size_t count = 0u;
+    for (auto& buf : tail_) {
+        if (buf.page_ == nullptr || buf.off_ != 0u || buf.len_ != PAGE_SIZE ||
+            (count + 1) * PAGE_SIZE > len)
+            break;
+        list_add_tail(&pages, &buf.page_->free.node);
+        ++count;
+    }
+    if (count == 0u)
+        return 0u;
+
+    const vaddr_t va = reinterpret_cast<vaddr_t>(dst.get());
+    if (ProcessDispatcher::GetCurrent()->aspace()->SupplyPages(
+            va, count * PAGE_SIZE, &pages) != ZX_OK)
+        return 0u;
+
+    // The pages belong to the reader's VMO now.
+    for (size_t i = 0; i < count; ++i) {
+        MBuf* buf = PopFront();
+        buf->page_ = nullptr;
+        FreeMBuf(buf);
+    }
+    size_ -= count * PAGE_SIZE;
+    return count * PAGE_SIZE;
+}
+
+MBufChain::MBuf* MBufChain::PopFront() {
+    MBuf* buf = tail_.pop_front();
+    if (head_ == buf)
+        head_ = nullptr;
+    return buf;
+}
+
 zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
                                      size_t len, size_t* written) {
     if (len + size_ > kSizeMax)
         return ZX_ERR_SHOULD_WAIT;
 
     fbl::SinglyLinkedList<MBuf*> bufs;
-    for (size_t need = 1 + ((len - 1) / MBuf::kPayloadSize); need != 0; need--) {
+    for (size_t need = 1 + ((len - 1) / InlineMBuf::kPayloadSize); need != 0; need--) {
         auto buf = AllocMBuf();
         if (buf == nullptr) {
             while (!bufs.is_empty())
@@ -90,7 +139,7 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
 
     size_t pos = 0;
     for (auto& buf : bufs) {
-        size_t copy_len = fbl::min(MBuf::kPayloadSize, len - pos);
+        size_t copy_len = fbl::min(InlineMBuf::kPayloadSize, len - pos);
         if (src.byte_offset(pos).copy_array_from_user(buf.data_, copy_len) != ZX_OK) {
             while (!bufs.is_empty())
                 FreeMBuf(bufs.pop_front());
@@ -120,20 +169,23 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
 
 zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src,
                                    size_t len, size_t* written) {
-    if (head_ == nullptr) {
-        head_ = AllocMBuf();
-        if (head_ == nullptr)
-            return ZX_ERR_SHOULD_WAIT;
-        tail_.push_front(head_);
-    }
-
     size_t pos = 0;
     while (pos < len) {
-        if (head_->rem() == 0) {
-            auto next = AllocMBuf();
+        if (head_ == nullptr || head_->rem() == 0) {
+            // Whole pages of data go into page MBufs so that a page aligned
+            // reader can take them without a copy.
+            MBuf* next = nullptr;
+            if (len - pos >= PAGE_SIZE)
+                next = AllocPageMBuf();
+            if (next == nullptr)
+                next = AllocMBuf();
             if (next == nullptr)
                 break;
-            tail_.insert_after(tail_.make_iterator(*head_), next);
+            if (head_ == nullptr) {
+                tail_.push_front(next);
+            } else {
+                tail_.insert_after(tail_.make_iterator(*head_), next);
+            }
             head_ = next;
         }
         void* dst = head_->data_ + head_->off_ + head_->len_;
@@ -160,14 +212,48 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src,
 MBufChain::MBuf* MBufChain::AllocMBuf() {
     if (freelist_.is_empty()) {
         fbl::AllocChecker ac;
-        MBuf* buf = new (&ac) MBuf();
+        MBuf* buf = new (&ac) InlineMBuf();
         return (!ac.check()) ? nullptr : buf;
     }
     return freelist_.pop_front();
 }
 
+MBufChain::MBuf* MBufChain::AllocPageMBuf() {
+    fbl::AllocChecker ac;
+    MBuf* buf = new (&ac) MBuf();
+    if (!ac.check())
+        return nullptr;
+    paddr_t pa;
+    buf->page_ = VmObjectPaged::AllocUnownedPage(PMM_ALLOC_FLAG_ANY, &pa);
+    if (buf->page_ == nullptr) {
+        delete buf;
+        return nullptr;
+    }
+    buf->data_ = static_cast<char*>(paddr_to_physmap(pa));
+    buf->cap_ = PAGE_SIZE;
+    return buf;
+}
+
 void MBufChain::FreeMBuf(MBuf* buf) {
+    if (!IsInline(buf)) {
+        // Page MBufs are not cached; pages are plentiful in the pmm and
+        // holding on to them would pin memory in idle sockets.
+        DeleteMBuf(buf);
+        return;
+    }
     buf->off_ = 0u;
     buf->len_ = 0u;
+    buf->pkt_len_ = 0u;
     freelist_.push_front(buf);
 }
+
+// static
+void MBufChain::DeleteMBuf(MBuf* buf) {
+    if (IsInline(buf)) {
+        delete static_cast<InlineMBuf*>(buf);
+        return;
+    }
+    if (buf->page_ != nullptr)
+        pmm_free_page(buf->page_);
+    delete buf;
+}
@@ -14,6 +14,7 @@
 #include <fbl/alloc_checker.h>
 #include <fbl/arena.h>
 #include <fbl/auto_lock.h>
+#include <lib/counters.h>
 #include <object/excp_port.h>
 #include <object/handle.h>
 #include <zircon/compiler.h>
@@ -23,6 +24,9 @@
 
 using fbl::AutoLock;
 
+KCOUNTER(port_queued_count, "kernel.port.packets_queued");
+KCOUNTER(port_dequeued_count, "kernel.port.packets_dequeued");
+
 static_assert(sizeof(zx_packet_signal_t) == sizeof(zx_packet_user_t),
               "size of zx_packet_signal_t must match zx_packet_user_t");
 static_assert(sizeof(zx_packet_exception_t) == sizeof(zx_packet_user_t),
@@ -55,6 +59,9 @@ constexpr size_t kMaxPendingPacketCount = 16 * 1024u;
 ArenaPortAllocator port_allocator;
 }  // namespace.
 
+DEFINE_SLAB_CACHED_NEW_DELETE(PortDispatcher, "port", 1024u)
+DEFINE_SLAB_CACHED_NEW_DELETE(PortObserver, "port.observer", 4096u)
+
 zx_status_t ArenaPortAllocator::Init() {
     return arena_.Init("packets", kMaxPendingPacketCount);
 }
@@ -242,6 +249,7 @@ zx_status_t PortDispatcher::Queue(PortPacket* port_packet, zx_signals_t observed
 
         packets_.push_back(port_packet);
         wake_count = sema_.Post();
+        kcounter_add(port_queued_count, 1u);
     }
 
     if (wake_count)
@@ -251,35 +259,53 @@ zx_status_t PortDispatcher::Queue(PortPacket* port_packet, zx_signals_t observed
 }
 
 zx_status_t PortDispatcher::Dequeue(zx_time_t deadline, zx_port_packet_t* out_packet) {
+    size_t actual;
+    return DequeueMany(deadline, out_packet, 1u, &actual);
+}
+
+zx_status_t PortDispatcher::DequeueMany(zx_time_t deadline, zx_port_packet_t* out_packets,
+                                        size_t max_packets, size_t* actual) {
     canary_.Assert();
+    DEBUG_ASSERT(max_packets > 0u);
 
     while (true) {
+        size_t count = 0u;
         {
             AutoLock al(&lock_);
 
-            PortPacket* port_packet = packets_.pop_front();
-            if (port_packet == nullptr)
-                goto wait;
-
-            if (out_packet != nullptr)
-                *out_packet = port_packet->packet;
-
-            PortObserver* observer = port_packet->observer;
-
-            if (observer) {
-                // Deleting the observer under the lock is fine because
-                // the reference that holds to this PortDispatcher is by
-                // construction not the last one. We need to do this under
-                // the lock because another thread can call CanReap().
-                delete observer;
-            } else if (port_packet->is_ephemeral()) {
-                port_packet->Free();
+            while (count < max_packets) {
+                PortPacket* port_packet = packets_.pop_front();
+                if (port_packet == nullptr)
+                    break;
+
+                if (out_packets != nullptr)
+                    out_packets[count] = port_packet->packet;
+                ++count;
+
+                PortObserver* observer = port_packet->observer;
+
+                if (observer) {
+                    // Deleting the observer under the lock is fine because
+                    // the reference that holds to this PortDispatcher is by
+                    // construction not the last one. We need to do this under
+                    // the lock because another thread can call CanReap().
+                    delete observer;
+                } else if (port_packet->is_ephemeral()) {
+                    port_packet->Free();
+                }
             }
         }
 
-        return ZX_OK;
+        // Taking more than one packet leaves |sema_| with a count higher than
+        // the number of queued packets. That is harmless: as with packets
+        // removed by CancelQueued(), a later waiter finds the queue empty
+        // and goes back to waiting.
+        if (count > 0u) {
+            kcounter_add(port_dequeued_count, count);
+            *actual = count;
+            return ZX_OK;
+        }
 
-wait:
         zx_status_t st = sema_.Wait(deadline, nullptr);
         if (st != ZX_OK)
             return st;
@@ -38,6 +38,7 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/resource_dispatcher.cpp \
     $(LOCAL_DIR)/resources.cpp \
     $(LOCAL_DIR)/semaphore.cpp \
+    $(LOCAL_DIR)/slab_cache.cpp \
     $(LOCAL_DIR)/socket_dispatcher.cpp \
     $(LOCAL_DIR)/thread_dispatcher.cpp \
     $(LOCAL_DIR)/timer_dispatcher.cpp \
@@ -0,0 +1,162 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/slab_cache.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arch/ops.h>
+#include <kernel/auto_lock.h>
+#include <kernel/percpu.h>
+#include <lib/console.h>
+
+namespace {
+
+// Guards |all_caches|. A plain spin_lock_t (rather than a fbl::Mutex) so
+// that caches can register themselves from global constructors regardless
+// of the order in which those run.
+spin_lock_t all_caches_lock = SPIN_LOCK_INITIAL_VALUE;
+internal::SlabCacheBase* all_caches TA_GUARDED(all_caches_lock) = nullptr;
+
+// Like the "counters" command, this is only an approximation since the
+// per-CPU slots are read without synchronization.
+uint64_t counter_sum(const k_counter_desc* desc) {
+    size_t index = kcounter_index(desc);
+    uint64_t sum = 0;
+    for (size_t ix = 0; ix != SMP_MAX_CPUS; ++ix) {
+        if (percpu[ix].counters != nullptr)
+            sum += percpu[ix].counters[index];
+    }
+    return sum;
+}
+
+}  // namespace
+
+namespace internal {
+
+SlabCacheBase::SlabCacheBase(const char* name, size_t object_size, size_t objects_per_slab,
+                             size_t max_slabs, const SlabCacheCounters& counters)
+    : name_(name),
+      object_size_(object_size),
+      objects_per_slab_(objects_per_slab),
+      max_slabs_(max_slabs),
+      counters_(counters) {
+    DEBUG_ASSERT(object_size_ >= sizeof(FreeNode));
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&all_caches_lock, state);
+    next_cache_ = all_caches;
+    all_caches = this;
+    spin_unlock_irqrestore(&all_caches_lock, state);
+}
+
+void* SlabCacheBase::Alloc() {
+    void* ptr = nullptr;
+    {
+        // The per-CPU lock is only contended if we migrate between reading
+        // the CPU number and taking the lock, which is harmless.
+        PerCpu& cpu = cpu_[arch_curr_cpu_num()];
+        AutoSpinLockIrqSave lock(&cpu.lock);
+        if (cpu.head != nullptr) {
+            FreeNode* node = cpu.head;
+            cpu.head = node->next;
+            --cpu.count;
+            ptr = node;
+        }
+    }
+
+    if (likely(ptr != nullptr)) {
+        kcounter_add(counters_.cpu_hit, 1u);
+    } else {
+        ptr = AllocFromSlab();
+        if (unlikely(ptr == nullptr)) {
+            kcounter_add(counters_.fail, 1u);
+            return nullptr;
+        }
+    }
+
+    kcounter_add(counters_.alloc, 1u);
+    return ptr;
+}
+
+void SlabCacheBase::Free(void* ptr) {
+    if (ptr == nullptr)
+        return;
+
+    kcounter_add(counters_.free, 1u);
+
+    {
+        PerCpu& cpu = cpu_[arch_curr_cpu_num()];
+        AutoSpinLockIrqSave lock(&cpu.lock);
+        if (cpu.count < kMaxCachedPerCpu) {
+            FreeNode* node = static_cast<FreeNode*>(ptr);
+            node->next = cpu.head;
+            cpu.head = node;
+            ++cpu.count;
+            return;
+        }
+    }
+
+    FreeToSlab(ptr);
+}
+
+void SlabCacheBase::Dump() TA_NO_THREAD_SAFETY_ANALYSIS {
+    uint64_t allocs = counter_sum(counters_.alloc);
+    uint64_t frees = counter_sum(counters_.free);
+    uint64_t hits = counter_sum(counters_.cpu_hit);
+    uint64_t fails = counter_sum(counters_.fail);
+
+    // Racy read of the per-CPU list lengths, good enough for diagnostics.
+    size_t cached = 0;
+    for (size_t ix = 0; ix != SMP_MAX_CPUS; ++ix)
+        cached += cpu_[ix].count;
+
+    printf("%-20s %6zu %6zu %6zu %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+           " %8" PRIu64 " %6zu\n",
+           name_, object_size_, objects_per_slab_, max_slabs_,
+           allocs - frees, allocs, hits, fails, cached);
+}
+
+// static
+void SlabCacheBase::DumpAll() {
+    printf("%-20s %6s %6s %6s %10s %10s %10s %8s %6s\n",
+           "cache", "size", "/slab", "slabs", "live", "allocs", "cpu-hits", "fails", "cached");
+
+    // Caches are never unregistered, so the list can be walked without
+    // holding the lock once we have read its head.
+    SlabCacheBase* cache;
+    {
+        AutoSpinLockIrqSave lock(&all_caches_lock);
+        cache = all_caches;
+    }
+    for (; cache != nullptr; cache = cache->next_cache_)
+        cache->Dump();
+}
+
+}  // namespace internal
+
+static int cmd_kstats(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc < 2) {
+        printf("not enough arguments:\n");
+    usage:
+        printf("%s slab              : slab cache usage\n", argv[0].str);
+        return -1;
+    }
+
+    if (strcmp(argv[1].str, "slab") == 0) {
+        internal::SlabCacheBase::DumpAll();
+    } else {
+        printf("unrecognized subcommand '%s'\n", argv[1].str);
+        goto usage;
+    }
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("kstats", "kernel object allocation statistics", &cmd_kstats)
+STATIC_COMMAND_END(kstats);
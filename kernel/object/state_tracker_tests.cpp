@@ -6,6 +6,8 @@
 
 #include <object/dispatcher.h>
 
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
 #include <object/state_observer.h>
 #include <unittest.h>
 
@@ -30,6 +32,11 @@ public:
         Cancel(/* handle= */ nullptr);
         CancelByKey(/* handle= */ nullptr, /* port= */ nullptr, /* key= */ 2u);
     }
+
+    // Helper: Asserts exactly |signals|.
+    void SetSignals(zx_signals_t signals) {
+        UpdateState(~signals, signals);
+    }
 };
 
 } // namespace
@@ -181,6 +188,105 @@ bool on_cancel_by_key(void* context) {
 
 } // namespace removal
 
+// Tests for only passing state changes to the observers that watch them
+namespace watched {
+
+class CountingObserver : public StateObserver {
+public:
+    explicit CountingObserver(zx_signals_t watched) : watched_(watched) {}
+
+    // The number of times OnStateChange() has been called.
+    int changes() const { return changes_; }
+
+private:
+    Flags OnInitialize(zx_signals_t initial_state,
+                       const StateObserver::CountInfo* cinfo) override {
+        return 0;
+    }
+    Flags OnStateChange(zx_signals_t new_state) override {
+        changes_++;
+        return 0;
+    }
+    Flags OnCancel(const Handle* handle) override { return 0; }
+    zx_signals_t watched_signals() const override { return watched_; }
+
+    const zx_signals_t watched_;
+    int changes_ = 0;
+};
+
+bool skips_unwatched(void* context) {
+    BEGIN_TEST;
+
+    CountingObserver obs1(1u);
+    CountingObserver obs2(2u);
+    CountingObserver obs3(3u);
+
+    TestDispatcher st;
+    st.AddObserver(&obs1, nullptr);
+    st.AddObserver(&obs2, nullptr);
+    st.AddObserver(&obs3, nullptr);
+
+    st.SetSignals(1u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(0, obs2.changes(), "");
+    EXPECT_EQ(1, obs3.changes(), "");
+
+    st.SetSignals(2u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(1, obs2.changes(), "");
+    EXPECT_EQ(2, obs3.changes(), "");
+
+    // Nobody watches for every signal being cleared.
+    st.SetSignals(0u);
+    EXPECT_EQ(1, obs1.changes(), "");
+    EXPECT_EQ(1, obs2.changes(), "");
+    EXPECT_EQ(2, obs3.changes(), "");
+
+    st.RemoveObserver(&obs1);
+    st.RemoveObserver(&obs2);
+    st.RemoveObserver(&obs3);
+
+    END_TEST;
+}
+
+// Uses more distinct sets of watched signals than the dispatcher has
+// observer groups.
+bool many_distinct_masks(void* context) {
+    BEGIN_TEST;
+
+    constexpr uint32_t kCount = 12u;
+    fbl::unique_ptr<CountingObserver> obs[kCount];
+    for (uint32_t ix = 0; ix < kCount; ++ix) {
+        fbl::AllocChecker ac;
+        obs[ix].reset(new (&ac) CountingObserver(1u << ix));
+        REQUIRE_TRUE(ac.check(), "");
+    }
+
+    TestDispatcher st;
+    for (uint32_t ix = 0; ix < kCount; ++ix)
+        st.AddObserver(obs[ix].get(), nullptr);
+
+    for (uint32_t ix = 0; ix < kCount; ++ix) {
+        st.SetSignals(1u << ix);
+        for (uint32_t jx = 0; jx < kCount; ++jx)
+            EXPECT_EQ(jx <= ix ? 1 : 0, obs[jx]->changes(), "");
+    }
+
+    // The remaining observers keep getting their changes.
+    for (uint32_t ix = 0; ix < kCount; ix += 2u)
+        st.RemoveObserver(obs[ix].get());
+    for (uint32_t ix = 0; ix < kCount; ++ix) {
+        st.SetSignals(1u << ix);
+        EXPECT_EQ((ix % 2u) ? 2 : 1, obs[ix]->changes(), "");
+    }
+    for (uint32_t ix = 1; ix < kCount; ix += 2u)
+        st.RemoveObserver(obs[ix].get());
+
+    END_TEST;
+}
+
+} // namespace watched
+
 #define ST_UNITTEST(fname) UNITTEST(#fname, fname)
 
 UNITTEST_START_TESTCASE(state_tracker_tests)
@@ -189,6 +295,8 @@ ST_UNITTEST(removal::on_initialize)
 ST_UNITTEST(removal::on_state_change_via_update_state)
 ST_UNITTEST(removal::on_cancel)
 ST_UNITTEST(removal::on_cancel_by_key)
+ST_UNITTEST(watched::skips_unwatched)
+ST_UNITTEST(watched::many_distinct_masks)
 
 UNITTEST_END_TESTCASE(
     state_tracker_tests, "statetracker", "StateTracker test", nullptr, nullptr);
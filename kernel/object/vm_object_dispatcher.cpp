@@ -71,6 +71,24 @@ zx_status_t VmObjectDispatcher::Write(user_in_ptr<const void> user_data,
     return vmo_->WriteUser(user_data, offset, length, bytes_written);
 }
 
+zx_status_t VmObjectDispatcher::ReadVector(UserIovecCursor* cursor,
+                                           size_t length,
+                                           uint64_t offset,
+                                           size_t* bytes_read) {
+    canary_.Assert();
+
+    return vmo_->ReadUserVector(cursor, offset, length, bytes_read);
+}
+
+zx_status_t VmObjectDispatcher::WriteVector(UserIovecCursor* cursor,
+                                            size_t length,
+                                            uint64_t offset,
+                                            size_t* bytes_written) {
+    canary_.Assert();
+
+    return vmo_->WriteUserVector(cursor, offset, length, bytes_written);
+}
+
 zx_status_t VmObjectDispatcher::SetSize(uint64_t size) {
     canary_.Assert();
 
@@ -44,7 +44,9 @@ zx_signals_t WaitStateObserver::End() {
     DEBUG_ASSERT(dispatcher_);
     DEBUG_ASSERT(dispatcher_->has_state_tracker());
 
-    dispatcher_->RemoveObserver(this);
+    // State changes that assert none of our watched signals are not passed
+    // on to us, so pick up whatever is asserted now as well.
+    wakeup_reasons_ |= dispatcher_->RemoveObserver(this);
     dispatcher_.reset();
 
     // Return the set of reasons that we may have been woken.  Basically, this
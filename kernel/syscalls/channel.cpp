@@ -129,6 +129,97 @@ zx_status_t sys_channel_read(zx_handle_t handle_value, uint32_t options,
     return result;
 }
 
+zx_status_t sys_channel_read_many(zx_handle_t handle_value, uint32_t options,
+                                  user_inout_ptr<zx_channel_msg_t> user_msgs, uint32_t count,
+                                  user_out_ptr<uint32_t> actual_count) {
+    LTRACEF("handle %x msgs %p count %u\n", handle_value, user_msgs.get(), count);
+
+    if (options)
+        return ZX_ERR_INVALID_ARGS;
+    if (count > ZX_CHANNEL_MAX_BATCH_MSGS)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<ChannelDispatcher> channel;
+    zx_status_t result = up->GetDispatcherWithRights(handle_value, ZX_RIGHT_READ, &channel);
+    if (result != ZX_OK)
+        return result;
+
+    // Like zx_channel_write_etc_many(), an empty batch does nothing.
+    if (count == 0u)
+        return actual_count ? actual_count.copy_to_user(0u) : ZX_OK;
+
+    zx_channel_msg_t msgs[ZX_CHANNEL_MAX_BATCH_MSGS];
+    if (user_msgs.copy_array_from_user(msgs, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    ChannelDispatcher::MessageList packets;
+    result = channel->ReadMany(msgs, count, &packets);
+    if (result == ZX_ERR_BUFFER_TOO_SMALL) {
+        // ReadMany() gives us the size of the next message, which remains
+        // unconsumed.
+        zx_status_t status = user_msgs.copy_array_to_user(msgs, 1u);
+        if (status != ZX_OK)
+            return status;
+        if (actual_count) {
+            status = actual_count.copy_to_user(0u);
+            if (status != ZX_OK)
+                return status;
+        }
+        return result;
+    }
+    if (result != ZX_OK)
+        return result;
+
+    // Report the sizes first: until data has been copied out, every
+    // message can still be put back in the channel, so a bad |user_msgs|
+    // or |actual_count| loses nothing.
+    uint32_t num_msgs = 0u;
+    for (const MessagePacket& msg : packets) {
+        msgs[num_msgs].num_bytes = msg.data_size();
+        msgs[num_msgs].num_handles = msg.num_handles();
+        num_msgs++;
+    }
+    zx_status_t status = user_msgs.copy_array_to_user(msgs, num_msgs);
+    if (status == ZX_OK && actual_count)
+        status = actual_count.copy_to_user(num_msgs);
+    if (status != ZX_OK) {
+        channel->Unread(&packets);
+        return status;
+    }
+
+    // Then the data. A message whose buffer is bad stays in the channel,
+    // along with the ones after it, and the batch ends before it.
+    ChannelDispatcher::MessageList done;
+    uint32_t num_done = 0u;
+    while (!packets.is_empty()) {
+        MessagePacket& msg = packets.front();
+        if (msg.data_size() > 0u &&
+            msg.CopyDataTo(make_user_out_ptr(msgs[num_done].bytes)) != ZX_OK)
+            break;
+        done.push_back(packets.pop_front());
+        num_done++;
+    }
+    channel->Unread(&packets);
+    if (num_done != num_msgs && actual_count)
+        actual_count.copy_to_user(num_done);
+    if (num_done == 0u)
+        return ZX_ERR_INVALID_ARGS;
+
+    // As with zx_channel_read(), write the handles after the data.
+    for (uint32_t ix = 0; ix != num_done; ++ix) {
+        auto msg = done.pop_front();
+        if (msgs[ix].num_handles > 0u) {
+            msg_get_handles(up, msg.get(), make_user_out_ptr(msgs[ix].handles),
+                            msgs[ix].num_handles);
+        }
+        ktrace(TAG_CHANNEL_READ, (uint32_t)channel->get_koid(), msgs[ix].num_bytes,
+               msgs[ix].num_handles, 0);
+    }
+    return ZX_OK;
+}
+
 static zx_status_t channel_read_out(ProcessDispatcher* up,
                                     fbl::unique_ptr<MessagePacket> reply,
                                     zx_channel_call_args_t* args,
@@ -280,6 +371,75 @@ zx_status_t sys_channel_write(zx_handle_t handle_value, uint32_t options,
     return ZX_OK;
 }
 
+zx_status_t sys_channel_write_etc_many(zx_handle_t handle_value, uint32_t options,
+                                       user_in_ptr<const zx_channel_msg_t> user_msgs,
+                                       uint32_t count) {
+    LTRACEF("handle %x msgs %p count %u options 0x%x\n",
+            handle_value, user_msgs.get(), count, options);
+
+    if (options)
+        return ZX_ERR_INVALID_ARGS;
+    if (count > ZX_CHANNEL_MAX_BATCH_MSGS)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<ChannelDispatcher> channel;
+    zx_status_t result = up->GetDispatcherWithRights(handle_value, ZX_RIGHT_WRITE, &channel);
+    if (result != ZX_OK)
+        return result;
+
+    // Build every packet first so that the whole batch is queued on the peer
+    // under one acquisition of its lock, and nothing is sent if any message
+    // is bad.
+    ChannelDispatcher::MessageList msgs;
+    zx_handle_t handles[kMaxMessageHandles];
+    uint32_t total_bytes = 0u;
+    uint32_t total_handles = 0u;
+    for (uint32_t ix = 0; ix != count; ++ix) {
+        zx_channel_msg_t m;
+        if (user_msgs.element_offset(ix).copy_from_user(&m) != ZX_OK) {
+            result = ZX_ERR_INVALID_ARGS;
+            break;
+        }
+
+        fbl::unique_ptr<MessagePacket> msg;
+        result = MessagePacket::Create(make_user_in_ptr(static_cast<const void*>(m.bytes)),
+                                       m.num_bytes, m.num_handles, &msg);
+        if (result != ZX_OK)
+            break;
+
+        if (m.num_handles > 0u) {
+            result = msg_put_handles(up, msg.get(), handles,
+                                     make_user_in_ptr(static_cast<const zx_handle_t*>(m.handles)),
+                                     m.num_handles, static_cast<Dispatcher*>(channel.get()));
+            if (result)
+                break;
+        }
+        total_bytes += m.num_bytes;
+        total_handles += m.num_handles;
+        msgs.push_back(fbl::move(msg));
+    }
+
+    if (result == ZX_OK)
+        result = channel->WriteMany(&msgs);
+
+    if (result != ZX_OK) {
+        // Put back the handles of the messages that were not sent.
+        AutoLock lock(up->handle_table_lock());
+        for (auto& msg : msgs) {
+            msg.set_owns_handles(false);
+            for (size_t ix = 0; ix != msg.num_handles(); ++ix) {
+                up->UndoRemoveHandleLocked(up->MapHandleToValue(msg.handles()[ix]));
+            }
+        }
+        return result;
+    }
+
+    ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(), total_bytes, total_handles, 0);
+    return ZX_OK;
+}
+
 zx_status_t sys_channel_call_noretry(zx_handle_t handle_value, uint32_t options,
                                      zx_time_t deadline,
                                      user_in_ptr<const zx_channel_call_args_t> user_args,
@@ -15,7 +15,9 @@
 #include <object/fifo_dispatcher.h>
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
+#include <object/vm_object_dispatcher.h>
 
+#include <zircon/rights.h>
 #include <zircon/syscalls/policy.h>
 #include <fbl/ref_ptr.h>
 
@@ -84,3 +86,35 @@ zx_status_t sys_fifo_read(zx_handle_t handle, user_out_ptr<void> entries, size_t
 
     return ZX_OK;
 }
+
+zx_status_t sys_fifo_get_vmo(zx_handle_t handle, user_out_handle* vmo_out,
+                             user_out_ptr<uint32_t> endpoint_out) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // Mapping the rings allows both reading and writing the fifo.
+    fbl::RefPtr<FifoDispatcher> fifo;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE,
+                                                     &fifo);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::RefPtr<VmObject> vmo;
+    uint32_t endpoint;
+    status = fifo->GetSharedVmo(&vmo, &endpoint);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::RefPtr<Dispatcher> dispatcher;
+    zx_rights_t rights;
+    status = VmObjectDispatcher::Create(fbl::move(vmo), &dispatcher, &rights);
+    if (status != ZX_OK)
+        return status;
+
+    status = endpoint_out.copy_to_user(endpoint);
+    if (status != ZX_OK)
+        return status;
+
+    // The VMO's size and pages are fixed for the life of the fifo.
+    rights = ZX_RIGHTS_BASIC | ZX_RIGHTS_IO | ZX_RIGHT_MAP;
+    return vmo_out->make(fbl::move(dispatcher), rights);
+}
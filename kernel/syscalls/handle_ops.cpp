@@ -10,12 +10,16 @@
 
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
+#include <fbl/algorithm.h>
 #include <fbl/auto_lock.h>
 
 #include "priv.h"
 
 #define LOCAL_TRACE 0
 
+// zx_handle_close_many() copies in and closes this many handles at a time.
+static constexpr size_t kCloseManyBatch = 64u;
+
 zx_status_t sys_handle_close(zx_handle_t handle_value) {
     LTRACEF("handle %x\n", handle_value);
 
@@ -30,6 +34,34 @@ zx_status_t sys_handle_close(zx_handle_t handle_value) {
     return ZX_OK;
 }
 
+zx_status_t sys_handle_close_many(user_in_ptr<const zx_handle_t> handles, size_t num_handles) {
+    LTRACEF("handles %p num_handles %zu\n", handles.get(), num_handles);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    zx_status_t result = ZX_OK;
+    for (size_t done = 0; done < num_handles;) {
+        size_t count = fbl::min(num_handles - done, kCloseManyBatch);
+        zx_handle_t values[kCloseManyBatch];
+        if (handles.copy_array_from_user(values, count, done) != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+        done += count;
+
+        // The handles are destroyed at the end of each iteration, after the
+        // lock is dropped, so that on_zero_handles() does not run under it.
+        HandleOwner closed[kCloseManyBatch];
+        fbl::AutoLock lock(up->handle_table_lock());
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] == ZX_HANDLE_INVALID)
+                continue;
+            closed[i] = up->RemoveHandleLocked(values[i]);
+            if (!closed[i])
+                result = ZX_ERR_BAD_HANDLE;
+        }
+    }
+    return result;
+}
+
 static zx_status_t handle_dup_replace(
     bool is_replace, zx_handle_t handle_value, zx_rights_t rights,
     user_out_handle* out) {
@@ -37,6 +69,9 @@ static zx_status_t handle_dup_replace(
 
     auto up = ProcessDispatcher::GetCurrent();
 
+    // A replaced handle is destroyed after the lock is dropped, so that
+    // its dispatcher's on_zero_handles() does not run under it.
+    HandleOwner replaced;
     {
         fbl::AutoLock lock(up->handle_table_lock());
         auto source = up->GetHandleLocked(handle_value);
@@ -59,12 +94,82 @@ static zx_status_t handle_dup_replace(
             return status;
 
         if (is_replace)
-            up->RemoveHandleLocked(handle_value);
+            replaced = up->RemoveHandleLocked(handle_value);
     }
 
     return ZX_OK;
 }
 
+// Duplicates or replaces all of |handles|, or none of them.
+static zx_status_t handle_dup_replace_many(
+    bool is_replace, user_in_ptr<const zx_handle_t> handles, uint32_t num_handles,
+    zx_rights_t rights, user_out_ptr<zx_handle_t> out) {
+    LTRACEF("handles %p num_handles %u\n", handles.get(), num_handles);
+
+    if (num_handles > ZX_HANDLE_MAX_BATCH)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    zx_handle_t values[ZX_HANDLE_MAX_BATCH];
+    if (handles.copy_array_from_user(values, num_handles) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // Whatever is left in these when they go out of scope is destroyed
+    // after the lock is dropped.
+    HandleOwner dups[ZX_HANDLE_MAX_BATCH];
+    HandleOwner replaced[ZX_HANDLE_MAX_BATCH];
+    Handle* sources[ZX_HANDLE_MAX_BATCH];
+    {
+        fbl::AutoLock lock(up->handle_table_lock());
+        for (uint32_t i = 0; i < num_handles; i++) {
+            auto source = up->GetHandleLocked(values[i]);
+            if (!source)
+                return ZX_ERR_BAD_HANDLE;
+            // A handle can only be replaced once.
+            for (uint32_t j = 0; is_replace && j < i; j++) {
+                if (sources[j] == source)
+                    return ZX_ERR_BAD_HANDLE;
+            }
+            if (!is_replace && !source->HasRights(ZX_RIGHT_DUPLICATE))
+                return ZX_ERR_ACCESS_DENIED;
+            zx_rights_t dup_rights = rights;
+            if (rights == ZX_RIGHT_SAME_RIGHTS) {
+                dup_rights = source->rights();
+            } else if ((source->rights() & rights) != rights) {
+                return ZX_ERR_INVALID_ARGS;
+            }
+            dups[i] = Handle::Dup(source, dup_rights);
+            if (!dups[i])
+                return ZX_ERR_NO_MEMORY;
+            sources[i] = source;
+        }
+    }
+
+    // The originals stay in the table until the new values have reached
+    // the caller, so a bad |out| leaves the table as it was.
+    zx_handle_t dup_values[ZX_HANDLE_MAX_BATCH];
+    for (uint32_t i = 0; i < num_handles; i++)
+        dup_values[i] = up->MapHandleToValue(dups[i]);
+    if (out.copy_array_to_user(dup_values, num_handles) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    fbl::AutoLock lock(up->handle_table_lock());
+    if (is_replace) {
+        // Another thread may have closed an original while the lock was
+        // dropped; then nothing is replaced.
+        for (uint32_t i = 0; i < num_handles; i++) {
+            if (up->GetHandleLocked(values[i]) != sources[i])
+                return ZX_ERR_BAD_HANDLE;
+        }
+        for (uint32_t i = 0; i < num_handles; i++)
+            replaced[i] = up->RemoveHandleLocked(values[i]);
+    }
+    for (uint32_t i = 0; i < num_handles; i++)
+        up->AddHandleLocked(fbl::move(dups[i]));
+    return ZX_OK;
+}
+
 zx_status_t sys_handle_duplicate(
     zx_handle_t handle_value, zx_rights_t rights, user_out_handle* out) {
     return handle_dup_replace(false, handle_value, rights, out);
@@ -74,3 +179,15 @@ zx_status_t sys_handle_replace(
     zx_handle_t handle_value, zx_rights_t rights, user_out_handle* out) {
     return handle_dup_replace(true, handle_value, rights, out);
 }
+
+zx_status_t sys_handle_duplicate_many(
+    user_in_ptr<const zx_handle_t> handles, uint32_t num_handles, zx_rights_t rights,
+    user_out_ptr<zx_handle_t> out) {
+    return handle_dup_replace_many(false, handles, num_handles, rights, out);
+}
+
+zx_status_t sys_handle_replace_many(
+    user_in_ptr<const zx_handle_t> handles, uint32_t num_handles, zx_rights_t rights,
+    user_out_ptr<zx_handle_t> out) {
+    return handle_dup_replace_many(true, handles, num_handles, rights, out);
+}
@@ -12,6 +12,7 @@
 #include <kernel/stats.h>
 #include <vm/pmm.h>
 #include <lib/heap.h>
+#include <lib/lockstat.h>
 #include <platform.h>
 #include <zircon/types.h>
 
@@ -27,6 +28,7 @@
 #include <fbl/ref_ptr.h>
 
 #include "priv.h"
+#include "syscall_stats.h"
 
 #define LOCAL_TRACE 0
 
@@ -513,6 +515,84 @@ zx_status_t sys_object_get_info(zx_handle_t handle, uint32_t topic,
             return single_record_result(
                 _buffer, buffer_size, _actual, _avail, &stats, sizeof(stats));
         }
+        case ZX_INFO_LOCKSTAT: {
+            auto status = validate_resource(handle, ZX_RSRC_KIND_ROOT);
+            if (status != ZX_OK)
+                return status;
+            if (!lockstat_enabled())
+                return ZX_ERR_NOT_SUPPORTED;
+
+            size_t num_space_for = buffer_size / sizeof(zx_info_lockstat_t);
+            user_out_ptr<zx_info_lockstat_t> lockstat_buf =
+                _buffer.reinterpret<zx_info_lockstat_t>();
+
+            size_t cursor = 0;
+            size_t num_copied = 0;
+            size_t num_locks = 0;
+            zx_info_lockstat_t info;
+            while (lockstat_read(&cursor, &info)) {
+                if (num_copied < num_space_for) {
+                    if (lockstat_buf.copy_array_to_user(&info, 1, num_copied) != ZX_OK)
+                        return ZX_ERR_INVALID_ARGS;
+                    num_copied++;
+                }
+                num_locks++;
+            }
+
+            if (_actual) {
+                zx_status_t status = _actual.copy_to_user(num_copied);
+                if (status != ZX_OK)
+                    return status;
+            }
+            if (_avail) {
+                zx_status_t status = _avail.copy_to_user(num_locks);
+                if (status != ZX_OK)
+                    return status;
+            }
+            return ZX_OK;
+        }
+        case ZX_INFO_SYSCALL_STATS: {
+            // A process handle gives the process's own statistics, and the
+            // root resource the system-wide ones.
+            fbl::RefPtr<ProcessDispatcher> process;
+            zx_rights_t rights;
+            auto status = up->GetDispatcherWithRights(handle, ZX_RIGHT_NONE, &process, &rights);
+            if (status == ZX_ERR_WRONG_TYPE)
+                status = validate_resource(handle, ZX_RSRC_KIND_ROOT);
+            else if (status == ZX_OK && (rights & ZX_RIGHT_READ) == 0)
+                status = ZX_ERR_ACCESS_DENIED;
+            if (status != ZX_OK)
+                return status;
+
+            size_t num_space_for = buffer_size / sizeof(zx_info_syscall_stats_t);
+            user_out_ptr<zx_info_syscall_stats_t> stats_buf =
+                _buffer.reinterpret<zx_info_syscall_stats_t>();
+
+            uint32_t cursor = 0;
+            size_t num_copied = 0;
+            size_t num_syscalls = 0;
+            zx_info_syscall_stats_t info;
+            while (syscall_stats_read(process.get(), &cursor, &info)) {
+                if (num_copied < num_space_for) {
+                    if (stats_buf.copy_array_to_user(&info, 1, num_copied) != ZX_OK)
+                        return ZX_ERR_INVALID_ARGS;
+                    num_copied++;
+                }
+                num_syscalls++;
+            }
+
+            if (_actual) {
+                zx_status_t status = _actual.copy_to_user(num_copied);
+                if (status != ZX_OK)
+                    return status;
+            }
+            if (_avail) {
+                zx_status_t status = _avail.copy_to_user(num_syscalls);
+                if (status != ZX_OK)
+                    return status;
+            }
+            return ZX_OK;
+        }
         case ZX_INFO_RESOURCE: {
             // grab a reference to the dispatcher
             fbl::RefPtr<ResourceDispatcher> resource;
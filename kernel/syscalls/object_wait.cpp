@@ -18,8 +18,10 @@
 #include <object/handle.h>
 #include <object/port_dispatcher.h>
 #include <object/process_dispatcher.h>
+#include <object/tls_slots.h>
 #include <object/wait_state_observer.h>
 
+#include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
 #include <fbl/inline_array.h>
 #include <fbl/ref_ptr.h>
@@ -32,12 +34,113 @@ using fbl::AutoLock;
 
 #define LOCAL_TRACE 0
 
-// TODO(ZX-1349) Re-lower this to 8.
-constexpr uint32_t kMaxWaitHandleCount = 16u;
+constexpr uint32_t kMaxWaitHandleCount = 256u;
 
 // ensure public headers agree
 static_assert(ZX_WAIT_MANY_MAX_ITEMS == kMaxWaitHandleCount, "");
 
+// Waits on up to this many handles are set up on the kernel stack. Larger
+// ones use storage that is allocated once per thread and kept until the
+// thread exits.
+constexpr uint32_t kStackWaitHandleCount = 16u;
+
+namespace {
+
+struct WaitManyStorage {
+    zx_wait_item_t items[kMaxWaitHandleCount];
+    WaitStateObserver observers[kMaxWaitHandleCount];
+};
+
+void FreeWaitManyStorage(void* tls) {
+    delete reinterpret_cast<WaitManyStorage*>(tls);
+}
+
+WaitManyStorage* GetWaitManyStorage() {
+    auto storage = reinterpret_cast<WaitManyStorage*>(tls_get(TLS_ENTRY_WAIT_MANY));
+    if (storage == nullptr) {
+        fbl::AllocChecker ac;
+        storage = new (&ac) WaitManyStorage;
+        if (!ac.check())
+            return nullptr;
+
+        tls_set(TLS_ENTRY_WAIT_MANY, storage);
+        tls_set_callback(TLS_ENTRY_WAIT_MANY, &FreeWaitManyStorage);
+    }
+    return storage;
+}
+
+zx_status_t WaitMany(user_inout_ptr<zx_wait_item_t> user_items, uint32_t count,
+                     zx_time_t deadline, zx_wait_item_t* items,
+                     WaitStateObserver* wait_state_observers) {
+    if (user_items.copy_array_from_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    Event event;
+
+    // We may need to unwind (which can be done outside the lock).
+    zx_status_t result = ZX_OK;
+    bool satisfied = false;
+    size_t num_added = 0;
+    {
+        auto up = ProcessDispatcher::GetCurrent();
+        AutoLock lock(up->handle_table_lock());
+
+        // Check every handle, and whether any of them already asserts the
+        // signals it is waited on for, before adding any observers.
+        for (size_t ix = 0; ix != count; ++ix) {
+            Handle* handle = up->GetHandleLocked(items[ix].handle);
+            if (!handle)
+                return ZX_ERR_BAD_HANDLE;
+            if (!handle->HasRights(ZX_RIGHT_WAIT))
+                return ZX_ERR_ACCESS_DENIED;
+
+            result = handle->dispatcher()->PollSignals(&items[ix].pending);
+            if (result != ZX_OK)
+                return result;
+            if (items[ix].pending & items[ix].waitfor)
+                satisfied = true;
+        }
+
+        for (; !satisfied && num_added != count; ++num_added) {
+            Handle* handle = up->GetHandleLocked(items[num_added].handle);
+            result = wait_state_observers[num_added].Begin(&event, handle, items[num_added].waitfor);
+            if (result != ZX_OK)
+                break;
+        }
+    }
+    if (result != ZX_OK) {
+        for (size_t ix = 0; ix < num_added; ++ix)
+            wait_state_observers[ix].End();
+        return result;
+    }
+
+    if (!satisfied) {
+        // event_wait() will return ZX_OK if already signaled,
+        // even if deadline has passed.  It will return ZX_ERR_TIMED_OUT
+        // after the deadline passes if the event has not been
+        // signaled.
+        result = event.Wait(deadline);
+
+        // Regardless of wait outcome, we must call End().
+        for (size_t ix = 0; ix != count; ++ix)
+            items[ix].pending = wait_state_observers[ix].End();
+    }
+
+    zx_signals_t combined = 0;
+    for (size_t ix = 0; ix != count; ++ix)
+        combined |= items[ix].pending;
+
+    if (user_items.copy_array_to_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    if (combined & ZX_SIGNAL_HANDLE_CLOSED)
+        return ZX_ERR_CANCELED;
+
+    return result;
+}
+
+}  // namespace
+
 zx_status_t sys_object_wait_one(zx_handle_t handle_value,
                                 zx_signals_t signals,
                                 zx_time_t deadline,
@@ -47,6 +150,8 @@ zx_status_t sys_object_wait_one(zx_handle_t handle_value,
     Event event;
 
     zx_status_t result;
+    zx_signals_t signals_state;
+    bool satisfied;
     WaitStateObserver wait_state_observer;
 
     auto up = ProcessDispatcher::GetCurrent();
@@ -59,9 +164,17 @@ zx_status_t sys_object_wait_one(zx_handle_t handle_value,
         if (!handle->HasRights(ZX_RIGHT_WAIT))
             return ZX_ERR_ACCESS_DENIED;
 
-        result = wait_state_observer.Begin(&event, handle, signals);
+        // There is no need for an observer if the wait is already satisfied.
+        result = handle->dispatcher()->PollSignals(&signals_state);
         if (result != ZX_OK)
             return result;
+        satisfied = (signals_state & signals) != 0u;
+
+        if (!satisfied) {
+            result = wait_state_observer.Begin(&event, handle, signals);
+            if (result != ZX_OK)
+                return result;
+        }
     }
 
 #if WITH_LIB_KTRACE
@@ -69,14 +182,16 @@ zx_status_t sys_object_wait_one(zx_handle_t handle_value,
     ktrace(TAG_WAIT_ONE, koid, signals, (uint32_t)deadline, (uint32_t)(deadline >> 32));
 #endif
 
-    // event_wait() will return ZX_OK if already signaled,
-    // even if the deadline has passed.  It will return ZX_ERR_TIMED_OUT
-    // after the deadline passes if the event has not been
-    // signaled.
-    result = event.Wait(deadline);
+    if (!satisfied) {
+        // event_wait() will return ZX_OK if already signaled,
+        // even if the deadline has passed.  It will return ZX_ERR_TIMED_OUT
+        // after the deadline passes if the event has not been
+        // signaled.
+        result = event.Wait(deadline);
 
-    // Regardless of wait outcome, we must call End().
-    auto signals_state = wait_state_observer.End();
+        // Regardless of wait outcome, we must call End().
+        signals_state = wait_state_observer.End();
+    }
 
 #if WITH_LIB_KTRACE
     ktrace(TAG_WAIT_ONE_DONE, koid, signals_state, result, 0);
@@ -107,61 +222,16 @@ zx_status_t sys_object_wait_many(user_inout_ptr<zx_wait_item_t> user_items, uint
     if (count > kMaxWaitHandleCount)
         return ZX_ERR_OUT_OF_RANGE;
 
-    zx_wait_item_t items[kMaxWaitHandleCount];
-    if (user_items.copy_array_from_user(items, count) != ZX_OK)
-        return ZX_ERR_INVALID_ARGS;
-
-    WaitStateObserver wait_state_observers[kMaxWaitHandleCount];
-    Event event;
-
-    // We may need to unwind (which can be done outside the lock).
-    zx_status_t result = ZX_OK;
-    size_t num_added = 0;
-    {
-        auto up = ProcessDispatcher::GetCurrent();
-        AutoLock lock(up->handle_table_lock());
-
-        for (; num_added != count; ++num_added) {
-            Handle* handle = up->GetHandleLocked(items[num_added].handle);
-            if (!handle) {
-                result = ZX_ERR_BAD_HANDLE;
-                break;
-            }
-            if (!handle->HasRights(ZX_RIGHT_WAIT)) {
-                result = ZX_ERR_ACCESS_DENIED;
-                break;
-            }
-
-            result = wait_state_observers[num_added].Begin(&event, handle, items[num_added].waitfor);
-            if (result != ZX_OK)
-                break;
-        }
-    }
-    if (result != ZX_OK) {
-        for (size_t ix = 0; ix < num_added; ++ix)
-            wait_state_observers[ix].End();
-        return result;
+    if (count <= kStackWaitHandleCount) {
+        zx_wait_item_t items[kStackWaitHandleCount];
+        WaitStateObserver wait_state_observers[kStackWaitHandleCount];
+        return WaitMany(user_items, count, deadline, items, wait_state_observers);
     }
 
-    // event_wait() will return ZX_OK if already signaled,
-    // even if deadline has passed.  It will return ZX_ERR_TIMED_OUT
-    // after the deadline passes if the event has not been
-    // signaled.
-    result = event.Wait(deadline);
-
-    // Regardless of wait outcome, we must call End().
-    zx_signals_t combined = 0;
-    for (size_t ix = 0; ix != count; ++ix) {
-        combined |= (items[ix].pending = wait_state_observers[ix].End());
-    }
-
-    if (user_items.copy_array_to_user(items, count) != ZX_OK)
-        return ZX_ERR_INVALID_ARGS;
-
-    if (combined & ZX_SIGNAL_HANDLE_CLOSED)
-        return ZX_ERR_CANCELED;
-
-    return result;
+    WaitManyStorage* storage = GetWaitManyStorage();
+    if (storage == nullptr)
+        return ZX_ERR_NO_MEMORY;
+    return WaitMany(user_items, count, deadline, storage->items, storage->observers);
 }
 
 zx_status_t sys_object_wait_async(zx_handle_t handle_value, zx_handle_t port_handle,
@@ -105,6 +105,45 @@ zx_status_t sys_port_wait(zx_handle_t handle, zx_time_t deadline,
     return ZX_OK;
 }
 
+zx_status_t sys_port_wait_many(zx_handle_t handle, zx_time_t deadline,
+                               user_out_ptr<zx_port_packet_t> packets_out, uint32_t count,
+                               user_out_ptr<uint32_t> actual_count) {
+    LTRACEF("handle %x count %u\n", handle, count);
+
+    if (count == 0u || count > ZX_PORT_WAIT_MANY_MAX_PACKETS)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<PortDispatcher> port;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ, &port);
+    if (status != ZX_OK)
+        return status;
+
+    ktrace(TAG_PORT_WAIT, (uint32_t)port->get_koid(), 0, 0, 0);
+
+    zx_port_packet_t pp[ZX_PORT_WAIT_MANY_MAX_PACKETS];
+    size_t actual = 0u;
+    zx_status_t st = port->DequeueMany(deadline, pp, count, &actual);
+
+    ktrace(TAG_PORT_WAIT_DONE, (uint32_t)port->get_koid(), st, 0, 0);
+
+    if (st != ZX_OK)
+        return st;
+
+    status = packets_out.copy_array_to_user(pp, actual);
+    if (status != ZX_OK)
+        return status;
+
+    if (actual_count) {
+        status = actual_count.copy_to_user(static_cast<uint32_t>(actual));
+        if (status != ZX_OK)
+            return status;
+    }
+
+    return ZX_OK;
+}
+
 zx_status_t sys_port_cancel(zx_handle_t handle, zx_handle_t source, uint64_t key) {
     auto up = ProcessDispatcher::GetCurrent();
 
@@ -0,0 +1,131 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "syscall_stats.h"
+
+#include <arch/ops.h>
+#include <debug.h>
+#include <fbl/alloc_checker.h>
+#include <lk/init.h>
+#include <platform.h>
+#include <string.h>
+#include <zircon/zx-syscall-numbers.h>
+
+namespace {
+
+constexpr size_t kNumBuckets = ZX_SYSCALL_STATS_NUM_BUCKETS;
+
+// Each CPU's counts are only written by that CPU, with interrupts disabled.
+// They are large enough for false sharing between CPUs not to matter.
+struct cpu_syscall_stats {
+    struct {
+        uint64_t count;
+        uint64_t ticks;
+        uint64_t histogram[kNumBuckets];
+    } syscalls[ZX_SYS_COUNT];
+};
+
+cpu_syscall_stats* syscall_cpu_stats;
+uint num_syscall_cpu_stats;
+
+// Nanoseconds per tick, in 32.32 fixed point.
+uint64_t ns_per_tick;
+
+const struct {
+    uint32_t id;
+    uint32_t nargs;
+    const char* name;
+} syscall_info[] = {
+#include <zircon/syscall-ktrace-info.inc>
+};
+
+const char* syscall_names[ZX_SYS_COUNT];
+
+uint64_t ticks_to_ns(uint64_t ticks) {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(ticks) * ns_per_tick) >> 32);
+}
+
+// Bucket 0 holds calls shorter than 256ns, and each following bucket
+// twice the span of the one before.
+size_t bucket_for(uint64_t ns) {
+    if (ns < 256)
+        return 0;
+    size_t log2 = 63 - __builtin_clzll(ns);
+    return log2 - 7 < kNumBuckets ? log2 - 7 : kNumBuckets - 1;
+}
+
+// This runs just before userboot starts the first process, by when all the
+// CPUs are known.
+void syscall_stats_init(uint level) {
+    ns_per_tick = (ZX_SEC(1) << 32) / ticks_per_second();
+
+    for (const auto& info : syscall_info) {
+        if (info.id < ZX_SYS_COUNT)
+            syscall_names[info.id] = info.name;
+    }
+
+    const uint num_cpus = arch_max_num_cpus();
+    fbl::AllocChecker ac;
+    syscall_cpu_stats = new (&ac) cpu_syscall_stats[num_cpus]();
+    if (!ac.check()) {
+        dprintf(INFO, "syscall stats: no memory for %u CPUs\n", num_cpus);
+        return;
+    }
+    num_syscall_cpu_stats = num_cpus;
+}
+
+} // namespace
+
+LK_INIT_HOOK(syscall_stats, syscall_stats_init, LK_INIT_LEVEL_USER - 1);
+
+void syscall_stats_record(ProcessDispatcher* process, uint64_t num, uint64_t ticks) {
+    if (unlikely(num >= ZX_SYS_COUNT))
+        return;
+
+    process->AddSyscallStats(static_cast<uint32_t>(num), ticks);
+
+    const uint cpu = arch_curr_cpu_num();
+    if (unlikely(cpu >= num_syscall_cpu_stats))
+        return;
+    auto* stats = &syscall_cpu_stats[cpu].syscalls[num];
+    stats->count++;
+    stats->ticks += ticks;
+    stats->histogram[bucket_for(ticks_to_ns(ticks))]++;
+}
+
+bool syscall_stats_read(ProcessDispatcher* process, uint32_t* cursor,
+                        zx_info_syscall_stats_t* info) {
+    for (; *cursor < ZX_SYS_COUNT; ++*cursor) {
+        const uint32_t num = *cursor;
+        *info = {};
+        info->syscall = num;
+
+        uint64_t ticks = 0;
+        if (process) {
+            process->GetSyscallStats(num, &info->count, &ticks);
+        } else {
+            // The other CPUs' counts may be mid-update, which at worst makes
+            // the histogram and the count disagree by one.
+            for (uint cpu = 0; cpu < num_syscall_cpu_stats; cpu++) {
+                const auto& stats = syscall_cpu_stats[cpu].syscalls[num];
+                info->count += stats.count;
+                ticks += stats.ticks;
+                for (size_t i = 0; i < kNumBuckets; i++)
+                    info->histogram[i] += stats.histogram[i];
+            }
+        }
+        if (info->count == 0)
+            continue;
+
+        info->total_ns = ticks_to_ns(ticks);
+        if (syscall_names[num])
+            strlcpy(info->name, syscall_names[num], sizeof(info->name));
+        ++*cursor;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <object/process_dispatcher.h>
+#include <zircon/syscalls/object.h>
+
+#include <stdint.h>
+
+// Every syscall is counted and timed, both in the calling process and,
+// along with a latency histogram, in the CPU it returns on. The counts are
+// read through ZX_INFO_SYSCALL_STATS.
+
+// Called with interrupts disabled on the way out of syscall |num|, which
+// took |ticks| since entry.
+void syscall_stats_record(ProcessDispatcher* process, uint64_t num, uint64_t ticks);
+
+// Fills in |info| for the next syscall at or after |*cursor|, which starts
+// at 0, that has been made by |process|, or by anyone if |process| is null,
+// and advances |*cursor| past it. Returns false after the last one.
+bool syscall_stats_read(ProcessDispatcher* process, uint32_t* cursor,
+                        zx_info_syscall_stats_t* info);
@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "priv.h"
+#include "syscall_stats.h"
 #include "vdso-valid-sysret.h"
 
 #define LOCAL_TRACE 0
@@ -42,6 +43,8 @@ inline syscall_result do_syscall(uint64_t syscall_num, uint64_t pc,
 
     CPU_STATS_INC(syscalls);
 
+    const uint64_t start_ticks = current_ticks();
+
     /* re-enable interrupts to maintain kernel preemptiveness
        This must be done after the above ktrace_tiny call, and after the
        above CPU_STATS_INC call as it also calls arch_curr_cpu_num. */
@@ -68,6 +71,8 @@ inline syscall_result do_syscall(uint64_t syscall_num, uint64_t pc,
 
     ktrace_tiny(TAG_SYSCALL_EXIT, (static_cast<uint32_t>(syscall_num << 8)) | arch_curr_cpu_num());
 
+    syscall_stats_record(current_process, syscall_num, current_ticks() - start_ticks);
+
     // The assembler caller will re-disable interrupts at the appropriate time.
     return {ret, thread_is_signaled(get_current_thread())};
 }
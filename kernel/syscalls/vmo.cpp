@@ -11,6 +11,7 @@
 #include <vm/vm_object.h>
 #include <vm/vm_object_paged.h>
 
+#include <lib/user_copy/user_iovec.h>
 #include <lib/user_copy/user_ptr.h>
 
 #include <object/handle.h>
@@ -23,6 +24,54 @@
 
 #define LOCAL_TRACE 0
 
+// Force map the range, even if it crosses multiple mappings, before the VMO
+// is locked to copy into it.
+// TODO(ZX-730): This is a workaround for this bug.  If we start decommitting
+// things, the bug will come back.  We should fix this more properly.
+static zx_status_t force_map_for_read(user_out_ptr<void> data, size_t len) {
+    uint8_t byte = 0;
+    auto int_data = data.reinterpret<uint8_t>();
+    for (size_t i = 0; i < len; i += PAGE_SIZE) {
+        zx_status_t status = int_data.copy_array_to_user(&byte, 1, i);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    if (len > 0) {
+        return int_data.copy_array_to_user(&byte, 1, len - 1);
+    }
+    return ZX_OK;
+}
+
+// Likewise for a range copied out of.
+static zx_status_t force_map_for_write(user_in_ptr<const void> data, size_t len) {
+    uint8_t byte = 0;
+    auto int_data = data.reinterpret<const uint8_t>();
+    for (size_t i = 0; i < len; i += PAGE_SIZE) {
+        zx_status_t status = int_data.copy_array_from_user(&byte, 1, i);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    if (len > 0) {
+        return int_data.copy_array_from_user(&byte, 1, len - 1);
+    }
+    return ZX_OK;
+}
+
+// Copies in the buffer list of zx_vmo_readv() or zx_vmo_writev() and
+// computes its combined size.
+static zx_status_t copy_iovecs_from_user(user_in_ptr<const zx_iovec_t> _vectors, uint32_t count,
+                                         zx_iovec_t* vectors, size_t* len) {
+    if (count > ZX_VMO_MAX_IOVECS)
+        return ZX_ERR_OUT_OF_RANGE;
+    if (_vectors.copy_array_from_user(vectors, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+    if (!UserIovecCursor::TotalCapacity(vectors, count, len))
+        return ZX_ERR_INVALID_ARGS;
+    return ZX_OK;
+}
+
 zx_status_t sys_vmo_create(uint64_t size, uint32_t options,
                            user_out_handle* out) {
     LTRACEF("size %#" PRIx64 "\n", size);
@@ -65,25 +114,9 @@ zx_status_t sys_vmo_read(zx_handle_t handle, user_out_ptr<void> _data,
     if (status != ZX_OK)
         return status;
 
-    // Force map the range, even if it crosses multiple mappings.
-    // TODO(ZX-730): This is a workaround for this bug.  If we start decommitting
-    // things, the bug will come back.  We should fix this more properly.
-    {
-        uint8_t byte = 0;
-        auto int_data = _data.reinterpret<uint8_t>();
-        for (size_t i = 0; i < len; i += PAGE_SIZE) {
-            status = int_data.copy_array_to_user(&byte, 1, i);
-            if (status != ZX_OK) {
-                return status;
-            }
-        }
-        if (len > 0) {
-            status = int_data.copy_array_to_user(&byte, 1, len - 1);
-            if (status != ZX_OK) {
-                return status;
-            }
-        }
-    }
+    status = force_map_for_read(_data, len);
+    if (status != ZX_OK)
+        return status;
 
     // do the read operation
     size_t nread;
@@ -107,25 +140,9 @@ zx_status_t sys_vmo_write(zx_handle_t handle, user_in_ptr<const void> _data,
     if (status != ZX_OK)
         return status;
 
-    // Force map the range, even if it crosses multiple mappings.
-    // TODO(ZX-730): This is a workaround for this bug.  If we start decommitting
-    // things, the bug will come back.  We should fix this more properly.
-    {
-        uint8_t byte = 0;
-        auto int_data = _data.reinterpret<const uint8_t>();
-        for (size_t i = 0; i < len; i += PAGE_SIZE) {
-            status = int_data.copy_array_from_user(&byte, 1, i);
-            if (status != ZX_OK) {
-                return status;
-            }
-        }
-        if (len > 0) {
-            status = int_data.copy_array_from_user(&byte, 1, len - 1);
-            if (status != ZX_OK) {
-                return status;
-            }
-        }
-    }
+    status = force_map_for_write(_data, len);
+    if (status != ZX_OK)
+        return status;
 
     // do the write operation
     size_t nwritten;
@@ -136,6 +153,77 @@ zx_status_t sys_vmo_write(zx_handle_t handle, user_in_ptr<const void> _data,
     return status;
 }
 
+zx_status_t sys_vmo_readv(zx_handle_t handle, user_in_ptr<const zx_iovec_t> _vectors,
+                          uint32_t count, uint64_t offset, user_out_ptr<size_t> _actual) {
+    LTRACEF("handle %x, vectors %p, count %u, offset %#" PRIx64 "\n",
+            handle, _vectors.get(), count, offset);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // lookup the dispatcher from handle
+    fbl::RefPtr<VmObjectDispatcher> vmo;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ, &vmo);
+    if (status != ZX_OK)
+        return status;
+
+    zx_iovec_t vectors[ZX_VMO_MAX_IOVECS];
+    size_t len;
+    status = copy_iovecs_from_user(_vectors, count, vectors, &len);
+    if (status != ZX_OK)
+        return status;
+
+    for (uint32_t i = 0; i < count; i++) {
+        status = force_map_for_read(make_user_out_ptr(vectors[i].buffer), vectors[i].capacity);
+        if (status != ZX_OK)
+            return status;
+    }
+
+    // Fill the buffers in one pass over the VMO.
+    UserIovecCursor cursor(vectors, count);
+    size_t nread;
+    status = vmo->ReadVector(&cursor, len, offset, &nread);
+    if (status == ZX_OK)
+        status = _actual.copy_to_user(nread);
+
+    return status;
+}
+
+zx_status_t sys_vmo_writev(zx_handle_t handle, user_in_ptr<const zx_iovec_t> _vectors,
+                           uint32_t count, uint64_t offset, user_out_ptr<size_t> _actual) {
+    LTRACEF("handle %x, vectors %p, count %u, offset %#" PRIx64 "\n",
+            handle, _vectors.get(), count, offset);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // lookup the dispatcher from handle
+    fbl::RefPtr<VmObjectDispatcher> vmo;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_WRITE, &vmo);
+    if (status != ZX_OK)
+        return status;
+
+    zx_iovec_t vectors[ZX_VMO_MAX_IOVECS];
+    size_t len;
+    status = copy_iovecs_from_user(_vectors, count, vectors, &len);
+    if (status != ZX_OK)
+        return status;
+
+    for (uint32_t i = 0; i < count; i++) {
+        status = force_map_for_write(make_user_in_ptr(static_cast<const void*>(vectors[i].buffer)),
+                                     vectors[i].capacity);
+        if (status != ZX_OK)
+            return status;
+    }
+
+    // Drain the buffers in one pass over the VMO.
+    UserIovecCursor cursor(vectors, count);
+    size_t nwritten;
+    status = vmo->WriteVector(&cursor, len, offset, &nwritten);
+    if (status == ZX_OK)
+        status = _actual.copy_to_user(nwritten);
+
+    return status;
+}
+
 zx_status_t sys_vmo_get_size(zx_handle_t handle, user_out_ptr<uint64_t> _size) {
     LTRACEF("handle %x, sizep %p\n", handle, _size.get());
 
@@ -414,6 +414,10 @@ public:
     // offset modification and locking.
     zx_status_t DecommitRange(size_t offset, size_t len, size_t* decommitted);
 
+    // Convenience wrapper for vmo()->SupplyPages() with the necessary offset
+    // modification and locking. Fails if the mapping is not writable.
+    zx_status_t SupplyPages(size_t offset, size_t len, list_node* pages);
+
     // Map in pages from the underlying vm object, optionally committing pages as it goes
     zx_status_t MapRange(size_t offset, size_t len, bool commit);
 
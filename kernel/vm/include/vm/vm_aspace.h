@@ -116,6 +116,11 @@ public:
     // VMAR in the tree that includes *va*.
     fbl::RefPtr<VmAddressRegionOrMapping> FindRegion(vaddr_t va);
 
+    // Hands the pages on |pages| to the vmo mapped at the page-aligned range
+    // [va, va + len), as VmMapping::SupplyPages() does. Returns
+    // ZX_ERR_NOT_FOUND if the range is not covered by a single mapping.
+    zx_status_t SupplyPages(vaddr_t va, size_t len, list_node* pages);
+
     // For region creation routines
     static const uint VMM_FLAG_VALLOC_SPECIFIC = (1u << 0); // allocate at specific address
     static const uint VMM_FLAG_COMMIT = (1u << 1);          // commit memory up front (no demand paging)
@@ -24,6 +24,7 @@
 #include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 
+class UserIovecCursor;
 class VmMapping;
 
 typedef zx_status_t (*vmo_lookup_fn_t)(void* context, size_t offset, size_t index, paddr_t pa);
@@ -107,6 +108,32 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // read/write operators against a list of user space buffers, as if they
+    // were one buffer
+    virtual zx_status_t ReadUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                                       size_t* bytes_read) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    virtual zx_status_t WriteUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                                        size_t* bytes_written) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // remove the pages backing the page-aligned range [offset, offset + len)
+    // from the vmo and append them, in order, to |pages|. fails without
+    // removing anything unless every page in the range is committed and unpinned.
+    virtual zx_status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // insert the pages on |pages|, which must have come from TakePages(), into the
+    // page-aligned range [offset, offset + len), freeing any pages already committed
+    // there. to every mapping of the vmo this looks like a write of the range.
+    // on success |pages| is left empty, on failure it is untouched.
+    virtual zx_status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     // translate a range of the vmo to physical addresses and store in the buffer
     virtual zx_status_t LookupUser(uint64_t offset, uint64_t len, user_inout_ptr<paddr_t> buffer,
                                    size_t buffer_size) {
@@ -31,6 +31,11 @@ public:
 
     static zx_status_t CreateFromROData(const void* data, size_t size, fbl::RefPtr<VmObject>* vmo);
 
+    // Allocates a page that is not part of any vmo but can be handed to SupplyPages() as
+    // if it had come from TakePages(), for kernel code that fills pages itself before
+    // giving them to userspace. The page is not zeroed. Free it with pmm_free_page().
+    static vm_page_t* AllocUnownedPage(uint32_t pmm_alloc_flags, paddr_t* pa);
+
     zx_status_t Resize(uint64_t size) override;
     zx_status_t ResizeLocked(uint64_t size) override TA_REQ(lock_);
     uint64_t size() const override
@@ -58,10 +63,17 @@ public:
                          size_t* bytes_read) override;
     zx_status_t WriteUser(user_in_ptr<const void> ptr, uint64_t offset, size_t len,
                           size_t* bytes_written) override;
+    zx_status_t ReadUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                               size_t* bytes_read) override;
+    zx_status_t WriteUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                                size_t* bytes_written) override;
 
     zx_status_t LookupUser(uint64_t offset, uint64_t len, user_inout_ptr<paddr_t> buffer,
                            size_t buffer_size) override;
 
+    zx_status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) override;
+    zx_status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) override;
+
     void Dump(uint depth, bool verbose) override;
 
     zx_status_t InvalidateCache(const uint64_t offset, const uint64_t len) override;
@@ -189,6 +189,10 @@ public:
 
     zx_status_t AddPage(vm_page*, uint64_t offset);
     vm_page* GetPage(uint64_t offset);
+    // removes the page at |offset| from the list without freeing it
+    vm_page* RemovePage(uint64_t offset);
+    // swaps |p| into |offset|, which must already hold a page, and returns the old page
+    vm_page* ReplacePage(vm_page* p, uint64_t offset);
     zx_status_t FreePage(uint64_t offset);
     size_t FreeAllPages();
 
@@ -520,6 +520,20 @@ fbl::RefPtr<VmAddressRegionOrMapping> VmAspace::FindRegion(vaddr_t va) {
     }
 }
 
+zx_status_t VmAspace::SupplyPages(vaddr_t va, size_t len, list_node* pages) {
+    canary_.Assert();
+
+    fbl::RefPtr<VmAddressRegionOrMapping> region = FindRegion(va);
+    if (!region || !region->is_mapping()) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    fbl::RefPtr<VmMapping> mapping = region->as_vm_mapping();
+    if (va < mapping->base() || len > mapping->size() - (va - mapping->base())) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    return mapping->SupplyPages(va - mapping->base(), len, pages);
+}
+
 void VmAspace::AttachToThread(thread_t* t) {
     canary_.Assert();
     DEBUG_ASSERT(t);
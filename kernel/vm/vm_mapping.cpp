@@ -545,6 +545,26 @@ zx_status_t VmMapping::DecommitRange(size_t offset, size_t len,
     return object_->DecommitRange(object_offset_ + offset, len, decommitted);
 }
 
+zx_status_t VmMapping::SupplyPages(size_t offset, size_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("%p [%#zx+%#zx], offset %#zx, len %#zx\n",
+            this, base_, size_, offset, len);
+
+    AutoLock guard(aspace_->lock());
+    if (state_ != LifeCycleState::ALIVE) {
+        return ZX_ERR_BAD_STATE;
+    }
+    if (offset + len < offset || offset + len > size_) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+    if (!(arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_WRITE)) {
+        return ZX_ERR_ACCESS_DENIED;
+    }
+    // VmObject::SupplyPages will typically call back into our instance's
+    // VmMapping::UnmapVmoRangeLocked.
+    return object_->SupplyPages(object_offset_ + offset, len, pages);
+}
+
 zx_status_t VmMapping::DestroyLocked() {
     canary_.Assert();
     DEBUG_ASSERT(is_mutex_held(aspace_->lock()));
@@ -15,6 +15,8 @@
 #include <fbl/auto_lock.h>
 #include <inttypes.h>
 #include <lib/console.h>
+#include <lib/counters.h>
+#include <lib/user_copy/user_iovec.h>
 #include <safeint/safe_math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +31,10 @@ using fbl::AutoLock;
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(vm_cow_page_count, "kernel.vm.fault.cow_page");
+KCOUNTER(vm_zero_page_count, "kernel.vm.fault.zero_page");
+KCOUNTER(vm_new_page_count, "kernel.vm.fault.new_page");
+
 namespace {
 
 void ZeroPage(paddr_t pa) {
@@ -338,6 +344,7 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
             DEBUG_ASSERT(src && dst);
 
             memcpy(dst, src, PAGE_SIZE);
+            kcounter_add(vm_cow_page_count, 1u);
 
             // add the new page and return it
             status = AddPageLocked(p_clone, offset);
@@ -363,6 +370,7 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
     // return the single global zero page
     if ((pf_flags & VMM_PF_FLAG_WRITE) == 0) {
         LTRACEF("returning the zero page\n");
+        kcounter_add(vm_zero_page_count, 1u);
         if (page_out)
             *page_out = vm_get_zero_page();
         if (pa_out)
@@ -388,6 +396,7 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
 
     // TODO: remove once pmm returns zeroed pages
     ZeroPage(pa);
+    kcounter_add(vm_new_page_count, 1u);
 
     zx_status_t status = AddPageLocked(p, offset);
     DEBUG_ASSERT(status == ZX_OK);
@@ -999,6 +1008,30 @@ zx_status_t VmObjectPaged::WriteUser(user_in_ptr<const void> ptr, uint64_t offse
     return ReadWriteInternal(offset, len, bytes_written, true, write_routine);
 }
 
+zx_status_t VmObjectPaged::ReadUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                                          size_t* bytes_read) {
+    canary_.Assert();
+
+    // read routine that scatters each page into the next user buffers
+    auto read_routine = [cursor](const void* src, size_t offset, size_t len) -> zx_status_t {
+        return cursor->CopyToUser(src, len);
+    };
+
+    return ReadWriteInternal(offset, len, bytes_read, false, read_routine);
+}
+
+zx_status_t VmObjectPaged::WriteUserVector(UserIovecCursor* cursor, uint64_t offset, size_t len,
+                                           size_t* bytes_written) {
+    canary_.Assert();
+
+    // write routine that gathers each page from the next user buffers
+    auto write_routine = [cursor](void* dst, size_t offset, size_t len) -> zx_status_t {
+        return cursor->CopyFromUser(dst, len);
+    };
+
+    return ReadWriteInternal(offset, len, bytes_written, true, write_routine);
+}
+
 zx_status_t VmObjectPaged::LookupUser(uint64_t offset, uint64_t len, user_inout_ptr<paddr_t> buffer,
                                       size_t buffer_size) {
     canary_.Assert();
@@ -1018,6 +1051,120 @@ zx_status_t VmObjectPaged::LookupUser(uint64_t offset, uint64_t len, user_inout_
     return Lookup(offset, len, 0, copy_to_user, &buffer);
 }
 
+// static
+vm_page_t* VmObjectPaged::AllocUnownedPage(uint32_t pmm_alloc_flags, paddr_t* pa) {
+    vm_page_t* p = pmm_alloc_page(pmm_alloc_flags, pa);
+    if (!p)
+        return nullptr;
+    InitializeVmPage(p);
+    return p;
+}
+
+zx_status_t VmObjectPaged::TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
+
+    if (!IS_PAGE_ALIGNED(offset) || !IS_PAGE_ALIGNED(len))
+        return ZX_ERR_INVALID_ARGS;
+
+    AutoLock a(&lock_);
+
+    if (!InRange(offset, len, size_))
+        return ZX_ERR_OUT_OF_RANGE;
+
+    const uint64_t end = offset + len;
+
+    // every page in the range must be committed and unpinned
+    uint64_t expected_next_off = offset;
+    page_list_.ForEveryPageInRange(
+        [&expected_next_off](const auto p, uint64_t off) {
+            if (off != expected_next_off || p->object.pin_count > 0) {
+                return ZX_ERR_STOP;
+            }
+            expected_next_off = off + PAGE_SIZE;
+            return ZX_ERR_NEXT;
+        },
+        offset, end);
+    if (expected_next_off != end)
+        return ZX_ERR_BAD_STATE;
+
+    // unmap all of the pages in this range on all the mapping regions
+    RangeChangeUpdateLocked(offset, len);
+
+    for (uint64_t off = offset; off < end; off += PAGE_SIZE) {
+        vm_page_t* p = page_list_.RemovePage(off);
+        DEBUG_ASSERT(p);
+        // the page stays in the OBJECT state while it is in transit; free.node
+        // overlays the unused object.offset/obj fields
+        list_add_tail(pages, &p->free.node);
+    }
+
+    return ZX_OK;
+}
+
+zx_status_t VmObjectPaged::SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
+
+    if (!IS_PAGE_ALIGNED(offset) || !IS_PAGE_ALIGNED(len))
+        return ZX_ERR_INVALID_ARGS;
+    if (list_length(pages) != len / PAGE_SIZE)
+        return ZX_ERR_INVALID_ARGS;
+
+    AutoLock a(&lock_);
+
+    if (!InRange(offset, len, size_))
+        return ZX_ERR_OUT_OF_RANGE;
+
+    if (AnyPagesPinnedLocked(offset, len))
+        return ZX_ERR_BAD_STATE;
+
+    const uint64_t end = offset + len;
+
+    // First fill the holes in the range. This is the only step that can fail,
+    // since the page list may need to allocate nodes, so back it out on error.
+    uint64_t off = offset;
+    vm_page_t* p;
+    list_for_every_entry (pages, p, vm_page_t, free.node) {
+        DEBUG_ASSERT(p->state == VM_PAGE_STATE_OBJECT);
+        if (page_list_.GetPage(off) == nullptr) {
+            zx_status_t status = page_list_.AddPage(p, off);
+            if (status != ZX_OK) {
+                vm_page_t* q;
+                uint64_t undo_off = offset;
+                list_for_every_entry (pages, q, vm_page_t, free.node) {
+                    if (undo_off == off)
+                        break;
+                    if (page_list_.GetPage(undo_off) == q)
+                        page_list_.RemovePage(undo_off);
+                    undo_off += PAGE_SIZE;
+                }
+                return status;
+            }
+        }
+        off += PAGE_SIZE;
+    }
+
+    // Then swap out the pages that were already committed.
+    list_node free_list = LIST_INITIAL_VALUE(free_list);
+    off = offset;
+    while ((p = list_remove_head_type(pages, vm_page_t, free.node)) != nullptr) {
+        if (page_list_.GetPage(off) != p) {
+            vm_page_t* old = page_list_.ReplacePage(p, off);
+            list_add_tail(&free_list, &old->free.node);
+        }
+        off += PAGE_SIZE;
+    }
+    DEBUG_ASSERT(off == end);
+
+    // other mappings may have covered this range of the vmo, so unmap it
+    RangeChangeUpdateLocked(offset, len);
+
+    pmm_free(&free_list);
+
+    return ZX_OK;
+}
+
 zx_status_t VmObjectPaged::InvalidateCache(const uint64_t offset, const uint64_t len) {
     return CacheOp(offset, len, CacheOpType::Invalidate);
 }
@@ -113,6 +113,49 @@ vm_page* VmPageList::GetPage(uint64_t offset) {
     return pln->GetPage(index);
 }
 
+vm_page* VmPageList::RemovePage(uint64_t offset) {
+    uint64_t node_offset = ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
+    size_t index = (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
+
+    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, offset, node_offset,
+                  index);
+
+    // lookup the tree node that holds this page
+    auto pln = list_.find(node_offset);
+    if (!pln.IsValid()) {
+        return nullptr;
+    }
+
+    auto page = pln->RemovePage(index);
+    if (page && pln->IsEmpty()) {
+        // if it was the last page in the node, remove the node from the tree
+        LTRACEF_LEVEL(2, "%p freeing the list node\n", this);
+        list_.erase(*pln);
+    }
+
+    return page;
+}
+
+vm_page* VmPageList::ReplacePage(vm_page* p, uint64_t offset) {
+    uint64_t node_offset = ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
+    size_t index = (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
+
+    LTRACEF_LEVEL(2, "%p page %p, offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, p, offset,
+                  node_offset, index);
+
+    // the caller guarantees there is a page here, so the node exists and
+    // swapping the entry does not need to allocate
+    auto pln = list_.find(node_offset);
+    DEBUG_ASSERT(pln.IsValid());
+
+    auto old = pln->RemovePage(index);
+    DEBUG_ASSERT(old);
+    __UNUSED auto status = pln->AddPage(p, index);
+    DEBUG_ASSERT(status == ZX_OK);
+
+    return old;
+}
+
 zx_status_t VmPageList::FreePage(uint64_t offset) {
     uint64_t node_offset = ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
     size_t index = (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
@@ -14,6 +14,7 @@ MODULE_SRCS := \
 
 MODULE_STATIC_LIBS := \
     system/ulib/ddk \
+    system/ulib/shared-fifo \
     system/ulib/sync \
     system/ulib/zx \
     system/ulib/zxcpp \
@@ -32,14 +32,14 @@ constexpr zx_signals_t kSignalFifoTerminate = ZX_USER_SIGNAL_0;
 
 namespace {
 
-void OutOfBandRespond(const zx::fifo& fifo, zx_status_t status, txnid_t txnid) {
+void OutOfBandRespond(shared_fifo_t* fifo, zx_status_t status, txnid_t txnid) {
     block_fifo_response_t response;
     response.status = status;
     response.txnid = txnid;
     response.count = 0;
 
     uint32_t actual;
-    status = fifo.write(&response, sizeof(block_fifo_response_t), &actual);
+    status = shared_fifo_write(fifo, &response, sizeof(block_fifo_response_t), &actual);
     if (status != ZX_OK) {
         fprintf(stderr, "Block Server I/O error: Could not write response\n");
     }
@@ -107,7 +107,7 @@ void BlockServer::Queue(uint32_t flags, zx_handle_t vmo, uint64_t length,
     }
 }
 
-BlockTransaction::BlockTransaction(zx_handle_t fifo, txnid_t txnid) :
+BlockTransaction::BlockTransaction(shared_fifo_t* fifo, txnid_t txnid) :
     fifo_(fifo), flags_(0), ctr_(0) {
     memset(&response_, 0, sizeof(response_));
     response_.txnid = txnid;
@@ -174,8 +174,8 @@ void BlockTransaction::SetResponseReadyLocked() {
 
 void BlockTransaction::RespondLocked() {
     uint32_t actual;
-    zx_status_t status = zx_fifo_write(fifo_, &response_,
-                                       sizeof(block_fifo_response_t), &actual);
+    zx_status_t status = shared_fifo_write(fifo_, &response_,
+                                           sizeof(block_fifo_response_t), &actual);
     if (status != ZX_OK) {
         fprintf(stderr, "Block Server I/O error: Could not write response\n");
     }
@@ -230,11 +230,13 @@ zx_status_t BlockServer::Read(block_fifo_request_t* requests, uint32_t* count) {
     // Keep trying to read messages from the fifo until we have a reason to
     // terminate
     while (true) {
-        zx_status_t status = fifo_.read(requests, sizeof(block_fifo_request_t), count);
+        zx_status_t status = shared_fifo_read(&shared_fifo_, requests,
+                                              sizeof(block_fifo_request_t), count);
         if (status == ZX_ERR_SHOULD_WAIT) {
             zx_signals_t waitfor = ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED | kSignalFifoTerminate;
             zx_signals_t observed;
-            if ((status = fifo_.wait_one(waitfor, zx::time::infinite(), &observed)) != ZX_OK) {
+            if ((status = shared_fifo_wait(&shared_fifo_, waitfor, ZX_TIME_INFINITE,
+                                           &observed)) != ZX_OK) {
                 return status;
             }
             if ((observed & ZX_FIFO_PEER_CLOSED) || (observed & kSignalFifoTerminate)) {
@@ -289,7 +291,7 @@ zx_status_t BlockServer::AllocateTxn(txnid_t* out) {
         if (txns_[i] == nullptr) {
             txnid_t txnid = static_cast<txnid_t>(i);
             fbl::AllocChecker ac;
-            txns_[i] = fbl::AdoptRef(new (&ac) BlockTransaction(fifo_.get(), txnid));
+            txns_[i] = fbl::AdoptRef(new (&ac) BlockTransaction(&shared_fifo_, txnid));
             if (!ac.check()) {
                 return ZX_ERR_NO_MEMORY;
             }
@@ -318,11 +320,16 @@ zx_status_t BlockServer::Create(zx_device_t* dev, block_protocol_t* bp,
     }
 
     zx_status_t status;
-    if ((status = zx::fifo::create(BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE, 0,
+    if ((status = zx::fifo::create(BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE, ZX_FIFO_SHARED,
                                    fifo_out, &bs->fifo_)) != ZX_OK) {
         delete bs;
         return status;
     }
+    if ((status = shared_fifo_init(&bs->shared_fifo_, bs->fifo_.get(),
+                                   BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE)) != ZX_OK) {
+        delete bs;
+        return status;
+    }
 
     if (bp->ops != NULL) {
         bp->ops->query(bp->ctx, &bs->info_, &bs->block_op_size_);
@@ -350,7 +357,7 @@ zx_status_t BlockServer::Serve() {
             if (txnid >= MAX_TXN_COUNT || txns_[txnid] == nullptr) {
                 // Operation which is not accessing a valid txn
                 if (wants_reply) {
-                    OutOfBandRespond(fifo_, ZX_ERR_IO, txnid);
+                    OutOfBandRespond(&shared_fifo_, ZX_ERR_IO, txnid);
                 }
                 continue;
             }
@@ -454,6 +461,7 @@ BlockServer::BlockServer(zx_device_t* dev, block_protocol_t* bp) :
 
 BlockServer::~BlockServer() {
     ShutDown();
+    shared_fifo_destroy(&shared_fifo_);
 }
 
 void BlockServer::ShutDown() {
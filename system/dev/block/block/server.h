@@ -22,6 +22,7 @@
 #include <fbl/ref_counted.h>
 #include <fbl/ref_ptr.h>
 #include <fbl/unique_ptr.h>
+#include <shared-fifo/shared-fifo.h>
 
 // Represents the mapping of "vmoid --> VMO"
 class IoBuffer : public fbl::WAVLTreeContainable<fbl::RefPtr<IoBuffer>>,
@@ -62,7 +63,7 @@ typedef struct {
 
 class BlockTransaction : public fbl::RefCounted<BlockTransaction> {
 public:
-    BlockTransaction(zx_handle_t fifo, txnid_t txnid);
+    BlockTransaction(shared_fifo_t* fifo, txnid_t txnid);
     ~BlockTransaction();
 
     // Verifies that the incoming txn does not break the Block IO fifo protocol.
@@ -90,7 +91,7 @@ private:
     void SetResponseReadyLocked() TA_REQ(lock_);
     void RespondLocked() TA_REQ(lock_);
 
-    const zx_handle_t fifo_;
+    shared_fifo_t* const fifo_;
 
     fbl::Mutex lock_;
     block_msg_t msgs_[MAX_TXN_MESSAGES] TA_GUARDED(lock_);
@@ -125,6 +126,9 @@ private:
                uint64_t vmo_offset, uint64_t dev_offset, block_msg_t* msg);
 
     zx::fifo fifo_;
+    // Requests and responses go through the fifo's shared rings, so a busy
+    // client and server need no syscalls to exchange them.
+    shared_fifo_t shared_fifo_ = {};
     zx_device_t* dev_;
     block_info_t info_;
     block_protocol_t bp_;
@@ -16,6 +16,8 @@
 #include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 
+#include <shared-fifo/shared-fifo.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -97,6 +99,11 @@ typedef struct ethdev {
     zx_handle_t rx_fifo;
     uint32_t rx_depth;
 
+    // The same fifos, through their shared rings. These stay mapped until
+    // release, since tx completions can race with teardown.
+    shared_fifo_t tx_shared;
+    shared_fifo_t rx_shared;
+
     // io buffer
     zx_handle_t io_vmo;
     void* io_buf;
@@ -154,8 +161,7 @@ static void eth_handle_rx(ethdev_t* edev, const void* data, size_t len, uint32_t
     zx_status_t status;
     uint32_t count;
 
-    // TODO: read multiple and cache locally to reduce syscalls
-    if ((status = zx_fifo_read(edev->rx_fifo, &e, sizeof(e), &count)) < 0) {
+    if ((status = shared_fifo_read(&edev->rx_shared, &e, sizeof(e), &count)) < 0) {
         if (status == ZX_ERR_SHOULD_WAIT) {
             if ((edev->fail_rx_read++ % FAIL_REPORT_RATE) == 0) {
                 zxlogf(ERROR, "eth [%s]: no rx buffers available (%u times)\n",
@@ -182,7 +188,7 @@ static void eth_handle_rx(ethdev_t* edev, const void* data, size_t len, uint32_t
         e.flags = ETH_FIFO_RX_OK | extra;
     }
 
-    if ((status = zx_fifo_write(edev->rx_fifo, &e, sizeof(e), &count)) < 0) {
+    if ((status = shared_fifo_write(&edev->rx_shared, &e, sizeof(e), &count)) < 0) {
         if (status == ZX_ERR_SHOULD_WAIT) {
             if ((edev->fail_rx_write++ % FAIL_REPORT_RATE) == 0) {
                 zxlogf(ERROR, "eth [%s]: no rx_fifo space available (%u times)\n",
@@ -214,7 +220,8 @@ static int tx_fifo_write(ethdev_t* edev, eth_fifo_entry_t* entries, uint32_t cou
     zx_status_t status;
     uint32_t actual;
     // Writing should never fail, or fail to write all entries
-    status = zx_fifo_write(edev->tx_fifo, entries, sizeof(eth_fifo_entry_t) * count, &actual);
+    status = shared_fifo_write(&edev->tx_shared, entries, sizeof(eth_fifo_entry_t) * count,
+                               &actual);
     if (status < 0) {
         zxlogf(ERROR, "eth [%s]: tx_fifo write failed %d\n", edev->name, status);
         return -1;
@@ -356,15 +363,15 @@ static int eth_tx_thread(void* arg) {
     uint32_t count;
 
     for (;;) {
-        if ((status = zx_fifo_read(edev->tx_fifo, entries, sizeof(entries), &count)) < 0) {
+        if ((status = shared_fifo_read(&edev->tx_shared, entries, sizeof(entries), &count)) < 0) {
             if (status == ZX_ERR_SHOULD_WAIT) {
                 zx_signals_t observed;
-                if ((status = zx_object_wait_one(edev->tx_fifo,
-                                                 ZX_FIFO_READABLE |
-                                                 ZX_FIFO_PEER_CLOSED |
-                                                 kSignalFifoTerminate,
-                                                 ZX_TIME_INFINITE,
-                                                 &observed)) < 0) {
+                if ((status = shared_fifo_wait(&edev->tx_shared,
+                                               ZX_FIFO_READABLE |
+                                               ZX_FIFO_PEER_CLOSED |
+                                               kSignalFifoTerminate,
+                                               ZX_TIME_INFINITE,
+                                               &observed)) < 0) {
                     zxlogf(ERROR, "eth [%s]: tx_fifo: error waiting: %d\n", edev->name, status);
                     break;
                 }
@@ -397,17 +404,29 @@ static zx_status_t eth_get_fifos_locked(ethdev_t* edev, void* out_buf, size_t ou
 
     eth_fifos_t* fifos = out_buf;
 
+    // Shared fifos let the driver and clients that map them exchange
+    // entries without a syscall per packet. Other clients are unaffected.
     zx_status_t status;
-    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, 0, &fifos->tx_fifo, &edev->tx_fifo)) < 0) {
+    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, ZX_FIFO_SHARED,
+                                 &fifos->tx_fifo, &edev->tx_fifo)) < 0) {
         zxlogf(ERROR, "eth_create  [%s]: failed to create tx fifo: %d\n", edev->name, status);
         return status;
     }
-    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, 0, &fifos->rx_fifo, &edev->rx_fifo)) < 0) {
+    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, ZX_FIFO_SHARED,
+                                 &fifos->rx_fifo, &edev->rx_fifo)) < 0) {
         zxlogf(ERROR, "eth_create  [%s]: failed to create rx fifo: %d\n", edev->name, status);
-        zx_handle_close(fifos->tx_fifo);
-        zx_handle_close(edev->tx_fifo);
-        edev->tx_fifo = ZX_HANDLE_INVALID;
-        return status;
+        goto fail_tx;
+    }
+    if ((status = shared_fifo_init(&edev->tx_shared, edev->tx_fifo,
+                                   FIFO_DEPTH, FIFO_ESIZE)) < 0) {
+        zxlogf(ERROR, "eth_create  [%s]: failed to map tx fifo: %d\n", edev->name, status);
+        goto fail_rx;
+    }
+    if ((status = shared_fifo_init(&edev->rx_shared, edev->rx_fifo,
+                                   FIFO_DEPTH, FIFO_ESIZE)) < 0) {
+        zxlogf(ERROR, "eth_create  [%s]: failed to map rx fifo: %d\n", edev->name, status);
+        shared_fifo_destroy(&edev->tx_shared);
+        goto fail_rx;
     }
 
     edev->tx_depth = FIFO_DEPTH;
@@ -417,6 +436,16 @@ static zx_status_t eth_get_fifos_locked(ethdev_t* edev, void* out_buf, size_t ou
 
     *out_actual = sizeof(*fifos);
     return ZX_OK;
+
+fail_rx:
+    zx_handle_close(fifos->rx_fifo);
+    zx_handle_close(edev->rx_fifo);
+    edev->rx_fifo = ZX_HANDLE_INVALID;
+fail_tx:
+    zx_handle_close(fifos->tx_fifo);
+    zx_handle_close(edev->tx_fifo);
+    edev->tx_fifo = ZX_HANDLE_INVALID;
+    return status;
 }
 
 static ssize_t eth_set_iobuf_locked(ethdev_t* edev, const void* in_buf, size_t in_len) {
@@ -677,6 +706,7 @@ static void eth_kill_locked(ethdev_t* edev) {
     if (edev->rx_fifo) {
         zx_handle_close(edev->rx_fifo);
         edev->rx_fifo = ZX_HANDLE_INVALID;
+        edev->rx_shared.handle = ZX_HANDLE_INVALID;
     }
     if (edev->tx_fifo) {
         // Ask the TX thread to exit.
@@ -697,6 +727,7 @@ static void eth_kill_locked(ethdev_t* edev) {
     if (edev->tx_fifo) {
         zx_handle_close(edev->tx_fifo);
         edev->tx_fifo = ZX_HANDLE_INVALID;
+        edev->tx_shared.handle = ZX_HANDLE_INVALID;
     }
 
     if (edev->io_buf) {
@@ -712,6 +743,8 @@ static void eth_release(void* ctx) {
     ethdev_t* edev = ctx;
     if (edev) {
         free(edev->paddr_map);
+        shared_fifo_destroy(&edev->tx_shared);
+        shared_fifo_destroy(&edev->rx_shared);
     }
     free(edev);
 }
@@ -10,7 +10,7 @@ MODULE_TYPE := driver
 
 MODULE_SRCS := $(LOCAL_DIR)/ethernet.c
 
-MODULE_STATIC_LIBS := system/ulib/ddk
+MODULE_STATIC_LIBS := system/ulib/ddk system/ulib/shared-fifo
 
 MODULE_LIBS := system/ulib/driver system/ulib/zircon system/ulib/c
 
@@ -65,18 +65,31 @@ static zx_status_t ktrace_ioctl(void* ctx, uint32_t op,
         *out_actual = sizeof(uint32_t);
         return ZX_OK;
     }
-    case IOCTL_KTRACE_START: {
+    case IOCTL_KTRACE_START:
+    case IOCTL_KTRACE_START_CIRCULAR: {
         if (cmdlen != sizeof(uint32_t)) {
             return ZX_ERR_INVALID_ARGS;
         }
         uint32_t group_mask = *(uint32_t *)cmd;
-        return zx_ktrace_control(get_root_resource(), KTRACE_ACTION_START, group_mask, NULL);
+        uint32_t action = (op == IOCTL_KTRACE_START) ?
+            KTRACE_ACTION_START : KTRACE_ACTION_START_CIRCULAR;
+        return zx_ktrace_control(get_root_resource(), action, group_mask, NULL);
     }
     case IOCTL_KTRACE_STOP: {
         zx_ktrace_control(get_root_resource(), KTRACE_ACTION_STOP, 0, NULL);
         zx_ktrace_control(get_root_resource(), KTRACE_ACTION_REWIND, 0, NULL);
         return ZX_OK;
     }
+    case IOCTL_KTRACE_PROFILE_START: {
+        if (cmdlen != sizeof(uint32_t)) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        uint32_t period_us = *(uint32_t *)cmd;
+        return zx_ktrace_control(get_root_resource(), KTRACE_ACTION_PROFILE_START,
+                                 period_us, NULL);
+    }
+    case IOCTL_KTRACE_PROFILE_STOP:
+        return zx_ktrace_control(get_root_resource(), KTRACE_ACTION_PROFILE_STOP, 0, NULL);
     default:
         return ZX_ERR_INVALID_ARGS;
     }
@@ -0,0 +1,413 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Turns the samples taken by the kernel's sampling profiler into the folded
+// stacks that flamegraph.pl reads, one line per distinct stack:
+//
+//   process;thread;outermost frame;...;innermost frame count
+//
+// The samples come from a ktrace buffer, as read from /dev/misc/ktrace.
+
+#include <cxxabi.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <zircon/ktrace.h>
+
+namespace {
+
+// Just enough of ELF64 to find the symbol tables, so that the tool builds
+// on hosts without <elf.h>.
+struct Elf64Ehdr {
+    uint8_t e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct Elf64Shdr {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+};
+
+struct Elf64Sym {
+    uint32_t st_name;
+    uint8_t st_info;
+    uint8_t st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+};
+
+constexpr uint32_t kShtSymtab = 2;
+constexpr uint32_t kShtDynsym = 11;
+constexpr uint8_t kSttFunc = 2;
+
+bool ReadFile(const char* path, std::vector<uint8_t>* data) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        fprintf(stderr, "error: cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    data->clear();
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "error: cannot read %s\n", path);
+    }
+    return ok;
+}
+
+std::string Demangle(const char* name) {
+    int status;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (demangled == nullptr) {
+        return name;
+    }
+    std::string result(demangled);
+    free(demangled);
+    return result;
+}
+
+// The functions of one ELF file, loaded at |base|.
+class Module {
+public:
+    bool Load(const char* path, uint64_t base) {
+        name_ = path;
+        if (const char* slash = strrchr(path, '/')) {
+            name_ = slash + 1;
+        }
+        base_ = base;
+
+        std::vector<uint8_t> data;
+        if (!ReadFile(path, &data)) {
+            return false;
+        }
+        Elf64Ehdr ehdr;
+        if (data.size() < sizeof(ehdr) || memcmp(data.data(), "\x7f" "ELF", 4) != 0 ||
+            data[4] != 2) {
+            fprintf(stderr, "error: %s is not a 64-bit ELF file\n", path);
+            return false;
+        }
+        memcpy(&ehdr, data.data(), sizeof(ehdr));
+        if (ehdr.e_shentsize != sizeof(Elf64Shdr) ||
+            ehdr.e_shoff + ehdr.e_shnum * sizeof(Elf64Shdr) > data.size()) {
+            fprintf(stderr, "error: %s has bad section headers\n", path);
+            return false;
+        }
+        std::vector<Elf64Shdr> shdrs(ehdr.e_shnum);
+        memcpy(shdrs.data(), &data[ehdr.e_shoff], ehdr.e_shnum * sizeof(Elf64Shdr));
+
+        // Prefer the full symbol table to the dynamic one.
+        for (uint32_t type : {kShtSymtab, kShtDynsym}) {
+            for (const Elf64Shdr& shdr : shdrs) {
+                if (shdr.sh_type == type && shdr.sh_link < shdrs.size()) {
+                    AddSymbols(data, shdr, shdrs[shdr.sh_link]);
+                }
+            }
+            if (!symbols_.empty()) {
+                break;
+            }
+        }
+        std::sort(symbols_.begin(), symbols_.end(),
+                  [](const Symbol& a, const Symbol& b) { return a.addr < b.addr; });
+        return true;
+    }
+
+    bool Contains(uint64_t pc) const {
+        return pc >= base_ && !symbols_.empty() && pc - base_ < symbols_.back().end;
+    }
+
+    // Returns the function containing |pc|, or the module offset.
+    std::string Symbolize(uint64_t pc) const {
+        uint64_t addr = pc - base_;
+        auto it = std::upper_bound(symbols_.begin(), symbols_.end(), addr,
+                                   [](uint64_t a, const Symbol& s) { return a < s.addr; });
+        if (it != symbols_.begin() && addr < (--it)->end) {
+            return it->name;
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "+0x%" PRIx64, addr);
+        return name_ + buf;
+    }
+
+private:
+    struct Symbol {
+        uint64_t addr;
+        uint64_t end;
+        std::string name;
+    };
+
+    void AddSymbols(const std::vector<uint8_t>& data, const Elf64Shdr& symtab,
+                    const Elf64Shdr& strtab) {
+        if (symtab.sh_offset + symtab.sh_size > data.size() ||
+            strtab.sh_offset + strtab.sh_size > data.size()) {
+            return;
+        }
+        const char* strings = reinterpret_cast<const char*>(&data[strtab.sh_offset]);
+        for (uint64_t off = 0; off + sizeof(Elf64Sym) <= symtab.sh_size;
+             off += sizeof(Elf64Sym)) {
+            Elf64Sym sym;
+            memcpy(&sym, &data[symtab.sh_offset + off], sizeof(sym));
+            if ((sym.st_info & 0xf) != kSttFunc || sym.st_value == 0 ||
+                sym.st_name >= strtab.sh_size ||
+                memchr(strings + sym.st_name, 0, strtab.sh_size - sym.st_name) == nullptr) {
+                continue;
+            }
+            uint64_t size = sym.st_size ? sym.st_size : 1;
+            symbols_.push_back({sym.st_value, sym.st_value + size,
+                                Demangle(strings + sym.st_name)});
+        }
+    }
+
+    std::string name_;
+    uint64_t base_ = 0;
+    std::vector<Symbol> symbols_;
+};
+
+struct Sample {
+    uint64_t pid;
+    uint64_t tid;
+    // Innermost first.
+    std::vector<uint64_t> kernel_pcs;
+};
+
+class Profile {
+public:
+    std::vector<Module> modules;
+
+    void AddName(uint32_t tag, const ktrace_rec_name_t* rec, size_t len) {
+        size_t max = len - offsetof(ktrace_rec_name_t, name);
+        std::string name(rec->name, strnlen(rec->name, max));
+        if (KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_PROC_NAME)) {
+            process_names_[rec->id] = name;
+        } else if (KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_THREAD_NAME)) {
+            thread_names_[rec->id] = name;
+        } else if (KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_KTHREAD_NAME)) {
+            kthread_names_[rec->id] = name;
+        }
+    }
+
+    void AddSample(const uint64_t* args, size_t num_args) {
+        Sample sample = {args[0], args[1], {args + 2, args + num_args}};
+        if (sample.pid == 0) {
+            // Kernel threads have no user stack to wait for.
+            Fold(sample, nullptr);
+        } else {
+            pending_[sample.tid].push_back(std::move(sample));
+        }
+    }
+
+    // A user stack belongs to all the samples that were taken from the thread
+    // since it last returned to user mode.
+    void AddUserStack(const uint64_t* args, size_t num_args) {
+        std::vector<uint64_t> user_pcs(args + 2, args + num_args);
+        auto it = pending_.find(args[1]);
+        if (it == pending_.end()) {
+            return;
+        }
+        for (const Sample& sample : it->second) {
+            Fold(sample, &user_pcs);
+        }
+        pending_.erase(it);
+    }
+
+    void Print() {
+        // Keep the samples whose user stacks were never written.
+        for (const auto& entry : pending_) {
+            for (const Sample& sample : entry.second) {
+                Fold(sample, nullptr);
+            }
+        }
+        pending_.clear();
+        for (const auto& entry : stacks_) {
+            printf("%s %" PRIu64 "\n", entry.first.c_str(), entry.second);
+        }
+    }
+
+    uint64_t num_samples() const { return num_samples_; }
+
+private:
+    std::string Name(const std::map<uint64_t, std::string>& names, uint64_t id) {
+        auto it = names.find(id);
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%" PRIu64, id);
+        return it == names.end() ? std::string(buf) : it->second + "-" + buf;
+    }
+
+    // Every PC but the innermost is a return address, which may be past the
+    // end of the calling function.
+    std::string Symbolize(uint64_t pc, bool innermost) {
+        if (!innermost) {
+            pc -= 1;
+        }
+        for (const Module& module : modules) {
+            if (module.Contains(pc)) {
+                return module.Symbolize(pc);
+            }
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "0x%" PRIx64, pc);
+        return buf;
+    }
+
+    static void Append(std::string* stack, std::string frame) {
+        // The folded format separates frames with ';' and ends with a space.
+        std::replace(frame.begin(), frame.end(), ';', ':');
+        std::replace(frame.begin(), frame.end(), ' ', '_');
+        *stack += ';';
+        *stack += frame;
+    }
+
+    void Fold(const Sample& sample, const std::vector<uint64_t>* user_pcs) {
+        std::string stack = sample.pid ? Name(process_names_, sample.pid) : "kernel";
+        Append(&stack, Name(sample.pid ? thread_names_ : kthread_names_, sample.tid));
+        if (user_pcs) {
+            for (size_t i = user_pcs->size(); i-- > 0;) {
+                Append(&stack, Symbolize((*user_pcs)[i], i == 0 && sample.kernel_pcs.empty()));
+            }
+        }
+        for (size_t i = sample.kernel_pcs.size(); i-- > 0;) {
+            Append(&stack, Symbolize(sample.kernel_pcs[i], i == 0));
+        }
+        stacks_[stack]++;
+        num_samples_++;
+    }
+
+    std::map<uint64_t, std::string> process_names_;
+    std::map<uint64_t, std::string> thread_names_;
+    std::map<uint64_t, std::string> kthread_names_;
+    std::map<uint64_t, std::vector<Sample>> pending_;
+    std::map<std::string, uint64_t> stacks_;
+    uint64_t num_samples_ = 0;
+};
+
+bool ReadTrace(const std::vector<uint8_t>& data, Profile* profile) {
+    size_t off = 0;
+    while (off + sizeof(uint32_t) <= data.size()) {
+        uint32_t tag;
+        memcpy(&tag, &data[off], sizeof(tag));
+        size_t len = KTRACE_LEN(tag);
+        if (len == 0) {
+            break;
+        }
+        if (off + len > data.size()) {
+            fprintf(stderr, "warning: trace ends in a partial record\n");
+            break;
+        }
+
+        if (KTRACE_GROUP(tag) & KTRACE_GRP_META) {
+            if (len > offsetof(ktrace_rec_name_t, name)) {
+                std::vector<uint8_t> buf(&data[off], &data[off] + len);
+                profile->AddName(tag, reinterpret_cast<const ktrace_rec_name_t*>(buf.data()), len);
+            }
+        } else if (len >= KTRACE_HDRSIZE + 2 * sizeof(uint64_t) &&
+                   (KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_PROFILE_SAMPLE) ||
+                    KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_PROFILE_USER_STACK))) {
+            size_t num_args = (len - KTRACE_HDRSIZE) / sizeof(uint64_t);
+            std::vector<uint64_t> args(num_args);
+            memcpy(args.data(), &data[off + KTRACE_HDRSIZE], num_args * sizeof(uint64_t));
+            if (KTRACE_EVENT(tag) == KTRACE_EVENT(TAG_PROFILE_SAMPLE)) {
+                profile->AddSample(args.data(), num_args);
+            } else {
+                profile->AddUserStack(args.data(), num_args);
+            }
+        }
+        off += len;
+    }
+    return true;
+}
+
+void Usage(FILE* f) {
+    fprintf(f, "usage: ktrace-profile [options] <ktrace file>\n");
+    fprintf(f, "Prints the profiler samples in a ktrace buffer as folded stacks.\n");
+    fprintf(f, "options:\n");
+    fprintf(f, "  -k <file>         Symbolize kernel frames with zircon.elf\n");
+    fprintf(f, "  -u <file>@<addr>  Symbolize user frames with an ELF file loaded at <addr>\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Profile profile;
+    const char* trace_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            Usage(stdout);
+            return 0;
+        } else if (!strcmp(arg, "-k") && i + 1 < argc) {
+            Module module;
+            if (!module.Load(argv[++i], 0)) {
+                return 1;
+            }
+            profile.modules.push_back(std::move(module));
+        } else if (!strcmp(arg, "-u") && i + 1 < argc) {
+            std::string spec(argv[++i]);
+            size_t at = spec.rfind('@');
+            char* end = nullptr;
+            uint64_t base = at == std::string::npos
+                                ? 0
+                                : strtoull(spec.c_str() + at + 1, &end, 16);
+            if (at == std::string::npos || end == nullptr || *end != 0) {
+                fprintf(stderr, "error: expected <file>@<addr>, not '%s'\n", spec.c_str());
+                return 1;
+            }
+            Module module;
+            if (!module.Load(spec.substr(0, at).c_str(), base)) {
+                return 1;
+            }
+            profile.modules.push_back(std::move(module));
+        } else if (arg[0] != '-' && trace_path == nullptr) {
+            trace_path = arg;
+        } else {
+            Usage(stderr);
+            return 1;
+        }
+    }
+    if (trace_path == nullptr) {
+        Usage(stderr);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(trace_path, &data) || !ReadTrace(data, &profile)) {
+        return 1;
+    }
+    profile.Print();
+    fprintf(stderr, "%" PRIu64 " samples\n", profile.num_samples());
+    return 0;
+}
@@ -0,0 +1,722 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Summarizes the scheduler's behavior from a ktrace buffer, as read from
+// /dev/misc/ktrace:
+//
+//  - how busy each CPU was, and how much of that was interrupt handling
+//  - how long each thread waited to run once it was runnable
+//  - how long each interrupt vector's handlers took
+//  - which threads woke which others the most
+//
+// It can also write the per-CPU timelines as the JSON that chrome://tracing
+// reads. The trace is streamed through a fixed-size buffer, so memory use
+// grows with the number of threads in the trace rather than its length.
+// The records must be in timestamp order, which is how the kernel hands
+// them out.
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zircon/ktrace.h>
+
+namespace {
+
+// Values of the outgoing thread's state in a context switch record.
+constexpr uint32_t kThreadReady = 1;
+constexpr uint32_t kThreadBlocked = 3;
+constexpr uint32_t kThreadSleeping = 4;
+constexpr uint32_t kThreadSuspended = 5;
+constexpr uint32_t kThreadDeath = 6;
+
+// Guards against a corrupt cpu number sizing the tables.
+constexpr uint32_t kMaxCpus = 256;
+
+// How deeply interrupt handlers may nest on one CPU before we lose track.
+constexpr size_t kMaxIrqDepth = 4;
+
+// Bucket 0 counts times under 1us, and bucket i > 0 times in
+// [2^(i-1), 2^i) us. The last bucket also counts anything longer.
+constexpr size_t kNumBuckets = 24;
+
+const char* StateName(uint32_t state) {
+    switch (state) {
+    case kThreadReady:
+        return "preempted";
+    case kThreadBlocked:
+        return "blocked";
+    case kThreadSleeping:
+        return "sleeping";
+    case kThreadSuspended:
+        return "suspended";
+    case kThreadDeath:
+        return "exited";
+    default:
+        return "other";
+    }
+}
+
+uint64_t BucketLimitUs(size_t bucket) {
+    return uint64_t(1) << bucket;
+}
+
+class Histogram {
+public:
+    void Add(uint64_t ns) {
+        uint64_t us = ns / 1000;
+        size_t bucket = 0;
+        while (us > 0 && bucket < kNumBuckets - 1) {
+            us >>= 1;
+            bucket++;
+        }
+        counts_[bucket]++;
+        count_++;
+        total_ns_ += ns;
+        max_ns_ = std::max(max_ns_, ns);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t total_ns() const { return total_ns_; }
+    uint64_t max_ns() const { return max_ns_; }
+    double avg_us() const { return count_ ? total_ns_ / 1000.0 / count_ : 0.0; }
+
+    // Returns the upper bound, in microseconds, of the bucket holding the
+    // given fraction of the samples.
+    uint64_t PercentileUs(double fraction) const {
+        uint64_t target = static_cast<uint64_t>(fraction * count_ + 0.5);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kNumBuckets; i++) {
+            seen += counts_[i];
+            if (seen >= target && seen > 0) {
+                return BucketLimitUs(i);
+            }
+        }
+        return BucketLimitUs(kNumBuckets - 1);
+    }
+
+    void Print(const char* indent) const {
+        uint64_t most = *std::max_element(counts_, counts_ + kNumBuckets);
+        for (size_t i = 0; i < kNumBuckets; i++) {
+            if (counts_[i] == 0) {
+                continue;
+            }
+            char range[32];
+            if (i == 0) {
+                snprintf(range, sizeof(range), "< 1us");
+            } else {
+                snprintf(range, sizeof(range), "%" PRIu64 "-%" PRIu64 "us",
+                         BucketLimitUs(i - 1), BucketLimitUs(i));
+            }
+            int width = static_cast<int>(counts_[i] * 40 / most);
+            printf("%s%16s %10" PRIu64 " %.*s\n", indent, range, counts_[i],
+                   width > 0 ? width : 1, "########################################");
+        }
+    }
+
+private:
+    uint64_t counts_[kNumBuckets] = {};
+    uint64_t count_ = 0;
+    uint64_t total_ns_ = 0;
+    uint64_t max_ns_ = 0;
+};
+
+// A thread, keyed by its kernel thread pointer. User threads also have
+// their koid, which is 0 for kernel threads.
+struct Thread {
+    uint32_t tid = 0;
+    bool idle = false;
+    std::string name;
+
+    // When the thread last became runnable, or 0 if it is not waiting to run.
+    uint64_t ready_ts = 0;
+
+    uint64_t run_ns = 0;
+    uint64_t wakeups = 0;
+    uint64_t preemptions = 0;
+
+    // Time from becoming runnable to running.
+    Histogram wait;
+};
+
+struct Cpu {
+    bool seen = false;
+
+    // The first and the latest context switch on this CPU.
+    uint64_t start_ts = 0;
+    uint64_t switch_ts = 0;
+
+    uint32_t current = 0;
+    bool current_idle = false;
+
+    uint64_t idle_ns = 0;
+    uint64_t irq_ns = 0;
+    uint64_t irq_in_idle_ns = 0;
+    uint64_t switches = 0;
+
+    size_t irq_depth = 0;
+    uint32_t irq_vector[kMaxIrqDepth];
+    uint64_t irq_ts[kMaxIrqDepth];
+};
+
+// Writes Chrome trace JSON as the events come, without holding on to them.
+// The CPUs appear as the threads of a pseudo-process.
+class JsonWriter {
+public:
+    ~JsonWriter() {
+        if (file_) {
+            fprintf(file_, "\n]}\n");
+            fclose(file_);
+        }
+    }
+
+    bool Open(const char* path) {
+        file_ = fopen(path, "w");
+        if (file_ == nullptr) {
+            fprintf(stderr, "error: cannot create %s: %s\n", path, strerror(errno));
+            return false;
+        }
+        fprintf(file_, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        return true;
+    }
+
+    bool enabled() const { return file_ != nullptr; }
+
+    void NameCpu(uint32_t cpu) {
+        Begin();
+        fprintf(file_, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,"
+                       "\"args\":{\"name\":\"CPU %u\"}}",
+                cpu, cpu);
+    }
+
+    void Slice(uint32_t cpu, const char* category, const std::string& name, double ts_us,
+               double dur_us, const char* args) {
+        Begin();
+        fprintf(file_, "{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                       "\"cat\":\"%s\",\"name\":",
+                cpu, ts_us, dur_us, category);
+        String(name);
+        fprintf(file_, ",\"args\":{%s}}", args);
+    }
+
+    void Instant(uint32_t cpu, const char* category, const std::string& name, double ts_us) {
+        Begin();
+        fprintf(file_, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                       "\"cat\":\"%s\",\"name\":",
+                cpu, ts_us, category);
+        String(name);
+        fputc('}', file_);
+    }
+
+private:
+    void Begin() {
+        if (first_) {
+            fprintf(file_, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,"
+                           "\"args\":{\"name\":\"CPUs\"}}");
+            first_ = false;
+        }
+        fprintf(file_, ",\n");
+    }
+
+    void String(const std::string& s) {
+        fputc('"', file_);
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                fputc('\\', file_);
+                fputc(c, file_);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                fprintf(file_, "\\u%04x", c);
+            } else {
+                fputc(c, file_);
+            }
+        }
+        fputc('"', file_);
+    }
+
+    FILE* file_ = nullptr;
+    bool first_ = true;
+};
+
+class Analyzer {
+public:
+    JsonWriter json;
+
+    void AddRecord(uint32_t tag, const uint8_t* data, size_t len) {
+        num_records_++;
+        const uint32_t event = KTRACE_EVENT(tag);
+        if (KTRACE_GROUP(tag) & KTRACE_GRP_META) {
+            AddMetadata(tag, data, len);
+            return;
+        }
+        if (len < KTRACE_HDRSIZE) {
+            return;
+        }
+        ktrace_rec_32b_t rec = {};
+        memcpy(&rec, data, std::min(len, sizeof(rec)));
+        if (num_timed_++ == 0) {
+            first_ts_ = rec.ts;
+        }
+        if (rec.ts < last_ts_) {
+            out_of_order_++;
+        }
+        last_ts_ = std::max(last_ts_, rec.ts);
+
+        if (event == KTRACE_EVENT(TAG_CONTEXT_SWITCH) && len >= KTRACE_RECSIZE) {
+            ContextSwitch(rec);
+        } else if (event == KTRACE_EVENT(TAG_THREAD_WAKEUP) && len >= KTRACE_RECSIZE) {
+            Wakeup(rec);
+        } else if (event == KTRACE_EVENT(TAG_IRQ_ENTER)) {
+            IrqEnter(rec.ts, rec.tid >> 8, rec.tid & 0xff);
+        } else if (event == KTRACE_EVENT(TAG_IRQ_EXIT)) {
+            IrqExit(rec.ts, rec.tid >> 8, rec.tid & 0xff);
+        }
+    }
+
+    // Accounts for whatever is still running at the end of the trace.
+    void Finish() {
+        for (uint32_t cpu = 0; cpu < cpus_.size(); cpu++) {
+            Cpu& c = cpus_[cpu];
+            if (c.seen) {
+                Thread& t = threads_[c.current];
+                EndRun(cpu, &t, last_ts_, "running");
+            }
+        }
+    }
+
+    void Print(size_t top, bool histograms) {
+        if (ticks_per_ms_ == 0) {
+            fprintf(stderr, "warning: no tick rate in the trace, assuming nanoseconds\n");
+        }
+        if (out_of_order_) {
+            fprintf(stderr, "warning: %" PRIu64 " records were out of timestamp order\n",
+                    out_of_order_);
+        }
+        uint64_t switches = 0;
+        for (const Cpu& c : cpus_) {
+            switches += c.switches;
+        }
+        printf("%.3f ms, %" PRIu64 " records, %" PRIu64 " context switches, "
+               "%" PRIu64 " wakeups\n",
+               Ns(last_ts_ - first_ts_) / 1e6, num_records_, switches, num_wakeups_);
+        if (num_wakeups_ == 0 && switches > 0) {
+            printf("(no wakeup records: this kernel does not trace them, so only\n"
+                   " preempted threads have wait times)\n");
+        }
+
+        printf("\n%-5s %8s %8s %8s %10s\n", "cpu", "busy%", "irq%", "idle%", "switches");
+        for (uint32_t cpu = 0; cpu < cpus_.size(); cpu++) {
+            const Cpu& c = cpus_[cpu];
+            if (!c.seen) {
+                continue;
+            }
+            double known = Ns(last_ts_ - c.start_ts);
+            if (known <= 0) {
+                continue;
+            }
+            double idle = static_cast<double>(c.idle_ns - std::min(c.idle_ns, c.irq_in_idle_ns));
+            printf("%-5u %8.2f %8.2f %8.2f %10" PRIu64 "\n", cpu,
+                   100.0 * (known - idle) / known, 100.0 * c.irq_ns / known,
+                   100.0 * idle / known, c.switches);
+        }
+
+        std::vector<const std::pair<const uint32_t, Thread>*> threads;
+        for (const auto& entry : threads_) {
+            if (!entry.second.idle && entry.second.wait.count() > 0) {
+                threads.push_back(&entry);
+            }
+        }
+        std::sort(threads.begin(), threads.end(), [](const std::pair<const uint32_t, Thread>* a,
+                                                     const std::pair<const uint32_t, Thread>* b) {
+            return a->second.wait.total_ns() > b->second.wait.total_ns();
+        });
+        if (threads.size() > top) {
+            threads.resize(top);
+        }
+        printf("\nrunnable wait, by total\n");
+        printf("%-36s %10s %8s %8s %10s %8s %8s %10s\n", "thread", "run(ms)", "wakeups",
+               "preempts", "avg(us)", "p50<(us)", "p99<(us)", "max(us)");
+        for (const auto* entry : threads) {
+            const Thread& t = entry->second;
+            printf("%-36.36s %10.3f %8" PRIu64 " %8" PRIu64 " %10.1f %8" PRIu64 " %8" PRIu64
+                   " %10.1f\n",
+                   ThreadName(entry->first).c_str(), t.run_ns / 1e6, t.wakeups, t.preemptions,
+                   t.wait.avg_us(), t.wait.PercentileUs(0.5), t.wait.PercentileUs(0.99),
+                   t.wait.max_ns() / 1e3);
+            if (histograms) {
+                t.wait.Print("    ");
+            }
+        }
+
+        if (!irqs_.empty()) {
+            printf("\ninterrupt handlers\n");
+            printf("%-20s %10s %12s %10s %8s %10s\n", "irq", "count", "total(us)", "avg(us)",
+                   "p99<(us)", "max(us)");
+            for (const auto& entry : irqs_) {
+                const Histogram& h = entry.second;
+                printf("%-20.20s %10" PRIu64 " %12.1f %10.2f %8" PRIu64 " %10.1f\n",
+                       IrqName(entry.first).c_str(), h.count(), h.total_ns() / 1e3, h.avg_us(),
+                       h.PercentileUs(0.99), h.max_ns() / 1e3);
+                if (histograms) {
+                    h.Print("    ");
+                }
+            }
+        }
+
+        if (!wakers_.empty()) {
+            std::vector<std::pair<uint64_t, std::pair<uint32_t, uint32_t>>> wakers;
+            for (const auto& entry : wakers_) {
+                wakers.push_back({entry.second, entry.first});
+            }
+            std::sort(wakers.begin(), wakers.end(),
+                      [](const std::pair<uint64_t, std::pair<uint32_t, uint32_t>>& a,
+                         const std::pair<uint64_t, std::pair<uint32_t, uint32_t>>& b) {
+                          return a.first > b.first;
+                      });
+            if (wakers.size() > top) {
+                wakers.resize(top);
+            }
+            printf("\ntop wakers\n");
+            printf("%10s  %s\n", "wakeups", "waker -> woken");
+            for (const auto& entry : wakers) {
+                printf("%10" PRIu64 "  %s -> %s\n", entry.first,
+                       entry.second.first ? ThreadName(entry.second.first).c_str() : "(irq)",
+                       ThreadName(entry.second.second).c_str());
+            }
+        }
+    }
+
+private:
+    void AddMetadata(uint32_t tag, const uint8_t* data, size_t len) {
+        const uint32_t event = KTRACE_EVENT(tag);
+        if (event == KTRACE_EVENT(TAG_TICKS_PER_MS) && len >= KTRACE_RECSIZE) {
+            ktrace_rec_32b_t rec;
+            memcpy(&rec, data, sizeof(rec));
+            ticks_per_ms_ = (static_cast<uint64_t>(rec.b) << 32) | rec.a;
+            return;
+        }
+        if (event < KTRACE_EVENT(TAG_KTHREAD_NAME) || len <= KTRACE_NAMESIZE) {
+            return;
+        }
+        ktrace_rec_name_t rec;
+        memcpy(&rec, data, offsetof(ktrace_rec_name_t, name));
+        const char* name = reinterpret_cast<const char*>(data) + KTRACE_NAMESIZE;
+        std::string s(name, strnlen(name, len - KTRACE_NAMESIZE));
+        if (event == KTRACE_EVENT(TAG_KTHREAD_NAME)) {
+            kthread_names_[rec.id] = s;
+        } else if (event == KTRACE_EVENT(TAG_THREAD_NAME)) {
+            thread_names_[rec.id] = s;
+            thread_pids_[rec.id] = rec.arg;
+        } else if (event == KTRACE_EVENT(TAG_PROC_NAME)) {
+            process_names_[rec.id] = s;
+        } else if (event == KTRACE_EVENT(TAG_IRQ_NAME)) {
+            irq_names_[rec.id] = s;
+        }
+    }
+
+    Thread& GetThread(uint32_t kt, uint32_t tid) {
+        auto it = threads_.find(kt);
+        if (it == threads_.end()) {
+            it = threads_.emplace(kt, Thread()).first;
+            auto name = kthread_names_.find(kt);
+            it->second.idle = name != kthread_names_.end() &&
+                              name->second.compare(0, 5, "idle ") == 0;
+        }
+        Thread& t = it->second;
+        if (tid != 0 && t.tid != tid) {
+            // A new thread at the address of one that has exited.
+            t.tid = tid;
+            t.name.clear();
+        }
+        return t;
+    }
+
+    std::string ThreadName(uint32_t kt) {
+        Thread& t = threads_[kt];
+        if (!t.name.empty()) {
+            return t.name;
+        }
+        char buf[32];
+        if (t.tid != 0) {
+            auto name = thread_names_.find(t.tid);
+            auto pid = thread_pids_.find(t.tid);
+            std::string process;
+            if (pid != thread_pids_.end()) {
+                auto it = process_names_.find(pid->second);
+                if (it != process_names_.end()) {
+                    process = it->second + ":";
+                }
+            }
+            snprintf(buf, sizeof(buf), "%u", t.tid);
+            t.name = process + (name != thread_names_.end() ? name->second + "-" : "") + buf;
+        } else {
+            auto name = kthread_names_.find(kt);
+            snprintf(buf, sizeof(buf), "%#x", kt);
+            t.name = name != kthread_names_.end() ? "kernel:" + name->second
+                                                  : std::string("kernel:") + buf;
+        }
+        return t.name;
+    }
+
+    std::string IrqName(uint32_t vector) {
+        auto it = irq_names_.find(vector);
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%u", vector);
+        return it == irq_names_.end() ? std::string(buf) : it->second + "-" + buf;
+    }
+
+    double Ns(uint64_t ticks) const {
+        return ticks_per_ms_ ? static_cast<double>(ticks) * 1e6 / static_cast<double>(ticks_per_ms_)
+                             : static_cast<double>(ticks);
+    }
+
+    double Us(uint64_t ts) const { return Ns(ts - first_ts_) / 1e3; }
+
+    Cpu* GetCpu(uint32_t cpu) {
+        if (cpu >= kMaxCpus) {
+            return nullptr;
+        }
+        if (cpu >= cpus_.size()) {
+            cpus_.resize(cpu + 1);
+        }
+        return &cpus_[cpu];
+    }
+
+    // Ends |t|'s time on |cpu|, which started at the CPU's last switch.
+    void EndRun(uint32_t cpu, Thread* t, uint64_t ts, const char* how) {
+        Cpu& c = cpus_[cpu];
+        uint64_t ns = static_cast<uint64_t>(Ns(ts - c.switch_ts));
+        t->run_ns += ns;
+        if (c.current_idle) {
+            c.idle_ns += ns;
+        } else if (json.enabled()) {
+            char args[64];
+            snprintf(args, sizeof(args), "\"end\":\"%s\"", how);
+            json.Slice(cpu, "sched", ThreadName(c.current), Us(c.switch_ts), ns / 1e3, args);
+        }
+    }
+
+    void ContextSwitch(const ktrace_rec_32b_t& rec) {
+        const uint32_t cpu = rec.b & 0xffff;
+        const uint32_t state = rec.b >> 16;
+        Cpu* c = GetCpu(cpu);
+        if (c == nullptr) {
+            return;
+        }
+        Thread& from = GetThread(rec.c, rec.tid);
+        Thread& to = GetThread(rec.d, rec.a);
+
+        if (c->seen) {
+            EndRun(cpu, &from, rec.ts, StateName(state));
+        } else {
+            c->seen = true;
+            c->start_ts = rec.ts;
+            if (json.enabled()) {
+                json.NameCpu(cpu);
+            }
+        }
+        c->switches++;
+
+        // A preempted thread is runnable straight away; a blocked one waits
+        // for a wakeup.
+        if (state == kThreadReady && !from.idle) {
+            from.ready_ts = rec.ts;
+            from.preemptions++;
+        } else {
+            from.ready_ts = 0;
+        }
+        if (to.ready_ts != 0) {
+            to.wait.Add(static_cast<uint64_t>(Ns(rec.ts - to.ready_ts)));
+            to.ready_ts = 0;
+        }
+
+        c->current = rec.d;
+        c->current_idle = to.idle;
+        c->switch_ts = rec.ts;
+    }
+
+    void Wakeup(const ktrace_rec_32b_t& rec) {
+        const uint32_t cpu = rec.b & 0xffff;
+        const uint32_t flags = rec.b >> 16;
+        num_wakeups_++;
+        Thread& woken = GetThread(rec.a, 0);
+        woken.ready_ts = rec.ts;
+        woken.wakeups++;
+        // Threads are keyed by the low 32 bits of their address, as in
+        // CONTEXT_SWITCH records. Interrupt handlers are waker 0.
+        uint32_t waker = 0;
+        if (!(flags & KTRACE_WAKEUP_FROM_IRQ)) {
+            waker = rec.d;
+            GetThread(waker, rec.tid);
+        }
+        wakers_[std::make_pair(waker, rec.a)]++;
+        if (json.enabled() && GetCpu(cpu) != nullptr && cpus_[cpu].seen) {
+            json.Instant(cpu, "wakeup", "wake " + ThreadName(rec.a), Us(rec.ts));
+        }
+    }
+
+    void IrqEnter(uint64_t ts, uint32_t vector, uint32_t cpu) {
+        Cpu* c = GetCpu(cpu);
+        if (c == nullptr) {
+            return;
+        }
+        if (c->irq_depth < kMaxIrqDepth) {
+            c->irq_vector[c->irq_depth] = vector;
+            c->irq_ts[c->irq_depth] = ts;
+        }
+        c->irq_depth++;
+    }
+
+    void IrqExit(uint64_t ts, uint32_t vector, uint32_t cpu) {
+        Cpu* c = GetCpu(cpu);
+        if (c == nullptr || c->irq_depth == 0) {
+            // The trace started inside the handler.
+            return;
+        }
+        c->irq_depth--;
+        if (c->irq_depth >= kMaxIrqDepth || c->irq_vector[c->irq_depth] != vector) {
+            return;
+        }
+        uint64_t ns = static_cast<uint64_t>(Ns(ts - c->irq_ts[c->irq_depth]));
+        irqs_[vector].Add(ns);
+        if (c->irq_depth == 0) {
+            // Nested handlers are already part of the outermost one.
+            c->irq_ns += ns;
+            if (c->current_idle) {
+                c->irq_in_idle_ns += ns;
+            }
+        }
+        if (json.enabled() && c->seen) {
+            json.Slice(cpu, "irq", "irq " + IrqName(vector), Us(c->irq_ts[c->irq_depth]),
+                       ns / 1e3, "");
+        }
+    }
+
+    uint64_t ticks_per_ms_ = 0;
+    uint64_t num_timed_ = 0;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;
+    uint64_t num_records_ = 0;
+    uint64_t num_wakeups_ = 0;
+    uint64_t out_of_order_ = 0;
+
+    std::map<uint32_t, std::string> kthread_names_;
+    std::map<uint32_t, std::string> thread_names_;
+    std::map<uint32_t, uint32_t> thread_pids_;
+    std::map<uint32_t, std::string> process_names_;
+    std::map<uint32_t, std::string> irq_names_;
+
+    std::map<uint32_t, Thread> threads_;
+    std::vector<Cpu> cpus_;
+    std::map<uint32_t, Histogram> irqs_;
+
+    // (waker, woken) kernel thread pairs.
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> wakers_;
+};
+
+bool ReadTrace(const char* path, Analyzer* analyzer) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        fprintf(stderr, "error: cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t have = 0;
+    bool eof = false;
+    while (!eof) {
+        size_t n = fread(buf + have, 1, sizeof(buf) - have, f);
+        have += n;
+        eof = n == 0;
+
+        size_t off = 0;
+        while (off + sizeof(uint32_t) <= have) {
+            uint32_t tag;
+            memcpy(&tag, buf + off, sizeof(tag));
+            size_t len = KTRACE_LEN(tag);
+            if (len == 0) {
+                // The rest of the buffer was never written.
+                eof = true;
+                have = off;
+                break;
+            }
+            if (off + len > have) {
+                break;
+            }
+            analyzer->AddRecord(tag, buf + off, len);
+            off += len;
+        }
+        memmove(buf, buf + off, have - off);
+        have -= off;
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "error: cannot read %s\n", path);
+    } else if (have > 0) {
+        fprintf(stderr, "warning: trace ends in a partial record\n");
+    }
+    return ok;
+}
+
+void Usage(FILE* f) {
+    fprintf(f, "usage: ktrace-sched [options] <ktrace file>\n");
+    fprintf(f, "Prints CPU use, scheduling latency, interrupt and wakeup statistics.\n");
+    fprintf(f, "options:\n");
+    fprintf(f, "  -j <file>   Also write the CPU timelines as Chrome trace JSON\n");
+    fprintf(f, "  -n <count>  Show this many threads and wakers (default 20)\n");
+    fprintf(f, "  -H          Print latency histograms\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Analyzer analyzer;
+    const char* trace_path = nullptr;
+    size_t top = 20;
+    bool histograms = false;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            Usage(stdout);
+            return 0;
+        } else if (!strcmp(arg, "-j") && i + 1 < argc) {
+            if (!analyzer.json.Open(argv[++i])) {
+                return 1;
+            }
+        } else if (!strcmp(arg, "-n") && i + 1 < argc) {
+            char* end;
+            top = strtoul(argv[++i], &end, 0);
+            if (*end != 0) {
+                fprintf(stderr, "error: bad count '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(arg, "-H")) {
+            histograms = true;
+        } else if (arg[0] != '-' && trace_path == nullptr) {
+            trace_path = arg;
+        } else {
+            Usage(stderr);
+            return 1;
+        }
+    }
+    if (trace_path == nullptr) {
+        Usage(stderr);
+        return 1;
+    }
+
+    if (!ReadTrace(trace_path, &analyzer)) {
+        return 1;
+    }
+    analyzer.Finish();
+    analyzer.Print(top, histograms);
+    return 0;
+}
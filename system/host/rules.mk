@@ -10,6 +10,8 @@ HOSTAPPS := \
 	$(LOCAL_DIR)/fidl/rules.mk \
 	$(LOCAL_DIR)/fvm/rules.mk \
 	$(LOCAL_DIR)/kernel-buildsig/rules.mk \
+	$(LOCAL_DIR)/ktrace-profile/rules.mk \
+	$(LOCAL_DIR)/ktrace-sched/rules.mk \
 	$(LOCAL_DIR)/loglistener/rules.mk \
 	$(LOCAL_DIR)/mdi/rules.mk \
 	$(LOCAL_DIR)/merkleroot/rules.mk \
@@ -19,6 +21,7 @@ HOSTAPPS := \
 	$(LOCAL_DIR)/mkkdtb/rules.mk \
 	$(LOCAL_DIR)/netprotocol/rules.mk \
 	$(LOCAL_DIR)/sysgen/rules.mk \
+	$(LOCAL_DIR)/trace2json/rules.mk \
 	$(LOCAL_DIR)/h2md/rules.mk \
 
 include $(HOSTAPPS)
@@ -0,0 +1,24 @@
+# Copyright 2018 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := hostapp
+
+MODULE_SRCS += $(LOCAL_DIR)/trace2json.cpp
+
+MODULE_COMPILEFLAGS := \
+    -Isystem/ulib/trace-engine/include \
+    -Isystem/ulib/trace-reader/include \
+    -Isystem/ulib/fbl/include
+
+MODULE_HOST_LIBS := \
+    system/ulib/trace-reader.hostlib \
+    system/ulib/fbl.hostlib
+
+MODULE_HOST_SYSLIBS := -lpthread
+
+include make/module.mk
@@ -0,0 +1,450 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Converts a trace in the Fuchsia trace format into the JSON that
+// chrome://tracing and catapult read.
+//
+// The trace is read with trace::IndexedTraceReader, so that a time range,
+// a thread or a category can be picked out of a large trace without
+// decoding the rest of it, and the records are decoded on several threads.
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <trace-reader/indexed_reader.h>
+
+namespace {
+
+// How the blocks are split up for the decoding threads. The output of
+// each wave of slices is held in memory until it is written out in order.
+constexpr size_t kBlocksPerSlice = 16u;
+constexpr size_t kSlicesPerThread = 4u;
+
+void Usage(FILE* f) {
+    fprintf(f, "Usage: trace2json [options] <trace> [<output.json>]\n");
+    fprintf(f, "Converts a trace into Chrome's JSON trace format, on stdout by default.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -j <threads>        Decode on this many threads (default: one per CPU)\n");
+    fprintf(f, " -b <us>             Skip the records before this many microseconds\n");
+    fprintf(f, "                     into the trace\n");
+    fprintf(f, " -e <us>             Skip the records from this many microseconds on\n");
+    fprintf(f, " -t <pid>/<tid>      Only the records of this thread\n");
+    fprintf(f, " -c <category>       Only the events in this category\n");
+    fprintf(f, " -s                  Print statistics about the trace to stderr\n");
+}
+
+void AppendString(std::string* out, const char* data, size_t length) {
+    out->push_back('"');
+    for (size_t i = 0; i < length; i++) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        switch (c) {
+        case '"':
+            out->append("\\\"");
+            break;
+        case '\\':
+            out->append("\\\\");
+            break;
+        case '\n':
+            out->append("\\n");
+            break;
+        default:
+            if (c < 0x20) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out->append(escape);
+            } else {
+                out->push_back(static_cast<char>(c));
+            }
+            break;
+        }
+    }
+    out->push_back('"');
+}
+
+void AppendString(std::string* out, const fbl::String& string) {
+    AppendString(out, string.data(), string.length());
+}
+
+void AppendFormat(std::string* out, const char* format, ...) __PRINTFLIKE(2, 3);
+void AppendFormat(std::string* out, const char* format, ...) {
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out->append(buffer);
+}
+
+void AppendArgumentValue(std::string* out, const trace::ArgumentValue& value) {
+    switch (value.type()) {
+    case trace::ArgumentType::kInt32:
+        AppendFormat(out, "%" PRId32, value.GetInt32());
+        break;
+    case trace::ArgumentType::kUint32:
+        AppendFormat(out, "%" PRIu32, value.GetUint32());
+        break;
+    case trace::ArgumentType::kInt64:
+        AppendFormat(out, "%" PRId64, value.GetInt64());
+        break;
+    case trace::ArgumentType::kUint64:
+        AppendFormat(out, "%" PRIu64, value.GetUint64());
+        break;
+    case trace::ArgumentType::kDouble:
+        AppendFormat(out, "%.17g", value.GetDouble());
+        break;
+    case trace::ArgumentType::kString:
+        AppendString(out, value.GetString());
+        break;
+    case trace::ArgumentType::kPointer:
+        AppendFormat(out, "\"0x%" PRIx64 "\"", value.GetPointer());
+        break;
+    case trace::ArgumentType::kKoid:
+        AppendFormat(out, "%" PRIu64, value.GetKoid());
+        break;
+    default:
+        out->append("null");
+        break;
+    }
+}
+
+void AppendArguments(std::string* out, const fbl::Vector<trace::Argument>& arguments) {
+    out->append(",\"args\":{");
+    for (size_t i = 0; i < arguments.size(); i++) {
+        if (i > 0)
+            out->push_back(',');
+        AppendString(out, arguments[i].name());
+        out->push_back(':');
+        AppendArgumentValue(out, arguments[i].value());
+    }
+    out->push_back('}');
+}
+
+class Converter {
+public:
+    explicit Converter(trace_ticks_t ticks_per_second)
+        : ticks_per_second_(ticks_per_second) {}
+
+    // Appends |record| to |out| as a JSON object, preceded by a comma.
+    void AppendRecord(std::string* out, const trace::Record& record) const;
+
+    // Appends the process and thread names from a kernel object record.
+    void AppendNames(std::string* out, const trace::Record& record) const;
+
+private:
+    void AppendCommon(std::string* out, const char* phase, trace_ticks_t timestamp,
+                      const trace::ProcessThread& process_thread) const;
+
+    trace_ticks_t const ticks_per_second_;
+};
+
+void Converter::AppendCommon(std::string* out, const char* phase, trace_ticks_t timestamp,
+                             const trace::ProcessThread& process_thread) const {
+    const double micros = static_cast<double>(timestamp) * 1000000.0 /
+                          static_cast<double>(ticks_per_second_);
+    AppendFormat(out, ",\n{\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%" PRIu64 ",\"tid\":%" PRIu64,
+                 phase, micros, process_thread.process_koid(), process_thread.thread_koid());
+}
+
+void Converter::AppendRecord(std::string* out, const trace::Record& record) const {
+    switch (record.type()) {
+    case trace::RecordType::kEvent: {
+        const auto& event = record.GetEvent();
+        const char* phase = nullptr;
+        bool has_id = false;
+        uint64_t id = 0u;
+        switch (event.type()) {
+        case trace::EventType::kInstant:
+            phase = "i";
+            break;
+        case trace::EventType::kCounter:
+            phase = "C";
+            has_id = true;
+            id = event.data.GetCounter().id;
+            break;
+        case trace::EventType::kDurationBegin:
+            phase = "B";
+            break;
+        case trace::EventType::kDurationEnd:
+            phase = "E";
+            break;
+        case trace::EventType::kAsyncBegin:
+            phase = "b";
+            has_id = true;
+            id = event.data.GetAsyncBegin().id;
+            break;
+        case trace::EventType::kAsyncInstant:
+            phase = "n";
+            has_id = true;
+            id = event.data.GetAsyncInstant().id;
+            break;
+        case trace::EventType::kAsyncEnd:
+            phase = "e";
+            has_id = true;
+            id = event.data.GetAsyncEnd().id;
+            break;
+        case trace::EventType::kFlowBegin:
+            phase = "s";
+            has_id = true;
+            id = event.data.GetFlowBegin().id;
+            break;
+        case trace::EventType::kFlowStep:
+            phase = "t";
+            has_id = true;
+            id = event.data.GetFlowStep().id;
+            break;
+        case trace::EventType::kFlowEnd:
+            phase = "f";
+            has_id = true;
+            id = event.data.GetFlowEnd().id;
+            break;
+        default:
+            return;
+        }
+        AppendCommon(out, phase, event.timestamp, event.process_thread);
+        out->append(",\"cat\":");
+        AppendString(out, event.category);
+        out->append(",\"name\":");
+        AppendString(out, event.name);
+        if (has_id)
+            AppendFormat(out, ",\"id\":\"0x%" PRIx64 "\"", id);
+        if (event.type() == trace::EventType::kInstant) {
+            switch (event.data.GetInstant().scope) {
+            case trace::EventScope::kGlobal:
+                out->append(",\"s\":\"g\"");
+                break;
+            case trace::EventScope::kProcess:
+                out->append(",\"s\":\"p\"");
+                break;
+            default:
+                out->append(",\"s\":\"t\"");
+                break;
+            }
+        }
+        if (event.type() == trace::EventType::kFlowEnd)
+            out->append(",\"bp\":\"e\"");
+        AppendArguments(out, event.arguments);
+        out->push_back('}');
+        break;
+    }
+    case trace::RecordType::kContextSwitch: {
+        // Shown as an instant event on the incoming thread.
+        const auto& context_switch = record.GetContextSwitch();
+        AppendCommon(out, "i", context_switch.timestamp, context_switch.incoming_thread);
+        AppendFormat(out, ",\"cat\":\"sched\",\"name\":\"context_switch\",\"s\":\"t\","
+                          "\"args\":{\"cpu\":%u,\"outgoing_pid\":%" PRIu64
+                          ",\"outgoing_tid\":%" PRIu64 ",\"outgoing_state\":%u}}",
+                     static_cast<unsigned>(context_switch.cpu_number),
+                     context_switch.outgoing_thread.process_koid(),
+                     context_switch.outgoing_thread.thread_koid(),
+                     static_cast<unsigned>(context_switch.outgoing_thread_state));
+        break;
+    }
+    case trace::RecordType::kLog: {
+        const auto& log = record.GetLog();
+        AppendCommon(out, "i", log.timestamp, log.process_thread);
+        out->append(",\"cat\":\"log\",\"name\":\"log\",\"s\":\"t\",\"args\":{\"message\":");
+        AppendString(out, log.message);
+        out->append("}}");
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Converter::AppendNames(std::string* out, const trace::Record& record) const {
+    if (record.type() != trace::RecordType::kKernelObject)
+        return;
+    const auto& object = record.GetKernelObject();
+    if (object.object_type == ZX_OBJ_TYPE_PROCESS) {
+        AppendFormat(out, ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%" PRIu64
+                          ",\"args\":{\"name\":",
+                     object.koid);
+    } else if (object.object_type == ZX_OBJ_TYPE_THREAD) {
+        zx_koid_t process_koid = ZX_KOID_INVALID;
+        for (const auto& argument : object.arguments) {
+            if (argument.name() == "process" &&
+                argument.value().type() == trace::ArgumentType::kKoid)
+                process_koid = argument.value().GetKoid();
+        }
+        AppendFormat(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%" PRIu64
+                          ",\"tid\":%" PRIu64 ",\"args\":{\"name\":",
+                     process_koid, object.koid);
+    } else {
+        return;
+    }
+    AppendString(out, object.name);
+    out->append("}}");
+}
+
+// Writes the JSON objects, dropping the comma before the first one.
+class Output {
+public:
+    explicit Output(FILE* file)
+        : file_(file) {}
+
+    void Write(const std::string& objects) {
+        size_t skip = 0u;
+        if (objects.empty())
+            return;
+        if (first_) {
+            skip = 2u; // ",\n"
+            first_ = false;
+        }
+        fwrite(objects.data() + skip, 1, objects.size() - skip, file_);
+    }
+
+private:
+    FILE* const file_;
+    bool first_ = true;
+};
+
+bool ParseMicros(const char* arg, uint64_t* out_micros) {
+    char* end;
+    *out_micros = strtoull(arg, &end, 0);
+    return *arg != '\0' && *end == '\0';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t num_threads = num_cpus > 0 ? static_cast<size_t>(num_cpus) : 1u;
+    bool has_begin = false, has_end = false;
+    uint64_t begin_micros = 0u, end_micros = 0u;
+    trace::IndexedTraceReader::Query query;
+    bool print_stats = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "j:b:e:t:c:sh")) > 0) {
+        switch (c) {
+        case 'j':
+            num_threads = strtoul(optarg, nullptr, 0);
+            if (num_threads == 0) {
+                fprintf(stderr, "Bad -j value '%s'\n", optarg);
+                Usage(stderr);
+                return 1;
+            }
+            break;
+        case 'b':
+            has_begin = ParseMicros(optarg, &begin_micros);
+            if (!has_begin) {
+                fprintf(stderr, "Bad -b value '%s'\n", optarg);
+                Usage(stderr);
+                return 1;
+            }
+            break;
+        case 'e':
+            has_end = ParseMicros(optarg, &end_micros);
+            if (!has_end) {
+                fprintf(stderr, "Bad -e value '%s'\n", optarg);
+                Usage(stderr);
+                return 1;
+            }
+            break;
+        case 't': {
+            uint64_t pid, tid;
+            if (sscanf(optarg, "%" SCNu64 "/%" SCNu64, &pid, &tid) != 2) {
+                fprintf(stderr, "Bad -t value '%s'\n", optarg);
+                Usage(stderr);
+                return 1;
+            }
+            query.thread = trace::ProcessThread(pid, tid);
+            break;
+        }
+        case 'c':
+            query.category = optarg;
+            break;
+        case 's':
+            print_stats = true;
+            break;
+        case 'h':
+            Usage(stdout);
+            return 0;
+        default:
+            Usage(stderr);
+            return 1;
+        }
+    }
+    if (optind == argc || argc - optind > 2) {
+        Usage(stderr);
+        return 1;
+    }
+    const char* trace_path = argv[optind];
+    const char* output_path = optind + 1 < argc ? argv[optind + 1] : nullptr;
+
+    auto reader = trace::IndexedTraceReader::Open(trace_path, [](fbl::String error) {
+        fprintf(stderr, "trace2json: %s\n", error.c_str());
+    });
+    if (!reader)
+        return 1;
+
+    trace_ticks_t ticks_per_second = reader->ticks_per_second();
+    if (ticks_per_second == 0u) {
+        fprintf(stderr, "trace2json: no initialization record, assuming nanosecond ticks\n");
+        ticks_per_second = 1000000000u;
+    }
+    const trace_ticks_t start = reader->min_timestamp();
+    if (has_begin)
+        query.begin = start + begin_micros * ticks_per_second / 1000000u;
+    if (has_end)
+        query.end = start + end_micros * ticks_per_second / 1000000u;
+
+    fbl::Vector<uint32_t> blocks = reader->FindBlocks(query);
+    if (print_stats) {
+        fprintf(stderr, "%zu records in %zu blocks, %zu to read\n",
+                reader->num_records(), reader->num_blocks(), blocks.size());
+    }
+
+    FILE* file = stdout;
+    if (output_path) {
+        file = fopen(output_path, "w");
+        if (!file) {
+            fprintf(stderr, "trace2json: cannot create %s: %s\n", output_path, strerror(errno));
+            return 1;
+        }
+    }
+
+    Converter converter(ticks_per_second);
+    Output output(file);
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    std::string names;
+    bool ok = reader->ReadDefinitions([&converter, &names](trace::Record record) {
+        converter.AppendNames(&names, record);
+    });
+    output.Write(names);
+
+    const size_t blocks_per_wave = num_threads * kSlicesPerThread * kBlocksPerSlice;
+    std::vector<std::string> slices;
+    for (size_t first = 0; ok && first < blocks.size(); first += blocks_per_wave) {
+        const size_t num_blocks = blocks.size() - first < blocks_per_wave
+                                      ? blocks.size() - first
+                                      : blocks_per_wave;
+        const size_t num_slices = (num_blocks + kBlocksPerSlice - 1) / kBlocksPerSlice;
+        slices.assign(num_slices, std::string());
+        ok = reader->ReadBlocksParallel(
+            query, blocks.get() + first, num_blocks, num_slices, num_threads,
+            [&converter, &slices](size_t slice, trace::Record record) {
+                converter.AppendRecord(&slices[slice], record);
+            });
+        for (const auto& slice : slices)
+            output.Write(slice);
+    }
+
+    fprintf(file, "\n]}\n");
+    if (output_path && fclose(file) != 0) {
+        fprintf(stderr, "trace2json: cannot write %s: %s\n", output_path, strerror(errno));
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
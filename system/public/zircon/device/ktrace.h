@@ -32,6 +32,21 @@ IOCTL_WRAPPER_OUT(ioctl_ktrace_get_handle, IOCTL_KTRACE_GET_HANDLE, zx_handle_t)
 #define IOCTL_KTRACE_STOP \
     IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_KTRACE, 4)
 
+// Start tracing into circular buffers, which overwrite their oldest
+// records instead of stopping when they fill up.
+// input: The group_mask
+#define IOCTL_KTRACE_START_CIRCULAR \
+    IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_KTRACE, 5)
+
+// Start sampling what each CPU is running, into the PROFILE group.
+// input: The sample period in microseconds, 0 for the default
+#define IOCTL_KTRACE_PROFILE_START \
+    IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_KTRACE, 6)
+
+// Stop sampling
+#define IOCTL_KTRACE_PROFILE_STOP \
+    IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_KTRACE, 7)
+
 static inline zx_status_t ioctl_ktrace_add_probe(int fd, const char* name, uint32_t* probe_id) {
     return fdio_ioctl(fd, IOCTL_KTRACE_ADD_PROBE,
                       name, strlen(name), probe_id, sizeof(uint32_t));
@@ -39,3 +54,6 @@ static inline zx_status_t ioctl_ktrace_add_probe(int fd, const char* name, uint3
 
 IOCTL_WRAPPER_IN(ioctl_ktrace_start, IOCTL_KTRACE_START, uint32_t);
 IOCTL_WRAPPER(ioctl_ktrace_stop, IOCTL_KTRACE_STOP);
+IOCTL_WRAPPER_IN(ioctl_ktrace_start_circular, IOCTL_KTRACE_START_CIRCULAR, uint32_t);
+IOCTL_WRAPPER_IN(ioctl_ktrace_profile_start, IOCTL_KTRACE_PROFILE_START, uint32_t);
+IOCTL_WRAPPER(ioctl_ktrace_profile_stop, IOCTL_KTRACE_PROFILE_STOP);
@@ -0,0 +1,43 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stdint.h>
+#include <zircon/compiler.h>
+
+__BEGIN_CDECLS
+
+// The kernel keeps its counters in a read-only VMO that devmgr publishes as
+// /boot/kernel/counters. Mapping it lets a reader sample every counter
+// without a syscall.
+//
+// The VMO starts with a zx_kcounters_header_t. It is followed by
+// |num_counters| descriptors at |desc_offset|, sorted by name. The counter
+// values start at |arena_offset|, which is page aligned. There is one array
+// of |num_counters| uint64_t values per CPU, and each array has its values
+// in the same order as the descriptors.
+//
+// A counter is the sum of its values across all the CPUs. Each CPU updates
+// only its own values, without atomics, so a reader should expect a sum to
+// lag slightly behind and should load each value only once.
+#define ZX_KCOUNTERS_MAGIC          0x524e434bu  // "KCNR"
+#define ZX_KCOUNTER_NAME_LEN        56u
+
+typedef struct zx_kcounters_header {
+    uint32_t magic;
+    uint32_t num_counters;
+    uint32_t num_cpus;
+    uint32_t reserved;
+    uint64_t desc_offset;
+    uint64_t arena_offset;
+} zx_kcounters_header_t;
+
+typedef struct zx_kcounter_desc {
+    // Null-terminated, such as "kernel.sched.preempt".
+    char name[ZX_KCOUNTER_NAME_LEN];
+    uint64_t reserved;
+} zx_kcounter_desc_t;
+
+__END_CDECLS
@@ -27,6 +27,7 @@ KTRACE_DEF(0x034,32B,PAGE_FAULT,IRQ) // virtual_address_hi, virtual_address_lo,
 KTRACE_DEF(0x035,32B,PAGE_FAULT_EXIT,IRQ) // virtual_address_hi, virtual_address_lo, flags, cpu
 
 KTRACE_DEF(0x040,32B,CONTEXT_SWITCH,SCHEDULER) // to-tid, (state<<16|cpu), from-kt, to-kt
+KTRACE_DEF(0x041,32B,THREAD_WAKEUP,SCHEDULER) // woken-kt, (flags<<16|cpu), waker-kt-hi, waker-kt-lo
 
 // events from 0x100 on all share the tag/tid/ts common header
 
@@ -56,6 +57,10 @@ KTRACE_DEF(0x160,32B,KWAIT_BLOCK,SCHEDULER) // queue_hi, queue_hi
 KTRACE_DEF(0x161,32B,KWAIT_WAKE,SCHEDULER) // queue_hi, queue_hi, is_mutex
 KTRACE_DEF(0x162,32B,KWAIT_UNBLOCK,SCHEDULER) // queue_hi, queue_hi, blocked_status
 
+// The profile records vary in size, up to 120 bytes.
+KTRACE_DEF(0x170,16B,PROFILE_SAMPLE,PROFILE) // pid, tid (ktid for kernel threads), kernel pc[]
+KTRACE_DEF(0x171,16B,PROFILE_USER_STACK,PROFILE) // pid, tid, user pc[]
+
 // events from 0x200-0x2ff are for arch-specific needs
 
 #ifdef __x86_64__
@@ -46,6 +46,7 @@ __BEGIN_CDECLS
 #define KTRACE_GRP_IRQ            0x020
 #define KTRACE_GRP_PROBE          0x040
 #define KTRACE_GRP_ARCH           0x080
+#define KTRACE_GRP_PROFILE        0x100
 
 #define KTRACE_GRP_TO_MASK(grp)   ((grp) << 20)
 
@@ -83,10 +84,16 @@ enum {
 #define TAG_PROBE_16(n) KTRACE_TAG(((n)|0x800),KTRACE_GRP_PROBE,16)
 #define TAG_PROBE_24(n) KTRACE_TAG(((n)|0x800),KTRACE_GRP_PROBE,24)
 
+// Flags for THREAD_WAKEUP records
+#define KTRACE_WAKEUP_FROM_IRQ  1 // woken by an interrupt handler, waker-kt is 0
+
 // Actions for ktrace control
 #define KTRACE_ACTION_START     1 // options = grpmask, 0 = all
 #define KTRACE_ACTION_STOP      2 // options ignored
 #define KTRACE_ACTION_REWIND    3 // options ignored
 #define KTRACE_ACTION_NEW_PROBE 4 // options ignored, ptr = name
+#define KTRACE_ACTION_START_CIRCULAR 5 // as START, but overwrite the oldest records when full
+#define KTRACE_ACTION_PROFILE_START 6 // options = sample period in us, 0 = 1000
+#define KTRACE_ACTION_PROFILE_STOP 7 // options ignored
 
 __END_CDECLS
@@ -21,6 +21,7 @@ __BEGIN_CDECLS
 // interim.
 #define MTRACE_KIND_IPT 0
 #define MTRACE_KIND_IPM 1
+#define MTRACE_KIND_HEAP 2
 
 // Actions for ipt control
 
@@ -93,4 +94,27 @@ __BEGIN_CDECLS
 
 #define MTRACE_IPM_OPTIONS_CPU(options) ((options) & MTRACE_IPM_OPTIONS_CPU_MASK)
 
+// Actions for kernel heap profile control
+
+// Start sampling kernel heap allocations.
+// |options| is the average number of bytes allocated between samples,
+// or 0 for the default. Samples from an earlier run that was not reset are
+// kept. Returns ZX_ERR_BAD_STATE if sampling is already on.
+#define MTRACE_HEAP_START 0
+
+// Stop sampling. Samples already taken are kept and live samples
+// continue to be retired as they are freed.
+#define MTRACE_HEAP_STOP 1
+
+// Discard all samples. Sampling must be stopped.
+#define MTRACE_HEAP_RESET 2
+
+// Return the size of the profile, including the terminating NUL, as
+// a uint32_t.
+#define MTRACE_HEAP_GET_PROFILE_SIZE 3
+
+// Copy the profile into the buffer as NUL-terminated text in pprof's heap
+// profile format. Returns ZX_ERR_BUFFER_TOO_SMALL if it does not fit.
+#define MTRACE_HEAP_GET_PROFILE 4
+
 __END_CDECLS
@@ -0,0 +1,53 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// zx_fifo_create() options
+
+// The entries of a shared fifo live in a VMO that each endpoint can map with
+// zx_fifo_get_vmo(). Both ends then move entries through shared memory and
+// only make syscalls to wake a peer that has gone to sleep.
+#define ZX_FIFO_SHARED              1u
+
+// Layout of a shared fifo VMO.
+//
+// The first page holds two rings, one per direction. Ring N carries the
+// entries written by endpoint N (as returned by zx_fifo_get_vmo()) and has
+// its entries in the page at ZX_FIFO_SHARED_DATA_OFFSET(N). Entry i of a
+// ring is at (i & (elem_count - 1)) * elem_size within its data page.
+//
+// |head| counts the entries ever written and is only advanced by the
+// producer. |tail| counts the entries ever read and is only advanced by the
+// consumer. Both wrap at 2^32, so the ring holds (head - tail) entries.
+//
+// A consumer that finds the ring empty clears ZX_FIFO_READABLE on its
+// endpoint, sets |consumer_waiting|, checks the ring once more and then
+// waits for ZX_FIFO_READABLE. A producer that publishes entries and finds
+// |consumer_waiting| set clears it and sets ZX_FIFO_READABLE on its peer
+// with zx_object_signal_peer(). The same goes for a full ring, with
+// |producer_waiting| and ZX_FIFO_WRITABLE.
+//
+// The producer and consumer fields are on separate cache lines.
+typedef struct zx_fifo_shared_ring {
+    // Written by the producer.
+    uint32_t head;
+    uint32_t consumer_waiting;
+    uint8_t reserved0[56];
+
+    // Written by the consumer.
+    uint32_t tail;
+    uint32_t producer_waiting;
+    uint8_t reserved1[56];
+} zx_fifo_shared_ring_t;
+
+#define ZX_FIFO_SHARED_RING_OFFSET(n)  ((n) * sizeof(zx_fifo_shared_ring_t))
+#define ZX_FIFO_SHARED_DATA_OFFSET(n)  (((n) + 1u) * 4096u)
+#define ZX_FIFO_SHARED_VMO_SIZE        (3u * 4096u)
+
+__END_CDECLS
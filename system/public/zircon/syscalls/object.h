@@ -31,6 +31,8 @@ typedef enum {
     ZX_INFO_KMEM_STATS                 = 17, // zx_info_kmem_stats_t[1]
     ZX_INFO_RESOURCE                   = 18, // zx_info_resource_t[1]
     ZX_INFO_HANDLE_COUNT               = 19, // zx_info_handle_count_t[1]
+    ZX_INFO_LOCKSTAT                   = 20, // zx_info_lockstat_t[n]
+    ZX_INFO_SYSCALL_STATS              = 21, // zx_info_syscall_stats_t[n]
     ZX_INFO_LAST
 } zx_object_info_topic_t;
 
@@ -356,6 +358,57 @@ typedef struct zx_info_resource {
 
 #define ZX_INFO_CPU_STATS_FLAG_ONLINE       (1u<<0)
 
+// Values for zx_info_lockstat_t.type.
+#define ZX_LOCKSTAT_TYPE_SPIN               1u
+#define ZX_LOCKSTAT_TYPE_MUTEX              2u
+
+#define ZX_LOCKSTAT_NUM_CALLERS             8u
+
+// Statistics for one kernel lock, when the kernel is booted with
+// kernel.lockstat.enable=true.
+typedef struct zx_info_lockstat {
+    // The kernel address of the lock, or 0 for the locks that did not fit
+    // in the kernel's table.
+    uint64_t lock;
+    // One of the ZX_LOCKSTAT_TYPE_* values.
+    uint32_t type;
+    uint32_t reserved;
+
+    uint64_t acquisitions;
+    // The acquisitions that found the lock held.
+    uint64_t contended;
+    // Time spent waiting for the lock in contended acquisitions.
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    // Time the lock was held for.
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+
+    // The kernel addresses that most often found the lock held, and how
+    // many times each did. The counts may be overestimates.
+    uint64_t caller_pc[ZX_LOCKSTAT_NUM_CALLERS];
+    uint64_t caller_count[ZX_LOCKSTAT_NUM_CALLERS];
+} zx_info_lockstat_t;
+
+#define ZX_SYSCALL_STATS_NUM_BUCKETS        24u
+
+// How many times one syscall was made, and how long it took.
+typedef struct zx_info_syscall_stats {
+    // The syscall's number, as in the ZX_SYS_* values.
+    uint32_t syscall;
+    uint32_t reserved;
+    char name[32];
+
+    uint64_t count;
+    uint64_t total_ns;
+
+    // The number of calls by duration: bucket 0 counts the calls shorter
+    // than 256ns, and bucket i > 0 those that took at least 2^(i+7)ns and,
+    // except for the last bucket, less than 2^(i+8)ns. Only kept
+    // system-wide; zero in the statistics of a process.
+    uint64_t histogram[ZX_SYSCALL_STATS_NUM_BUCKETS];
+} zx_info_syscall_stats_t;
+
 // Object properties.
 
 // Argument is a uint32_t.
@@ -118,4 +118,7 @@ typedef struct zx_port_packet {
     };
 } zx_port_packet_t;
 
+// Maximum number of packets returned by one zx_port_wait_many() call.
+#define ZX_PORT_WAIT_MANY_MAX_PACKETS 16u
+
 __END_CDECLS
@@ -170,9 +170,36 @@ typedef struct {
     uint32_t rd_num_handles;
 } zx_channel_call_args_t;
 
+// Describes one message for zx_channel_write_etc_many() and
+// zx_channel_read_many(). When writing, |bytes| and |handles| are only read
+// from. When reading, |num_bytes| and |num_handles| give the buffer sizes on
+// input and are updated with the size of the message on output.
+typedef struct {
+    void* bytes;
+    zx_handle_t* handles;
+    uint32_t num_bytes;
+    uint32_t num_handles;
+} zx_channel_msg_t;
+
+// Maximum number of messages moved by one zx_channel_write_etc_many() or
+// zx_channel_read_many() call.
+#define ZX_CHANNEL_MAX_BATCH_MSGS 16u
+
+// Maximum number of handles in one zx_handle_duplicate_many() or
+// zx_handle_replace_many() call. zx_handle_close_many() has no limit.
+#define ZX_HANDLE_MAX_BATCH 64u
+
+// Describes one buffer for zx_vmo_readv() and zx_vmo_writev().
+typedef struct {
+    void* buffer;
+    size_t capacity;
+} zx_iovec_t;
+
+// Maximum number of buffers in one zx_vmo_readv() or zx_vmo_writev() call.
+#define ZX_VMO_MAX_IOVECS 16u
+
 // Maximum number of wait items allowed for zx_object_wait_many()
-// TODO(ZX-1349) Re-lower this.
-#define ZX_WAIT_MANY_MAX_ITEMS 16
+#define ZX_WAIT_MANY_MAX_ITEMS 256
 
 // Structure for zx_object_wait_many():
 typedef struct {
@@ -6,13 +6,16 @@
 #include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
 
 #include <zircon/compiler.h>
 #include <zircon/syscalls.h>
 #include <fbl/algorithm.h>
+#include <fbl/unique_free_ptr.h>
 #include <fbl/unique_ptr.h>
 
 namespace {
@@ -32,8 +35,181 @@ struct TestArgs {
     uint32_t size;
     uint32_t handles;
     uint32_t queue;
+    // Read into a separate page aligned buffer, which lets the kernel move
+    // the pages of large messages instead of copying them.
+    bool aligned;
+    // If nonzero, move this many messages per zx_channel_write_etc_many()
+    // and zx_channel_read_many() call instead of one per syscall.
+    uint32_t batch;
+    // Time zx_channel_call() round trips to a server thread instead of
+    // writing and reading on the same thread.
+    bool call;
 };
 
+struct CallServerArgs {
+    zx_handle_t channel;
+    uint32_t size;
+    uint32_t handles;
+};
+
+// Echoes every message (bytes and handles) back to the caller until the
+// channel is signaled with ZX_USER_SIGNAL_0.
+int call_server(void* arg) {
+    __UNUSED zx_status_t status;
+    const CallServerArgs* args = static_cast<const CallServerArgs*>(arg);
+
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[args->size]);
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    if (args->handles)
+        handles.reset(new zx_handle_t[args->handles]);
+
+    for (;;) {
+        zx_signals_t pending = 0;
+        status = zx_object_wait_one(args->channel, ZX_CHANNEL_READABLE | ZX_USER_SIGNAL_0,
+                                    ZX_TIME_INFINITE, &pending);
+        assert(status == ZX_OK);
+        if (!(pending & ZX_CHANNEL_READABLE))
+            break;
+
+        uint32_t r_size = args->size;
+        uint32_t r_handles = args->handles;
+        status = zx_channel_read(args->channel, 0u, data.get(), handles.get(), r_size,
+                                 r_handles, &r_size, &r_handles);
+        assert(status == ZX_OK);
+        status = zx_channel_write(args->channel, 0u, data.get(), r_size,
+                                  handles.get(), r_handles);
+        assert(status == ZX_OK);
+    }
+    return 0;
+}
+
+// Times zx_channel_call() from this thread to call_server() on another.
+// Returns the number of round trips.
+uint64_t run_call(zx_handle_t mp[2], uint64_t duration_ns, const TestArgs& test_args,
+                  zx_handle_t event, uint64_t* elapsed_ns) {
+    __UNUSED zx_status_t status;
+
+    CallServerArgs server_args = {mp[1], test_args.size, test_args.handles};
+    thrd_t server;
+    assert(thrd_create(&server, call_server, &server_args) == thrd_success);
+
+    // The leading bytes hold the txid, which the kernel overwrites.
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[test_args.size]);
+    for (uint32_t i = 0; i < test_args.size; i++)
+        data[i] = static_cast<uint8_t>(i);
+    fbl::unique_ptr<uint8_t[]> read_data(new uint8_t[test_args.size]);
+
+    // The server sends the handles back, so the same ones can be reused.
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    if (test_args.handles) {
+        handles.reset(new zx_handle_t[test_args.handles]);
+        duplicate_handles(test_args.handles, event, handles.get());
+    }
+
+    zx_channel_call_args_t args = {
+        data.get(), handles.get(), read_data.get(), handles.get(),
+        test_args.size, test_args.handles, test_args.size, test_args.handles};
+
+    static constexpr uint32_t big_it_size = 10000;
+    uint64_t big_its = 0;
+    uint64_t start_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            uint32_t r_size = 0;
+            uint32_t r_handles = 0;
+            status = zx_channel_call(mp[0], 0u, ZX_TIME_INFINITE, &args,
+                                     &r_size, &r_handles, nullptr);
+            assert(status == ZX_OK);
+            assert(r_size == test_args.size);
+            assert(r_handles == test_args.handles);
+        }
+
+        end_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    status = zx_object_signal(mp[1], 0u, ZX_USER_SIGNAL_0);
+    assert(status == ZX_OK);
+    assert(thrd_join(server, nullptr) == thrd_success);
+
+    for (uint32_t i = 0; i < test_args.handles; i++) {
+        status = zx_handle_close(handles[i]);
+        assert(status == ZX_OK);
+    }
+
+    *elapsed_ns = end_ns - start_ns;
+    return big_its * big_it_size;
+}
+
+// Like the loop in do_test(), but with the batched syscalls. Returns the
+// number of messages written and read.
+uint64_t run_batched(zx_handle_t mp[2], uint64_t duration_ns, const TestArgs& test_args,
+                     zx_handle_t event, uint64_t* elapsed_ns) {
+    __UNUSED zx_status_t status;
+    const uint32_t batch = test_args.batch;
+
+    // Every message is written from the same bytes but needs its own
+    // handles and read buffer.
+    fbl::unique_ptr<uint8_t[]> data;
+    fbl::unique_ptr<uint8_t[]> read_data;
+    if (test_args.size) {
+        data.reset(new uint8_t[test_args.size]);
+        for (uint32_t i = 0; i < test_args.size; i++)
+            data[i] = static_cast<uint8_t>(i);
+        read_data.reset(new uint8_t[test_args.size * batch]);
+    }
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    if (test_args.handles) {
+        handles.reset(new zx_handle_t[test_args.handles * batch]);
+        duplicate_handles(test_args.handles * batch, event, handles.get());
+    }
+
+    fbl::unique_ptr<zx_channel_msg_t[]> wr_msgs(new zx_channel_msg_t[batch]);
+    fbl::unique_ptr<zx_channel_msg_t[]> rd_msgs(new zx_channel_msg_t[batch]);
+    for (uint32_t i = 0; i < batch; i++) {
+        zx_handle_t* msg_handles = handles.get() + i * test_args.handles;
+        wr_msgs[i] = {data.get(), msg_handles, test_args.size, test_args.handles};
+        rd_msgs[i] = {read_data.get() + i * test_args.size, msg_handles,
+                      test_args.size, test_args.handles};
+    }
+
+    static constexpr uint32_t big_it_size = 10000;
+    uint64_t msgs = 0;
+    uint64_t start_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        for (uint32_t i = 0; i < big_it_size; i += batch) {
+            status = zx_channel_write_etc_many(mp[0], 0u, wr_msgs.get(), batch);
+            assert(status == ZX_OK);
+
+            for (uint32_t j = 0; j < batch; j++) {
+                rd_msgs[j].num_bytes = test_args.size;
+                rd_msgs[j].num_handles = test_args.handles;
+            }
+            uint32_t actual = 0;
+            status = zx_channel_read_many(mp[1], 0u, rd_msgs.get(), batch, &actual);
+            assert(status == ZX_OK);
+            assert(actual == batch);
+            msgs += batch;
+        }
+
+        end_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    for (uint32_t i = 0; i < test_args.handles * batch; i++) {
+        status = zx_handle_close(handles[i]);
+        assert(status == ZX_OK);
+    }
+
+    *elapsed_ns = end_ns - start_ns;
+    return msgs;
+}
+
 void do_test(uint32_t duration, const TestArgs& test_args) {
     __UNUSED zx_status_t status;
 
@@ -55,6 +231,15 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
         for (uint32_t i = 0; i < test_args.size; i++)
             data[i] = static_cast<uint8_t>(i);
     }
+    fbl::unique_free_ptr<uint8_t> aligned_data;
+    uint8_t* read_data = data.get();
+    if (test_args.aligned && test_args.size) {
+        void* ptr = nullptr;
+        size_t aligned_size = fbl::round_up(test_args.size, static_cast<uint32_t>(PAGE_SIZE));
+        assert(posix_memalign(&ptr, PAGE_SIZE, aligned_size) == 0);
+        aligned_data.reset(static_cast<uint8_t*>(ptr));
+        read_data = aligned_data.get();
+    }
     fbl::unique_ptr<zx_handle_t[]> handles;
     if (test_args.handles)
         handles.reset(new zx_handle_t[test_args.handles]);
@@ -67,37 +252,49 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
         assert(status == ZX_OK);
     }
 
-    duplicate_handles(test_args.handles, event, handles.get());
+    uint64_t its;
+    uint64_t elapsed_ns;
+    if (test_args.call) {
+        its = run_call(mp, duration_ns, test_args, event, &elapsed_ns);
+    } else if (test_args.batch) {
+        its = run_batched(mp, duration_ns, test_args, event, &elapsed_ns);
+    } else {
+        duplicate_handles(test_args.handles, event, handles.get());
 
-    static constexpr uint32_t big_it_size = 10000;
-    uint64_t big_its = 0;
-    uint64_t start_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
-    uint64_t end_ns;
-    for (;;) {
-        big_its++;
-        for (uint32_t i = 0; i < big_it_size; i++) {
-            status = zx_channel_write(mp[0], 0, data.get(), test_args.size,
-                                      handles.get(), test_args.handles);
-            assert(status == ZX_OK);
+        static constexpr uint32_t big_it_size = 10000;
+        uint64_t big_its = 0;
+        uint64_t start_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        uint64_t end_ns;
+        for (;;) {
+            big_its++;
+            for (uint32_t i = 0; i < big_it_size; i++) {
+                status = zx_channel_write(mp[0], 0, data.get(), test_args.size,
+                                          handles.get(), test_args.handles);
+                assert(status == ZX_OK);
+
+                uint32_t r_size = test_args.size;
+                uint32_t r_handles = test_args.handles;
+                status = zx_channel_read(mp[1], 0u, read_data, handles.get(), r_size,
+                                         r_handles, &r_size, &r_handles);
+                assert(status == ZX_OK);
+                assert(r_size == test_args.size);
+                assert(r_handles == test_args.handles);
+            }
+
+            end_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+            if ((end_ns - start_ns) >= duration_ns)
+                break;
+        }
 
-            uint32_t r_size = test_args.size;
-            uint32_t r_handles = test_args.handles;
-            status = zx_channel_read(mp[1], 0u, data.get(), handles.get(), r_size,
-                                     r_handles, &r_size, &r_handles);
+        for (uint32_t i = 0; i < test_args.handles; i++) {
+            status = zx_handle_close(handles[i]);
             assert(status == ZX_OK);
-            assert(r_size == test_args.size);
-            assert(r_handles == test_args.handles);
         }
 
-        end_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
-        if ((end_ns - start_ns) >= duration_ns)
-            break;
+        its = big_its * big_it_size;
+        elapsed_ns = end_ns - start_ns;
     }
 
-    for (uint32_t i = 0; i < test_args.handles; i++) {
-        status = zx_handle_close(handles[i]);
-        assert(status == ZX_OK);
-    }
     status = zx_handle_close(event);
     assert(status == ZX_OK);
     status = zx_handle_close(mp[0]);
@@ -105,11 +302,15 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
     status = zx_handle_close(mp[1]);
     assert(status == ZX_OK);
 
-    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
-    double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
-    printf("write/read %" PRIu32 " bytes, %" PRIu32 " handles (%" PRIu32 " pre-queued): "
+    double real_duration = static_cast<double>(elapsed_ns) / 1000000000.0;
+    double its_per_second = static_cast<double>(its) / real_duration;
+    char batch[32] = "";
+    if (test_args.batch)
+        snprintf(batch, sizeof(batch), ", batches of %" PRIu32, test_args.batch);
+    printf("%s %" PRIu32 " bytes, %" PRIu32 " handles (%" PRIu32 " pre-queued%s%s): "
                "%.0f iterations/second\n",
-           test_args.size, test_args.handles, test_args.queue, its_per_second);
+           test_args.call ? "call" : "write/read", test_args.size, test_args.handles, test_args.queue,
+           test_args.aligned ? ", page aligned read" : "", batch, its_per_second);
 }
 
 }  // namespace
@@ -121,12 +322,15 @@ int main(int argc, char** argv) {
         "Options:\n"
         "  -h    show help (this)\n"
         "  -o    run single test (default)\n"
-        "  -s    run suite (ignores -S/-H/-Q)\n"
+        "  -s    run suite (ignores -S/-H/-Q/-A/-B/-C)\n"
         "  -n N  set test repetition count to N (default: 1)\n"
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
         "  -H N  set message handle count to N handles (default: 0)\n"
-        "  -Q N  set message pre-queue count to N messages (default: 0)\n";
+        "  -Q N  set message pre-queue count to N messages (default: 0)\n"
+        "  -A    read into a page aligned buffer (default: off)\n"
+        "  -B N  move N messages per batched syscall (default: 0, unbatched)\n"
+        "  -C    time zx_channel_call() round trips to another thread (default: off)\n";
 
     bool run_suite = false;  // -o/-s
     uint32_t duration = 5;   // -d
@@ -135,11 +339,14 @@ int main(int argc, char** argv) {
     TestArgs test_args = {
         10,                  // -S (size)
         0,                   // -H (handles)
-        0                    // -Q (queue)
+        0,                   // -Q (queue)
+        false,               // -A (aligned)
+        0,                   // -B (batch)
+        false                // -C (call)
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hosACn:d:S:H:Q:B:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -181,6 +388,18 @@ int main(int argc, char** argv) {
                 assert(optarg);
                 test_args.queue = value;
                 break;
+            case 'A':
+                test_args.aligned = true;
+                break;
+            case 'B':
+                assert(optarg);
+                if (value > ZX_CHANNEL_MAX_BATCH_MSGS)
+                    argument_error(argv[0], "batch size too large");
+                test_args.batch = value;
+                break;
+            case 'C':
+                test_args.call = true;
+                break;
             default:  // '?'
                 argument_error(argv[0], "invalid option");
                 break;
@@ -188,6 +407,8 @@ int main(int argc, char** argv) {
     }
     if (optind < argc)
         argument_error(argv[0], "unexpected positional argument");
+    if (test_args.call && test_args.size < sizeof(zx_txid_t))
+        argument_error(argv[0], "call messages must be large enough to hold a txid");
 
     for (uint32_t i = 0; i < repeats; i++) {
         if (repeats > 1u) {
@@ -214,6 +435,26 @@ int main(int argc, char** argv) {
                 {10, 0, 1},
                 {100, 0, 1},
                 {1000, 0, 1},
+                // Large messages, copied and (when aligned) page transferred.
+                // The kernel switches to moving pages at 16KB.
+                {4096, 0, 0, false},
+                {4096, 0, 0, true},
+                {16384, 0, 0, false},
+                {16384, 0, 0, true},
+                {32768, 0, 0, false},
+                {32768, 0, 0, true},
+                {65536, 0, 0, false},
+                {65536, 0, 0, true},
+                // Batched syscalls.
+                {10, 0, 0, false, 4},
+                {10, 0, 0, false, 16},
+                {1000, 0, 0, false, 4},
+                {1000, 0, 0, false, 16},
+                {10, 1, 0, false, 16},
+                // Synchronous round trips.
+                {16, 0, 0, false, 0, true},
+                {1000, 0, 0, false, 0, true},
+                {16, 1, 0, false, 0, true},
             };
             for (size_t i = 0; i < fbl::count_of(suite); i++)
                 do_test(duration, suite[i]);
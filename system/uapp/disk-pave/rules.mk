@@ -23,6 +23,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/fs-management \
     system/ulib/fvm \
     system/ulib/installer \
+    system/ulib/shared-fifo \
     system/ulib/sync \
     system/ulib/zx \
     system/ulib/fbl \
@@ -13,6 +13,7 @@ MODULE_SRCS += $(LOCAL_DIR)/iotime.c
 
 MODULE_STATIC_LIBS := \
     system/ulib/block-client \
+    system/ulib/shared-fifo \
     system/ulib/sync
 
 MODULE_LIBS := \
@@ -18,6 +18,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/async \
     system/ulib/async.loop \
     system/ulib/block-client \
+    system/ulib/shared-fifo \
     system/ulib/trace-provider \
     system/ulib/trace \
     system/ulib/zx \
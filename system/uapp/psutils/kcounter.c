@@ -0,0 +1,162 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/kcounters.h>
+#include <zircon/process.h>
+#include <zircon/status.h>
+#include <zircon/syscalls.h>
+#include <fdio/io.h>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COUNTERS_PATH "/boot/kernel/counters"
+
+typedef struct {
+    const zx_kcounters_header_t* header;
+    const zx_kcounter_desc_t* desc;
+    const volatile uint64_t* arena;
+} counters_t;
+
+static zx_status_t map_counters(counters_t* counters) {
+    int fd = open(COUNTERS_PATH, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "kcounter: cannot open %s\n", COUNTERS_PATH);
+        return ZX_ERR_NOT_FOUND;
+    }
+    zx_handle_t vmo;
+    zx_status_t status = fdio_get_exact_vmo(fd, &vmo);
+    close(fd);
+    if (status != ZX_OK) {
+        fprintf(stderr, "kcounter: cannot get VMO: %s\n", zx_status_get_string(status));
+        return status;
+    }
+
+    uint64_t size;
+    uintptr_t addr = 0;
+    status = zx_vmo_get_size(vmo, &size);
+    if (status == ZX_OK) {
+        status = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, size,
+                             ZX_VM_FLAG_PERM_READ, &addr);
+    }
+    zx_handle_close(vmo);
+    if (status != ZX_OK) {
+        fprintf(stderr, "kcounter: cannot map VMO: %s\n", zx_status_get_string(status));
+        return status;
+    }
+
+    const zx_kcounters_header_t* header = (const zx_kcounters_header_t*)addr;
+    if (size < sizeof(*header) || header->magic != ZX_KCOUNTERS_MAGIC ||
+        header->desc_offset + header->num_counters * sizeof(zx_kcounter_desc_t) > size ||
+        header->arena_offset +
+            (uint64_t)header->num_cpus * header->num_counters * sizeof(uint64_t) > size) {
+        fprintf(stderr, "kcounter: %s is not laid out as expected\n", COUNTERS_PATH);
+        return ZX_ERR_BAD_STATE;
+    }
+
+    counters->header = header;
+    counters->desc = (const zx_kcounter_desc_t*)(addr + header->desc_offset);
+    counters->arena = (const volatile uint64_t*)(addr + header->arena_offset);
+    return ZX_OK;
+}
+
+static uint64_t counter_value(const counters_t* counters, uint32_t index) {
+    uint64_t sum = 0;
+    for (uint32_t cpu = 0; cpu < counters->header->num_cpus; cpu++) {
+        sum += counters->arena[cpu * counters->header->num_counters + index];
+    }
+    return sum;
+}
+
+static bool matches(const char* name, int num_prefixes, char** prefixes) {
+    if (num_prefixes == 0)
+        return true;
+    for (int i = 0; i < num_prefixes; i++) {
+        if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void print_help(FILE* f) {
+    fprintf(f, "Usage: kcounter [options] [prefix ...]\n");
+    fprintf(f, "Prints the kernel counters whose names start with one of the prefixes,\n");
+    fprintf(f, "or all of them.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -d <delay>      Print the change every <delay> seconds\n");
+    fprintf(f, " -n <times>      With -d, run this many times and then exit\n");
+}
+
+int main(int argc, char** argv) {
+    zx_time_t delay = 0;
+    int num_loops = -1;
+
+    int c;
+    while ((c = getopt(argc, argv, "d:n:h")) > 0) {
+        switch (c) {
+            case 'd':
+                delay = ZX_SEC(atoi(optarg));
+                if (delay == 0) {
+                    fprintf(stderr, "Bad -d value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'n':
+                num_loops = atoi(optarg);
+                if (num_loops == 0) {
+                    fprintf(stderr, "Bad -n value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_help(stdout);
+                return 0;
+            default:
+                fprintf(stderr, "Unknown option\n");
+                print_help(stderr);
+                return 1;
+        }
+    }
+
+    counters_t counters;
+    zx_status_t status = map_counters(&counters);
+    if (status != ZX_OK)
+        return 1;
+
+    const uint32_t num_counters = counters.header->num_counters;
+    uint64_t* last = calloc(num_counters, sizeof(uint64_t));
+    if (last == NULL)
+        return 1;
+
+    for (;;) {
+        zx_time_t next_deadline = zx_deadline_after(delay);
+
+        for (uint32_t i = 0; i < num_counters; i++) {
+            const char* name = counters.desc[i].name;
+            if (!matches(name, argc - optind, argv + optind))
+                continue;
+            uint64_t value = counter_value(&counters, i);
+            printf("%-*s %20" PRIu64 "\n", (int)ZX_KCOUNTER_NAME_LEN, name, value - last[i]);
+            if (delay != 0)
+                last[i] = value;
+        }
+
+        if (delay == 0 || (num_loops > 0 && --num_loops == 0))
+            break;
+
+        zx_nanosleep(next_deadline);
+        printf("\n");
+    }
+
+    free(last);
+    return 0;
+}
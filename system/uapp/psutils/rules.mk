@@ -181,6 +181,24 @@ LOCAL_SCHEMA_HEADER :=
 include make/module.mk
 
 
+MODULE := $(LOCAL_DIR).kcounter
+
+MODULE_TYPE := userapp
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/kcounter.c
+
+MODULE_NAME := kcounter
+MODULE_GROUP := core
+
+MODULE_LIBS := \
+    system/ulib/fdio \
+    system/ulib/zircon \
+    system/ulib/c
+
+include make/module.mk
+
+
 MODULE := $(LOCAL_DIR).kstats
 
 MODULE_TYPE := userapp
@@ -371,7 +371,10 @@ int usage(char* name) {
             "The summary contains a listing of the tests executed  \n"
             "by full path (e.g. /boot/test/core/futex_test) as well\n"
             "as whether the test passed or failed. For details, see\n"
-            "//system/uapp/runtests/summary-schema.json            \n", name);
+            "//system/uapp/runtests/summary-schema.json            \n"
+            "Tests can write further output, such as benchmark     \n"
+            "results, to the directory named by the                \n"
+            "RUNTESTS_OUTPUT_DIR environment variable.             \n", name);
     return -1;
 }
 
@@ -491,6 +494,13 @@ int main(int argc, char** argv) {
                 return -1;
             }
             test_output_dir = buf;
+
+            // Tell the tests where they can put files of their own.
+            if (setenv(TEST_OUTPUT_DIR_ENV_NAME, test_output_dir, 1) != 0) {
+                printf("Error: Could not set %s environment variable\n",
+                       TEST_OUTPUT_DIR_ENV_NAME);
+                return -1;
+            }
         }
 
         int num_tests = 0;
@@ -509,6 +519,7 @@ int main(int argc, char** argv) {
 
     // It's not catastrophic if we can't unset it; we're just trying to clean up
     unsetenv(TEST_ENV_NAME);
+    unsetenv(TEST_OUTPUT_DIR_ENV_NAME);
 
     if (output_dir != NULL) {
         char summary_path[PATH_MAX];
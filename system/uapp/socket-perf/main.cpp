@@ -0,0 +1,279 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#include <zircon/compiler.h>
+#include <zircon/syscalls.h>
+#include <fbl/algorithm.h>
+#include <fbl/unique_free_ptr.h>
+
+namespace {
+
+void argument_error(const char* argv0, const char* message) {
+    fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
+    exit(EXIT_FAILURE);
+}
+
+struct TestArgs {
+    uint32_t size;
+    // Read into page aligned buffers, which lets the kernel move whole
+    // pages of stream data instead of copying them.
+    bool aligned;
+    // Write from one thread and read from another instead of alternating
+    // writes and reads on the same thread.
+    bool threaded;
+};
+
+// Returns a page aligned buffer with room for |size| bytes at offset 1, so
+// that callers can choose between an aligned and a misaligned buffer.
+fbl::unique_free_ptr<uint8_t> alloc_buffer(uint32_t size) {
+    void* ptr = nullptr;
+    size_t alloc_size = fbl::round_up(size + 1u, static_cast<uint32_t>(PAGE_SIZE));
+    assert(posix_memalign(&ptr, PAGE_SIZE, alloc_size) == 0);
+    return fbl::unique_free_ptr<uint8_t>(static_cast<uint8_t*>(ptr));
+}
+
+// Reads exactly |size| bytes from |socket| into |buf|, waiting as needed.
+void read_all(zx_handle_t socket, uint8_t* buf, uint32_t size) {
+    __UNUSED zx_status_t status;
+    size_t done = 0;
+    while (done < size) {
+        size_t actual = 0;
+        status = zx_socket_read(socket, 0u, buf + done, size - done, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            status = zx_object_wait_one(socket, ZX_SOCKET_READABLE, ZX_TIME_INFINITE, nullptr);
+            assert(status == ZX_OK);
+            continue;
+        }
+        assert(status == ZX_OK);
+        done += actual;
+    }
+}
+
+// Writes exactly |size| bytes from |buf| to |socket|, waiting as needed.
+void write_all(zx_handle_t socket, const uint8_t* buf, uint32_t size) {
+    __UNUSED zx_status_t status;
+    size_t done = 0;
+    while (done < size) {
+        size_t actual = 0;
+        status = zx_socket_write(socket, 0u, buf + done, size - done, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            status = zx_object_wait_one(socket, ZX_SOCKET_WRITABLE | ZX_SOCKET_PEER_CLOSED,
+                                        ZX_TIME_INFINITE, nullptr);
+            assert(status == ZX_OK);
+            continue;
+        }
+        if (status == ZX_ERR_PEER_CLOSED)
+            return;
+        assert(status == ZX_OK);
+        done += actual;
+    }
+}
+
+struct WriterArgs {
+    zx_handle_t socket;
+    uint32_t size;
+};
+
+// Writes |size| byte chunks until the reader closes its end.
+int writer_thread(void* arg) {
+    const WriterArgs* args = static_cast<const WriterArgs*>(arg);
+    fbl::unique_free_ptr<uint8_t> data = alloc_buffer(args->size);
+    for (uint32_t i = 0; i < args->size; i++)
+        data.get()[i] = static_cast<uint8_t>(i);
+
+    for (;;) {
+        zx_signals_t pending = 0;
+        zx_object_wait_one(args->socket, ZX_SOCKET_WRITABLE | ZX_SOCKET_PEER_CLOSED,
+                           ZX_TIME_INFINITE, &pending);
+        if (pending & ZX_SOCKET_PEER_CLOSED)
+            break;
+        write_all(args->socket, data.get(), args->size);
+    }
+    return 0;
+}
+
+void do_test(uint32_t duration, const TestArgs& test_args) {
+    __UNUSED zx_status_t status;
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    // We'll write to sockets[0] and read from sockets[1].
+    zx_handle_t sockets[2] = {ZX_HANDLE_INVALID, ZX_HANDLE_INVALID};
+    status = zx_socket_create(ZX_SOCKET_STREAM, &sockets[0], &sockets[1]);
+    assert(status == ZX_OK);
+
+    fbl::unique_free_ptr<uint8_t> data = alloc_buffer(test_args.size);
+    for (uint32_t i = 0; i < test_args.size; i++)
+        data.get()[i] = static_cast<uint8_t>(i);
+    fbl::unique_free_ptr<uint8_t> read_buffer = alloc_buffer(test_args.size);
+    uint8_t* read_data = read_buffer.get() + (test_args.aligned ? 0 : 1);
+
+    WriterArgs writer_args = {sockets[0], test_args.size};
+    thrd_t writer;
+    if (test_args.threaded)
+        assert(thrd_create(&writer, writer_thread, &writer_args) == thrd_success);
+
+    static constexpr uint32_t big_it_size = 100;
+    uint64_t bytes = 0;
+    uint64_t start_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            if (test_args.threaded) {
+                read_all(sockets[1], read_data, test_args.size);
+            } else {
+                // The socket may not hold all of a large write at once, so
+                // drain whatever each write managed to queue.
+                uint32_t done = 0;
+                while (done < test_args.size) {
+                    size_t actual = 0;
+                    status = zx_socket_write(sockets[0], 0u, data.get() + done,
+                                             test_args.size - done, &actual);
+                    assert(status == ZX_OK);
+                    read_all(sockets[1], read_data + done, static_cast<uint32_t>(actual));
+                    done += static_cast<uint32_t>(actual);
+                }
+            }
+            bytes += test_args.size;
+        }
+
+        end_ns = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    status = zx_handle_close(sockets[1]);
+    assert(status == ZX_OK);
+    if (test_args.threaded)
+        assert(thrd_join(writer, nullptr) == thrd_success);
+    status = zx_handle_close(sockets[0]);
+    assert(status == ZX_OK);
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double mb_per_second = static_cast<double>(bytes) / real_duration / (1024.0 * 1024.0);
+    printf("%s %" PRIu32 " bytes%s: %.1f MB/second\n",
+           test_args.threaded ? "streamed" : "write/read", test_args.size,
+           test_args.aligned ? ", page aligned read" : "", mb_per_second);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr char help[] =
+        "Usage: %s [options ...]\n"
+        "\n"
+        "Options:\n"
+        "  -h    show help (this)\n"
+        "  -o    run single test (default)\n"
+        "  -s    run suite (ignores -S/-A/-T)\n"
+        "  -n N  set test repetition count to N (default: 1)\n"
+        "  -d N  set test duration to N seconds (default: 5)\n"
+        "  -S N  set write size to N bytes (default: 65536)\n"
+        "  -A    read into a page aligned buffer (default: off)\n"
+        "  -T    write from a separate thread (default: off)\n";
+
+    bool run_suite = false;  // -o/-s
+    uint32_t duration = 5;   // -d
+    uint32_t repeats = 1;    // -n
+    // Ignored when running a suite:
+    TestArgs test_args = {
+        65536,               // -S (size)
+        false,               // -A (aligned)
+        false                // -T (threaded)
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+hosATn:d:S:")) != -1) {
+        // Our option values are always unsigned numbers.
+        uint32_t value = 0;
+        if (optarg) {
+            errno = 0;
+            char* endptr = nullptr;
+            unsigned long long v = strtoull(optarg, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || v > UINT32_MAX)
+                argument_error(argv[0], "invalid numeric optional value");
+            value = static_cast<uint32_t>(v);
+        }
+
+        switch (opt) {
+            case 'h':
+                printf(help, argv[0]);
+                return EXIT_SUCCESS;
+            case 'o':
+                run_suite = false;
+                break;
+            case 's':
+                run_suite = true;
+                break;
+            case 'n':
+                assert(optarg);
+                repeats = value;
+                break;
+            case 'd':
+                assert(optarg);
+                duration = value;
+                break;
+            case 'S':
+                assert(optarg);
+                test_args.size = value;
+                break;
+            case 'A':
+                test_args.aligned = true;
+                break;
+            case 'T':
+                test_args.threaded = true;
+                break;
+            default:  // '?'
+                argument_error(argv[0], "invalid option");
+                break;
+        }
+    }
+    if (optind < argc)
+        argument_error(argv[0], "unexpected positional argument");
+    if (test_args.size == 0)
+        argument_error(argv[0], "write size must be nonzero");
+
+    for (uint32_t i = 0; i < repeats; i++) {
+        if (repeats > 1u) {
+            if (i > 0u)
+                printf("\n");
+            printf("Test iteration #%" PRIu32 " (of %" PRIu32 "):\n", i + 1,
+                   repeats);
+        }
+
+        if (run_suite) {
+            static constexpr TestArgs suite[] = {
+                {64, false, false},
+                {1024, false, false},
+                // Writes of a page or more are stored in whole pages, which
+                // an aligned reader gets without a copy.
+                {4096, false, false},
+                {4096, true, false},
+                {65536, false, false},
+                {65536, true, false},
+                {131072, false, false},
+                {131072, true, false},
+                {4096, false, true},
+                {65536, false, true},
+                {65536, true, true},
+            };
+            for (size_t i = 0; i < fbl::count_of(suite); i++)
+                do_test(duration, suite[i]);
+        } else {
+            do_test(duration, test_args);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
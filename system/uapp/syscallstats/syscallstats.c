@@ -0,0 +1,211 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/device/sysinfo.h>
+#include <zircon/status.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
+#include <task-utils/get.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef enum {
+    SORT_TIME,
+    SORT_COUNT,
+    SORT_AVERAGE,
+} sort_t;
+
+static sort_t sort_order = SORT_TIME;
+
+static zx_status_t get_root_resource(zx_handle_t* root_resource) {
+    int fd = open("/dev/misc/sysinfo", O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "syscallstats: cannot open sysinfo: %s\n", strerror(errno));
+        return ZX_ERR_NOT_FOUND;
+    }
+    ssize_t n = ioctl_sysinfo_get_root_resource(fd, root_resource);
+    close(fd);
+    if (n != sizeof(*root_resource)) {
+        fprintf(stderr, "syscallstats: cannot obtain root resource: %s\n",
+                zx_status_get_string(n < 0 ? (zx_status_t)n : ZX_ERR_NOT_FOUND));
+        return n < 0 ? (zx_status_t)n : ZX_ERR_NOT_FOUND;
+    }
+    return ZX_OK;
+}
+
+static zx_status_t get_process(zx_koid_t koid, zx_handle_t* process) {
+    zx_obj_type_t type;
+    zx_status_t status = get_task_by_koid(koid, &type, process);
+    if (status == ZX_OK && type != ZX_OBJ_TYPE_PROCESS) {
+        zx_handle_close(*process);
+        status = ZX_ERR_WRONG_TYPE;
+    }
+    if (status != ZX_OK) {
+        fprintf(stderr, "syscallstats: no process with koid %" PRIu64 ": %s\n",
+                koid, zx_status_get_string(status));
+    }
+    return status;
+}
+
+// Reads the statistics of every syscall that has been made.
+// The caller is responsible for |*out_stats|.
+static zx_status_t get_stats(zx_handle_t handle, zx_info_syscall_stats_t** out_stats,
+                             size_t* out_count) {
+    zx_info_syscall_stats_t* stats = NULL;
+    size_t count = 64;
+    for (int pass = 0; pass < 3; pass++) {
+        zx_info_syscall_stats_t* resized = realloc(stats, count * sizeof(*stats));
+        if (resized == NULL) {
+            free(stats);
+            return ZX_ERR_NO_MEMORY;
+        }
+        stats = resized;
+        size_t actual, avail;
+        zx_status_t status = zx_object_get_info(handle, ZX_INFO_SYSCALL_STATS, stats,
+                                                count * sizeof(*stats), &actual, &avail);
+        if (status != ZX_OK) {
+            free(stats);
+            fprintf(stderr, "syscallstats: ZX_INFO_SYSCALL_STATS failed: %s\n",
+                    zx_status_get_string(status));
+            return status;
+        }
+        if (actual == avail) {
+            *out_stats = stats;
+            *out_count = actual;
+            return ZX_OK;
+        }
+        // More syscalls were made meanwhile.
+        count = avail + 8;
+    }
+    free(stats);
+    return ZX_ERR_BAD_STATE;
+}
+
+static uint64_t sort_key(const zx_info_syscall_stats_t* stats) {
+    switch (sort_order) {
+    case SORT_COUNT:
+        return stats->count;
+    case SORT_AVERAGE:
+        return stats->total_ns / stats->count;
+    case SORT_TIME:
+    default:
+        return stats->total_ns;
+    }
+}
+
+static int compare_stats(const void* a, const void* b) {
+    uint64_t ka = sort_key(a);
+    uint64_t kb = sort_key(b);
+    return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+// Prints the nonzero buckets, labelled with their lower bounds.
+static void print_histogram(const zx_info_syscall_stats_t* stats) {
+    printf("   ");
+    for (uint32_t i = 0; i < ZX_SYSCALL_STATS_NUM_BUCKETS; i++) {
+        if (stats->histogram[i] == 0)
+            continue;
+        uint64_t ns = i == 0 ? 0 : 1ull << (i + 7);
+        if (ns >= 1000000) {
+            printf(" >=%" PRIu64 "ms:%" PRIu64, ns / 1000000, stats->histogram[i]);
+        } else if (ns >= 1000) {
+            printf(" >=%" PRIu64 "us:%" PRIu64, ns / 1000, stats->histogram[i]);
+        } else {
+            printf(" >=%" PRIu64 "ns:%" PRIu64, ns, stats->histogram[i]);
+        }
+    }
+    printf("\n");
+}
+
+static void print_help(FILE* f) {
+    fprintf(f, "Usage: syscallstats [options]\n");
+    fprintf(f, "Prints how many times each syscall was made and how long it took,\n");
+    fprintf(f, "system-wide or for one process.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -p <koid>       Only the syscalls made by this process\n");
+    fprintf(f, " -s <order>      Sort by total time (time), count or average time (avg)\n");
+    fprintf(f, " -H              Also print the latency histograms (system-wide only)\n");
+}
+
+int main(int argc, char** argv) {
+    zx_koid_t koid = ZX_KOID_INVALID;
+    bool histograms = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "p:s:Hh")) > 0) {
+        switch (c) {
+            case 'p': {
+                char* end;
+                koid = strtoull(optarg, &end, 0);
+                if (*end != '\0' || koid == ZX_KOID_INVALID) {
+                    fprintf(stderr, "Bad -p value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            }
+            case 's':
+                if (!strcmp(optarg, "time")) {
+                    sort_order = SORT_TIME;
+                } else if (!strcmp(optarg, "count")) {
+                    sort_order = SORT_COUNT;
+                } else if (!strcmp(optarg, "avg")) {
+                    sort_order = SORT_AVERAGE;
+                } else {
+                    fprintf(stderr, "Bad -s value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'H':
+                histograms = true;
+                break;
+            case 'h':
+                print_help(stdout);
+                return 0;
+            default:
+                print_help(stderr);
+                return 1;
+        }
+    }
+    if (optind != argc) {
+        print_help(stderr);
+        return 1;
+    }
+
+    zx_handle_t handle;
+    zx_status_t status = koid != ZX_KOID_INVALID ? get_process(koid, &handle)
+                                                 : get_root_resource(&handle);
+    if (status != ZX_OK)
+        return 1;
+
+    zx_info_syscall_stats_t* stats;
+    size_t count;
+    status = get_stats(handle, &stats, &count);
+    zx_handle_close(handle);
+    if (status != ZX_OK)
+        return 1;
+
+    qsort(stats, count, sizeof(*stats), compare_stats);
+
+    printf("%-28s %12s %14s %10s\n", "syscall", "count", "total-us", "avg-ns");
+    for (size_t i = 0; i < count; i++) {
+        printf("%-28s %12" PRIu64 " %14" PRIu64 " %10" PRIu64 "\n",
+               stats[i].name, stats[i].count, stats[i].total_ns / 1000,
+               stats[i].total_ns / stats[i].count);
+        if (histograms)
+            print_histogram(&stats[i]);
+    }
+
+    free(stats);
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <zircon/assert.h>
 #include <zircon/listnode.h>
@@ -19,6 +20,9 @@
 // The port wait key associated with the dispatcher's control messages.
 #define KEY_CONTROL (0u)
 
+// The maximum number of packets a dispatch thread takes from the port at once.
+#define MAX_PACKET_BATCH (ZX_PORT_WAIT_MANY_MAX_PACKETS)
+
 static zx_status_t async_loop_begin_wait(async_t* async, async_wait_t* wait);
 static zx_status_t async_loop_cancel_wait(async_t* async, async_wait_t* wait);
 static zx_status_t async_loop_post_task(async_t* async, async_task_t* task);
@@ -53,15 +57,25 @@ typedef struct async_loop {
     list_node_t task_list; // pending tasks, earliest deadline first
     list_node_t due_list; // due tasks, earliest deadline first
     list_node_t thread_list; // earliest created thread first
+
+    // Packets taken from the port by |zx_port_wait_many()| but not yet dispatched.
+    // Only one thread at a time takes a batch, see |async_loop_run_once()|.
+    bool fetching_batch; // true while a thread is waiting for a batch of packets
+    uint32_t pending_head; // index of the next packet to dispatch
+    uint32_t pending_count; // number of packets left to dispatch
+    zx_port_packet_t pending[MAX_PACKET_BATCH];
 } async_loop_t;
 
 static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline);
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop,
+                                                   const zx_port_packet_t* packet);
 static zx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             zx_status_t status, const zx_packet_signal_t* signal);
 static zx_status_t async_loop_dispatch_tasks(async_loop_t* loop);
 static zx_status_t async_loop_dispatch_packet(async_loop_t* loop, async_receiver_t* receiver,
                                               zx_status_t status, const zx_packet_user_t* data);
 static void async_loop_wake_threads(async_loop_t* loop);
+static bool async_loop_remove_pending_locked(async_loop_t* loop, uint64_t key, uint32_t type);
 static zx_status_t async_loop_wait_async(async_loop_t* loop, async_wait_t* wait);
 static void async_loop_insert_task_locked(async_loop_t* loop, async_task_t* task);
 static void async_loop_restart_timer_locked(async_loop_t* loop);
@@ -160,6 +174,13 @@ void async_loop_shutdown(async_t* async) {
     async_loop_wake_threads(loop);
     async_loop_join_threads(async);
 
+    // Drop packets which were taken from the port but never dispatched.
+    // Waits among them which asked to observe shutdown are still on the
+    // wait list and are canceled below.
+    mtx_lock(&loop->lock);
+    loop->pending_count = 0u;
+    mtx_unlock(&loop->lock);
+
     list_node_t* node;
     while ((node = list_remove_head(&loop->wait_list))) {
         async_wait_t* wait = node_to_wait(node);
@@ -219,32 +240,70 @@ static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
     if (state != ASYNC_LOOP_RUNNABLE)
         return ZX_ERR_CANCELED;
 
-    zx_port_packet_t packet;
-    zx_status_t status = zx_port_wait(loop->port, deadline, &packet, 0);
+    // Dispatch packets left over from an earlier batch first.  Otherwise,
+    // when this is the only dispatch thread, take as many packets as the
+    // port has ready (up to |MAX_PACKET_BATCH|) with a single syscall and
+    // keep the extras for the following iterations.  With several threads
+    // we take one packet at a time so that a handler which blocks cannot
+    // hold up packets which another thread could be dispatching.
+    zx_port_packet_t packets[MAX_PACKET_BATCH];
+    uint32_t max_packets = 1u;
+    mtx_lock(&loop->lock);
+    if (loop->pending_count) {
+        packets[0] = loop->pending[loop->pending_head++];
+        loop->pending_count--;
+        mtx_unlock(&loop->lock);
+        return async_loop_dispatch_port_packet(loop, &packets[0]);
+    }
+    if (!loop->fetching_batch &&
+        atomic_load_explicit(&loop->active_threads, memory_order_acquire) == 1u) {
+        loop->fetching_batch = true;
+        max_packets = MAX_PACKET_BATCH;
+    }
+    mtx_unlock(&loop->lock);
+
+    uint32_t count = 0u;
+    zx_status_t status = zx_port_wait_many(loop->port, deadline, packets, max_packets, &count);
+
+    if (max_packets > 1u) {
+        mtx_lock(&loop->lock);
+        loop->fetching_batch = false;
+        if (status == ZX_OK && count > 1u) {
+            memcpy(loop->pending, &packets[1], (count - 1u) * sizeof(zx_port_packet_t));
+            loop->pending_head = 0u;
+            loop->pending_count = count - 1u;
+        }
+        mtx_unlock(&loop->lock);
+    }
     if (status != ZX_OK)
         return status;
 
-    if (packet.key == KEY_CONTROL) {
+    return async_loop_dispatch_port_packet(loop, &packets[0]);
+}
+
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop,
+                                                   const zx_port_packet_t* packet) {
+    if (packet->key == KEY_CONTROL) {
         // Handle wake-up packets.
-        if (packet.type == ZX_PKT_TYPE_USER)
+        if (packet->type == ZX_PKT_TYPE_USER)
             return ZX_OK;
 
         // Handle task timer expirations.
-        if (packet.type == ZX_PKT_TYPE_SIGNAL_REP &&
-            packet.signal.observed & ZX_TIMER_SIGNALED) {
+        if (packet->type == ZX_PKT_TYPE_SIGNAL_REP &&
+            packet->signal.observed & ZX_TIMER_SIGNALED) {
             return async_loop_dispatch_tasks(loop);
         }
     } else {
         // Handle wait completion packets.
-        if (packet.type == ZX_PKT_TYPE_SIGNAL_ONE) {
-            async_wait_t* wait = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_wait(loop, wait, packet.status, &packet.signal);
+        if (packet->type == ZX_PKT_TYPE_SIGNAL_ONE) {
+            async_wait_t* wait = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_wait(loop, wait, packet->status, &packet->signal);
         }
 
         // Handle queued user packets.
-        if (packet.type == ZX_PKT_TYPE_USER) {
-            async_receiver_t* receiver = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_packet(loop, receiver, packet.status, &packet.user);
+        if (packet->type == ZX_PKT_TYPE_USER) {
+            async_receiver_t* receiver = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_packet(loop, receiver, packet->status, &packet->user);
         }
     }
 
@@ -458,14 +517,32 @@ static zx_status_t async_loop_cancel_wait(async_t* async, async_wait_t* wait) {
     // invoked again past this point.
     zx_status_t status = zx_port_cancel(loop->port, wait->object,
                                         (uintptr_t)wait);
-    if (status == ZX_OK && (wait->flags & ASYNC_FLAG_HANDLE_SHUTDOWN)) {
-        mtx_lock(&loop->lock);
+
+    mtx_lock(&loop->lock);
+    // The wait's packet may already have been taken from the port as part
+    // of a batch, in which case it must be dropped from the pending packets.
+    if (status == ZX_ERR_NOT_FOUND &&
+        async_loop_remove_pending_locked(loop, (uintptr_t)wait, ZX_PKT_TYPE_SIGNAL_ONE))
+        status = ZX_OK;
+    if (status == ZX_OK && (wait->flags & ASYNC_FLAG_HANDLE_SHUTDOWN))
         list_delete(wait_to_node(wait));
-        mtx_unlock(&loop->lock);
-    }
+    mtx_unlock(&loop->lock);
     return status;
 }
 
+static bool async_loop_remove_pending_locked(async_loop_t* loop, uint64_t key, uint32_t type) {
+    zx_port_packet_t* first = &loop->pending[loop->pending_head];
+    for (uint32_t i = 0u; i < loop->pending_count; i++) {
+        if (first[i].key == key && first[i].type == type) {
+            memmove(&first[i], &first[i + 1u],
+                    (loop->pending_count - i - 1u) * sizeof(zx_port_packet_t));
+            loop->pending_count--;
+            return true;
+        }
+    }
+    return false;
+}
+
 static zx_status_t async_loop_post_task(async_t* async, async_task_t* task) {
     async_loop_t* loop = (async_loop_t*)async;
     ZX_DEBUG_ASSERT(loop);
@@ -15,6 +15,7 @@ MODULE_SO_NAME := blktest
 
 MODULE_STATIC_LIBS := \
     system/ulib/block-client \
+    system/ulib/shared-fifo \
     system/ulib/sync \
     system/ulib/pretty \
     system/ulib/zxcpp \
@@ -27,6 +27,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/async.loop \
     system/ulib/block-client \
     system/ulib/digest \
+    system/ulib/shared-fifo \
     third_party/ulib/uboringssl \
     system/ulib/trace \
     system/ulib/zx \
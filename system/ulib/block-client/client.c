@@ -8,21 +8,22 @@
 #include <zircon/compiler.h>
 #include <zircon/device/block.h>
 #include <zircon/syscalls.h>
+#include <shared-fifo/shared-fifo.h>
 #include <sync/completion.h>
 
 #include "block-client/client.h"
 
 // Writes on a FIFO, repeating the write later if the FIFO is full.
-static zx_status_t do_write(zx_handle_t fifo, block_fifo_request_t* request, size_t count) {
+static zx_status_t do_write(shared_fifo_t* fifo, block_fifo_request_t* request, size_t count) {
     zx_status_t status;
     while (true) {
         uint32_t actual;
-        status = zx_fifo_write(fifo, request, sizeof(block_fifo_request_t) * count, &actual);
+        status = shared_fifo_write(fifo, request, sizeof(block_fifo_request_t) * count, &actual);
         if (status == ZX_ERR_SHOULD_WAIT) {
             zx_signals_t signals;
-            if ((status = zx_object_wait_one(fifo,
-                                             ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED,
-                                             ZX_TIME_INFINITE, &signals)) != ZX_OK) {
+            if ((status = shared_fifo_wait(fifo,
+                                           ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED,
+                                           ZX_TIME_INFINITE, &signals)) != ZX_OK) {
                 return status;
             } else if (signals & ZX_FIFO_PEER_CLOSED) {
                 return ZX_ERR_PEER_CLOSED;
@@ -40,16 +41,16 @@ static zx_status_t do_write(zx_handle_t fifo, block_fifo_request_t* request, siz
     }
 }
 
-static zx_status_t do_read(zx_handle_t fifo, block_fifo_response_t* response) {
+static zx_status_t do_read(shared_fifo_t* fifo, block_fifo_response_t* response) {
     zx_status_t status;
     while (true) {
         uint32_t count;
-        status = zx_fifo_read(fifo, response, sizeof(block_fifo_response_t), &count);
+        status = shared_fifo_read(fifo, response, sizeof(block_fifo_response_t), &count);
         if (status == ZX_ERR_SHOULD_WAIT) {
             zx_signals_t signals;
-            if ((status = zx_object_wait_one(fifo,
-                                             ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED,
-                                             ZX_TIME_INFINITE, &signals)) != ZX_OK) {
+            if ((status = shared_fifo_wait(fifo,
+                                           ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED,
+                                           ZX_TIME_INFINITE, &signals)) != ZX_OK) {
                 return status;
             } else if (signals & ZX_FIFO_PEER_CLOSED) {
                 return ZX_ERR_PEER_CLOSED;
@@ -68,6 +69,8 @@ typedef struct block_completion {
 
 typedef struct fifo_client {
     zx_handle_t fifo;
+    // Maps the fifo's rings when the server created it with ZX_FIFO_SHARED.
+    shared_fifo_t shared;
     block_completion_t txns[MAX_TXN_COUNT];
 } fifo_client_t;
 
@@ -76,6 +79,12 @@ zx_status_t block_fifo_create_client(zx_handle_t fifo, fifo_client_t** out) {
     if (client == NULL) {
         return ZX_ERR_NO_MEMORY;
     }
+    zx_status_t status = shared_fifo_init(&client->shared, fifo,
+                                          BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE);
+    if (status != ZX_OK) {
+        free(client);
+        return status;
+    }
     client->fifo = fifo;
     *out = client;
     return ZX_OK;
@@ -86,6 +95,7 @@ void block_fifo_release_client(fifo_client_t* client) {
         return;
     }
 
+    shared_fifo_destroy(&client->shared);
     zx_handle_close(client->fifo);
     free(client);
 }
@@ -108,14 +118,14 @@ zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests
         requests[i].opcode = (requests[i].opcode & BLOCKIO_OP_MASK) |
                              (i == count - 1 ? BLOCKIO_TXN_END : 0);
     }
-    if ((status = do_write(client->fifo, &requests[0], count)) != ZX_OK) {
+    if ((status = do_write(&client->shared, &requests[0], count)) != ZX_OK) {
         return status;
     }
 
     // As expected by the protocol, when we send one "BLOCKIO_TXN_END" message, we
     // must read a reply message.
     block_fifo_response_t response;
-    if ((status = do_read(client->fifo, &response)) != ZX_OK) {
+    if ((status = do_read(&client->shared, &response)) != ZX_OK) {
         return status;
     }
 
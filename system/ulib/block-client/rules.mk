@@ -13,6 +13,7 @@ MODULE_SRCS += \
 
 MODULE_STATIC_LIBS := \
     system/ulib/fs \
+    system/ulib/shared-fifo \
     system/ulib/sync \
 
 MODULE_LIBS := \
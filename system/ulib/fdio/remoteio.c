@@ -737,9 +737,7 @@ zx_status_t fdio_create_fd(zx_handle_t* handles, uint32_t* types, size_t hcount,
     *fd_out = fd;
     return ZX_OK;
 fail:
-    for (size_t i = 0; i < hcount; i++) {
-        zx_handle_close(handles[i]);
-    }
+    zx_handle_close_many(handles, hcount);
     return r;
 }
 
@@ -184,9 +184,7 @@ zx_status_t Connection::HandleMessage(zxrio_msg_t* msg) {
 
     // ensure handle count specified by opcode matches reality
     if (msg->hcount != ZXRIO_HC(msg->op)) {
-        for (unsigned i = 0; i < msg->hcount; i++) {
-            zx_handle_close(msg->handle[i]);
-        }
+        zx_handle_close_many(msg->handle, msg->hcount);
         return ZX_ERR_IO;
     }
     msg->hcount = 0;
@@ -623,9 +621,7 @@ zx_status_t Connection::HandleMessage(zxrio_msg_t* msg) {
     }
     default:
         // close inbound handles so they do not leak
-        for (unsigned i = 0; i < ZXRIO_HC(msg->op); i++) {
-            zx_handle_close(msg->handle[i]);
-        }
+        zx_handle_close_many(msg->handle, ZXRIO_HC(msg->op));
         return ZX_ERR_NOT_SUPPORTED;
     }
 }
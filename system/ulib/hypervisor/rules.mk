@@ -26,6 +26,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/async.loop \
     system/ulib/block-client \
     system/ulib/fbl \
+    system/ulib/shared-fifo \
     system/ulib/zx \
     system/ulib/zxcpp \
 
@@ -102,11 +102,7 @@ const char* launchpad_error_message(launchpad_t* lp) {
 #define lp_vmar(lp) ((lp)->handles[1])
 
 static void close_handles(zx_handle_t* handles, size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-        if (handles[i] != ZX_HANDLE_INVALID) {
-            zx_handle_close(handles[i]);
-        }
-    }
+    zx_handle_close_many(handles, count);
 }
 
 void launchpad_destroy(launchpad_t* lp) {
@@ -328,9 +324,7 @@ zx_status_t launchpad_add_handles(launchpad_t* lp, size_t n,
             }
         }
     } else {
-        for (size_t i = 0; i < n; i++) {
-            zx_handle_close(h[i]);
-        }
+        zx_handle_close_many(h, n);
     }
     return status;
 }
@@ -224,7 +224,7 @@ void WritebackBuffer::CopyToBufferLocked(WriteTxn* txn) {
     write_request_t* reqs = txn->Requests();
     // Write back to the buffer
     for (size_t i = 0; i < req_count; i++) {
-        size_t vmo_offset = reqs[i].vmo_offset;
+        const size_t vmo_offset = reqs[i].vmo_offset;
         size_t dev_offset = reqs[i].dev_offset;
         const size_t vmo_len = reqs[i].length;
         ZX_DEBUG_ASSERT(vmo_len > 0);
@@ -241,10 +241,18 @@ void WritebackBuffer::CopyToBufferLocked(WriteTxn* txn) {
         ZX_DEBUG_ASSERT((start_ <= wb_offset) ?
                         (start_ < wb_offset + wb_len) :
                         (wb_offset + wb_len <= start_)); // Wraparound
-        ZX_ASSERT_MSG((status = zx_vmo_read(vmo, ptr, vmo_offset * kMinfsBlockSize,
-                      wb_len * kMinfsBlockSize, &actual)) == ZX_OK, "VMO Read Fail: %d", status);
-        ZX_ASSERT_MSG(actual == wb_len * kMinfsBlockSize, "Only read %" PRIu64 " of %" PRIu64,
-                      actual, wb_len * kMinfsBlockSize);
+        // If the request wraps around the end of the buffer, gather both
+        // halves with a single read.
+        zx_iovec_t vectors[2] = {
+            {ptr, wb_len * kMinfsBlockSize},
+            {buffer_->GetData(), (vmo_len - wb_len) * kMinfsBlockSize},
+        };
+        uint32_t vector_count = (wb_len != vmo_len) ? 2 : 1;
+        ZX_ASSERT_MSG((status = zx_vmo_readv(vmo, vectors, vector_count,
+                                             vmo_offset * kMinfsBlockSize, &actual)) == ZX_OK,
+                      "VMO Read Fail: %d", status);
+        ZX_ASSERT_MSG(actual == vmo_len * kMinfsBlockSize, "Only read %" PRIu64 " of %" PRIu64,
+                      actual, vmo_len * kMinfsBlockSize);
         len_ += wb_len;
 
         // Update the write_request to transfer from the writeback buffer
@@ -254,15 +262,9 @@ void WritebackBuffer::CopyToBufferLocked(WriteTxn* txn) {
 
         if (wb_len != vmo_len) {
             // We wrapped around; write what remains from this request
-            vmo_offset += wb_len;
             dev_offset += wb_len;
             wb_len = vmo_len - wb_len;
-            ptr = buffer_->GetData();
             ZX_DEBUG_ASSERT((start_ == 0) ?  (start_ < wb_len) : (wb_len <= start_)); // Wraparound
-            ZX_ASSERT(zx_vmo_read(vmo, ptr, vmo_offset * kMinfsBlockSize,
-                                  wb_len * kMinfsBlockSize, &actual) == ZX_OK);
-            ZX_ASSERT_MSG(actual == wb_len * kMinfsBlockSize, "Only read %"
-                          PRIu64 " of %" PRIu64, actual, wb_len * kMinfsBlockSize);
             len_ += wb_len;
 
             // Shift down all following write requests
@@ -0,0 +1,128 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <fbl/function.h>
+#include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
+#include <perftest/results.h>
+#include <zircon/syscalls.h>
+
+// A framework for microbenchmarks.
+//
+// A test is a function that times some operation with a loop like:
+//
+//   bool ChannelWriteRead(perftest::RepeatState* state) {
+//       ...set up...
+//       while (state->KeepRunning()) {
+//           ...the operation being timed...
+//       }
+//       ...tear down...
+//       return true;
+//   }
+//
+// Each pass through the loop is one run. The first few runs warm up the
+// caches and are not recorded; the time taken by each of the others is.
+// Tests are registered from static constructors:
+//
+//   void RegisterTests() {
+//       perftest::RegisterTest("Channel/WriteRead", ChannelWriteRead);
+//   }
+//   PERFTEST_CTOR(RegisterTests);
+//
+// and are run by a main() that calls PerfTestMain().
+
+namespace perftest {
+
+class RepeatState {
+public:
+    RepeatState(uint32_t warm_up_runs, uint32_t runs);
+
+    // Returns true if there is another run to do. Each call ends the run
+    // before it, if there is one, and starts the next.
+    bool KeepRunning() {
+        uint64_t now = zx_ticks_get();
+        if (calls_ > warm_up_runs_ + runs_)
+            return false;
+        if (calls_ >= warm_up_runs_)
+            ticks_[calls_ - warm_up_runs_] = now;
+        return calls_++ < warm_up_runs_ + runs_;
+    }
+
+    // Says that each run moves |bytes| bytes, so that the throughput is
+    // reported as well as the time.
+    void SetBytesProcessedPerRun(uint64_t bytes) { bytes_per_run_ = bytes; }
+
+    // Returns true if KeepRunning() has returned false, i.e. if the test
+    // did all of its runs.
+    bool finished() const { return calls_ > warm_up_runs_ + runs_; }
+
+    // Appends the time of each recorded run, in nanoseconds.
+    void GetResults(TestCaseResults* results) const;
+
+private:
+    uint32_t const warm_up_runs_;
+    uint32_t const runs_;
+    uint32_t calls_ = 0;
+    uint64_t bytes_per_run_ = 0;
+
+    // The time at the start of each recorded run, and at the end of the
+    // last one.
+    fbl::unique_ptr<uint64_t[]> ticks_;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(RepeatState);
+};
+
+// Returns false if the test failed.
+using TestFunc = fbl::Function<bool(RepeatState*)>;
+
+// Adds a test to the ones that RunTests() runs.
+void RegisterTest(const char* name, TestFunc test_func);
+
+// Registers a test that times |Func| on its own, for operations that need
+// no setting up.
+template <bool (*Func)()>
+void RegisterSimpleTest(const char* name) {
+    RegisterTest(name, [](RepeatState* state) {
+        while (state->KeepRunning()) {
+            if (!Func())
+                return false;
+        }
+        return true;
+    });
+}
+
+struct RunOptions {
+    uint32_t warm_up_runs = 10u;
+    uint32_t runs = 1000u;
+
+    // If set, only the tests whose names contain this string are run.
+    const char* filter = nullptr;
+};
+
+// Runs the registered tests in the order they were registered, logging
+// their progress to |log|, and adds the results of the ones that pass to
+// |results|. Returns false if any test failed.
+bool RunTests(const RunOptions& options, FILE* log, ResultsSet* results);
+
+// A main() for a program made of registered tests.
+//
+// Run on its own, the program runs every test and prints their statistics;
+// see the --help text for its options. Run by runtests, it only runs each
+// test a few times, to check that they work, unless performance tests were
+// asked for with runtests -P. If runtests was given an output directory,
+// the results are written to <directory>/<program name>.json.
+int PerfTestMain(int argc, char** argv);
+
+} // namespace perftest
+
+// Calls |func|, which registers tests, before main().
+#define PERFTEST_CTOR(func) \
+    namespace { \
+    __attribute__((constructor)) void func##_ctor() { func(); } \
+    }
@@ -0,0 +1,86 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <fbl/string.h>
+#include <fbl/vector.h>
+
+namespace perftest {
+
+struct SummaryStatistics {
+    double min;
+    double max;
+    double mean;
+    double std_dev;
+    double median;
+    double p90;
+    double p99;
+};
+
+// The values measured for one test, typically one per run.
+class TestCaseResults {
+public:
+    TestCaseResults(const fbl::String& label, const fbl::String& unit)
+        : label_(label), unit_(unit) {}
+
+    const fbl::String& label() const { return label_; }
+    const fbl::String& unit() const { return unit_; }
+    const fbl::Vector<double>& values() const { return values_; }
+
+    // The bytes each run moves, or 0 if the test has no throughput.
+    uint64_t bytes_per_run() const { return bytes_per_run_; }
+    void set_bytes_per_run(uint64_t bytes) { bytes_per_run_ = bytes; }
+
+    void AppendValue(double value) { values_.push_back(value); }
+
+    // Must only be called if there is at least one value. The percentiles
+    // are the nearest value at or above the rank.
+    SummaryStatistics GetSummaryStatistics() const;
+
+    // Writes the results as a JSON object.
+    void WriteJSON(FILE* out) const;
+
+private:
+    fbl::String label_;
+    fbl::String unit_;
+    fbl::Vector<double> values_;
+    uint64_t bytes_per_run_ = 0;
+};
+
+// The results of a set of tests, as a program reports them.
+//
+// The JSON form is an array with an object per test:
+//
+//   [{"label": "Channel/WriteRead/64bytes",
+//     "unit": "nanoseconds",
+//     "values": [1234.5, 1201.0, ...],
+//     "bytes_per_run": 64},
+//    ...]
+//
+// "bytes_per_run" is only present for tests that report throughput.
+class ResultsSet {
+public:
+    const fbl::Vector<TestCaseResults>& results() const { return results_; }
+
+    // The returned pointer is valid until the next call.
+    TestCaseResults* AddTestCase(const fbl::String& label, const fbl::String& unit);
+
+    void WriteJSON(FILE* out) const;
+
+    // Returns false, having printed why, if the file cannot be written.
+    bool WriteJSONFile(const char* path) const;
+
+    // Prints a table of each test's statistics, in microseconds when the
+    // unit is nanoseconds.
+    void PrintSummaryStatistics(FILE* out) const;
+
+private:
+    fbl::Vector<TestCaseResults> results_;
+};
+
+} // namespace perftest
@@ -0,0 +1,163 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/perftest.h>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fbl/string.h>
+#include <fbl/vector.h>
+#include <unittest/unittest.h>
+
+namespace perftest {
+namespace {
+
+// How often each test runs when runtests only wants to know that it works.
+constexpr uint32_t kQuickWarmUpRuns = 1u;
+constexpr uint32_t kQuickRuns = 3u;
+
+struct NamedTest {
+    fbl::String name;
+    TestFunc test_func;
+};
+
+// Registration happens in static constructors, so the list is created on
+// first use rather than relying on the order of static initialization.
+fbl::Vector<NamedTest>* GetTests() {
+    static fbl::Vector<NamedTest>* tests = new fbl::Vector<NamedTest>;
+    return tests;
+}
+
+void PrintUsage(FILE* out, const char* name) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "Runs the benchmarks in this program and prints their statistics.\n"
+            "Options:\n"
+            "  --filter <string>  Only run the tests whose names contain <string>\n"
+            "  --runs <count>     Time this many runs of each test (default %u)\n"
+            "  --warm-up <count>  Do this many untimed runs first (default %u)\n"
+            "  --out <file>       Write the results to <file> as JSON\n"
+            "  --quick            Only check that the tests work, and do not\n"
+            "                     print statistics\n",
+            name, RunOptions().runs, RunOptions().warm_up_runs);
+}
+
+bool ParseCount(const char* arg, uint32_t* out) {
+    char* end;
+    unsigned long value = strtoul(arg, &end, 0);
+    if (*arg == '\0' || *end != '\0' || value == 0 || value > UINT32_MAX)
+        return false;
+    *out = static_cast<uint32_t>(value);
+    return true;
+}
+
+} // namespace
+
+RepeatState::RepeatState(uint32_t warm_up_runs, uint32_t runs)
+    : warm_up_runs_(warm_up_runs), runs_(runs), ticks_(new uint64_t[runs + 1]) {}
+
+void RepeatState::GetResults(TestCaseResults* results) const {
+    const double ns_per_tick = 1e9 / static_cast<double>(zx_ticks_per_second());
+    for (uint32_t i = 0; i < runs_; i++)
+        results->AppendValue(static_cast<double>(ticks_[i + 1] - ticks_[i]) * ns_per_tick);
+    results->set_bytes_per_run(bytes_per_run_);
+}
+
+void RegisterTest(const char* name, TestFunc test_func) {
+    GetTests()->push_back(NamedTest{fbl::String(name), fbl::move(test_func)});
+}
+
+bool RunTests(const RunOptions& options, FILE* log, ResultsSet* results) {
+    bool ok = true;
+    for (NamedTest& test : *GetTests()) {
+        if (options.filter && !strstr(test.name.c_str(), options.filter))
+            continue;
+
+        fprintf(log, "%-48s", test.name.c_str());
+        fflush(log);
+        RepeatState state(options.warm_up_runs, options.runs);
+        if (!test.test_func(&state)) {
+            fprintf(log, " [FAILED]\n");
+            ok = false;
+            continue;
+        }
+        if (!state.finished()) {
+            // Returning early would leave runs without times.
+            fprintf(log, " [FAILED] stopped before its last run\n");
+            ok = false;
+            continue;
+        }
+        TestCaseResults* test_results = results->AddTestCase(test.name, "nanoseconds");
+        state.GetResults(test_results);
+        fprintf(log, " [PASSED] mean %.3f us\n",
+                test_results->GetSummaryStatistics().mean / 1000);
+    }
+    return ok;
+}
+
+int PerfTestMain(int argc, char** argv) {
+    RunOptions options;
+    const char* out_path = nullptr;
+    bool quick = false;
+
+    // runtests tells the test which classes of tests to run.
+    char out_path_buf[PATH_MAX];
+    if (const char* test_class = getenv(TEST_ENV_NAME)) {
+        if (!(strtoul(test_class, nullptr, 0) & TEST_PERFORMANCE)) {
+            quick = true;
+        } else if (const char* out_dir = getenv(TEST_OUTPUT_DIR_ENV_NAME)) {
+            const char* name = strrchr(argv[0], '/');
+            name = name ? name + 1 : argv[0];
+            snprintf(out_path_buf, sizeof(out_path_buf), "%s/%s.json", out_dir, name);
+            out_path = out_path_buf;
+        }
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            PrintUsage(stdout, argv[0]);
+            return 0;
+        } else if (!strcmp(arg, "--filter") && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (!strcmp(arg, "--runs") && i + 1 < argc) {
+            if (!ParseCount(argv[++i], &options.runs)) {
+                fprintf(stderr, "Bad run count '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(arg, "--warm-up") && i + 1 < argc) {
+            if (!ParseCount(argv[++i], &options.warm_up_runs)) {
+                fprintf(stderr, "Bad run count '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(arg, "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (!strcmp(arg, "--quick")) {
+            quick = true;
+        } else if (!strncmp(arg, "v=", 2)) {
+            // The verbosity that runtests passes to unit tests.
+        } else {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    }
+    if (quick) {
+        options.warm_up_runs = kQuickWarmUpRuns;
+        options.runs = kQuickRuns;
+    }
+
+    ResultsSet results;
+    bool ok = RunTests(options, stdout, &results);
+    if (!quick) {
+        printf("\n");
+        results.PrintSummaryStatistics(stdout);
+        if (out_path && !results.WriteJSONFile(out_path))
+            ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+} // namespace perftest
@@ -0,0 +1,146 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/results.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fbl/unique_ptr.h>
+
+namespace perftest {
+namespace {
+
+// Writes |string| as a JSON string. Test names are plain ASCII, so only
+// the characters that must be escaped are.
+void WriteJSONString(FILE* out, const char* string) {
+    fputc('"', out);
+    for (const char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', out);
+            fputc(*c, out);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+int CompareDoubles(const void* a, const void* b) {
+    double x = *static_cast<const double*>(a);
+    double y = *static_cast<const double*>(b);
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// The nearest-rank percentile of sorted |values|.
+double Percentile(const double* values, size_t count, double fraction) {
+    size_t rank = static_cast<size_t>(ceil(fraction * static_cast<double>(count)));
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+} // namespace
+
+SummaryStatistics TestCaseResults::GetSummaryStatistics() const {
+    const size_t count = values_.size();
+    fbl::unique_ptr<double[]> sorted(new double[count]);
+    memcpy(sorted.get(), values_.get(), count * sizeof(double));
+    qsort(sorted.get(), count, sizeof(double), CompareDoubles);
+
+    double sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += sorted[i];
+    const double mean = sum / static_cast<double>(count);
+    double sum_of_squares = 0;
+    for (size_t i = 0; i < count; i++)
+        sum_of_squares += (sorted[i] - mean) * (sorted[i] - mean);
+
+    SummaryStatistics stats;
+    stats.min = sorted[0];
+    stats.max = sorted[count - 1];
+    stats.mean = mean;
+    stats.std_dev = sqrt(sum_of_squares / static_cast<double>(count));
+    stats.median = count % 2 ? sorted[count / 2]
+                             : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+    stats.p90 = Percentile(sorted.get(), count, 0.9);
+    stats.p99 = Percentile(sorted.get(), count, 0.99);
+    return stats;
+}
+
+void TestCaseResults::WriteJSON(FILE* out) const {
+    fprintf(out, "{\"label\":");
+    WriteJSONString(out, label_.c_str());
+    fprintf(out, ",\"unit\":");
+    WriteJSONString(out, unit_.c_str());
+    fprintf(out, ",\"values\":[");
+    for (size_t i = 0; i < values_.size(); i++) {
+        fprintf(out, "%s%.17g", i ? "," : "", values_[i]);
+    }
+    fprintf(out, "]");
+    if (bytes_per_run_)
+        fprintf(out, ",\"bytes_per_run\":%" PRIu64, bytes_per_run_);
+    fprintf(out, "}");
+}
+
+TestCaseResults* ResultsSet::AddTestCase(const fbl::String& label, const fbl::String& unit) {
+    results_.push_back(TestCaseResults(label, unit));
+    return &results_[results_.size() - 1];
+}
+
+void ResultsSet::WriteJSON(FILE* out) const {
+    fprintf(out, "[");
+    for (size_t i = 0; i < results_.size(); i++) {
+        fprintf(out, i ? ",\n" : "\n");
+        results_[i].WriteJSON(out);
+    }
+    fprintf(out, "\n]\n");
+}
+
+bool ResultsSet::WriteJSONFile(const char* path) const {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    WriteJSON(out);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void ResultsSet::PrintSummaryStatistics(FILE* out) const {
+    fprintf(out, "%-40s %10s %10s %10s %10s %10s %10s %10s %10s\n", "test", "mean", "std_dev",
+            "min", "median", "p90", "p99", "max", "MB/s");
+    for (const TestCaseResults& results : results_) {
+        if (results.values().is_empty())
+            continue;
+        SummaryStatistics stats = results.GetSummaryStatistics();
+        double scale = 1.0;
+        const char* unit = results.unit().c_str();
+        if (results.unit() == "nanoseconds") {
+            scale = 1e-3;
+            unit = "us";
+        }
+        fprintf(out, "%-40s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f",
+                results.label().c_str(), stats.mean * scale, stats.std_dev * scale,
+                stats.min * scale, stats.median * scale, stats.p90 * scale, stats.p99 * scale,
+                stats.max * scale);
+        if (results.bytes_per_run() && results.unit() == "nanoseconds" && stats.mean > 0) {
+            // Bytes per nanosecond is 1000 MB/s.
+            fprintf(out, " %10.1f",
+                    static_cast<double>(results.bytes_per_run()) * 1000 / stats.mean);
+        } else {
+            fprintf(out, " %10s", "");
+        }
+        fprintf(out, "  %s\n", unit);
+    }
+}
+
+} // namespace perftest
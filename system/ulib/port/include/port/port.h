@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <threads.h>
+
 #include <zircon/compiler.h>
+#include <zircon/syscalls/port.h>
 #include <zircon/types.h>
 
 __BEGIN_CDECLS
@@ -21,6 +24,12 @@ struct port_handler {
 
 typedef struct {
     zx_handle_t handle;
+
+    // Packets received by port_dispatch() but not dispatched yet.
+    mtx_t lock;
+    uint32_t pending_head;
+    uint32_t pending_count;
+    zx_port_packet_t pending[ZX_PORT_WAIT_MANY_MAX_PACKETS];
 } port_t;
 
 // Initialize a port
@@ -41,6 +50,9 @@ zx_status_t port_wait_repeating(port_t* port, port_handler_t* ph);
 // If a packet is received, the callback for the port handler
 // is invoked.  If that callback returns ZX_OK, port_wait()
 // is invoked on that port handler again.
+//
+// Packets are received from the kernel in batches, so only one
+// thread may call port_dispatch() on a given port at a time.
 zx_status_t port_dispatch(port_t* port, zx_time_t timeout, bool once);
 
 // Cancel pending waits for the handler on this port
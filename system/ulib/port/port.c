@@ -21,6 +21,9 @@
 #endif
 
 zx_status_t port_init(port_t* port) {
+    mtx_init(&port->lock, mtx_plain);
+    port->pending_head = 0;
+    port->pending_count = 0;
     zx_status_t r = zx_port_create(0, &port->handle);
     zprintf("port_init(%p) port=%x\n", port, port->handle);
     return r;
@@ -43,9 +46,31 @@ zx_status_t port_wait_repeating(port_t* port, port_handler_t* ph) {
 }
 
 
+// Drops a signal packet for |ph| which port_dispatch() has received
+// but not yet dispatched. Returns true if there was one.
+static bool port_remove_pending(port_t* port, port_handler_t* ph) {
+    bool removed = false;
+    mtx_lock(&port->lock);
+    zx_port_packet_t* first = &port->pending[port->pending_head];
+    for (uint32_t i = 0; i < port->pending_count; i++) {
+        if (first[i].key == (uint64_t)(uintptr_t)ph && first[i].type != ZX_PKT_TYPE_USER) {
+            memmove(&first[i], &first[i + 1],
+                    (port->pending_count - i - 1) * sizeof(zx_port_packet_t));
+            port->pending_count--;
+            removed = true;
+            break;
+        }
+    }
+    mtx_unlock(&port->lock);
+    return removed;
+}
+
 zx_status_t port_cancel(port_t* port, port_handler_t* ph) {
     zx_status_t r = zx_port_cancel(port->handle, ph->handle,
                                    (uint64_t)(uintptr_t)ph);
+    if (r == ZX_ERR_NOT_FOUND && port_remove_pending(port, ph)) {
+        r = ZX_OK;
+    }
     zprintf("port_cancel(%p, %p) obj=%x port=%x: r = %d\n",
             port, ph, ph->handle, port->handle, r);
     return r;
@@ -61,11 +86,46 @@ zx_status_t port_queue(port_t* port, port_handler_t* ph, uint32_t evt) {
     return r;
 }
 
+// Takes the next packet left over from the last batch, if any.
+static bool port_take_pending(port_t* port, zx_port_packet_t* pkt) {
+    bool found = false;
+    mtx_lock(&port->lock);
+    if (port->pending_count > 0) {
+        *pkt = port->pending[port->pending_head++];
+        port->pending_count--;
+        found = true;
+    }
+    mtx_unlock(&port->lock);
+    return found;
+}
+
+// Waits for packets, returning the first one in |pkt| and keeping the
+// rest for later calls to port_take_pending().
+static zx_status_t port_wait_batch(port_t* port, zx_time_t deadline, zx_port_packet_t* pkt) {
+    zx_port_packet_t pkts[ZX_PORT_WAIT_MANY_MAX_PACKETS];
+    uint32_t count;
+    zx_status_t r = zx_port_wait_many(port->handle, deadline, pkts,
+                                      ZX_PORT_WAIT_MANY_MAX_PACKETS, &count);
+    if (r != ZX_OK) {
+        return r;
+    }
+    *pkt = pkts[0];
+    if (count > 1) {
+        mtx_lock(&port->lock);
+        memcpy(port->pending, &pkts[1], (count - 1) * sizeof(zx_port_packet_t));
+        port->pending_head = 0;
+        port->pending_count = count - 1;
+        mtx_unlock(&port->lock);
+    }
+    return ZX_OK;
+}
+
 zx_status_t port_dispatch(port_t* port, zx_time_t deadline, bool once) {
     for (;;) {
         zx_port_packet_t pkt;
         zx_status_t r;
-        if ((r = zx_port_wait(port->handle, deadline, &pkt, 0)) != ZX_OK) {
+        if (!port_take_pending(port, &pkt) &&
+            (r = port_wait_batch(port, deadline, &pkt)) != ZX_OK) {
             if (r != ZX_ERR_TIMED_OUT) {
                 printf("port_dispatch: port wait failed %d\n", r);
             }
@@ -0,0 +1,74 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include <zircon/compiler.h>
+#include <zircon/syscalls/fifo.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// Moves entries through a fifo created with ZX_FIFO_SHARED without a syscall
+// per entry. The rings are mapped into the process and a syscall is only
+// made to wake a peer that is waiting, or to go to sleep.
+//
+// Any other fifo works too, in which case every call is forwarded to the
+// matching zx_fifo_* syscall. Either way the two ends of a fifo need not
+// agree on whether they use this library, since the kernel follows the same
+// protocol on behalf of a peer that uses zx_fifo_read() and zx_fifo_write().
+//
+// The functions below are thread-safe. Once an endpoint is wrapped, it must
+// only be read, written and waited on through its shared_fifo_t.
+typedef struct shared_fifo {
+    zx_handle_t handle;
+    uint32_t elem_count;
+    uint32_t elem_size;
+
+    // Null unless the fifo is shared.
+    zx_fifo_shared_ring_t* tx_ring;
+    uint8_t* tx_data;
+    zx_fifo_shared_ring_t* rx_ring;
+    const uint8_t* rx_data;
+    uintptr_t mapping;
+
+    mtx_t tx_lock;
+    mtx_t rx_lock;
+} shared_fifo_t;
+
+// Wraps |handle|, which must have been created with |elem_count| entries of
+// |elem_size| bytes. The caller keeps ownership of |handle|.
+zx_status_t shared_fifo_init(shared_fifo_t* fifo, zx_handle_t handle,
+                             uint32_t elem_count, uint32_t elem_size);
+
+// Unmaps the rings. Does not close the fifo's handle.
+void shared_fifo_destroy(shared_fifo_t* fifo);
+
+// Returns true if entries move through shared memory.
+static inline bool shared_fifo_is_mapped(const shared_fifo_t* fifo) {
+    return fifo->tx_ring != NULL;
+}
+
+// Like zx_fifo_write(). Writes to a shared fifo whose peer has closed may
+// succeed until the peer would have to be woken.
+zx_status_t shared_fifo_write(shared_fifo_t* fifo, const void* data, size_t len,
+                              uint32_t* num_written);
+
+// Like zx_fifo_read().
+zx_status_t shared_fifo_read(shared_fifo_t* fifo, void* data, size_t len,
+                             uint32_t* num_read);
+
+// Like zx_object_wait_one() on the fifo. ZX_FIFO_READABLE and
+// ZX_FIFO_WRITABLE are reported based on the state of the rings, and are
+// only hints: a read or write may still return ZX_ERR_SHOULD_WAIT
+// afterwards if another thread got there first.
+zx_status_t shared_fifo_wait(shared_fifo_t* fifo, zx_signals_t signals,
+                             zx_time_t deadline, zx_signals_t* observed);
+
+__END_CDECLS
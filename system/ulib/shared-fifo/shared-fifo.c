@@ -0,0 +1,246 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+
+#include "shared-fifo/shared-fifo.h"
+
+// See zircon/syscalls/fifo.h for the protocol. Setting a waiting flag and
+// then checking the ring, against updating the ring and then checking the
+// flag, needs sequentially consistent ordering on both sides.
+
+static bool take_flag(uint32_t* flag) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(flag, __ATOMIC_RELAXED) != 0u &&
+           __atomic_exchange_n(flag, 0u, __ATOMIC_SEQ_CST) != 0u;
+}
+
+// Returns the number of entries in |ring|, which is more than the fifo's
+// elem_count if the peer has corrupted it.
+static uint32_t ring_used(const zx_fifo_shared_ring_t* ring) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+    return head - tail;
+}
+
+zx_status_t shared_fifo_init(shared_fifo_t* fifo, zx_handle_t handle,
+                             uint32_t elem_count, uint32_t elem_size) {
+    memset(fifo, 0, sizeof(*fifo));
+    fifo->handle = handle;
+    fifo->elem_count = elem_count;
+    fifo->elem_size = elem_size;
+    mtx_init(&fifo->tx_lock, mtx_plain);
+    mtx_init(&fifo->rx_lock, mtx_plain);
+
+    zx_handle_t vmo;
+    uint32_t endpoint;
+    zx_status_t status = zx_fifo_get_vmo(handle, &vmo, &endpoint);
+    if (status == ZX_ERR_NOT_SUPPORTED) {
+        // Not a shared fifo; use the syscalls.
+        return ZX_OK;
+    } else if (status != ZX_OK) {
+        return status;
+    }
+
+    uintptr_t addr;
+    status = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, ZX_FIFO_SHARED_VMO_SIZE,
+                         ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE, &addr);
+    zx_handle_close(vmo);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    uint8_t* base = (uint8_t*)addr;
+    uint32_t peer = endpoint ^ 1u;
+    fifo->mapping = addr;
+    fifo->tx_ring = (zx_fifo_shared_ring_t*)(base + ZX_FIFO_SHARED_RING_OFFSET(endpoint));
+    fifo->tx_data = base + ZX_FIFO_SHARED_DATA_OFFSET(endpoint);
+    fifo->rx_ring = (zx_fifo_shared_ring_t*)(base + ZX_FIFO_SHARED_RING_OFFSET(peer));
+    fifo->rx_data = base + ZX_FIFO_SHARED_DATA_OFFSET(peer);
+    return ZX_OK;
+}
+
+void shared_fifo_destroy(shared_fifo_t* fifo) {
+    if (shared_fifo_is_mapped(fifo)) {
+        zx_vmar_unmap(zx_vmar_root_self(), fifo->mapping, ZX_FIFO_SHARED_VMO_SIZE);
+    }
+    mtx_destroy(&fifo->tx_lock);
+    mtx_destroy(&fifo->rx_lock);
+    memset(fifo, 0, sizeof(*fifo));
+    fifo->handle = ZX_HANDLE_INVALID;
+}
+
+zx_status_t shared_fifo_write(shared_fifo_t* fifo, const void* data, size_t len,
+                              uint32_t* num_written) {
+    if (!shared_fifo_is_mapped(fifo)) {
+        return zx_fifo_write(fifo->handle, data, len, num_written);
+    }
+
+    size_t count = len / fifo->elem_size;
+    if (count == 0) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    zx_fifo_shared_ring_t* ring = fifo->tx_ring;
+    const uint32_t mask = fifo->elem_count - 1;
+    const uint8_t* src = data;
+
+    mtx_lock(&fifo->tx_lock);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (used > fifo->elem_count) {
+        mtx_unlock(&fifo->tx_lock);
+        return ZX_ERR_BAD_STATE;
+    }
+    if (used == fifo->elem_count) {
+        mtx_unlock(&fifo->tx_lock);
+        return ZX_ERR_SHOULD_WAIT;
+    }
+
+    uint32_t avail = fifo->elem_count - used;
+    if (count > avail) {
+        count = avail;
+    }
+    for (size_t i = 0; i < count; i++) {
+        memcpy(fifo->tx_data + ((head + i) & mask) * fifo->elem_size,
+               src + i * fifo->elem_size, fifo->elem_size);
+    }
+    __atomic_store_n(&ring->head, head + (uint32_t)count, __ATOMIC_RELEASE);
+
+    zx_status_t status = ZX_OK;
+    if (take_flag(&ring->consumer_waiting)) {
+        status = zx_object_signal_peer(fifo->handle, 0u, ZX_FIFO_READABLE);
+    }
+    mtx_unlock(&fifo->tx_lock);
+
+    if (status != ZX_OK) {
+        return status;
+    }
+    *num_written = (uint32_t)count;
+    return ZX_OK;
+}
+
+zx_status_t shared_fifo_read(shared_fifo_t* fifo, void* data, size_t len,
+                             uint32_t* num_read) {
+    if (!shared_fifo_is_mapped(fifo)) {
+        return zx_fifo_read(fifo->handle, data, len, num_read);
+    }
+
+    size_t count = len / fifo->elem_size;
+    if (count == 0) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    zx_fifo_shared_ring_t* ring = fifo->rx_ring;
+    const uint32_t mask = fifo->elem_count - 1;
+    uint8_t* dst = data;
+
+    mtx_lock(&fifo->rx_lock);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t used = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    if (used > fifo->elem_count) {
+        mtx_unlock(&fifo->rx_lock);
+        return ZX_ERR_BAD_STATE;
+    }
+    if (used == 0) {
+        mtx_unlock(&fifo->rx_lock);
+        return ZX_ERR_SHOULD_WAIT;
+    }
+
+    if (count > used) {
+        count = used;
+    }
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dst + i * fifo->elem_size,
+               fifo->rx_data + ((tail + i) & mask) * fifo->elem_size, fifo->elem_size);
+    }
+    __atomic_store_n(&ring->tail, tail + (uint32_t)count, __ATOMIC_RELEASE);
+
+    zx_status_t status = ZX_OK;
+    if (take_flag(&ring->producer_waiting)) {
+        status = zx_object_signal_peer(fifo->handle, 0u, ZX_FIFO_WRITABLE);
+        // The entries have been read either way.
+        if (status == ZX_ERR_PEER_CLOSED) {
+            status = ZX_OK;
+        }
+    }
+    mtx_unlock(&fifo->rx_lock);
+
+    if (status != ZX_OK) {
+        return status;
+    }
+    *num_read = (uint32_t)count;
+    return ZX_OK;
+}
+
+// Returns the subset of ZX_FIFO_READABLE and ZX_FIFO_WRITABLE in |signals|
+// that the rings currently satisfy. A corrupt ring counts as ready so that
+// the next read or write reports it.
+static zx_signals_t ring_signals(shared_fifo_t* fifo, zx_signals_t signals) {
+    zx_signals_t ready = 0u;
+    if ((signals & ZX_FIFO_READABLE) && ring_used(fifo->rx_ring) != 0u) {
+        ready |= ZX_FIFO_READABLE;
+    }
+    if ((signals & ZX_FIFO_WRITABLE) && ring_used(fifo->tx_ring) != fifo->elem_count) {
+        ready |= ZX_FIFO_WRITABLE;
+    }
+    return ready;
+}
+
+zx_status_t shared_fifo_wait(shared_fifo_t* fifo, zx_signals_t signals,
+                             zx_time_t deadline, zx_signals_t* observed) {
+    if (!shared_fifo_is_mapped(fifo)) {
+        return zx_object_wait_one(fifo->handle, signals, deadline, observed);
+    }
+
+    const zx_signals_t ring_mask = signals & (ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+    for (;;) {
+        zx_signals_t ready = ring_signals(fifo, ring_mask);
+        if (ready != 0u) {
+            if (observed) {
+                *observed = ready;
+            }
+            return ZX_OK;
+        }
+
+        // Nothing to do yet. Clear our doorbells before asking the peer to
+        // ring them, then check the rings again in case the peer got there
+        // before it could see the request.
+        if (ring_mask != 0u) {
+            zx_status_t status = zx_object_signal(fifo->handle, ring_mask, 0u);
+            if (status != ZX_OK) {
+                return status;
+            }
+        }
+        if (ring_mask & ZX_FIFO_READABLE) {
+            __atomic_store_n(&fifo->rx_ring->consumer_waiting, 1u, __ATOMIC_SEQ_CST);
+        }
+        if (ring_mask & ZX_FIFO_WRITABLE) {
+            __atomic_store_n(&fifo->tx_ring->producer_waiting, 1u, __ATOMIC_SEQ_CST);
+        }
+        if (ring_signals(fifo, ring_mask) != 0u) {
+            continue;
+        }
+
+        zx_signals_t pending = 0u;
+        zx_status_t status = zx_object_wait_one(fifo->handle, signals, deadline, &pending);
+        if (status != ZX_OK) {
+            if (observed) {
+                *observed = pending;
+            }
+            return status;
+        }
+
+        // A doorbell only says that the rings changed.
+        if (pending & ~ring_mask) {
+            if (observed) {
+                *observed = (pending & ~ring_mask) | ring_signals(fifo, ring_mask);
+            }
+            return ZX_OK;
+        }
+    }
+}
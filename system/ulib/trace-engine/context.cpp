@@ -9,6 +9,7 @@
 
 #include <fbl/algorithm.h>
 #include <fbl/atomic.h>
+#include <fbl/auto_lock.h>
 #include <fbl/intrusive_hash_table.h>
 #include <fbl/unique_ptr.h>
 #include <zx/process.h>
@@ -113,6 +114,18 @@ struct ContextCache {
 
     // Storage for the string entries.
     StringEntry string_entries[kMaxStringEntries];
+
+    // The chunk of the trace buffer which this thread writes its small
+    // records into, from |chunk_current| up to |chunk_end|.  The chunk is
+    // only valid while the context's chunk epoch is still |chunk_epoch|.
+    uint8_t* chunk_current{nullptr};
+    uint8_t* chunk_end{nullptr};
+    uint32_t chunk_epoch{0u};
+
+    // The block of string indexes which this thread hands out, from
+    // |next_string_index| up to |string_index_end|.
+    trace_string_index_t next_string_index{0u};
+    trace_string_index_t string_index_end{0u};
 };
 thread_local fbl::unique_ptr<ContextCache> tls_cache{};
 
@@ -130,6 +143,11 @@ ContextCache* GetCurrentContextCache(uint32_t generation) {
     cache->generation = generation;
     cache->thread_ref = trace_make_unknown_thread_ref();
     cache->string_table.clear();
+    cache->chunk_current = nullptr;
+    cache->chunk_end = nullptr;
+    cache->chunk_epoch = 0u;
+    cache->next_string_index = 0u;
+    cache->string_index_end = 0u;
     return cache;
 }
 
@@ -160,6 +178,17 @@ inline constexpr uint64_t MakeRecordHeader(RecordType type, size_t size) {
            RecordFields::RecordSize::Make(size >> 3);
 }
 
+// Fills [begin, end) with a padding record, which must fit in one record.
+void WritePadding(uint8_t* begin, uint8_t* end) {
+    size_t size = end - begin;
+    ZX_DEBUG_ASSERT(size <= RecordFields::kMaxRecordSizeBytes);
+    if (size) {
+        *reinterpret_cast<uint64_t*>(begin) =
+            MakeRecordHeader(RecordType::kMetadata, size) |
+            MetadataRecordFields::MetadataType::Make(ToUnderlyingType(MetadataType::kPadding));
+    }
+}
+
 inline constexpr uint64_t MakeArgumentHeader(ArgumentType type, size_t size,
                                              const trace_string_ref_t* name_ref) {
     return ArgumentFields::Type::Make(ToUnderlyingType(type)) |
@@ -226,6 +255,12 @@ public:
     explicit Payload(trace_context_t* context, size_t num_bytes)
         : ptr_(context->AllocRecord(num_bytes)) {}
 
+    // For records that others refer to, which must outlive the rolling
+    // buffers.
+    explicit Payload(trace_context_t* context, size_t num_bytes, bool durable)
+        : ptr_(durable ? context->AllocDurableRecord(num_bytes)
+                       : context->AllocRecord(num_bytes)) {}
+
     explicit operator bool() const {
         return ptr_ != nullptr;
     }
@@ -862,7 +897,7 @@ void trace_context_write_initialization_record(
     uint64_t ticks_per_second) {
     const size_t record_size = sizeof(trace::RecordHeader) +
                                trace::WordsToBytes(1);
-    trace::Payload payload(context, record_size);
+    trace::Payload payload(context, record_size, true);
     if (payload) {
         payload
             .WriteUint64(trace::MakeRecordHeader(trace::RecordType::kInitialization, record_size))
@@ -881,7 +916,7 @@ void trace_context_write_string_record(
 
     const size_t record_size = sizeof(trace::RecordHeader) +
                                trace::Pad(length);
-    trace::Payload payload(context, record_size);
+    trace::Payload payload(context, record_size, true);
     if (payload) {
         payload
             .WriteUint64(trace::MakeRecordHeader(trace::RecordType::kString, record_size) |
@@ -901,7 +936,7 @@ void trace_context_write_thread_record(
 
     const size_t record_size = sizeof(trace::RecordHeader) +
                                trace::WordsToBytes(2);
-    trace::Payload payload(context, record_size);
+    trace::Payload payload(context, record_size, true);
     if (payload) {
         payload
             .WriteUint64(trace::MakeRecordHeader(trace::RecordType::kThread, record_size) |
@@ -917,52 +952,302 @@ void* trace_context_alloc_record(trace_context_t* context, size_t num_bytes) {
 
 /* struct trace_context */
 
+namespace {
+
+// The durable buffer gets a quarter of the space, up to this much.
+constexpr size_t kMaxDurableBufferSize = 256 * 1024;
+
+// The size of the chunks which threads reserve for their records.
+constexpr size_t kChunkSize = 4096;
+
+// Smaller buffers are not split into chunks, since the unused ends of the
+// chunks would take up too much of them.
+constexpr size_t kMinChunkedBufferSize = 16 * kChunkSize;
+
+// Larger records are allocated from the rolling buffer directly, so that
+// they do not waste much of a chunk.
+constexpr size_t kMaxChunkedRecordSize = kChunkSize / 4;
+
+// The number of string indexes which threads reserve at a time.
+constexpr trace_string_index_t kStringIndexBlockSize = 16u;
+
+size_t DurableBufferSize(size_t buffer_num_bytes) {
+    return fbl::min(fbl::round_down(buffer_num_bytes / 4u, 8u), kMaxDurableBufferSize);
+}
+
+size_t RollingBufferSize(size_t buffer_num_bytes) {
+    size_t used = sizeof(trace_buffer_header_t) + DurableBufferSize(buffer_num_bytes);
+    if (buffer_num_bytes < used)
+        return 0u;
+    return fbl::round_down((buffer_num_bytes - used) / 2u, 8u);
+}
+
+} // namespace
+
 trace_context::trace_context(void* buffer, size_t buffer_num_bytes,
+                             trace_buffering_mode_t buffering_mode,
                              trace_handler_t* handler)
     : generation_(trace::g_next_generation.fetch_add(1u, fbl::memory_order_relaxed) + 1u),
+      buffering_mode_(buffering_mode),
       buffer_start_(static_cast<uint8_t*>(buffer)),
       buffer_end_(buffer_start_ + buffer_num_bytes),
-      buffer_current_(reinterpret_cast<uintptr_t>(buffer_start_)),
-      buffer_full_mark_(0u),
       handler_(handler) {
     ZX_DEBUG_ASSERT(generation_ != 0u);
+    ZX_DEBUG_ASSERT(IsBufferLargeEnough(buffer_num_bytes, buffering_mode));
+
+    if (buffering_mode_ == TRACE_BUFFERING_MODE_ONESHOT) {
+        rolling_buffer_start_[0] = buffer_start_;
+        rolling_buffer_size_ = buffer_num_bytes;
+        chunked_ = rolling_buffer_size_ >= kMinChunkedBufferSize;
+        return;
+    }
+
+    durable_buffer_size_ = DurableBufferSize(buffer_num_bytes);
+    rolling_buffer_size_ = RollingBufferSize(buffer_num_bytes);
+    durable_buffer_start_ = buffer_start_ + sizeof(trace_buffer_header_t);
+    rolling_buffer_start_[0] = durable_buffer_start_ + durable_buffer_size_;
+    rolling_buffer_start_[1] = rolling_buffer_start_[0] + rolling_buffer_size_;
+
+    header_ = reinterpret_cast<trace_buffer_header_t*>(buffer_start_);
+    memset(header_, 0, sizeof(*header_));
+    header_->magic = TRACE_BUFFER_HEADER_MAGIC;
+    header_->version = TRACE_BUFFER_HEADER_VERSION;
+    header_->buffering_mode = buffering_mode_;
+    header_->total_size = buffer_num_bytes;
+    header_->durable_buffer_size = durable_buffer_size_;
+    header_->rolling_buffer_size = rolling_buffer_size_;
+    chunked_ = rolling_buffer_size_ >= kMinChunkedBufferSize;
 }
 
 trace_context::~trace_context() = default;
 
+bool trace_context::IsBufferLargeEnough(size_t buffer_num_bytes,
+                                        trace_buffering_mode_t buffering_mode) {
+    switch (buffering_mode) {
+    case TRACE_BUFFERING_MODE_ONESHOT:
+        return true;
+    case TRACE_BUFFERING_MODE_CIRCULAR:
+    case TRACE_BUFFERING_MODE_STREAMING:
+        // Each rolling buffer must at least hold the largest record.
+        return RollingBufferSize(buffer_num_bytes) >= TRACE_ENCODED_RECORD_MAX_LENGTH;
+    default:
+        return false;
+    }
+}
+
+bool trace_context::is_buffer_full() const {
+    // Overwriting old records is what circular mode is for, so there only
+    // a full durable buffer counts.
+    if (buffering_mode_ == TRACE_BUFFERING_MODE_CIRCULAR)
+        return durable_full_mark_.load(fbl::memory_order_relaxed) != 0u;
+    return num_records_dropped_.load(fbl::memory_order_relaxed) != 0u;
+}
+
+size_t trace_context::bytes_allocated() const {
+    if (header_)
+        return buffer_end_ - buffer_start_;
+    uint64_t offset = GetOffset(rolling_current_.load(fbl::memory_order_relaxed));
+    if (offset <= rolling_buffer_size_)
+        return offset;
+    fbl::AutoLock lock(&mutex_);
+    return rolling_data_end_[0];
+}
+
+uint64_t trace_context::durable_data_end() const {
+    uint64_t end = durable_full_mark_.load(fbl::memory_order_relaxed);
+    if (!end)
+        end = durable_current_.load(fbl::memory_order_relaxed);
+    return fbl::min(end, static_cast<uint64_t>(durable_buffer_size_));
+}
+
 uint64_t* trace_context::AllocRecord(size_t num_bytes) {
     ZX_DEBUG_ASSERT((num_bytes & 7) == 0);
     if (unlikely(num_bytes > TRACE_ENCODED_RECORD_MAX_LENGTH))
         return nullptr;
 
-    uint8_t* ptr = reinterpret_cast<uint8_t*>(
-        buffer_current_.fetch_add(num_bytes,
-                                  fbl::memory_order_relaxed));
-    if (likely(ptr + num_bytes <= buffer_end_)) {
-        ZX_DEBUG_ASSERT(ptr + num_bytes >= buffer_start_);
-        return reinterpret_cast<uint64_t*>(ptr); // success!
-    }
-
-    // Buffer is full!
-    // Snap to the endpoint to reduce likelihood of pointer wrap-around.
-    buffer_current_.store(reinterpret_cast<uintptr_t>(buffer_end_),
-                          fbl::memory_order_relaxed);
-
-    // Mark the end point if not already marked.
-    uintptr_t expected_mark = 0u;
-    if (buffer_full_mark_.compare_exchange_strong(&expected_mark,
-                                                  reinterpret_cast<uintptr_t>(ptr),
-                                                  fbl::memory_order_relaxed,
-                                                  fbl::memory_order_relaxed)) {
+    // Small records go into a chunk which belongs to the current thread,
+    // so that threads only contend for the rolling buffer once per chunk.
+    // A padding record always covers the rest of the chunk, which keeps
+    // the buffer readable however much of the chunk ends up being used.
+    if (likely(num_bytes <= kMaxChunkedRecordSize && chunked_)) {
+        trace::ContextCache* cache = trace::GetCurrentContextCache(generation_);
+        if (likely(cache)) {
+            uint32_t epoch = chunk_epoch_.load(fbl::memory_order_relaxed);
+            if (unlikely(cache->chunk_epoch != epoch ||
+                         static_cast<size_t>(cache->chunk_end - cache->chunk_current) <
+                             num_bytes)) {
+                uint8_t* chunk = reinterpret_cast<uint8_t*>(AllocRollingSpace(kChunkSize));
+                if (unlikely(!chunk))
+                    return nullptr;
+                cache->chunk_current = chunk;
+                cache->chunk_end = chunk + kChunkSize;
+                cache->chunk_epoch = epoch;
+            }
+            uint8_t* ptr = cache->chunk_current;
+            cache->chunk_current += num_bytes;
+            trace::WritePadding(cache->chunk_current, cache->chunk_end);
+            return reinterpret_cast<uint64_t*>(ptr);
+        }
+    }
+
+    return AllocRollingSpace(num_bytes);
+}
+
+uint64_t* trace_context::AllocRollingSpace(size_t num_bytes) {
+    uint64_t current = rolling_current_.fetch_add(num_bytes, fbl::memory_order_relaxed);
+    uint32_t wrapped_count = GetWrappedCount(current);
+    uint64_t offset = GetOffset(current);
+    if (likely(offset + num_bytes <= rolling_buffer_size_)) {
+        return reinterpret_cast<uint64_t*>(
+            rolling_buffer_start_[wrapped_count & 1u] + offset); // success!
+    }
+
+    // The rolling buffer is full!
+    // Allocations only ever grow the offset, so exactly one writer sees its
+    // allocation cross the end. That writer deals with the full buffer and,
+    // if writing has moved on to the other rolling buffer, tries again.
+    // Writers that lose the race drop their record.
+    if (offset <= rolling_buffer_size_ && HandleRollingBufferFull(wrapped_count, offset))
+        return AllocRollingSpace(num_bytes);
+
+    // The buffer stays full until it is switched, which may be never, so
+    // pull the offset back just past the end. Otherwise failed allocations
+    // would keep growing it until it carried into the wrapped count.
+    uint64_t full = (static_cast<uint64_t>(wrapped_count) << kRollingOffsetBits) |
+                    (rolling_buffer_size_ + 1u);
+    current = rolling_current_.load(fbl::memory_order_relaxed);
+    while (current > full && GetWrappedCount(current) == wrapped_count &&
+           !rolling_current_.compare_exchange_weak(&current, full, fbl::memory_order_relaxed,
+                                                   fbl::memory_order_relaxed)) {
+    }
+
+    num_records_dropped_.fetch_add(1u, fbl::memory_order_relaxed);
+    return nullptr;
+}
+
+bool trace_context::HandleRollingBufferFull(uint32_t wrapped_count, uint64_t offset) {
+    uint64_t durable_end = durable_data_end();
+    bool notify = false;
+    bool switched = false;
+    {
+        fbl::AutoLock lock(&mutex_);
+        rolling_data_end_[wrapped_count & 1u] = offset;
+
+        switch (buffering_mode_) {
+        case TRACE_BUFFERING_MODE_ONESHOT:
+            break;
+        case TRACE_BUFFERING_MODE_CIRCULAR:
+            SwitchRollingBufferLocked(wrapped_count);
+            switched = true;
+            break;
+        case TRACE_BUFFERING_MODE_STREAMING:
+            // The handler is about to save this buffer, so stop threads
+            // from filling in the rest of their chunks.
+            chunk_epoch_.fetch_add(1u, fbl::memory_order_relaxed);
+            rolling_buffer_free_[wrapped_count & 1u] = false;
+            notify = true;
+            if (rolling_buffer_free_[(wrapped_count + 1u) & 1u]) {
+                SwitchRollingBufferLocked(wrapped_count);
+                switched = true;
+            } else {
+                waiting_for_save_ = true;
+            }
+            break;
+        }
+        if (header_) {
+            header_->durable_data_end = durable_end;
+            header_->rolling_data_end[wrapped_count & 1u] = offset;
+        }
+    }
+
+    if (buffering_mode_ == TRACE_BUFFERING_MODE_ONESHOT) {
         // Notify the trace manager so it can notify the user that a record
         // (likely) got dropped.
         handler_->ops->buffer_overflow(handler_);
+    } else if (notify) {
+        handler_->ops->notify_buffer_full(handler_, wrapped_count, durable_end);
     }
+    return switched;
+}
 
+void trace_context::SwitchRollingBufferLocked(uint32_t wrapped_count) {
+    // Chunks in the old buffer must not be written to once it is reused.
+    chunk_epoch_.fetch_add(1u, fbl::memory_order_relaxed);
+
+    // Every allocation since the buffer filled up has failed, so no
+    // successful one can be lost by storing over them.
+    uint32_t next = wrapped_count + 1u;
+    rolling_current_.store(static_cast<uint64_t>(next) << kRollingOffsetBits,
+                           fbl::memory_order_relaxed);
+    if (header_)
+        header_->wrapped_count = next;
+}
+
+zx_status_t trace_context::MarkRollingBufferSaved(uint32_t wrapped_count) {
+    if (buffering_mode_ != TRACE_BUFFERING_MODE_STREAMING)
+        return ZX_ERR_BAD_STATE;
+
+    fbl::AutoLock lock(&mutex_);
+    uint32_t current = GetWrappedCount(rolling_current_.load(fbl::memory_order_relaxed));
+    if (wrapped_count > current || rolling_buffer_free_[wrapped_count & 1u])
+        return ZX_ERR_BAD_STATE;
+
+    rolling_buffer_free_[wrapped_count & 1u] = true;
+    rolling_data_end_[wrapped_count & 1u] = 0u;
+    header_->rolling_data_end[wrapped_count & 1u] = 0u;
+
+    // If the current buffer filled up while this one was being saved,
+    // writing can carry on here.
+    if (waiting_for_save_ && ((current + 1u) & 1u) == (wrapped_count & 1u)) {
+        waiting_for_save_ = false;
+        SwitchRollingBufferLocked(current);
+    }
+    return ZX_OK;
+}
+
+uint64_t* trace_context::AllocDurableRecord(size_t num_bytes) {
+    if (!durable_buffer_start_)
+        return AllocRecord(num_bytes);
+
+    ZX_DEBUG_ASSERT((num_bytes & 7) == 0);
+    uint64_t offset = durable_current_.fetch_add(num_bytes, fbl::memory_order_relaxed);
+    if (likely(offset + num_bytes <= durable_buffer_size_))
+        return reinterpret_cast<uint64_t*>(durable_buffer_start_ + offset); // success!
+
+    // Mark the end point if not already marked. Once the durable buffer is
+    // full no more string or thread indexes are handed out, so that later
+    // records refer to strings and threads inline instead.
+    uint64_t expected_mark = 0u;
+    durable_full_mark_.compare_exchange_strong(&expected_mark, offset,
+                                               fbl::memory_order_relaxed,
+                                               fbl::memory_order_relaxed);
+    num_records_dropped_.fetch_add(1u, fbl::memory_order_relaxed);
     return nullptr;
 }
 
+void trace_context::UpdateBufferHeaderAfterStopped() {
+    if (!header_)
+        return;
+
+    fbl::AutoLock lock(&mutex_);
+    uint64_t current = rolling_current_.load(fbl::memory_order_relaxed);
+    uint32_t wrapped_count = GetWrappedCount(current);
+    uint64_t offset = GetOffset(current);
+    // If the current buffer is full, its end was noted when it filled up.
+    if (offset <= rolling_buffer_size_)
+        rolling_data_end_[wrapped_count & 1u] = offset;
+
+    header_->durable_data_end = durable_data_end();
+    header_->rolling_data_end[0] = rolling_data_end_[0];
+    header_->rolling_data_end[1] = rolling_data_end_[1];
+    header_->wrapped_count = wrapped_count;
+    header_->num_records_dropped = num_records_dropped_.load(fbl::memory_order_relaxed);
+}
+
 bool trace_context::AllocThreadIndex(trace_thread_index_t* out_index) {
+    // The thread record would have nowhere to go.
+    if (unlikely(durable_full_mark_.load(fbl::memory_order_relaxed) != 0u))
+        return false;
     trace_thread_index_t index = next_thread_index_.fetch_add(1u, fbl::memory_order_relaxed);
     if (unlikely(index > TRACE_ENCODED_THREAD_REF_MAX_INDEX)) {
         // Guard again possible wrapping.
@@ -975,13 +1260,31 @@ bool trace_context::AllocThreadIndex(trace_thread_index_t* out_index) {
 }
 
 bool trace_context::AllocStringIndex(trace_string_index_t* out_index) {
-    trace_string_index_t index = next_string_index_.fetch_add(1u, fbl::memory_order_relaxed);
+    // The string record would have nowhere to go.
+    if (unlikely(durable_full_mark_.load(fbl::memory_order_relaxed) != 0u))
+        return false;
+
+    // Threads reserve a block of indexes at a time.
+    trace::ContextCache* cache = trace::GetCurrentContextCache(generation_);
+    if (likely(cache) && likely(cache->next_string_index != cache->string_index_end)) {
+        *out_index = cache->next_string_index++;
+        return true;
+    }
+
+    trace_string_index_t block_size = cache ? kStringIndexBlockSize : 1u;
+    trace_string_index_t index = next_string_index_.fetch_add(block_size,
+                                                              fbl::memory_order_relaxed);
     if (unlikely(index > TRACE_ENCODED_STRING_REF_MAX_INDEX)) {
         // Guard again possible wrapping.
         next_string_index_.store(TRACE_ENCODED_STRING_REF_MAX_INDEX + 1u,
                                  fbl::memory_order_relaxed);
         return false;
     }
+    if (cache) {
+        cache->next_string_index = index + 1u;
+        cache->string_index_end = fbl::min(index + block_size,
+                                           TRACE_ENCODED_STRING_REF_MAX_INDEX + 1u);
+    }
     *out_index = index;
     return true;
 }
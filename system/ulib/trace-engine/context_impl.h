@@ -5,8 +5,10 @@
 #pragma once
 
 #include <zircon/assert.h>
+#include <zircon/compiler.h>
 
 #include <fbl/atomic.h>
+#include <fbl/mutex.h>
 
 #include <trace-engine/context.h>
 #include <trace-engine/handler.h>
@@ -16,46 +18,124 @@
 // context references.
 // Implements the opaque type declared in <trace-engine/context.h>.
 struct trace_context {
-    trace_context(void* buffer, size_t buffer_num_bytes, trace_handler_t* handler);
+    trace_context(void* buffer, size_t buffer_num_bytes,
+                  trace_buffering_mode_t buffering_mode, trace_handler_t* handler);
 
     ~trace_context();
 
+    // Returns false if |buffer_num_bytes| is too small for |buffering_mode|.
+    static bool IsBufferLargeEnough(size_t buffer_num_bytes,
+                                    trace_buffering_mode_t buffering_mode);
+
     uint32_t generation() const { return generation_; }
 
     trace_handler_t* handler() const { return handler_; }
 
-    bool is_buffer_full() const {
-        return buffer_full_mark_.load(fbl::memory_order_relaxed) != 0u;
-    }
+    trace_buffering_mode_t buffering_mode() const { return buffering_mode_; }
 
-    size_t bytes_allocated() const {
-        uintptr_t tail = buffer_full_mark_.load(fbl::memory_order_relaxed);
-        if (!tail)
-            tail = buffer_current_.load(fbl::memory_order_relaxed);
-        return reinterpret_cast<uint8_t*>(tail) - buffer_start_;
-    }
+    // Returns true if records were dropped for want of space.
+    bool is_buffer_full() const;
+
+    size_t bytes_allocated() const;
 
     uint64_t* AllocRecord(size_t num_bytes);
+    // Allocates from the durable buffer, which is never overwritten, in
+    // the modes that have one.
+    uint64_t* AllocDurableRecord(size_t num_bytes);
     bool AllocThreadIndex(trace_thread_index_t* out_index);
     bool AllocStringIndex(trace_string_index_t* out_index);
 
+    // Called when the trace has stopped and all references are gone.
+    void UpdateBufferHeaderAfterStopped();
+
+    zx_status_t MarkRollingBufferSaved(uint32_t wrapped_count);
+
 private:
+    // |rolling_current_| packs the wrapped count above the offset into the
+    // current rolling buffer, so that one atomic add both allocates space
+    // and tells the writer which rolling buffer the space is in.
+    static constexpr int kRollingOffsetBits = 40;
+    static constexpr uint64_t kRollingOffsetMask = (1ull << kRollingOffsetBits) - 1;
+
+    static uint32_t GetWrappedCount(uint64_t current) {
+        return static_cast<uint32_t>(current >> kRollingOffsetBits);
+    }
+    static uint64_t GetOffset(uint64_t current) {
+        return current & kRollingOffsetMask;
+    }
+
+    uint64_t durable_data_end() const;
+
+    // Allocates space in the current rolling buffer, shared by all threads.
+    uint64_t* AllocRollingSpace(size_t num_bytes);
+
+    // Called by the one writer whose allocation crossed the end of rolling
+    // buffer (|wrapped_count| & 1) at |offset|. Returns true if writing
+    // has moved on to the other rolling buffer.
+    bool HandleRollingBufferFull(uint32_t wrapped_count, uint64_t offset);
+
+    void SwitchRollingBufferLocked(uint32_t wrapped_count) __TA_REQUIRES(mutex_);
+
     // The generation counter associated with this context to distinguish
     // it from previously created contexts.
     uint32_t const generation_;
 
+    trace_buffering_mode_t const buffering_mode_;
+
     // Buffer start and end pointers.
     uint8_t* const buffer_start_;
     uint8_t* const buffer_end_;
 
-    // Current allocation pointer.
-    // Starts at |buffer_start| and grows from there.
-    // May exceed |buffer_end| when the buffer is full.
-    fbl::atomic<uintptr_t> buffer_current_;
+    // The header at |buffer_start_|, or null in oneshot mode.
+    trace_buffer_header_t* header_ = nullptr;
+
+    // The durable buffer, or null in oneshot mode.
+    uint8_t* durable_buffer_start_ = nullptr;
+    size_t durable_buffer_size_ = 0u;
+
+    // Offset of the next allocation in the durable buffer.
+    // May exceed |durable_buffer_size_| when the buffer is full.
+    fbl::atomic<uint64_t> durable_current_{0u};
+
+    // Offset beyond the last successful durable allocation, or 0 if not
+    // full. Only ever set once in the lifetime of the trace context.
+    fbl::atomic<uint64_t> durable_full_mark_{0u};
+
+    // The rolling buffers. In oneshot mode there is just one, which takes
+    // up the whole buffer.
+    uint8_t* rolling_buffer_start_[2] = {};
+    size_t rolling_buffer_size_ = 0u;
+
+    // Wrapped count and offset of the next allocation, see above.
+    // The offset may exceed |rolling_buffer_size_| when the current
+    // rolling buffer is full. Failed allocations pull it back to just past
+    // the end, so that it never carries into the wrapped count.
+    fbl::atomic<uint64_t> rolling_current_{0u};
+
+    // Whether threads reserve chunks of the rolling buffers for their
+    // small records.
+    bool chunked_ = false;
+
+    // Bumped whenever the chunks that threads have reserved in the rolling
+    // buffers must no longer be written to.
+    fbl::atomic<uint32_t> chunk_epoch_{1u};
+
+    // The number of allocations that failed.
+    fbl::atomic<uint64_t> num_records_dropped_{0u};
+
+    mutable fbl::Mutex mutex_;
+
+    // The number of bytes of records in each rolling buffer, once it has
+    // filled up.
+    uint64_t rolling_data_end_[2] __TA_GUARDED(mutex_) = {};
+
+    // In streaming mode, whether each rolling buffer may be written, that
+    // is, whether it has been saved since it last filled up.
+    bool rolling_buffer_free_[2] __TA_GUARDED(mutex_) = {true, true};
 
-    // Pointer beyond the last successful allocation, or null if not full.
-    // Only ever set to non-null once in the lifetime of the trace context.
-    fbl::atomic<uintptr_t> buffer_full_mark_;
+    // In streaming mode, set when the current rolling buffer is full and
+    // the other one has not been saved yet.
+    bool waiting_for_save_ __TA_GUARDED(mutex_) = false;
 
     // Handler associated with the trace session.
     trace_handler_t* const handler_;
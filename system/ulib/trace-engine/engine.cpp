@@ -132,10 +132,23 @@ zx_status_t trace_start_engine(async_t* async,
                                trace_handler_t* handler,
                                void* buffer,
                                size_t buffer_num_bytes) {
+    return trace_start_engine_with_mode(async, handler, TRACE_BUFFERING_MODE_ONESHOT,
+                                        buffer, buffer_num_bytes);
+}
+
+// thread-safe
+zx_status_t trace_start_engine_with_mode(async_t* async,
+                                         trace_handler_t* handler,
+                                         trace_buffering_mode_t buffering_mode,
+                                         void* buffer,
+                                         size_t buffer_num_bytes) {
     ZX_DEBUG_ASSERT(async);
     ZX_DEBUG_ASSERT(handler);
     ZX_DEBUG_ASSERT(buffer);
 
+    if (!trace_context::IsBufferLargeEnough(buffer_num_bytes, buffering_mode))
+        return ZX_ERR_INVALID_ARGS;
+
     fbl::AutoLock lock(&g_engine_mutex);
 
     // We must have fully stopped a prior tracing session before starting a new one.
@@ -166,7 +179,7 @@ zx_status_t trace_start_engine(async_t* async,
     g_async = async;
     g_handler = handler;
     g_disposition = ZX_OK;
-    g_context = new trace_context(buffer, buffer_num_bytes, handler);
+    g_context = new trace_context(buffer, buffer_num_bytes, buffering_mode, handler);
     g_event = fbl::move(event);
 
     // Write the trace initialization record first before allowing clients to
@@ -217,6 +230,16 @@ zx_status_t trace_stop_engine(zx_status_t disposition) {
     return ZX_OK;
 }
 
+// thread-safe
+zx_status_t trace_engine_mark_buffer_saved(uint32_t wrapped_count) {
+    trace_context_t* context = trace_acquire_context();
+    if (!context)
+        return ZX_ERR_BAD_STATE;
+    zx_status_t status = context->MarkRollingBufferSaved(wrapped_count);
+    trace_release_context(context);
+    return status;
+}
+
 namespace {
 
 // Handle status == ZX_ERR_CANCELED passed to handle_event().
@@ -282,6 +305,7 @@ void handle_context_released(async_t* async) {
         ZX_DEBUG_ASSERT(g_context != nullptr);
 
         // Get final disposition.
+        g_context->UpdateBufferHeaderAfterStopped();
         if (g_context->is_buffer_full())
             update_disposition_locked(ZX_ERR_NO_MEMORY);
         disposition = g_disposition;
@@ -63,6 +63,8 @@ struct trace_handler_ops {
     // |disposition| is |ZX_OK| if tracing stopped normally, otherwise indicates
     // that tracing was aborted due to an error.
     // |buffer_bytes_written| is number of bytes which were written to the trace buffer.
+    // In circular and streaming modes this is the size of the whole buffer,
+    // whose header describes what it holds.
     //
     // Called on an asynchronous dispatch thread.
     void (*trace_stopped)(trace_handler_t* handler, async_t* async,
@@ -73,6 +75,20 @@ struct trace_handler_ops {
     //
     // Called by instrumentation on any thread.  Must be thread-safe.
     void (*buffer_overflow)(trace_handler_t* handler);
+
+    // Called by the trace engine in streaming mode when rolling buffer
+    // (|wrapped_count| & 1) has filled up. The handler should save that
+    // rolling buffer, along with any durable records it has not saved yet,
+    // and then call |trace_engine_mark_buffer_saved()|.
+    //
+    // |durable_data_end| is the number of bytes in the durable buffer.
+    //
+    // Only called for traces started in streaming mode, so handlers that
+    // never use it need not provide it.
+    //
+    // Called by instrumentation on any thread.  Must be thread-safe.
+    void (*notify_buffer_full)(trace_handler_t* handler, uint32_t wrapped_count,
+                               uint64_t durable_data_end);
 };
 
 // Asynchronously starts the trace engine.
@@ -109,6 +125,17 @@ zx_status_t trace_start_engine(async_t* async,
                                void* buffer,
                                size_t buffer_num_bytes);
 
+// Like |trace_start_engine()|, which starts the engine in
+// |TRACE_BUFFERING_MODE_ONESHOT|, but with the given |buffering_mode|.
+//
+// Returns |ZX_ERR_INVALID_ARGS| if |buffer_num_bytes| is too small to be
+// split up as the mode requires.
+zx_status_t trace_start_engine_with_mode(async_t* async,
+                                         trace_handler_t* handler,
+                                         trace_buffering_mode_t buffering_mode,
+                                         void* buffer,
+                                         size_t buffer_num_bytes);
+
 // Asynchronously stops the trace engine.
 //
 // The trace handler's |trace_stopped()| method will be invoked asynchronously
@@ -123,4 +150,15 @@ zx_status_t trace_start_engine(async_t* async,
 // This function is thread-safe.
 zx_status_t trace_stop_engine(zx_status_t disposition);
 
+// Tells the trace engine that the handler has saved the rolling buffer it
+// was asked to save by |notify_buffer_full()| with |wrapped_count|, so that
+// it can be written again.
+//
+// Returns |ZX_OK| on success.
+// Returns |ZX_ERR_BAD_STATE| if no trace is running in streaming mode, or if
+// that rolling buffer was not waiting to be saved.
+//
+// This function is thread-safe.
+zx_status_t trace_engine_mark_buffer_saved(uint32_t wrapped_count);
+
 __END_CDECLS
@@ -208,6 +208,64 @@ inline trace_thread_ref_t trace_make_indexed_thread_ref(trace_thread_index_t ind
 // the record header.
 #define TRACE_ENCODED_RECORD_MAX_LENGTH ((size_t)32760u)
 
+// Describes how the trace engine uses its buffer.
+typedef enum {
+    // Records are written one after another until the buffer is full, and
+    // any further records are dropped.
+    TRACE_BUFFERING_MODE_ONESHOT = 0,
+    // The buffer is split as described by |trace_buffer_header_t|. When a
+    // rolling buffer is full, writing moves on to the other one and
+    // overwrites it, so the buffer keeps the most recent records.
+    TRACE_BUFFERING_MODE_CIRCULAR = 1,
+    // The buffer is split as in circular mode. When a rolling buffer is
+    // full, the handler is asked to save it and writing moves on to the
+    // other one, provided that it has been saved since it was last filled.
+    // Otherwise records are dropped until it has been.
+    TRACE_BUFFERING_MODE_STREAMING = 2,
+} trace_buffering_mode_t;
+
+// Identifies a buffer that starts with a |trace_buffer_header_t|.
+#define TRACE_BUFFER_HEADER_MAGIC ((uint64_t)0x6275666865616472u)
+#define TRACE_BUFFER_HEADER_VERSION 0u
+
+// In circular and streaming modes the buffer starts with this header. It is
+// followed by the durable buffer, then by rolling buffers 0 and 1, each of
+// the sizes given here. Oneshot buffers have no header and hold nothing but
+// records.
+//
+// The durable buffer holds the records that others refer to: the
+// initialization record, and string and thread records. It is never
+// overwritten. All other records go to the rolling buffers. Rolling buffer
+// (wrapped_count & 1) is the one being written and, once writing has
+// wrapped at least once, the other one holds the records that came just
+// before.
+//
+// The engine only updates the header when a rolling buffer fills up and
+// when tracing stops.
+typedef struct trace_buffer_header {
+    uint64_t magic;
+    uint32_t version;
+    // A |trace_buffering_mode_t|.
+    uint32_t buffering_mode;
+    uint64_t total_size;
+    uint64_t durable_buffer_size;
+    uint64_t rolling_buffer_size;
+
+    // The number of bytes of records in the durable buffer and in each
+    // rolling buffer.
+    uint64_t durable_data_end;
+    uint64_t rolling_data_end[2];
+
+    // The number of times writing has moved from one rolling buffer to
+    // the other.
+    uint64_t wrapped_count;
+
+    // The number of records that could not be written.
+    uint64_t num_records_dropped;
+
+    uint64_t reserved[6];
+} trace_buffer_header_t;
+
 // Enumerates all known argument types.
 typedef enum {
     TRACE_ARG_NULL = 0,
@@ -339,6 +397,7 @@ enum class MetadataType {
     kProviderInfo = 1,
     kProviderSection = 2,
     kProviderEvent = 3,
+    kPadding = 4,
 };
 
 // Enumerates all provider events.
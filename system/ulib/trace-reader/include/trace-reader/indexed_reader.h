@@ -0,0 +1,175 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <trace-reader/reader.h>
+#include <trace-reader/records.h>
+
+#include <fbl/function.h>
+#include <fbl/intrusive_hash_table.h>
+#include <fbl/macros.h>
+#include <fbl/string.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+
+namespace trace {
+
+// Reads a trace file by mapping it into memory.
+//
+// Opening the file indexes it in one pass, without decoding the records.
+// After that, the records of a time range, a thread or a category can be
+// decoded without reading the rest of the file, and large parts of the
+// file can be decoded on several threads at once.
+//
+// The index groups the records into blocks of consecutive records, and
+// notes the span of each block's timestamps and which blocks each thread
+// and category appears in. Decoding a block needs the string and thread
+// tables as they were at its start, so the index also notes the records
+// that define them, which are replayed before the blocks that follow them.
+class IndexedTraceReader {
+public:
+    using RecordConsumer = TraceReader::RecordConsumer;
+    using ErrorHandler = TraceReader::ErrorHandler;
+
+    // Called for the records of slice |slice|, see |ReadBlocksParallel|.
+    using SliceRecordConsumer = fbl::Function<void(size_t slice, Record record)>;
+
+    // The number of records in each block.
+    static constexpr size_t kRecordsPerBlock = 1024u;
+
+    // Selects event, context switch and log records. The other records
+    // are read by |ReadDefinitions|.
+    struct Query {
+        // Only the records with timestamps in [begin, end).
+        trace_ticks_t begin = 0u;
+        trace_ticks_t end = UINT64_MAX;
+
+        // If set, only the records of this thread, including the context
+        // switches to and from it.
+        ProcessThread thread;
+
+        // If not empty, only the events in this category.
+        fbl::String category;
+    };
+
+    ~IndexedTraceReader();
+
+    // Maps and indexes the trace in |path|, which may hold a stream of
+    // records or a buffer as |TraceReader::ReadBuffer| reads them.
+    // Returns null, having reported why, if the file cannot be read or is
+    // corrupt. |error_handler| may be called on several threads, but only
+    // on one at a time.
+    static fbl::unique_ptr<IndexedTraceReader> Open(const char* path,
+                                                    ErrorHandler error_handler);
+
+    size_t num_records() const { return num_records_; }
+    size_t num_blocks() const { return blocks_.size(); }
+
+    // The first and last timestamps in the trace.
+    trace_ticks_t min_timestamp() const { return min_timestamp_; }
+    trace_ticks_t max_timestamp() const { return max_timestamp_; }
+
+    // The value from the trace's initialization record, or 0 if it has none.
+    trace_ticks_t ticks_per_second() const { return ticks_per_second_; }
+
+    // Reads the metadata, initialization, string, thread and kernel object
+    // records, in trace order.
+    bool ReadDefinitions(RecordConsumer consumer) const;
+
+    // Returns, in trace order, the blocks that may hold records that
+    // |query| selects.
+    fbl::Vector<uint32_t> FindBlocks(const Query& query) const;
+
+    // Reads the records that |query| selects from |blocks|, which must be
+    // in trace order, on the calling thread.
+    bool ReadBlocks(const Query& query, const uint32_t* blocks, size_t num_blocks,
+                    RecordConsumer consumer) const;
+
+    // Splits |blocks|, which must be in trace order, into |num_slices|
+    // runs of consecutive blocks, and reads the records that |query|
+    // selects from them on up to |num_threads| threads.
+    //
+    // Each slice's records are passed to |consumer| in trace order, on one
+    // thread, while the other slices are read on other threads. The
+    // records of each slice come before those of the next in the trace.
+    bool ReadBlocksParallel(const Query& query, const uint32_t* blocks, size_t num_blocks,
+                            size_t num_slices, size_t num_threads,
+                            SliceRecordConsumer consumer) const;
+
+private:
+    class Indexer;
+
+    struct Block {
+        // Where the block is in the file, in words.
+        uint64_t offset;
+        uint32_t num_words;
+
+        // The number of definitions before the block.
+        uint32_t first_definition;
+
+        trace_ticks_t min_timestamp;
+        trace_ticks_t max_timestamp;
+    };
+
+    // A thread and the blocks in which it appears.
+    struct ThreadEntry : public fbl::SinglyLinkedListable<fbl::unique_ptr<ThreadEntry>> {
+        explicit ThreadEntry(const ProcessThread& process_thread)
+            : process_thread(process_thread) {}
+
+        ProcessThread const process_thread;
+        fbl::Vector<uint32_t> blocks;
+
+        // Used by the hash table.
+        ProcessThread GetKey() const { return process_thread; }
+        static size_t GetHash(const ProcessThread& key);
+    };
+
+    // A category and the blocks in which it appears.
+    struct CategoryEntry : public fbl::SinglyLinkedListable<fbl::unique_ptr<CategoryEntry>> {
+        explicit CategoryEntry(fbl::String name)
+            : name(fbl::move(name)) {}
+
+        fbl::String const name;
+        fbl::Vector<uint32_t> blocks;
+
+        // Used by the hash table.
+        fbl::String GetKey() const { return name; }
+        static size_t GetHash(const fbl::String& key);
+    };
+
+    IndexedTraceReader(ErrorHandler error_handler, const uint64_t* words, size_t num_bytes);
+
+    bool ReadRecordAt(TraceReader* reader, uint64_t offset) const;
+    void ReportError(fbl::String error) const;
+
+    ErrorHandler const error_handler_;
+    mutable pthread_mutex_t error_lock_ = PTHREAD_MUTEX_INITIALIZER;
+
+    // The mapped file.
+    const uint64_t* const words_;
+    size_t const num_bytes_;
+
+    fbl::Vector<Block> blocks_;
+
+    // Where each definition is in the file, in words, in trace order.
+    fbl::Vector<uint64_t> definitions_;
+
+    fbl::HashTable<ProcessThread, fbl::unique_ptr<ThreadEntry>,
+                   fbl::SinglyLinkedList<fbl::unique_ptr<ThreadEntry>>, size_t, 1021u>
+        threads_;
+    fbl::HashTable<fbl::String, fbl::unique_ptr<CategoryEntry>> categories_;
+
+    size_t num_records_ = 0u;
+    trace_ticks_t min_timestamp_ = UINT64_MAX;
+    trace_ticks_t max_timestamp_ = 0u;
+    trace_ticks_t ticks_per_second_ = 0u;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(IndexedTraceReader);
+};
+
+} // namespace trace
@@ -40,6 +40,27 @@ public:
     // chunks as they become available to resume decoding.
     bool ReadRecords(Chunk& chunk);
 
+    // Reads all the records in a buffer filled in by the trace engine,
+    // whose first |num_bytes| were written.  Understands each of the
+    // buffering modes: in circular and streaming mode the durable records
+    // are read first, followed by the rolling buffers from oldest to newest.
+    // Returns false if the buffer is corrupt.
+    bool ReadBuffer(const void* buffer, size_t num_bytes);
+
+    // A part of a trace buffer that holds consecutive records.
+    struct BufferRegion {
+        const uint8_t* begin;
+        size_t num_bytes;
+    };
+    static constexpr size_t kMaxBufferRegions = 3u;
+
+    // Finds the parts of a buffer that |ReadBuffer| reads, in the order it
+    // reads them. Returns false, with the reason in |*out_error|, if the
+    // buffer is corrupt.
+    static bool GetBufferRegions(const void* buffer, size_t num_bytes,
+                                 BufferRegion* out_regions, size_t* out_num_regions,
+                                 fbl::String* out_error);
+
     // Gets the current trace provider id.
     // Returns 0 if no providers have been registered yet.
     ProviderId current_provider_id() const { return current_provider_->id; }
@@ -85,6 +106,8 @@ private:
                          trace_encoded_thread_ref_t thread_ref,
                          ProcessThread* out_process_thread) const;
 
+    bool ReadBufferRegion(const uint8_t* begin, size_t num_bytes);
+
     void ReportError(fbl::String error) const;
 
     RecordConsumer const record_consumer_;
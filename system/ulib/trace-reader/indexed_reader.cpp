@@ -0,0 +1,596 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <trace-reader/indexed_reader.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fbl/atomic.h>
+#include <fbl/string_piece.h>
+#include <fbl/string_printf.h>
+#include <trace-engine/fields.h>
+#include <trace-engine/types.h>
+
+namespace trace {
+namespace {
+
+bool Matches(const IndexedTraceReader::Query& query, const Record& record) {
+    trace_ticks_t timestamp;
+    switch (record.type()) {
+    case RecordType::kEvent: {
+        const auto& event = record.GetEvent();
+        if (query.thread && event.process_thread != query.thread)
+            return false;
+        if (!query.category.empty() && event.category != query.category)
+            return false;
+        timestamp = event.timestamp;
+        break;
+    }
+    case RecordType::kContextSwitch: {
+        const auto& context_switch = record.GetContextSwitch();
+        if (query.thread && context_switch.outgoing_thread != query.thread &&
+            context_switch.incoming_thread != query.thread)
+            return false;
+        if (!query.category.empty())
+            return false;
+        timestamp = context_switch.timestamp;
+        break;
+    }
+    case RecordType::kLog: {
+        const auto& log = record.GetLog();
+        if (query.thread && log.process_thread != query.thread)
+            return false;
+        if (!query.category.empty())
+            return false;
+        timestamp = log.timestamp;
+        break;
+    }
+    default:
+        // Read by ReadDefinitions() instead.
+        return false;
+    }
+    return timestamp >= query.begin && timestamp < query.end;
+}
+
+} // namespace
+
+size_t IndexedTraceReader::ThreadEntry::GetHash(const ProcessThread& key) {
+    return static_cast<size_t>(key.thread_koid() * 31u + key.process_koid());
+}
+
+size_t IndexedTraceReader::CategoryEntry::GetHash(const fbl::String& key) {
+    // FNV-1a.
+    size_t hash = 2166136261u;
+    for (char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// Builds the index in one pass over the records, keeping just enough of
+// the string and thread tables to tell which threads and categories the
+// records belong to.
+class IndexedTraceReader::Indexer {
+public:
+    explicit Indexer(IndexedTraceReader* reader)
+        : reader_(reader) {
+        SetCurrentProvider(0u, true);
+    }
+
+    bool IndexRegion(const uint8_t* begin, size_t num_bytes);
+
+private:
+    struct Provider {
+        ProviderId id;
+        fbl::StringPiece strings[TRACE_ENCODED_STRING_REF_MAX_INDEX + 1];
+        // The entries for the strings that have been used as categories.
+        CategoryEntry* categories[TRACE_ENCODED_STRING_REF_MAX_INDEX + 1];
+        ThreadEntry* threads[TRACE_ENCODED_THREAD_REF_MAX_INDEX + 1];
+    };
+
+    void IndexRecord(const uint64_t* record, size_t num_words);
+    void StartBlock(const uint64_t* record);
+    void FinishBlock(const uint64_t* end);
+
+    void SetCurrentProvider(ProviderId id, bool reset);
+    ThreadEntry* DecodeThreadRef(trace_encoded_thread_ref_t thread_ref,
+                                 const uint64_t** cursor, const uint64_t* end);
+    CategoryEntry* DecodeCategoryRef(trace_encoded_string_ref_t string_ref,
+                                     const uint64_t** cursor, const uint64_t* end);
+    ThreadEntry* GetThreadEntry(const ProcessThread& process_thread);
+    CategoryEntry* GetCategoryEntry(fbl::StringPiece name);
+
+    template <typename Entry>
+    void NoteEntry(Entry* entry) {
+        const uint32_t block = static_cast<uint32_t>(reader_->blocks_.size());
+        if (entry && (entry->blocks.is_empty() ||
+                      entry->blocks[entry->blocks.size() - 1] != block))
+            entry->blocks.push_back(block);
+    }
+    void NoteTimestamp(trace_ticks_t timestamp);
+
+    IndexedTraceReader* const reader_;
+
+    fbl::Vector<fbl::unique_ptr<Provider>> providers_;
+    Provider* current_provider_ = nullptr;
+
+    // The block being built.
+    const uint64_t* block_start_ = nullptr;
+    size_t block_num_records_ = 0u;
+    uint32_t block_first_definition_ = 0u;
+    trace_ticks_t block_min_timestamp_ = UINT64_MAX;
+    trace_ticks_t block_max_timestamp_ = 0u;
+};
+
+bool IndexedTraceReader::Indexer::IndexRegion(const uint8_t* begin, size_t num_bytes) {
+    if ((num_bytes & 7u) || (reinterpret_cast<uintptr_t>(begin) & 7u)) {
+        reader_->ReportError("Buffer contains extraneous bytes");
+        return false;
+    }
+
+    // Blocks do not span regions, which need not be adjacent in the file.
+    const uint64_t* current = reinterpret_cast<const uint64_t*>(begin);
+    const uint64_t* const end = current + num_bytes / 8u;
+    while (current < end) {
+        auto size = RecordFields::RecordSize::Get<size_t>(*current);
+        if (size == 0) {
+            reader_->ReportError("Unexpected record of size 0");
+            FinishBlock(current);
+            return false;
+        }
+        if (size > static_cast<size_t>(end - current)) {
+            // A trace that was cut short; keep what is there.
+            reader_->ReportError("Trace ends in a partial record");
+            break;
+        }
+
+        if (!block_start_)
+            StartBlock(current);
+        IndexRecord(current, size);
+        current += size;
+        if (++block_num_records_ == kRecordsPerBlock)
+            FinishBlock(current);
+    }
+    FinishBlock(current);
+    return true;
+}
+
+void IndexedTraceReader::Indexer::IndexRecord(const uint64_t* record, size_t num_words) {
+    const RecordHeader header = record[0];
+    const uint64_t* const end = record + num_words;
+    const uint64_t* cursor = record + 1;
+    reader_->num_records_++;
+
+    auto type = RecordFields::Type::Get<RecordType>(header);
+    switch (type) {
+    case RecordType::kMetadata: {
+        auto metadata_type = MetadataRecordFields::MetadataType::Get<MetadataType>(header);
+        if (metadata_type == MetadataType::kProviderInfo) {
+            SetCurrentProvider(
+                ProviderInfoMetadataRecordFields::Id::Get<ProviderId>(header), true);
+        } else if (metadata_type == MetadataType::kProviderSection) {
+            SetCurrentProvider(
+                ProviderSectionMetadataRecordFields::Id::Get<ProviderId>(header), false);
+        }
+        reader_->definitions_.push_back(record - reader_->words_);
+        break;
+    }
+    case RecordType::kInitialization: {
+        if (cursor < end)
+            reader_->ticks_per_second_ = *cursor;
+        reader_->definitions_.push_back(record - reader_->words_);
+        break;
+    }
+    case RecordType::kString: {
+        auto index = StringRecordFields::StringIndex::Get<trace_string_index_t>(header);
+        auto length = StringRecordFields::StringLength::Get<size_t>(header);
+        if (index >= TRACE_ENCODED_STRING_REF_MIN_INDEX &&
+            index <= TRACE_ENCODED_STRING_REF_MAX_INDEX &&
+            BytesToWords(length) <= static_cast<size_t>(end - cursor)) {
+            current_provider_->strings[index] =
+                fbl::StringPiece(reinterpret_cast<const char*>(cursor), length);
+            current_provider_->categories[index] = nullptr;
+        }
+        reader_->definitions_.push_back(record - reader_->words_);
+        break;
+    }
+    case RecordType::kThread: {
+        auto index = ThreadRecordFields::ThreadIndex::Get<trace_thread_index_t>(header);
+        if (index >= TRACE_ENCODED_THREAD_REF_MIN_INDEX &&
+            index <= TRACE_ENCODED_THREAD_REF_MAX_INDEX && end - cursor >= 2) {
+            current_provider_->threads[index] =
+                GetThreadEntry(ProcessThread(cursor[0], cursor[1]));
+        }
+        reader_->definitions_.push_back(record - reader_->words_);
+        break;
+    }
+    case RecordType::kKernelObject: {
+        reader_->definitions_.push_back(record - reader_->words_);
+        break;
+    }
+    case RecordType::kEvent: {
+        if (cursor == end)
+            break;
+        NoteTimestamp(*cursor++);
+        NoteEntry(DecodeThreadRef(
+            EventRecordFields::ThreadRef::Get<trace_encoded_thread_ref_t>(header),
+            &cursor, end));
+        NoteEntry(DecodeCategoryRef(
+            EventRecordFields::CategoryStringRef::Get<trace_encoded_string_ref_t>(header),
+            &cursor, end));
+        break;
+    }
+    case RecordType::kContextSwitch: {
+        if (cursor == end)
+            break;
+        NoteTimestamp(*cursor++);
+        NoteEntry(DecodeThreadRef(
+            ContextSwitchRecordFields::OutgoingThreadRef::Get<trace_encoded_thread_ref_t>(
+                header),
+            &cursor, end));
+        NoteEntry(DecodeThreadRef(
+            ContextSwitchRecordFields::IncomingThreadRef::Get<trace_encoded_thread_ref_t>(
+                header),
+            &cursor, end));
+        break;
+    }
+    case RecordType::kLog: {
+        if (cursor == end)
+            break;
+        NoteTimestamp(*cursor++);
+        NoteEntry(DecodeThreadRef(
+            LogRecordFields::ThreadRef::Get<trace_encoded_thread_ref_t>(header),
+            &cursor, end));
+        break;
+    }
+    default:
+        // The reader skips these too.
+        break;
+    }
+}
+
+void IndexedTraceReader::Indexer::StartBlock(const uint64_t* record) {
+    block_start_ = record;
+    block_num_records_ = 0u;
+    block_first_definition_ = static_cast<uint32_t>(reader_->definitions_.size());
+    block_min_timestamp_ = UINT64_MAX;
+    block_max_timestamp_ = 0u;
+}
+
+void IndexedTraceReader::Indexer::FinishBlock(const uint64_t* end) {
+    if (!block_start_)
+        return;
+    reader_->blocks_.push_back(Block{
+        static_cast<uint64_t>(block_start_ - reader_->words_),
+        static_cast<uint32_t>(end - block_start_),
+        block_first_definition_,
+        block_min_timestamp_,
+        block_max_timestamp_});
+    block_start_ = nullptr;
+}
+
+void IndexedTraceReader::Indexer::NoteTimestamp(trace_ticks_t timestamp) {
+    if (timestamp < block_min_timestamp_)
+        block_min_timestamp_ = timestamp;
+    if (timestamp > block_max_timestamp_)
+        block_max_timestamp_ = timestamp;
+    if (timestamp < reader_->min_timestamp_)
+        reader_->min_timestamp_ = timestamp;
+    if (timestamp > reader_->max_timestamp_)
+        reader_->max_timestamp_ = timestamp;
+}
+
+// As in TraceReader, a provider info record starts the provider's tables
+// afresh, and a provider section record only switches to them.
+void IndexedTraceReader::Indexer::SetCurrentProvider(ProviderId id, bool reset) {
+    for (auto& provider : providers_) {
+        if (provider->id == id) {
+            if (reset) {
+                provider.reset(new Provider());
+                provider->id = id;
+            }
+            current_provider_ = provider.get();
+            return;
+        }
+    }
+    fbl::unique_ptr<Provider> provider(new Provider());
+    provider->id = id;
+    current_provider_ = provider.get();
+    providers_.push_back(fbl::move(provider));
+}
+
+IndexedTraceReader::ThreadEntry* IndexedTraceReader::Indexer::DecodeThreadRef(
+    trace_encoded_thread_ref_t thread_ref, const uint64_t** cursor, const uint64_t* end) {
+    if (thread_ref == TRACE_ENCODED_THREAD_REF_INLINE) {
+        if (end - *cursor < 2)
+            return nullptr;
+        ProcessThread process_thread((*cursor)[0], (*cursor)[1]);
+        *cursor += 2;
+        return GetThreadEntry(process_thread);
+    }
+    return current_provider_->threads[thread_ref];
+}
+
+IndexedTraceReader::CategoryEntry* IndexedTraceReader::Indexer::DecodeCategoryRef(
+    trace_encoded_string_ref_t string_ref, const uint64_t** cursor, const uint64_t* end) {
+    if (string_ref == TRACE_ENCODED_STRING_REF_EMPTY)
+        return nullptr;
+
+    if (string_ref & TRACE_ENCODED_STRING_REF_INLINE_FLAG) {
+        size_t length = string_ref & TRACE_ENCODED_STRING_REF_LENGTH_MASK;
+        size_t num_words = BytesToWords(length);
+        if (length > TRACE_ENCODED_STRING_REF_MAX_LENGTH ||
+            num_words > static_cast<size_t>(end - *cursor))
+            return nullptr;
+        fbl::StringPiece name(reinterpret_cast<const char*>(*cursor), length);
+        *cursor += num_words;
+        return GetCategoryEntry(name);
+    }
+
+    if (string_ref > TRACE_ENCODED_STRING_REF_MAX_INDEX)
+        return nullptr;
+    CategoryEntry*& category = current_provider_->categories[string_ref];
+    if (!category && current_provider_->strings[string_ref].data())
+        category = GetCategoryEntry(current_provider_->strings[string_ref]);
+    return category;
+}
+
+IndexedTraceReader::ThreadEntry* IndexedTraceReader::Indexer::GetThreadEntry(
+    const ProcessThread& process_thread) {
+    auto it = reader_->threads_.find(process_thread);
+    if (it != reader_->threads_.end())
+        return &*it;
+    auto entry = fbl::make_unique<ThreadEntry>(process_thread);
+    ThreadEntry* result = entry.get();
+    reader_->threads_.insert(fbl::move(entry));
+    return result;
+}
+
+IndexedTraceReader::CategoryEntry* IndexedTraceReader::Indexer::GetCategoryEntry(
+    fbl::StringPiece name) {
+    fbl::String key(name);
+    auto it = reader_->categories_.find(key);
+    if (it != reader_->categories_.end())
+        return &*it;
+    auto entry = fbl::make_unique<CategoryEntry>(fbl::move(key));
+    CategoryEntry* result = entry.get();
+    reader_->categories_.insert(fbl::move(entry));
+    return result;
+}
+
+IndexedTraceReader::IndexedTraceReader(ErrorHandler error_handler,
+                                       const uint64_t* words, size_t num_bytes)
+    : error_handler_(fbl::move(error_handler)), words_(words), num_bytes_(num_bytes) {}
+
+IndexedTraceReader::~IndexedTraceReader() {
+    if (words_)
+        munmap(const_cast<uint64_t*>(words_), num_bytes_);
+}
+
+fbl::unique_ptr<IndexedTraceReader> IndexedTraceReader::Open(const char* path,
+                                                             ErrorHandler error_handler) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (error_handler)
+            error_handler(fbl::StringPrintf("Cannot open %s: %s", path, strerror(errno)));
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        if (error_handler)
+            error_handler(fbl::StringPrintf("Cannot stat %s: %s", path, strerror(errno)));
+        close(fd);
+        return nullptr;
+    }
+    const size_t num_bytes = static_cast<size_t>(st.st_size);
+    void* words = nullptr;
+    if (num_bytes > 0u) {
+        words = mmap(nullptr, num_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (words == MAP_FAILED) {
+            if (error_handler)
+                error_handler(fbl::StringPrintf("Cannot map %s: %s", path, strerror(errno)));
+            close(fd);
+            return nullptr;
+        }
+    }
+    close(fd);
+
+    fbl::unique_ptr<IndexedTraceReader> reader(new IndexedTraceReader(
+        fbl::move(error_handler), static_cast<const uint64_t*>(words), num_bytes));
+
+    TraceReader::BufferRegion regions[TraceReader::kMaxBufferRegions];
+    size_t num_regions;
+    fbl::String error;
+    if (!TraceReader::GetBufferRegions(words, num_bytes, regions, &num_regions, &error)) {
+        reader->ReportError(fbl::move(error));
+        return nullptr;
+    }
+    Indexer indexer(reader.get());
+    for (size_t i = 0; i < num_regions; i++) {
+        if (!indexer.IndexRegion(regions[i].begin, regions[i].num_bytes))
+            return nullptr;
+    }
+    return reader;
+}
+
+bool IndexedTraceReader::ReadDefinitions(RecordConsumer consumer) const {
+    TraceReader reader(fbl::move(consumer),
+                       [this](fbl::String error) { ReportError(fbl::move(error)); });
+    for (uint64_t offset : definitions_) {
+        if (!ReadRecordAt(&reader, offset))
+            return false;
+    }
+    return true;
+}
+
+fbl::Vector<uint32_t> IndexedTraceReader::FindBlocks(const Query& query) const {
+    fbl::Vector<uint32_t> result;
+    auto add = [this, &query, &result](uint32_t block) {
+        if (blocks_[block].max_timestamp >= query.begin &&
+            blocks_[block].min_timestamp < query.end)
+            result.push_back(block);
+    };
+
+    const fbl::Vector<uint32_t>* thread_blocks = nullptr;
+    if (query.thread) {
+        auto it = threads_.find(query.thread);
+        if (it == threads_.end())
+            return result;
+        thread_blocks = &it->blocks;
+    }
+    const fbl::Vector<uint32_t>* category_blocks = nullptr;
+    if (!query.category.empty()) {
+        auto it = categories_.find(query.category);
+        if (it == categories_.end())
+            return result;
+        category_blocks = &it->blocks;
+    }
+
+    if (thread_blocks && category_blocks) {
+        // Both lists are sorted.
+        size_t i = 0, j = 0;
+        while (i < thread_blocks->size() && j < category_blocks->size()) {
+            uint32_t a = (*thread_blocks)[i], b = (*category_blocks)[j];
+            if (a == b)
+                add(a);
+            if (a <= b)
+                i++;
+            if (b <= a)
+                j++;
+        }
+    } else if (thread_blocks || category_blocks) {
+        for (uint32_t block : thread_blocks ? *thread_blocks : *category_blocks)
+            add(block);
+    } else {
+        for (uint32_t block = 0; block < blocks_.size(); block++)
+            add(block);
+    }
+    return result;
+}
+
+bool IndexedTraceReader::ReadBlocks(const Query& query, const uint32_t* blocks,
+                                    size_t num_blocks, RecordConsumer consumer) const {
+    // The definitions between the blocks are replayed to keep the reader's
+    // tables up to date, but not passed on.
+    bool replaying = false;
+    TraceReader reader(
+        [&query, &consumer, &replaying](Record record) {
+            if (!replaying && Matches(query, record))
+                consumer(fbl::move(record));
+        },
+        [this](fbl::String error) { ReportError(fbl::move(error)); });
+
+    size_t next_definition = 0u;
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (blocks[i] >= blocks_.size() ||
+            next_definition > blocks_[blocks[i]].first_definition) {
+            ReportError("Blocks are not in trace order");
+            return false;
+        }
+        const Block& block = blocks_[blocks[i]];
+
+        replaying = true;
+        for (; next_definition < block.first_definition; next_definition++) {
+            if (!ReadRecordAt(&reader, definitions_[next_definition]))
+                return false;
+        }
+        replaying = false;
+
+        Chunk chunk(words_ + block.offset, block.num_words);
+        if (!reader.ReadRecords(chunk))
+            return false;
+
+        // The block's own definitions have just been read.
+        next_definition = blocks[i] + 1u < blocks_.size()
+                              ? blocks_[blocks[i] + 1u].first_definition
+                              : definitions_.size();
+    }
+    return true;
+}
+
+namespace {
+
+struct ParallelRead {
+    const IndexedTraceReader* reader;
+    const IndexedTraceReader::Query* query;
+    const uint32_t* blocks;
+    size_t num_blocks;
+    size_t num_slices;
+    const IndexedTraceReader::SliceRecordConsumer* consumer;
+
+    fbl::atomic<size_t> next_slice{0u};
+    fbl::atomic<bool> ok{true};
+
+    // Reads slices until there are none left.
+    void Run() {
+        size_t slice;
+        while ((slice = next_slice.fetch_add(1u)) < num_slices) {
+            const size_t begin = num_blocks * slice / num_slices;
+            const size_t end = num_blocks * (slice + 1u) / num_slices;
+            auto consumer = this->consumer;
+            if (!reader->ReadBlocks(*query, blocks + begin, end - begin,
+                                    [consumer, slice](Record record) {
+                                        (*consumer)(slice, fbl::move(record));
+                                    }))
+                ok.store(false);
+        }
+    }
+
+    static void* RunThread(void* arg) {
+        static_cast<ParallelRead*>(arg)->Run();
+        return nullptr;
+    }
+};
+
+} // namespace
+
+bool IndexedTraceReader::ReadBlocksParallel(const Query& query, const uint32_t* blocks,
+                                            size_t num_blocks, size_t num_slices,
+                                            size_t num_threads,
+                                            SliceRecordConsumer consumer) const {
+    if (num_slices == 0u)
+        num_slices = 1u;
+
+    ParallelRead read;
+    read.reader = this;
+    read.query = &query;
+    read.blocks = blocks;
+    read.num_blocks = num_blocks;
+    read.num_slices = num_slices;
+    read.consumer = &consumer;
+
+    // The calling thread reads slices too, so it is one of |num_threads|.
+    fbl::Vector<pthread_t> threads;
+    for (size_t i = 1; i < num_threads && i < num_slices; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, &ParallelRead::RunThread, &read) != 0)
+            break;
+        threads.push_back(thread);
+    }
+    read.Run();
+    for (pthread_t thread : threads)
+        pthread_join(thread, nullptr);
+    return read.ok.load();
+}
+
+bool IndexedTraceReader::ReadRecordAt(TraceReader* reader, uint64_t offset) const {
+    const uint64_t* record = words_ + offset;
+    Chunk chunk(record, RecordFields::RecordSize::Get<size_t>(*record));
+    return reader->ReadRecords(chunk);
+}
+
+void IndexedTraceReader::ReportError(fbl::String error) const {
+    if (!error_handler_)
+        return;
+    pthread_mutex_lock(&error_lock_);
+    error_handler_(fbl::move(error));
+    pthread_mutex_unlock(&error_lock_);
+}
+
+} // namespace trace
@@ -6,6 +6,7 @@
 
 #include <fbl/string_printf.h>
 #include <trace-engine/fields.h>
+#include <trace-engine/types.h>
 
 namespace trace {
 
@@ -93,6 +94,91 @@ bool TraceReader::ReadRecords(Chunk& chunk) {
     }
 }
 
+bool TraceReader::ReadBuffer(const void* buffer, size_t num_bytes) {
+    BufferRegion regions[kMaxBufferRegions];
+    size_t num_regions;
+    fbl::String error;
+    if (!GetBufferRegions(buffer, num_bytes, regions, &num_regions, &error)) {
+        ReportError(fbl::move(error));
+        return false;
+    }
+    for (size_t i = 0; i < num_regions; i++) {
+        if (!ReadBufferRegion(regions[i].begin, regions[i].num_bytes))
+            return false;
+    }
+    return true;
+}
+
+bool TraceReader::GetBufferRegions(const void* buffer, size_t num_bytes,
+                                   BufferRegion* out_regions, size_t* out_num_regions,
+                                   fbl::String* out_error) {
+    auto bytes = static_cast<const uint8_t*>(buffer);
+    auto header = static_cast<const trace_buffer_header_t*>(buffer);
+    if (num_bytes < sizeof(*header) || header->magic != TRACE_BUFFER_HEADER_MAGIC) {
+        // oneshot
+        out_regions[0] = BufferRegion{bytes, num_bytes};
+        *out_num_regions = 1u;
+        return true;
+    }
+
+    if (header->version != TRACE_BUFFER_HEADER_VERSION) {
+        *out_error = fbl::StringPrintf("Unsupported buffer header version %u",
+                                       header->version);
+        return false;
+    }
+    if (header->buffering_mode != TRACE_BUFFERING_MODE_CIRCULAR &&
+        header->buffering_mode != TRACE_BUFFERING_MODE_STREAMING) {
+        *out_error = fbl::StringPrintf("Unexpected buffering mode %u",
+                                       header->buffering_mode);
+        return false;
+    }
+    const uint64_t durable_size = header->durable_buffer_size;
+    const uint64_t rolling_size = header->rolling_buffer_size;
+    if (header->total_size > num_bytes ||
+        durable_size > header->total_size - sizeof(*header) ||
+        rolling_size > (header->total_size - sizeof(*header) - durable_size) / 2 ||
+        header->durable_data_end > durable_size ||
+        header->rolling_data_end[0] > rolling_size ||
+        header->rolling_data_end[1] > rolling_size) {
+        *out_error = "Buffer header is corrupted";
+        return false;
+    }
+
+    const uint8_t* durable_start = bytes + sizeof(*header);
+    const uint8_t* rolling_start = durable_start + durable_size;
+    size_t n = 0;
+    out_regions[n++] = BufferRegion{durable_start, header->durable_data_end};
+
+    // Once it has wrapped, the other rolling buffer holds the older records.
+    const uint64_t current = header->wrapped_count & 1u;
+    if (header->wrapped_count > 0u) {
+        const uint64_t older = current ^ 1u;
+        out_regions[n++] = BufferRegion{rolling_start + older * rolling_size,
+                                        header->rolling_data_end[older]};
+    }
+    out_regions[n++] = BufferRegion{rolling_start + current * rolling_size,
+                                    header->rolling_data_end[current]};
+    *out_num_regions = n;
+    return true;
+}
+
+bool TraceReader::ReadBufferRegion(const uint8_t* begin, size_t num_bytes) {
+    if (num_bytes & 7u) {
+        ReportError("Buffer contains extraneous bytes");
+        return false;
+    }
+    Chunk chunk(reinterpret_cast<const uint64_t*>(begin), num_bytes / 8u);
+    if (!ReadRecords(chunk))
+        return false;
+    if (pending_header_) {
+        // Each region ends on a record boundary.
+        ReportError("Buffer ends in a partial record");
+        pending_header_ = 0u;
+        return false;
+    }
+    return true;
+}
+
 bool TraceReader::ReadMetadataRecord(Chunk& record, RecordHeader header) {
     auto type = MetadataRecordFields::MetadataType::Get<MetadataType>(header);
 
@@ -139,6 +225,9 @@ bool TraceReader::ReadMetadataRecord(Chunk& record, RecordHeader header) {
         }
         break;
     }
+    case MetadataType::kPadding:
+        // Unused space, there is nothing to report.
+        break;
     default: {
         // Ignore unknown metadata types for forward compatibility.
         ReportError(fbl::StringPrintf(
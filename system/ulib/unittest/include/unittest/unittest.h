@@ -102,6 +102,8 @@ typedef enum test_type {
 } test_type_t;
 
 #define TEST_ENV_NAME "RUNTESTS_TEST_CLASS"
+// runtests -o sets this to the directory for the tests' output files.
+#define TEST_OUTPUT_DIR_ENV_NAME "RUNTESTS_OUTPUT_DIR"
 #define TEST_DEFAULT (TEST_SMALL | TEST_MEDIUM)
 
 extern test_type_t utest_test_type;
@@ -12,6 +12,10 @@
 
 extern __LOCAL const struct vdso_constants DATA_CONSTANTS;
 
+// Unlike DATA_CONSTANTS, the kernel updates this after boot; see
+// vdso_time_values.
+extern __LOCAL struct vdso_time_values DATA_TIME_VALUES;
+
 extern "C" {
 
 // This declares the VDSO_zx_* aliases for the vDSO entry points.
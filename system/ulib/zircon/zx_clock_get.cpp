@@ -0,0 +1,64 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/syscalls.h>
+
+#include "private.h"
+
+namespace {
+
+// This must match u64_mul_u64_fp32_64() in the kernel's lib/fixed_point.h
+// exactly, so that the vDSO and the kernel never disagree on the time.
+uint64_t ticks_to_mono(uint64_t ticks) {
+    const uint32_t l0 = DATA_TIME_VALUES.ticks_to_mono_l0;
+    const uint32_t l32 = DATA_TIME_VALUES.ticks_to_mono_l32;
+    const uint32_t l64 = DATA_TIME_VALUES.ticks_to_mono_l64;
+    const uint32_t a_r32 = static_cast<uint32_t>(ticks >> 32);
+    const uint32_t a_0 = static_cast<uint32_t>(ticks);
+
+    uint64_t res_0 = (static_cast<uint64_t>(a_r32) * l0) << 32;
+    res_0 += static_cast<uint64_t>(a_0) * l0;
+    res_0 += static_cast<uint64_t>(a_r32) * l32;
+    uint64_t tmp = static_cast<uint64_t>(a_0) * l32;
+    res_0 += tmp >> 32;
+    uint64_t res_l32 = static_cast<uint32_t>(tmp);
+    tmp = static_cast<uint64_t>(a_r32) * l64;
+    res_0 += tmp >> 32;
+    res_l32 += static_cast<uint32_t>(tmp);
+    tmp = static_cast<uint64_t>(a_0) * l64;
+    res_l32 += tmp >> 32;
+    res_0 += res_l32 >> 32;
+    // Round to nearest.
+    return res_0 + (static_cast<uint32_t>(res_l32) >> 31);
+}
+
+int64_t utc_offset() {
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&DATA_TIME_VALUES.seq, __ATOMIC_ACQUIRE);
+        if (seq & 1u)
+            continue;
+        int64_t offset = __atomic_load_n(&DATA_TIME_VALUES.utc_offset, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&DATA_TIME_VALUES.seq, __ATOMIC_RELAXED) == seq)
+            return offset;
+    }
+}
+
+} // anonymous namespace
+
+zx_time_t _zx_clock_get(uint32_t clock_id) {
+    // The kernel only sets this at boot, when its clock turns out to be
+    // a fixed multiple of the counter that zx_ticks_get() reads.
+    if (likely(DATA_TIME_VALUES.ticks_to_mono_valid)) {
+        switch (clock_id) {
+        case ZX_CLOCK_MONOTONIC:
+            return ticks_to_mono(VDSO_zx_ticks_get());
+        case ZX_CLOCK_UTC:
+            return ticks_to_mono(VDSO_zx_ticks_get()) + utc_offset();
+        }
+    }
+    return SYSCALL_zx_clock_get_kernel(clock_id);
+}
+
+VDSO_INTERFACE_FUNCTION(zx_clock_get);
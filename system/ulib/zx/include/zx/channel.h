@@ -43,6 +43,16 @@ public:
                                 num_handles);
     }
 
+    zx_status_t read_many(uint32_t flags, zx_channel_msg_t* msgs, uint32_t count,
+                          uint32_t* actual_count) const {
+        return zx_channel_read_many(get(), flags, msgs, count, actual_count);
+    }
+
+    zx_status_t write_many(uint32_t flags, const zx_channel_msg_t* msgs,
+                           uint32_t count) const {
+        return zx_channel_write_etc_many(get(), flags, msgs, count);
+    }
+
     zx_status_t call(uint32_t flags, zx::time deadline,
                      const zx_channel_call_args_t* args,
                      uint32_t* actual_bytes, uint32_t* actual_handles,
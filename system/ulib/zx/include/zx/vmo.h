@@ -38,6 +38,16 @@ public:
         return zx_vmo_write(get(), data, offset, len, actual);
     }
 
+    zx_status_t readv(const zx_iovec_t* vectors, uint32_t count, uint64_t offset,
+                      size_t* actual) const {
+        return zx_vmo_readv(get(), vectors, count, offset, actual);
+    }
+
+    zx_status_t writev(const zx_iovec_t* vectors, uint32_t count, uint64_t offset,
+                       size_t* actual) const {
+        return zx_vmo_writev(get(), vectors, count, offset, actual);
+    }
+
     zx_status_t get_size(uint64_t* size) const {
         return zx_vmo_get_size(get(), size);
     }
@@ -7,9 +7,11 @@
 #include <zircon/syscalls.h>
 #include <zircon/syscalls/object.h>
 #include <unittest/unittest.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <threads.h>
 #include <unistd.h>
 
@@ -884,6 +886,159 @@ static bool channel_disallow_write_to_self(void) {
     END_TEST;
 }
 
+// Large messages are read by moving pages into page aligned buffers; the
+// data must be the same as with the copy path and must not change if the
+// sender reuses its buffer.
+static bool channel_large_message(void) {
+    BEGIN_TEST;
+
+    const uint32_t size = ZX_CHANNEL_MAX_MSG_BYTES - 100u;
+    uint8_t* wr_buf = malloc(size);
+    ASSERT_NONNULL(wr_buf, "");
+    void* aligned = NULL;
+    ASSERT_EQ(posix_memalign(&aligned, PAGE_SIZE, ZX_CHANNEL_MAX_MSG_BYTES), 0, "");
+    uint8_t* rd_aligned = aligned;
+    // Offset by one byte so the kernel has to copy.
+    uint8_t* rd_unaligned = malloc(size + 1u);
+    ASSERT_NONNULL(rd_unaligned, "");
+    rd_unaligned += 1;
+
+    zx_handle_t channel[2];
+    ASSERT_EQ(zx_channel_create(0, &channel[0], &channel[1]), ZX_OK, "");
+
+    for (uint32_t i = 0; i < size; i++)
+        wr_buf[i] = (uint8_t)i;
+    ASSERT_EQ(zx_channel_write(channel[0], 0u, wr_buf, size, NULL, 0u), ZX_OK, "");
+    ASSERT_EQ(zx_channel_write(channel[0], 0u, wr_buf, size, NULL, 0u), ZX_OK, "");
+    memset(wr_buf, 0xff, size);
+
+    // Touch the aligned buffer so that the pages being replaced are committed.
+    memset(rd_aligned, 0, ZX_CHANNEL_MAX_MSG_BYTES);
+
+    uint32_t actual = 0u;
+    ASSERT_EQ(zx_channel_read(channel[1], 0u, rd_aligned, NULL, ZX_CHANNEL_MAX_MSG_BYTES, 0u,
+                              &actual, NULL), ZX_OK, "");
+    ASSERT_EQ(actual, size, "");
+    ASSERT_EQ(zx_channel_read(channel[1], 0u, rd_unaligned, NULL, size, 0u,
+                              &actual, NULL), ZX_OK, "");
+    ASSERT_EQ(actual, size, "");
+
+    for (uint32_t i = 0; i < size; i++) {
+        ASSERT_EQ(rd_aligned[i], (uint8_t)i, "aligned read returned incorrect data");
+        ASSERT_EQ(rd_unaligned[i], (uint8_t)i, "unaligned read returned incorrect data");
+    }
+    // The bytes past the message in the aligned buffer are left alone.
+    for (uint32_t i = size; i < ZX_CHANNEL_MAX_MSG_BYTES; i++)
+        ASSERT_EQ(rd_aligned[i], 0u, "aligned read clobbered past the message");
+
+    zx_handle_close(channel[0]);
+    zx_handle_close(channel[1]);
+    free(rd_unaligned - 1);
+    free(rd_aligned);
+    free(wr_buf);
+
+    END_TEST;
+}
+
+static bool channel_batched(void) {
+    BEGIN_TEST;
+
+    zx_handle_t channel[2];
+    ASSERT_EQ(zx_channel_create(0, &channel[0], &channel[1]), ZX_OK, "");
+    zx_handle_t event;
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+
+    char bytes[3][8] = {"one", "two", "three"};
+    zx_channel_msg_t wr[3] = {
+        {bytes[0], NULL, 4u, 0u},
+        {bytes[1], &event, 4u, 1u},
+        {bytes[2], NULL, 6u, 0u},
+    };
+
+    // A bad handle in any message fails the whole batch, leaving the other
+    // messages' handles with the caller.
+    zx_handle_t bad_handle = ZX_HANDLE_INVALID;
+    zx_channel_msg_t bad = {bytes[0], &bad_handle, 4u, 1u};
+    zx_channel_msg_t wr_bad[2] = {wr[1], bad};
+    ASSERT_EQ(zx_channel_write_etc_many(channel[0], 0u, wr_bad, 2u), ZX_ERR_BAD_HANDLE, "");
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_USER_SIGNAL_0), ZX_OK, "handle was not returned");
+    ASSERT_EQ(zx_channel_read(channel[1], 0u, NULL, NULL, 0u, 0u, NULL, NULL),
+              ZX_ERR_SHOULD_WAIT, "partial batch was written");
+
+    ASSERT_EQ(zx_channel_write_etc_many(channel[0], 0u, wr, 3u), ZX_OK, "");
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_USER_SIGNAL_0), ZX_ERR_BAD_HANDLE,
+              "handle was not transferred");
+
+    // The first message does not fit.
+    char rd_bytes[4][8];
+    zx_handle_t rd_handles[4];
+    zx_channel_msg_t rd[4];
+    for (int i = 0; i < 4; i++) {
+        rd[i].bytes = rd_bytes[i];
+        rd[i].handles = &rd_handles[i];
+        rd[i].num_bytes = 2u;
+        rd[i].num_handles = 1u;
+    }
+    uint32_t actual = 99u;
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_ERR_BUFFER_TOO_SMALL, "");
+    ASSERT_EQ(actual, 0u, "");
+    ASSERT_EQ(rd[0].num_bytes, 4u, "");
+    ASSERT_EQ(rd[0].num_handles, 0u, "");
+
+    // Reading stops at the end of the queue.
+    for (int i = 0; i < 4; i++) {
+        rd[i].num_bytes = 8u;
+        rd[i].num_handles = 1u;
+    }
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 3u, "");
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(rd[i].num_bytes, wr[i].num_bytes, "");
+        ASSERT_EQ(rd[i].num_handles, wr[i].num_handles, "");
+        ASSERT_EQ(strcmp(rd_bytes[i], bytes[i]), 0, "");
+    }
+    ASSERT_EQ(zx_object_signal(rd_handles[1], 0u, ZX_USER_SIGNAL_0), ZX_OK, "");
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_ERR_SHOULD_WAIT, "");
+
+    // An empty batch does nothing, as it does for writes.
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 0u, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 0u, "");
+
+    // A bad buffer ends the batch before its message, which stays in the
+    // channel with the ones after it.
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+    zx_channel_msg_t wr_again[3] = {wr[1], wr[0], wr[2]};
+    ASSERT_EQ(zx_channel_write_etc_many(channel[0], 0u, wr_again, 3u), ZX_OK, "");
+    for (int i = 0; i < 4; i++) {
+        rd[i].bytes = rd_bytes[i];
+        rd[i].num_bytes = 8u;
+        rd[i].num_handles = 1u;
+    }
+    rd[0].bytes = (void*)1;
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_ERR_INVALID_ARGS, "");
+    rd[0].bytes = rd_bytes[0];
+    rd[1].bytes = (void*)1;
+    rd[1].num_bytes = 8u;
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 1u, "");
+    ASSERT_EQ(rd[0].num_handles, 1u, "");
+    ASSERT_EQ(zx_object_signal(rd_handles[0], 0u, ZX_USER_SIGNAL_0), ZX_OK,
+              "handle of the message read was lost");
+    zx_handle_close(rd_handles[0]);
+    rd[1].bytes = rd_bytes[1];
+    rd[1].num_bytes = 8u;
+    ASSERT_EQ(zx_channel_read_many(channel[1], 0u, rd, 4u, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 2u, "messages after the bad buffer were lost");
+    ASSERT_EQ(strcmp(rd_bytes[0], bytes[0]), 0, "");
+    ASSERT_EQ(strcmp(rd_bytes[1], bytes[2]), 0, "");
+
+    zx_handle_close(rd_handles[1]);
+    zx_handle_close(channel[0]);
+    zx_handle_close(channel[1]);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(channel_tests)
 RUN_TEST(channel_test)
 RUN_TEST(channel_read_error_test)
@@ -897,6 +1052,8 @@ RUN_TEST(channel_call2)
 RUN_TEST(bad_channel_call_finish)
 RUN_TEST(channel_nest)
 RUN_TEST(channel_disallow_write_to_self)
+RUN_TEST(channel_large_message)
+RUN_TEST(channel_batched)
 END_TEST_CASE(channel_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -9,7 +9,9 @@
 #include <threads.h>
 #include <unistd.h>
 
+#include <zircon/process.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/fifo.h>
 #include <unittest/unittest.h>
 
 static zx_signals_t get_signals(zx_handle_t h) {
@@ -118,8 +120,98 @@ static bool options_test(void) {
     END_TEST;
 }
 
+// Plays the part of a peer that has mapped the rings of a shared fifo, while
+// the other end uses the syscalls.
+static bool shared_test(void) {
+    BEGIN_TEST;
+    zx_handle_t a, b, vmo;
+    uint32_t endpoint_a, endpoint_b;
+    uint64_t n[8] = { 1, 2, 3, 4, 5, 6, 7, 8};
+    uint32_t actual;
+
+    // only plain fifos can be created without the option
+    ASSERT_EQ(zx_fifo_create(8, 8, 0, &a, &b), ZX_OK, "");
+    EXPECT_EQ(zx_fifo_get_vmo(a, &vmo, &endpoint_a), ZX_ERR_NOT_SUPPORTED, "");
+    EXPECT_EQ(zx_object_signal_peer(a, 0u, ZX_FIFO_READABLE), ZX_ERR_INVALID_ARGS, "");
+    zx_handle_close(a);
+    zx_handle_close(b);
+
+    ASSERT_EQ(zx_fifo_create(8, 8, ZX_FIFO_SHARED, &a, &b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_WRITABLE);
+    EXPECT_SIGNALS(b, ZX_FIFO_WRITABLE);
+
+    ASSERT_EQ(zx_fifo_get_vmo(a, &vmo, &endpoint_a), ZX_OK, "");
+    zx_handle_close(vmo);
+    ASSERT_EQ(zx_fifo_get_vmo(b, &vmo, &endpoint_b), ZX_OK, "");
+    EXPECT_NE(endpoint_a, endpoint_b, "");
+
+    uintptr_t addr;
+    ASSERT_EQ(zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, ZX_FIFO_SHARED_VMO_SIZE,
+                          ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE, &addr), ZX_OK, "");
+    zx_handle_close(vmo);
+    uint8_t* base = (uint8_t*)addr;
+    zx_fifo_shared_ring_t* a_to_b = (zx_fifo_shared_ring_t*)(base + ZX_FIFO_SHARED_RING_OFFSET(endpoint_a));
+    zx_fifo_shared_ring_t* b_to_a = (zx_fifo_shared_ring_t*)(base + ZX_FIFO_SHARED_RING_OFFSET(endpoint_b));
+    uint64_t* a_data = (uint64_t*)(base + ZX_FIFO_SHARED_DATA_OFFSET(endpoint_a));
+    uint64_t* b_data = (uint64_t*)(base + ZX_FIFO_SHARED_DATA_OFFSET(endpoint_b));
+
+    // entries written with the syscall show up in the ring and ring b's doorbell
+    EXPECT_EQ(a_to_b->consumer_waiting, 1u, "");
+    ASSERT_EQ(zx_fifo_write(a, n, sizeof(uint64_t) * 3, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 3u, "");
+    EXPECT_EQ(a_to_b->head, 3u, "");
+    EXPECT_EQ(a_to_b->consumer_waiting, 0u, "");
+    EXPECT_EQ(a_data[0], 1u, "");
+    EXPECT_EQ(a_data[2], 3u, "");
+    EXPECT_SIGNALS(b, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+
+    // consuming them through the ring makes room without a syscall
+    a_to_b->tail = 3u;
+    ASSERT_EQ(zx_fifo_write(a, n, sizeof(n), &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 8u, "");
+    EXPECT_EQ(a_to_b->head, 11u, "");
+
+    // a full ring makes the writer ask to be woken
+    ASSERT_EQ(zx_fifo_write(a, n, sizeof(n), &actual), ZX_ERR_SHOULD_WAIT, "");
+    EXPECT_EQ(a_to_b->producer_waiting, 1u, "");
+    EXPECT_SIGNALS(a, 0u);
+    a_to_b->tail = 11u;
+    a_to_b->producer_waiting = 0u;
+    ASSERT_EQ(zx_object_signal_peer(b, 0u, ZX_FIFO_WRITABLE), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_WRITABLE);
+
+    // entries written through the ring can be read with the syscall
+    EXPECT_EQ(b_to_a->consumer_waiting, 1u, "");
+    b_data[0] = 42u;
+    b_to_a->head = 1u;
+    b_to_a->consumer_waiting = 0u;
+    ASSERT_EQ(zx_object_signal_peer(b, 0u, ZX_FIFO_READABLE), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+    memset(n, 0, sizeof(n));
+    ASSERT_EQ(zx_fifo_read(a, n, sizeof(n), &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 1u, "");
+    EXPECT_EQ(n[0], 42u, "");
+    EXPECT_EQ(b_to_a->tail, 1u, "");
+
+    // draining the ring asks for the doorbell again
+    EXPECT_EQ(b_to_a->consumer_waiting, 1u, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_WRITABLE);
+
+    // indices that make no sense are refused
+    b_to_a->head = 100u;
+    EXPECT_EQ(zx_fifo_read(a, n, sizeof(n), &actual), ZX_ERR_BAD_STATE, "");
+
+    EXPECT_EQ(zx_vmar_unmap(zx_vmar_root_self(), addr, ZX_FIFO_SHARED_VMO_SIZE), ZX_OK, "");
+    zx_handle_close(b);
+    EXPECT_SIGNALS(a, ZX_FIFO_PEER_CLOSED);
+    zx_handle_close(a);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(fifo_tests)
 RUN_TEST(basic_test)
+RUN_TEST(shared_test)
 END_TEST_CASE(fifo_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -526,6 +526,71 @@ static bool test_event_signaling() {
     END_TEST;
 }
 
+// Pairs of threads ping-pong on a futex of their own, with more and more
+// pairs running at once.  The pairs share nothing but the process's futex
+// table, so the time per round trip should stay roughly flat as pairs are
+// added, at least until there are more threads than cpus.
+struct alignas(64) PingPong {
+    // 1 while it is the pong thread's turn, 0 while it is the ping thread's.
+    zx_futex_t state;
+};
+
+constexpr uint32_t kPingPongIterations = 2000;
+
+static void ping_pong_wait_while(zx_futex_t* futex, int value) {
+    while (__atomic_load_n(futex, __ATOMIC_ACQUIRE) == value)
+        zx_futex_wait(futex, value, ZX_TIME_INFINITE);
+}
+
+static void ping_pong_set(zx_futex_t* futex, int value) {
+    __atomic_store_n(futex, value, __ATOMIC_RELEASE);
+    zx_futex_wake(futex, 1);
+}
+
+static int ping_thread(void* arg) {
+    auto pair = static_cast<PingPong*>(arg);
+    for (uint32_t i = 0; i < kPingPongIterations; ++i) {
+        ping_pong_set(&pair->state, 1);
+        ping_pong_wait_while(&pair->state, 1);
+    }
+    return 0;
+}
+
+static int pong_thread(void* arg) {
+    auto pair = static_cast<PingPong*>(arg);
+    for (uint32_t i = 0; i < kPingPongIterations; ++i) {
+        ping_pong_wait_while(&pair->state, 0);
+        ping_pong_set(&pair->state, 0);
+    }
+    return 0;
+}
+
+static bool test_futex_independent_scaling() {
+    BEGIN_TEST;
+    constexpr uint32_t kMaxPairs = 8;
+    static PingPong pairs[kMaxPairs];
+
+    for (uint32_t num_pairs = 1; num_pairs <= kMaxPairs; num_pairs *= 2) {
+        thrd_t threads[kMaxPairs * 2];
+        zx_time_t start = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        for (uint32_t i = 0; i < num_pairs; ++i) {
+            pairs[i].state = 0;
+            ASSERT_EQ(thrd_create_with_name(&threads[i * 2], ping_thread, &pairs[i], "ping"),
+                      thrd_success);
+            ASSERT_EQ(thrd_create_with_name(&threads[i * 2 + 1], pong_thread, &pairs[i], "pong"),
+                      thrd_success);
+        }
+        for (uint32_t i = 0; i < num_pairs * 2; ++i)
+            ASSERT_EQ(thrd_join(threads[i], NULL), thrd_success);
+        zx_duration_t elapsed = zx_clock_get(ZX_CLOCK_MONOTONIC) - start;
+
+        unittest_printf("%u pairs: %" PRIu64 " ns per round trip\n",
+                        num_pairs, elapsed / kPingPongIterations);
+    }
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(futex_tests)
 RUN_TEST(test_futex_wait_value_mismatch);
 RUN_TEST(test_futex_wait_timeout);
@@ -545,6 +610,7 @@ RUN_TEST(test_futex_thread_killed);
 RUN_TEST(test_futex_thread_suspended);
 RUN_TEST(test_futex_misaligned);
 RUN_TEST(test_event_signaling);
+RUN_TEST(test_futex_independent_scaling);
 END_TEST_CASE(futex_tests)
 
 #ifndef BUILD_COMBINED_TESTS
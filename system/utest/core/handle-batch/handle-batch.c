@@ -0,0 +1,209 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
+#include <unittest/unittest.h>
+
+static bool is_valid(zx_handle_t handle) {
+    return zx_object_get_info(handle, ZX_INFO_HANDLE_VALID, NULL, 0u, NULL, NULL) == ZX_OK;
+}
+
+static zx_rights_t get_rights(zx_handle_t handle) {
+    zx_info_handle_basic_t info = {};
+    if (zx_object_get_info(handle, ZX_INFO_HANDLE_BASIC, &info, sizeof(info), NULL, NULL) != ZX_OK)
+        return 0u;
+    return info.rights;
+}
+
+// More than the kernel copies in at once.
+#define NUM_CLOSE_HANDLES 200u
+
+static bool close_many_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t handles[NUM_CLOSE_HANDLES];
+    for (size_t i = 0; i < NUM_CLOSE_HANDLES; i++) {
+        if (i % 7 == 3) {
+            handles[i] = ZX_HANDLE_INVALID;
+            continue;
+        }
+        ASSERT_EQ(zx_event_create(0u, &handles[i]), ZX_OK, "");
+    }
+
+    ASSERT_EQ(zx_handle_close_many(handles, NUM_CLOSE_HANDLES), ZX_OK, "");
+    for (size_t i = 0; i < NUM_CLOSE_HANDLES; i++) {
+        if (handles[i] != ZX_HANDLE_INVALID)
+            EXPECT_FALSE(is_valid(handles[i]), "handle should be closed");
+    }
+
+    ASSERT_EQ(zx_handle_close_many(NULL, 0u), ZX_OK, "");
+
+    END_TEST;
+}
+
+static bool close_many_bad_handle_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t handles[3];
+    ASSERT_EQ(zx_event_create(0u, &handles[0]), ZX_OK, "");
+    ASSERT_EQ(zx_event_create(0u, &handles[2]), ZX_OK, "");
+    // Closed twice.
+    handles[1] = handles[0];
+
+    // Every valid handle is still closed.
+    EXPECT_EQ(zx_handle_close_many(handles, 3u), ZX_ERR_BAD_HANDLE, "");
+    EXPECT_FALSE(is_valid(handles[0]), "");
+    EXPECT_FALSE(is_valid(handles[2]), "");
+
+    END_TEST;
+}
+
+static bool duplicate_many_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t handles[4];
+    zx_handle_t dups[4];
+    for (size_t i = 0; i < 4; i++)
+        ASSERT_EQ(zx_event_create(0u, &handles[i]), ZX_OK, "");
+
+    const zx_rights_t rights = ZX_RIGHT_DUPLICATE | ZX_RIGHT_TRANSFER;
+    ASSERT_EQ(zx_handle_duplicate_many(handles, 4u, rights, dups), ZX_OK, "");
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(is_valid(handles[i]), "original should remain");
+        EXPECT_NE(dups[i], handles[i], "");
+        EXPECT_EQ(get_rights(dups[i]), rights, "");
+    }
+
+    ASSERT_EQ(zx_handle_close_many(dups, 4u), ZX_OK, "");
+
+    // A single bad handle fails the whole call.
+    ASSERT_EQ(zx_handle_close(handles[3]), ZX_OK, "");
+    handles[3] = dups[0];
+    dups[0] = ZX_HANDLE_INVALID;
+    EXPECT_EQ(zx_handle_duplicate_many(handles, 4u, ZX_RIGHT_SAME_RIGHTS, dups),
+              ZX_ERR_BAD_HANDLE, "");
+    EXPECT_EQ(dups[0], ZX_HANDLE_INVALID, "nothing should be written");
+
+    // As does asking for more rights than a handle has.
+    EXPECT_EQ(zx_handle_duplicate_many(handles, 3u, ZX_RIGHT_DUPLICATE | ZX_RIGHT_EXECUTE, dups),
+              ZX_ERR_INVALID_ARGS, "");
+
+    zx_handle_t many[ZX_HANDLE_MAX_BATCH + 1] = {};
+    EXPECT_EQ(zx_handle_duplicate_many(many, ZX_HANDLE_MAX_BATCH + 1, ZX_RIGHT_SAME_RIGHTS, many),
+              ZX_ERR_OUT_OF_RANGE, "");
+
+    ASSERT_EQ(zx_handle_close_many(handles, 3u), ZX_OK, "");
+
+    END_TEST;
+}
+
+static bool replace_many_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t handles[4];
+    zx_handle_t replaced[4];
+    for (size_t i = 0; i < 4; i++)
+        ASSERT_EQ(zx_event_create(0u, &handles[i]), ZX_OK, "");
+
+    const zx_rights_t rights = ZX_RIGHT_TRANSFER | ZX_RIGHT_SIGNAL;
+    ASSERT_EQ(zx_handle_replace_many(handles, 4u, rights, replaced), ZX_OK, "");
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_FALSE(is_valid(handles[i]), "original should be gone");
+        EXPECT_EQ(get_rights(replaced[i]), rights, "");
+    }
+
+    // Replacing the same handle twice fails, and leaves every handle in
+    // place.
+    zx_handle_t twice[3] = {replaced[0], replaced[1], replaced[0]};
+    zx_handle_t out[3];
+    EXPECT_EQ(zx_handle_replace_many(twice, 3u, ZX_RIGHT_SAME_RIGHTS, out),
+              ZX_ERR_BAD_HANDLE, "");
+    for (size_t i = 0; i < 4; i++)
+        EXPECT_TRUE(is_valid(replaced[i]), "handle should remain");
+
+    // So does a bad output buffer.
+    EXPECT_EQ(zx_handle_replace_many(replaced, 4u, ZX_RIGHT_SAME_RIGHTS, (zx_handle_t*)1),
+              ZX_ERR_INVALID_ARGS, "");
+    for (size_t i = 0; i < 4; i++)
+        EXPECT_TRUE(is_valid(replaced[i]), "handle should remain");
+
+    ASSERT_EQ(zx_handle_close_many(replaced, 4u), ZX_OK, "");
+
+    END_TEST;
+}
+
+#define NUM_BENCH_HANDLES 256u
+#define NUM_BENCH_ROUNDS 20u
+
+// Reports the cost per handle of closing and duplicating handles one at a
+// time against doing it in batches.
+static bool handle_batch_benchmark(void) {
+    BEGIN_TEST;
+
+    static zx_handle_t handles[NUM_BENCH_HANDLES];
+    zx_handle_t event;
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+
+    uint64_t single_close = 0u;
+    uint64_t batch_close = 0u;
+    uint64_t single_dup = 0u;
+    uint64_t batch_dup = 0u;
+    for (uint32_t round = 0; round < NUM_BENCH_ROUNDS; round++) {
+        uint64_t start = zx_ticks_get();
+        for (size_t i = 0; i < NUM_BENCH_HANDLES; i++)
+            ASSERT_EQ(zx_handle_duplicate(event, ZX_RIGHT_SAME_RIGHTS, &handles[i]), ZX_OK, "");
+        single_dup += zx_ticks_get() - start;
+
+        start = zx_ticks_get();
+        for (size_t i = 0; i < NUM_BENCH_HANDLES; i++)
+            ASSERT_EQ(zx_handle_close(handles[i]), ZX_OK, "");
+        single_close += zx_ticks_get() - start;
+
+        zx_handle_t sources[ZX_HANDLE_MAX_BATCH];
+        for (size_t i = 0; i < ZX_HANDLE_MAX_BATCH; i++)
+            sources[i] = event;
+        start = zx_ticks_get();
+        for (size_t i = 0; i < NUM_BENCH_HANDLES; i += ZX_HANDLE_MAX_BATCH) {
+            ASSERT_EQ(zx_handle_duplicate_many(sources, ZX_HANDLE_MAX_BATCH,
+                                               ZX_RIGHT_SAME_RIGHTS, &handles[i]), ZX_OK, "");
+        }
+        batch_dup += zx_ticks_get() - start;
+
+        start = zx_ticks_get();
+        ASSERT_EQ(zx_handle_close_many(handles, NUM_BENCH_HANDLES), ZX_OK, "");
+        batch_close += zx_ticks_get() - start;
+    }
+
+    const double ns_per_tick = 1e9 / (double)zx_ticks_per_second();
+    const double count = (double)(NUM_BENCH_HANDLES * NUM_BENCH_ROUNDS);
+    unittest_printf("handle close: %.1f ns/handle, close_many: %.1f ns/handle\n",
+                    (double)single_close * ns_per_tick / count,
+                    (double)batch_close * ns_per_tick / count);
+    unittest_printf("handle duplicate: %.1f ns/handle, duplicate_many: %.1f ns/handle\n",
+                    (double)single_dup * ns_per_tick / count,
+                    (double)batch_dup * ns_per_tick / count);
+
+    ASSERT_EQ(zx_handle_close(event), ZX_OK, "");
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(handle_batch_tests)
+RUN_TEST(close_many_test)
+RUN_TEST(close_many_bad_handle_test)
+RUN_TEST(duplicate_many_test)
+RUN_TEST(replace_many_test)
+RUN_TEST(handle_batch_benchmark)
+END_TEST_CASE(handle_batch_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
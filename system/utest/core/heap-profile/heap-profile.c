@@ -0,0 +1,94 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unittest/unittest.h>
+#include <zircon/mtrace.h>
+#include <zircon/syscalls.h>
+
+extern zx_handle_t get_root_resource(void);
+
+static zx_status_t heap_control(uint32_t action, uint32_t options, void* ptr, uint32_t size) {
+    return zx_mtrace_control(get_root_resource(), MTRACE_KIND_HEAP, action, options, ptr, size);
+}
+
+// Makes the kernel allocate and free some heap memory.
+static bool churn_kernel_heap(void) {
+    BEGIN_TEST;
+    zx_handle_t channel[2];
+    ASSERT_EQ(zx_channel_create(0u, &channel[0], &channel[1]), ZX_OK, "");
+    static char bytes[2048];
+    for (int i = 0; i < 64; i++) {
+        ASSERT_EQ(zx_channel_write(channel[0], 0u, bytes, sizeof(bytes), NULL, 0u), ZX_OK, "");
+    }
+    zx_handle_close(channel[0]);
+    zx_handle_close(channel[1]);
+    END_TEST;
+}
+
+// Reads the profile and checks that it looks like a pprof heap profile.
+static bool check_profile(const char* expected_header) {
+    BEGIN_TEST;
+    uint32_t size = 0u;
+    ASSERT_EQ(heap_control(MTRACE_HEAP_GET_PROFILE_SIZE, 0u, &size, sizeof(size)), ZX_OK, "");
+    ASSERT_GT(size, 1u, "");
+
+    char small[8];
+    EXPECT_EQ(heap_control(MTRACE_HEAP_GET_PROFILE, 0u, small, sizeof(small)),
+              ZX_ERR_BUFFER_TOO_SMALL, "");
+
+    // The profile may grow between the two calls.
+    size += 4096u;
+    char* profile = malloc(size);
+    ASSERT_NONNULL(profile, "");
+    zx_status_t status = heap_control(MTRACE_HEAP_GET_PROFILE, 0u, profile, size);
+    EXPECT_EQ(status, ZX_OK, "");
+    if (status == ZX_OK) {
+        EXPECT_LT(strnlen(profile, size), (size_t)size, "profile is not NUL-terminated");
+        EXPECT_EQ(strncmp(profile, expected_header, strlen(expected_header)), 0,
+                  "bad profile header");
+        EXPECT_NONNULL(strstr(profile, "MAPPED_LIBRARIES:"), "");
+    }
+    free(profile);
+    END_TEST;
+}
+
+static bool heap_profile_start_stop_reset(void) {
+    BEGIN_TEST;
+
+    // Sample often, so that the churn below is likely to be caught.
+    ASSERT_EQ(heap_control(MTRACE_HEAP_START, 4096u, NULL, 0u), ZX_OK, "");
+    EXPECT_EQ(heap_control(MTRACE_HEAP_START, 4096u, NULL, 0u), ZX_ERR_BAD_STATE,
+              "started twice");
+    EXPECT_EQ(heap_control(MTRACE_HEAP_RESET, 0u, NULL, 0u), ZX_ERR_BAD_STATE,
+              "reset while sampling");
+
+    EXPECT_TRUE(churn_kernel_heap(), "");
+    EXPECT_TRUE(check_profile("heap profile: "), "");
+
+    EXPECT_EQ(heap_control(MTRACE_HEAP_STOP, 0u, NULL, 0u), ZX_OK, "");
+    // Stopped profiles can still be read, and samples are still retired.
+    EXPECT_TRUE(churn_kernel_heap(), "");
+    EXPECT_TRUE(check_profile("heap profile: "), "");
+
+    EXPECT_EQ(heap_control(MTRACE_HEAP_RESET, 0u, NULL, 0u), ZX_OK, "");
+    EXPECT_TRUE(check_profile("heap profile: 0: 0 [0: 0] @ heap_v2/"), "");
+
+    EXPECT_EQ(heap_control(MTRACE_HEAP_STOP, 1u, NULL, 0u), ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(heap_control(99u, 0u, NULL, 0u), ZX_ERR_INVALID_ARGS, "");
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(heap_profile_tests)
+RUN_TEST(heap_profile_start_stop_reset)
+END_TEST_CASE(heap_profile_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
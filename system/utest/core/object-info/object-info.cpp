@@ -14,6 +14,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define LOCAL_TRACE 0
 #define LTRACEF(str, x...)                                  \
@@ -893,6 +894,45 @@ bool handle_count_valid() {
     return true;
 }
 
+bool syscall_stats_smoke() {
+    BEGIN_TEST;
+    // How many syscalls this process has made depends on the tests that ran
+    // before this one, so size the buffer from a first query. That query
+    // also counts object_get_info, so the second finds nothing new.
+    size_t actual, avail;
+    ASSERT_EQ(zx_object_get_info(zx_process_self(), ZX_INFO_SYSCALL_STATS,
+                                 nullptr, 0u, &actual, &avail),
+              ZX_OK);
+    const size_t count = avail + 1;
+    zx_info_syscall_stats_t* stats =
+        static_cast<zx_info_syscall_stats_t*>(calloc(count, sizeof(*stats)));
+    ASSERT_NONNULL(stats);
+    zx_status_t status = zx_object_get_info(zx_process_self(), ZX_INFO_SYSCALL_STATS,
+                                            stats, count * sizeof(*stats), &actual, &avail);
+    if (status != ZX_OK)
+        free(stats);
+    ASSERT_EQ(status, ZX_OK);
+    EXPECT_EQ(actual, avail);
+
+    const zx_info_syscall_stats_t* get_info = nullptr;
+    for (size_t i = 0; i < actual; i++) {
+        EXPECT_GT(stats[i].count, 0u);
+        if (strcmp(stats[i].name, "object_get_info") == 0)
+            get_info = &stats[i];
+    }
+    EXPECT_NONNULL(get_info);
+    if (get_info != nullptr) {
+        EXPECT_GE(get_info->count, 1u);
+        EXPECT_GT(get_info->total_ns, 0u);
+
+        // Processes only get counts.
+        for (size_t i = 0; i < ZX_SYSCALL_STATS_NUM_BUCKETS; i++)
+            EXPECT_EQ(get_info->histogram[i], 0u);
+    }
+    free(stats);
+    END_TEST;
+}
+
 } // namespace
 
 // Tests that should pass for any topic. Use the wrappers below instead of
@@ -1011,6 +1051,13 @@ RUN_TEST((invalid_handle_fails<ZX_INFO_THREAD_EXCEPTION_REPORT, zx_exception_rep
 
 RUN_TEST(handle_count_valid);
 
+RUN_TEST(syscall_stats_smoke);
+RUN_MULTI_ENTRY_TESTS(ZX_INFO_SYSCALL_STATS, zx_info_syscall_stats_t, zx_process_self);
+RUN_TEST((wrong_handle_type_fails<ZX_INFO_SYSCALL_STATS, zx_info_syscall_stats_t, get_test_job>));
+RUN_TEST((wrong_handle_type_fails<ZX_INFO_SYSCALL_STATS, zx_info_syscall_stats_t, zx_thread_self>));
+RUN_TEST((missing_rights_fails<ZX_INFO_SYSCALL_STATS, zx_info_syscall_stats_t, get_test_process,
+                               ZX_RIGHT_READ>));
+
 END_TEST_CASE(object_info_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -736,6 +736,68 @@ static bool cancel_stress() {
     END_TEST;
 }
 
+static bool wait_many_test() {
+    BEGIN_TEST;
+
+    zx_handle_t port;
+    ASSERT_EQ(zx_port_create(0u, &port), ZX_OK);
+
+    zx_port_packet_t out[ZX_PORT_WAIT_MANY_MAX_PACKETS] = {};
+    uint32_t actual = 0u;
+
+    EXPECT_EQ(zx_port_wait_many(port, 0u, out, 0u, &actual), ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(zx_port_wait_many(port, 0u, out, ZX_PORT_WAIT_MANY_MAX_PACKETS + 1u, &actual),
+              ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(zx_port_wait_many(port, zx_deadline_after(ZX_MSEC(1)), out,
+                                ZX_PORT_WAIT_MANY_MAX_PACKETS, &actual),
+              ZX_ERR_TIMED_OUT);
+
+    // Queue more packets than fit in one batch.
+    const uint32_t kNumPackets = ZX_PORT_WAIT_MANY_MAX_PACKETS + 3u;
+    for (uint32_t ix = 0; ix != kNumPackets; ++ix) {
+        zx_port_packet_t in = {};
+        in.key = ix;
+        in.user.u32[0] = ix * 2u;
+        ASSERT_EQ(zx_port_queue(port, &in, 0u), ZX_OK);
+    }
+
+    // A signal packet is delivered along with the user packets, in order.
+    zx_handle_t event;
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+    ASSERT_EQ(zx_object_wait_async(event, port, 1000u, ZX_EVENT_SIGNALED,
+                                   ZX_WAIT_ASYNC_ONCE), ZX_OK);
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_EVENT_SIGNALED), ZX_OK);
+
+    // The first call fills the whole array.
+    ASSERT_EQ(zx_port_wait_many(port, 0u, out, ZX_PORT_WAIT_MANY_MAX_PACKETS, &actual), ZX_OK);
+    ASSERT_EQ(actual, ZX_PORT_WAIT_MANY_MAX_PACKETS);
+    for (uint32_t ix = 0; ix != actual; ++ix) {
+        EXPECT_EQ(out[ix].key, ix);
+        EXPECT_EQ(out[ix].type, ZX_PKT_TYPE_USER);
+        EXPECT_EQ(out[ix].user.u32[0], ix * 2u);
+    }
+
+    // The second returns only what is left.
+    ASSERT_EQ(zx_port_wait_many(port, ZX_TIME_INFINITE, out,
+                                ZX_PORT_WAIT_MANY_MAX_PACKETS, &actual), ZX_OK);
+    ASSERT_EQ(actual, 4u);
+    for (uint32_t ix = 0; ix != 3u; ++ix)
+        EXPECT_EQ(out[ix].key, ZX_PORT_WAIT_MANY_MAX_PACKETS + ix);
+    EXPECT_EQ(out[3].key, 1000u);
+    EXPECT_EQ(out[3].type, ZX_PKT_TYPE_SIGNAL_ONE);
+    EXPECT_EQ(out[3].signal.observed & ZX_EVENT_SIGNALED, ZX_EVENT_SIGNALED);
+
+    // The port is now empty, even though the kernel handed out several
+    // packets per wait.
+    EXPECT_EQ(zx_port_wait_many(port, 0u, out, 1u, nullptr), ZX_ERR_TIMED_OUT);
+    EXPECT_EQ(zx_port_wait(port, 0u, out, 1u), ZX_ERR_TIMED_OUT);
+
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_handle_close(port), ZX_OK);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(port_tests)
 RUN_TEST(basic_test)
 RUN_TEST(queue_count_valid_test<0u>)
@@ -747,6 +809,7 @@ RUN_TEST(wait_count_valid_test<1u>)
 RUN_TEST(wait_count_invalid_test<2u>)
 RUN_TEST(wait_count_invalid_test<23u>)
 RUN_TEST(queue_and_close_test)
+RUN_TEST(wait_many_test)
 RUN_TEST(async_wait_channel_test)
 RUN_TEST(async_wait_event_test_single)
 RUN_TEST(async_wait_event_test_repeat)
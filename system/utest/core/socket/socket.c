@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static zx_signals_t get_satisfied_signals(zx_handle_t handle) {
@@ -475,6 +476,59 @@ static bool socket_short_write(void) {
     END_TEST;
 }
 
+// Whole pages of stream data are moved into page aligned read buffers. The
+// data must be the same as with the copy path, including a partial page at
+// the end, and must not change if the writer reuses its buffer.
+static bool socket_page_aligned_read(void) {
+    BEGIN_TEST;
+
+    const size_t size = 8 * PAGE_SIZE + 100;
+    uint8_t* wr_buf = malloc(size);
+    ASSERT_NONNULL(wr_buf, "");
+    void* aligned = NULL;
+    ASSERT_EQ(posix_memalign(&aligned, PAGE_SIZE, 2 * size), 0, "");
+    uint8_t* rd_aligned = aligned;
+    // Offset by one byte so the kernel has to copy.
+    uint8_t* rd_unaligned = rd_aligned + size + 1;
+
+    zx_handle_t h0, h1;
+    ASSERT_EQ(zx_socket_create(0, &h0, &h1), ZX_OK, "");
+
+    for (size_t i = 0; i < size; i++)
+        wr_buf[i] = (uint8_t)i;
+    size_t actual = 0;
+    ASSERT_EQ(zx_socket_write(h0, 0u, wr_buf, size, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, size, "");
+    ASSERT_EQ(zx_socket_write(h0, 0u, wr_buf, size, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, size, "");
+    memset(wr_buf, 0xff, size);
+
+    // Touch the aligned buffer so that the pages being replaced are committed.
+    memset(rd_aligned, 0, size);
+
+    ASSERT_EQ(zx_socket_read(h1, 0u, rd_aligned, size, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, size, "");
+    ASSERT_EQ(zx_socket_read(h1, 0u, rd_unaligned, size - 1, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, size - 1, "");
+    for (size_t i = 0; i < size; i++) {
+        if (rd_aligned[i] != (uint8_t)i) {
+            ASSERT_EQ(rd_aligned[i], (uint8_t)i, "aligned read data mismatch");
+        }
+    }
+    for (size_t i = 0; i < size - 1; i++) {
+        if (rd_unaligned[i] != (uint8_t)i) {
+            ASSERT_EQ(rd_unaligned[i], (uint8_t)i, "unaligned read data mismatch");
+        }
+    }
+
+    free(aligned);
+    free(wr_buf);
+    zx_handle_close(h0);
+    zx_handle_close(h1);
+
+    END_TEST;
+}
+
 static bool socket_datagram(void) {
     BEGIN_TEST;
 
@@ -808,6 +862,7 @@ RUN_TEST(socket_bytes_outstanding)
 RUN_TEST(socket_bytes_outstanding_shutdown_write)
 RUN_TEST(socket_bytes_outstanding_shutdown_read)
 RUN_TEST(socket_short_write)
+RUN_TEST(socket_page_aligned_read)
 RUN_TEST(socket_datagram)
 RUN_TEST(socket_datagram_no_short_write)
 RUN_TEST(socket_control_plane_absent)
@@ -25,8 +25,45 @@ static bool elapsed_time_using_ticks(void) {
     END_TEST;
 }
 
+// zx_clock_get() is usually answered by the vDSO; make sure it still
+// behaves like a single clock.
+static bool clock_get_is_monotonic(void) {
+    BEGIN_TEST;
+
+    zx_time_t last = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    ASSERT_GT(last, 0u, "Invalid monotonic time");
+    for (int i = 0; i < 100000; i++) {
+        zx_time_t now = zx_clock_get(ZX_CLOCK_MONOTONIC);
+        ASSERT_GE(now, last, "Monotonic time went backwards");
+        last = now;
+    }
+
+    // A sleep is timed by the kernel's own clock.
+    zx_time_t deadline = zx_deadline_after(ZX_MSEC(1));
+    ASSERT_EQ(zx_nanosleep(deadline), ZX_OK, "");
+    ASSERT_GE(zx_clock_get(ZX_CLOCK_MONOTONIC), deadline, "Woke up early");
+
+    END_TEST;
+}
+
+static bool clock_get_utc_tracks_monotonic(void) {
+    BEGIN_TEST;
+
+    zx_time_t mono = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    zx_time_t utc = zx_clock_get(ZX_CLOCK_UTC);
+    zx_time_t mono_after = zx_clock_get(ZX_CLOCK_MONOTONIC);
+    int64_t offset = (int64_t)(utc - mono);
+    int64_t offset_after = (int64_t)(utc - mono_after);
+    ASSERT_GE(offset, offset_after, "");
+    ASSERT_LE(offset - offset_after, (int64_t)ZX_SEC(1), "UTC and monotonic disagree");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(ticks_tests)
 RUN_TEST(elapsed_time_using_ticks)
+RUN_TEST(clock_get_is_monotonic)
+RUN_TEST(clock_get_utc_tracks_monotonic)
 END_TEST_CASE(ticks_tests)
 
 #ifndef BUILD_COMBINED_TESTS
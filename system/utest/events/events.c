@@ -279,12 +279,63 @@ static bool wait_many_failures_test(void) {
     END_TEST;
 }
 
+static int thread_fn_signaler(void* arg) {
+    zx_nanosleep(zx_deadline_after(ZX_MSEC(200)));
+    zx_handle_t handle = *((zx_handle_t*)arg);
+    zx_object_signal(handle, 0u, ZX_EVENT_SIGNALED);
+    return 0;
+}
+
+static bool wait_many_max_items_test(void) {
+    BEGIN_TEST;
+
+    static zx_handle_t events[ZX_WAIT_MANY_MAX_ITEMS + 1];
+    static zx_wait_item_t items[ZX_WAIT_MANY_MAX_ITEMS + 1];
+    for (size_t ix = 0; ix < countof(items); ++ix) {
+        ASSERT_EQ(zx_event_create(0u, &events[ix]), ZX_OK, "Error during event create");
+        items[ix].handle = events[ix];
+        items[ix].waitfor = ZX_EVENT_SIGNALED;
+    }
+
+    ASSERT_EQ(zx_object_wait_many(items, ZX_WAIT_MANY_MAX_ITEMS + 1, 0u),
+              ZX_ERR_OUT_OF_RANGE, "");
+
+    ASSERT_EQ(zx_object_wait_many(items, ZX_WAIT_MANY_MAX_ITEMS, zx_deadline_after(1u)),
+              ZX_ERR_TIMED_OUT, "wait should have timeout");
+    for (size_t ix = 0; ix < ZX_WAIT_MANY_MAX_ITEMS; ++ix)
+        ASSERT_EQ(items[ix].pending, 0u, "");
+
+    // Already signaled.
+    const size_t last = ZX_WAIT_MANY_MAX_ITEMS - 1;
+    ASSERT_EQ(zx_object_signal(events[last], 0u, ZX_EVENT_SIGNALED), ZX_OK, "");
+    ASSERT_EQ(zx_object_wait_many(items, ZX_WAIT_MANY_MAX_ITEMS, ZX_TIME_INFINITE), ZX_OK, "");
+    for (size_t ix = 0; ix < ZX_WAIT_MANY_MAX_ITEMS; ++ix)
+        ASSERT_EQ(items[ix].pending, ix == last ? ZX_EVENT_SIGNALED : 0u, "");
+    ASSERT_EQ(zx_object_signal(events[last], ZX_EVENT_SIGNALED, 0u), ZX_OK, "");
+
+    // Signaled while waiting.
+    const size_t middle = ZX_WAIT_MANY_MAX_ITEMS / 2;
+    thrd_t thread;
+    ASSERT_EQ(thrd_create_with_name(&thread, thread_fn_signaler, &events[middle], "signaler"),
+              thrd_success, "Error during thread creation");
+    ASSERT_EQ(zx_object_wait_many(items, ZX_WAIT_MANY_MAX_ITEMS, ZX_TIME_INFINITE), ZX_OK, "");
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "Error during thread join");
+    for (size_t ix = 0; ix < ZX_WAIT_MANY_MAX_ITEMS; ++ix)
+        ASSERT_EQ(items[ix].pending, ix == middle ? ZX_EVENT_SIGNALED : 0u, "");
+
+    for (size_t ix = 0; ix < countof(events); ++ix)
+        ASSERT_EQ(zx_handle_close(events[ix]), ZX_OK, "Error during handle close");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(event_tests)
 RUN_TEST(basic_test)
 RUN_TEST(user_signals_test)
 RUN_TEST(wait_signals_test)
 RUN_TEST(reset_test)
 RUN_TEST(wait_many_failures_test)
+RUN_TEST(wait_many_max_items_test)
 END_TEST_CASE(event_tests)
 
 int main(int argc, char** argv) {
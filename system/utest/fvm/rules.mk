@@ -19,6 +19,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/fs \
     system/ulib/gpt \
     system/ulib/digest \
+    system/ulib/shared-fifo \
     system/ulib/zx \
     system/ulib/zxcpp \
     system/ulib/fbl \
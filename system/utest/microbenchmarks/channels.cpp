@@ -0,0 +1,151 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+#include <threads.h>
+
+#include <fbl/unique_ptr.h>
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+// Writes a message to one end of a channel and reads it from the other.
+bool ChannelWriteRead(perftest::RepeatState* state, uint32_t size) {
+    state->SetBytesProcessedPerRun(size);
+    zx_handle_t channel[2];
+    if (zx_channel_create(0, &channel[0], &channel[1]) != ZX_OK)
+        return false;
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[size]());
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        uint32_t actual_bytes;
+        ok = zx_channel_write(channel[0], 0, buffer.get(), size, nullptr, 0) == ZX_OK &&
+             zx_channel_read(channel[1], 0, buffer.get(), nullptr, size, 0, &actual_bytes,
+                             nullptr) == ZX_OK &&
+             actual_bytes == size;
+    }
+    zx_handle_close(channel[0]);
+    zx_handle_close(channel[1]);
+    return ok;
+}
+
+// Moves a batch of small messages, either one syscall per message or one
+// per batch.
+bool ChannelWriteReadBatch(perftest::RepeatState* state, bool batched) {
+    constexpr uint32_t kMsgSize = 64;
+    constexpr uint32_t kCount = ZX_CHANNEL_MAX_BATCH_MSGS;
+    state->SetBytesProcessedPerRun(kMsgSize * kCount);
+    zx_handle_t channel[2];
+    if (zx_channel_create(0, &channel[0], &channel[1]) != ZX_OK)
+        return false;
+    uint8_t buffers[kCount][kMsgSize] = {};
+    zx_channel_msg_t msgs[kCount];
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        if (batched) {
+            for (uint32_t i = 0; i < kCount; i++)
+                msgs[i] = zx_channel_msg_t{buffers[i], nullptr, kMsgSize, 0};
+            uint32_t actual_count;
+            ok = zx_channel_write_etc_many(channel[0], 0, msgs, kCount) == ZX_OK &&
+                 zx_channel_read_many(channel[1], 0, msgs, kCount, &actual_count) == ZX_OK &&
+                 actual_count == kCount;
+        } else {
+            for (uint32_t i = 0; ok && i < kCount; i++) {
+                ok = zx_channel_write(channel[0], 0, buffers[i], kMsgSize, nullptr, 0) == ZX_OK;
+            }
+            for (uint32_t i = 0; ok && i < kCount; i++) {
+                ok = zx_channel_read(channel[1], 0, buffers[i], nullptr, kMsgSize, 0, nullptr,
+                                     nullptr) == ZX_OK;
+            }
+        }
+    }
+    zx_handle_close(channel[0]);
+    zx_handle_close(channel[1]);
+    return ok;
+}
+
+// Answers every message on the channel with the same message, until the
+// peer closes.
+int EchoThread(void* arg) {
+    zx_handle_t channel = *static_cast<zx_handle_t*>(arg);
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[ZX_CHANNEL_MAX_MSG_BYTES]);
+    for (;;) {
+        zx_signals_t observed;
+        if (zx_object_wait_one(channel, ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
+                               ZX_TIME_INFINITE, &observed) != ZX_OK ||
+            !(observed & ZX_CHANNEL_READABLE))
+            break;
+        uint32_t actual_bytes;
+        if (zx_channel_read(channel, 0, buffer.get(), nullptr, ZX_CHANNEL_MAX_MSG_BYTES, 0,
+                            &actual_bytes, nullptr) != ZX_OK ||
+            zx_channel_write(channel, 0, buffer.get(), actual_bytes, nullptr, 0) != ZX_OK)
+            break;
+    }
+    zx_handle_close(channel);
+    return 0;
+}
+
+// The round trip of a zx_channel_call() to another thread, which includes
+// waking it and being woken by it.
+bool ChannelCall(perftest::RepeatState* state, uint32_t size) {
+    zx_handle_t client;
+    zx_handle_t server;
+    if (zx_channel_create(0, &client, &server) != ZX_OK)
+        return false;
+    thrd_t thread;
+    if (thrd_create(&thread, EchoThread, &server) != thrd_success) {
+        zx_handle_close(client);
+        zx_handle_close(server);
+        return false;
+    }
+    fbl::unique_ptr<uint8_t[]> request(new uint8_t[size]());
+    fbl::unique_ptr<uint8_t[]> reply(new uint8_t[size]);
+    zx_channel_call_args_t args = {};
+    args.wr_bytes = request.get();
+    args.wr_num_bytes = size;
+    args.rd_bytes = reply.get();
+    args.rd_num_bytes = size;
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        uint32_t actual_bytes;
+        uint32_t actual_handles;
+        ok = zx_channel_call(client, 0, ZX_TIME_INFINITE, &args, &actual_bytes,
+                             &actual_handles, nullptr) == ZX_OK &&
+             actual_bytes == size;
+    }
+    // Closing our end stops the echo thread, which closes the other end.
+    zx_handle_close(client);
+    thrd_join(thread, nullptr);
+    return ok;
+}
+
+void RegisterTests() {
+    static const uint32_t kSizes[] = {64, 1024, 32 * 1024, ZX_CHANNEL_MAX_MSG_BYTES};
+    for (uint32_t size : kSizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "Channel/WriteRead/%ubytes", size);
+        perftest::RegisterTest(name, [size](perftest::RepeatState* state) {
+            return ChannelWriteRead(state, size);
+        });
+    }
+    perftest::RegisterTest("Channel/WriteRead/16x64bytes", [](perftest::RepeatState* state) {
+        return ChannelWriteReadBatch(state, false);
+    });
+    perftest::RegisterTest("Channel/WriteReadMany/16x64bytes", [](perftest::RepeatState* state) {
+        return ChannelWriteReadBatch(state, true);
+    });
+    // The txid at the start of each message takes 4 bytes.
+    static const uint32_t kCallSizes[] = {4, 1024};
+    for (uint32_t size : kCallSizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "Channel/CallRoundTrip/%ubytes", size);
+        perftest::RegisterTest(name, [size](perftest::RepeatState* state) {
+            return ChannelCall(state, size);
+        });
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
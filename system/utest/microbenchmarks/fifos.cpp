@@ -0,0 +1,71 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <perftest/perftest.h>
+#include <shared-fifo/shared-fifo.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+constexpr uint32_t kElemCount = 64;
+constexpr uint32_t kElemSize = 16;
+
+// Writes |batch| entries to one end of a fifo and reads them from the
+// other. With |shared|, the fifo is created with ZX_FIFO_SHARED and the
+// entries move through mapped rings rather than syscalls.
+bool FifoWriteRead(perftest::RepeatState* state, uint32_t batch, bool shared) {
+    state->SetBytesProcessedPerRun(batch * kElemSize);
+    zx_handle_t handles[2];
+    if (zx_fifo_create(kElemCount, kElemSize, shared ? ZX_FIFO_SHARED : 0,
+                       &handles[0], &handles[1]) != ZX_OK)
+        return false;
+    shared_fifo_t fifo[2];
+    if (shared_fifo_init(&fifo[0], handles[0], kElemCount, kElemSize) != ZX_OK) {
+        zx_handle_close(handles[0]);
+        zx_handle_close(handles[1]);
+        return false;
+    }
+    if (shared_fifo_init(&fifo[1], handles[1], kElemCount, kElemSize) != ZX_OK) {
+        shared_fifo_destroy(&fifo[0]);
+        zx_handle_close(handles[0]);
+        zx_handle_close(handles[1]);
+        return false;
+    }
+    bool ok = !shared || (shared_fifo_is_mapped(&fifo[0]) && shared_fifo_is_mapped(&fifo[1]));
+
+    uint8_t buffer[kElemCount * kElemSize] = {};
+    while (ok && state->KeepRunning()) {
+        uint32_t written;
+        uint32_t read;
+        ok = shared_fifo_write(&fifo[0], buffer, batch * kElemSize, &written) == ZX_OK &&
+             written == batch &&
+             shared_fifo_read(&fifo[1], buffer, batch * kElemSize, &read) == ZX_OK &&
+             read == batch;
+    }
+    shared_fifo_destroy(&fifo[0]);
+    shared_fifo_destroy(&fifo[1]);
+    zx_handle_close(handles[0]);
+    zx_handle_close(handles[1]);
+    return ok;
+}
+
+void RegisterTests() {
+    static const uint32_t kBatches[] = {1, 16};
+    for (uint32_t batch : kBatches) {
+        char name[64];
+        snprintf(name, sizeof(name), "Fifo/WriteRead/%ux%ubytes", batch, kElemSize);
+        perftest::RegisterTest(name, [batch](perftest::RepeatState* state) {
+            return FifoWriteRead(state, batch, false);
+        });
+        snprintf(name, sizeof(name), "Fifo/Shared/WriteRead/%ux%ubytes", batch, kElemSize);
+        perftest::RegisterTest(name, [batch](perftest::RepeatState* state) {
+            return FifoWriteRead(state, batch, true);
+        });
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
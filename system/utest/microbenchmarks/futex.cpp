@@ -0,0 +1,70 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+// Whose turn it is in a futex ping-pong.
+enum : int {
+    kMainTurn = 0,
+    kThreadTurn = 1,
+    kStop = 2,
+};
+
+void SetTurn(zx_futex_t* futex, int turn) {
+    __atomic_store_n(futex, turn, __ATOMIC_RELEASE);
+    zx_futex_wake(futex, 1);
+}
+
+// Waits for |futex| to stop holding |value|, and returns its new value.
+int WaitWhile(zx_futex_t* futex, int value) {
+    int current;
+    while ((current = __atomic_load_n(futex, __ATOMIC_ACQUIRE)) == value)
+        zx_futex_wait(futex, value, ZX_TIME_INFINITE);
+    return current;
+}
+
+int PongThread(void* arg) {
+    zx_futex_t* futex = static_cast<zx_futex_t*>(arg);
+    while (WaitWhile(futex, kMainTurn) == kThreadTurn)
+        SetTurn(futex, kMainTurn);
+    return 0;
+}
+
+// Hands the turn to another thread blocked in zx_futex_wait() and waits for
+// it to be handed back, so each run is two cross-thread wakeups.
+bool FutexPingPong(perftest::RepeatState* state) {
+    zx_futex_t futex = kMainTurn;
+    thrd_t thread;
+    if (thrd_create(&thread, PongThread, &futex) != thrd_success)
+        return false;
+    while (state->KeepRunning()) {
+        SetTurn(&futex, kThreadTurn);
+        WaitWhile(&futex, kThreadTurn);
+    }
+    SetTurn(&futex, kStop);
+    thrd_join(thread, nullptr);
+    return true;
+}
+
+// A wake with no waiters, which is all an uncontended unlock costs.
+bool FutexWakeNoWaiters(perftest::RepeatState* state) {
+    zx_futex_t futex = 0;
+    bool ok = true;
+    while (ok && state->KeepRunning())
+        ok = zx_futex_wake(&futex, 1) == ZX_OK;
+    return ok;
+}
+
+void RegisterTests() {
+    perftest::RegisterTest("Futex/PingPong", FutexPingPong);
+    perftest::RegisterTest("Futex/WakeNoWaiters", FutexWakeNoWaiters);
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
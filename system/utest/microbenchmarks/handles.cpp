@@ -0,0 +1,84 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+bool EventCreateClose() {
+    zx_handle_t event;
+    if (zx_event_create(0, &event) != ZX_OK)
+        return false;
+    return zx_handle_close(event) == ZX_OK;
+}
+
+bool HandleDuplicateClose(perftest::RepeatState* state) {
+    zx_handle_t event;
+    if (zx_event_create(0, &event) != ZX_OK)
+        return false;
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        zx_handle_t dup;
+        ok = zx_handle_duplicate(event, ZX_RIGHT_SAME_RIGHTS, &dup) == ZX_OK &&
+             zx_handle_close(dup) == ZX_OK;
+    }
+    zx_handle_close(event);
+    return ok;
+}
+
+bool HandleReplace(perftest::RepeatState* state) {
+    zx_handle_t event;
+    if (zx_event_create(0, &event) != ZX_OK)
+        return false;
+    bool ok = true;
+    while (ok && state->KeepRunning())
+        ok = zx_handle_replace(event, ZX_RIGHT_SAME_RIGHTS, &event) == ZX_OK;
+    zx_handle_close(event);
+    return ok;
+}
+
+// Duplicates and closes a batch of handles, either one syscall per handle
+// or one per batch.
+bool HandleDuplicateCloseBatch(perftest::RepeatState* state, bool batched) {
+    zx_handle_t events[ZX_HANDLE_MAX_BATCH];
+    zx_handle_t dups[ZX_HANDLE_MAX_BATCH];
+    for (uint32_t i = 0; i < ZX_HANDLE_MAX_BATCH; i++) {
+        if (zx_event_create(0, &events[i]) != ZX_OK) {
+            zx_handle_close_many(events, i);
+            return false;
+        }
+    }
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        if (batched) {
+            ok = zx_handle_duplicate_many(events, ZX_HANDLE_MAX_BATCH, ZX_RIGHT_SAME_RIGHTS,
+                                          dups) == ZX_OK &&
+                 zx_handle_close_many(dups, ZX_HANDLE_MAX_BATCH) == ZX_OK;
+        } else {
+            for (uint32_t i = 0; ok && i < ZX_HANDLE_MAX_BATCH; i++) {
+                ok = zx_handle_duplicate(events[i], ZX_RIGHT_SAME_RIGHTS, &dups[i]) == ZX_OK &&
+                     zx_handle_close(dups[i]) == ZX_OK;
+            }
+        }
+    }
+    zx_handle_close_many(events, ZX_HANDLE_MAX_BATCH);
+    return ok;
+}
+
+void RegisterTests() {
+    perftest::RegisterSimpleTest<EventCreateClose>("Handle/EventCreateClose");
+    perftest::RegisterTest("Handle/DuplicateClose", HandleDuplicateClose);
+    perftest::RegisterTest("Handle/Replace", HandleReplace);
+    perftest::RegisterTest("Handle/DuplicateClose/64handles", [](perftest::RepeatState* state) {
+        return HandleDuplicateCloseBatch(state, false);
+    });
+    perftest::RegisterTest("Handle/DuplicateCloseMany/64handles",
+                           [](perftest::RepeatState* state) {
+                               return HandleDuplicateCloseBatch(state, true);
+                           });
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
@@ -0,0 +1,116 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
+
+namespace {
+
+constexpr uint64_t kPingKey = 1;
+constexpr uint64_t kStopKey = 2;
+
+bool PortQueueWait(perftest::RepeatState* state) {
+    zx_handle_t port;
+    if (zx_port_create(0, &port) != ZX_OK)
+        return false;
+    zx_port_packet_t packet = {};
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        ok = zx_port_queue(port, &packet, 0u) == ZX_OK &&
+             zx_port_wait(port, ZX_TIME_INFINITE, &packet, 0u) == ZX_OK;
+    }
+    zx_handle_close(port);
+    return ok;
+}
+
+// Queues a batch of packets and dequeues them, either one wait per packet
+// or one per batch.
+bool PortQueueWaitBatch(perftest::RepeatState* state, bool batched) {
+    constexpr uint32_t kCount = ZX_PORT_WAIT_MANY_MAX_PACKETS;
+    zx_handle_t port;
+    if (zx_port_create(0, &port) != ZX_OK)
+        return false;
+    zx_port_packet_t packets[kCount] = {};
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        for (uint32_t i = 0; ok && i < kCount; i++)
+            ok = zx_port_queue(port, &packets[i], 0u) == ZX_OK;
+        if (batched) {
+            uint32_t actual_count;
+            ok = ok && zx_port_wait_many(port, ZX_TIME_INFINITE, packets, kCount,
+                                         &actual_count) == ZX_OK &&
+                 actual_count == kCount;
+        } else {
+            for (uint32_t i = 0; ok && i < kCount; i++)
+                ok = zx_port_wait(port, ZX_TIME_INFINITE, &packets[i], 0u) == ZX_OK;
+        }
+    }
+    zx_handle_close(port);
+    return ok;
+}
+
+struct PingPong {
+    zx_handle_t ping;
+    zx_handle_t pong;
+};
+
+int PongThread(void* arg) {
+    PingPong* ports = static_cast<PingPong*>(arg);
+    for (;;) {
+        zx_port_packet_t packet;
+        if (zx_port_wait(ports->ping, ZX_TIME_INFINITE, &packet, 0u) != ZX_OK ||
+            packet.key == kStopKey ||
+            zx_port_queue(ports->pong, &packet, 0u) != ZX_OK)
+            break;
+    }
+    return 0;
+}
+
+// Wakes a thread blocked on one port and is woken in turn through another,
+// so each run is two cross-thread wakeups.
+bool PortPingPong(perftest::RepeatState* state) {
+    PingPong ports;
+    if (zx_port_create(0, &ports.ping) != ZX_OK)
+        return false;
+    if (zx_port_create(0, &ports.pong) != ZX_OK) {
+        zx_handle_close(ports.ping);
+        return false;
+    }
+    thrd_t thread;
+    if (thrd_create(&thread, PongThread, &ports) != thrd_success) {
+        zx_handle_close(ports.ping);
+        zx_handle_close(ports.pong);
+        return false;
+    }
+    zx_port_packet_t packet = {};
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        packet.key = kPingKey;
+        ok = zx_port_queue(ports.ping, &packet, 0u) == ZX_OK &&
+             zx_port_wait(ports.pong, ZX_TIME_INFINITE, &packet, 0u) == ZX_OK;
+    }
+    packet.key = kStopKey;
+    zx_port_queue(ports.ping, &packet, 0u);
+    thrd_join(thread, nullptr);
+    zx_handle_close(ports.ping);
+    zx_handle_close(ports.pong);
+    return ok;
+}
+
+void RegisterTests() {
+    perftest::RegisterTest("Port/QueueWait", PortQueueWait);
+    perftest::RegisterTest("Port/QueueWait/16packets", [](perftest::RepeatState* state) {
+        return PortQueueWaitBatch(state, false);
+    });
+    perftest::RegisterTest("Port/QueueWaitMany/16packets", [](perftest::RepeatState* state) {
+        return PortQueueWaitBatch(state, true);
+    });
+    perftest::RegisterTest("Port/PingPong", PortPingPong);
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
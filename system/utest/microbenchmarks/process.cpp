@@ -0,0 +1,75 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+#include <threads.h>
+
+#include <mini-process/mini-process.h>
+#include <perftest/perftest.h>
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+const char kName[] = "perftest";
+
+bool ProcessCreateClose() {
+    zx_handle_t process;
+    zx_handle_t vmar;
+    if (zx_process_create(zx_job_default(), kName, sizeof(kName) - 1, 0, &process,
+                          &vmar) != ZX_OK)
+        return false;
+    zx_handle_close(vmar);
+    return zx_handle_close(process) == ZX_OK;
+}
+
+// Starts a process that does nothing, kills it and waits for it to be torn
+// down. This is the kernel's share of starting a program, without loading
+// one.
+bool ProcessStartKill() {
+    zx_handle_t event;
+    if (zx_event_create(0, &event) != ZX_OK)
+        return false;
+    zx_handle_t process;
+    zx_handle_t thread;
+    if (start_mini_process(zx_job_default(), event, &process, &thread) != ZX_OK)
+        return false;
+    bool ok = zx_task_kill(process) == ZX_OK &&
+              zx_object_wait_one(process, ZX_PROCESS_TERMINATED, ZX_TIME_INFINITE,
+                                 nullptr) == ZX_OK;
+    zx_handle_close(thread);
+    zx_handle_close(process);
+    return ok;
+}
+
+// Creates a kernel thread object without starting it.
+bool ThreadCreateClose() {
+    zx_handle_t thread;
+    if (zx_thread_create(zx_process_self(), kName, sizeof(kName) - 1, 0, &thread) != ZX_OK)
+        return false;
+    return zx_handle_close(thread) == ZX_OK;
+}
+
+int ThreadExit(void* arg) {
+    return 0;
+}
+
+// Starts a C11 thread that returns at once and joins it, which includes
+// setting up and tearing down its stacks and thread-local storage.
+bool ThreadCreateJoin() {
+    thrd_t thread;
+    if (thrd_create(&thread, ThreadExit, nullptr) != thrd_success)
+        return false;
+    return thrd_join(thread, nullptr) == thrd_success;
+}
+
+void RegisterTests() {
+    perftest::RegisterSimpleTest<ProcessCreateClose>("Process/CreateClose");
+    perftest::RegisterSimpleTest<ProcessStartKill>("Process/StartKill");
+    perftest::RegisterSimpleTest<ThreadCreateClose>("Thread/CreateClose");
+    perftest::RegisterSimpleTest<ThreadCreateJoin>("Thread/CreateJoin");
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
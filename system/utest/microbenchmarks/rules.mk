@@ -0,0 +1,38 @@
+# Copyright 2018 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := usertest
+
+MODULE_SRCS := \
+    $(LOCAL_DIR)/channels.cpp \
+    $(LOCAL_DIR)/fifos.cpp \
+    $(LOCAL_DIR)/futex.cpp \
+    $(LOCAL_DIR)/handles.cpp \
+    $(LOCAL_DIR)/main.cpp \
+    $(LOCAL_DIR)/ports.cpp \
+    $(LOCAL_DIR)/process.cpp \
+    $(LOCAL_DIR)/sockets.cpp \
+    $(LOCAL_DIR)/syscalls.cpp \
+    $(LOCAL_DIR)/vmo.cpp
+
+MODULE_NAME := microbenchmarks-test
+
+MODULE_STATIC_LIBS := \
+    system/ulib/perftest \
+    system/ulib/shared-fifo \
+    system/ulib/zxcpp \
+    system/ulib/fbl
+
+MODULE_LIBS := \
+    system/ulib/c \
+    system/ulib/fdio \
+    system/ulib/mini-process \
+    system/ulib/zircon \
+    system/ulib/unittest
+
+include make/module.mk
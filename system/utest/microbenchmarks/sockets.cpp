@@ -0,0 +1,51 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <fbl/unique_ptr.h>
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+// Writes |size| bytes to one end of a stream socket and reads them from the
+// other, a chunk at a time if the socket cannot take them all at once.
+bool SocketWriteRead(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+    zx_handle_t socket[2];
+    if (zx_socket_create(0, &socket[0], &socket[1]) != ZX_OK)
+        return false;
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[size]());
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        size_t done = 0;
+        while (ok && done < size) {
+            size_t written;
+            size_t read;
+            ok = zx_socket_write(socket[0], 0, buffer.get() + done, size - done,
+                                 &written) == ZX_OK &&
+                 zx_socket_read(socket[1], 0, buffer.get() + done, written, &read) == ZX_OK &&
+                 read == written;
+            done += written;
+        }
+    }
+    zx_handle_close(socket[0]);
+    zx_handle_close(socket[1]);
+    return ok;
+}
+
+void RegisterTests() {
+    static const size_t kSizes[] = {64, 1024, 32 * 1024, 64 * 1024};
+    for (size_t size : kSizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "Socket/WriteRead/%zubytes", size);
+        perftest::RegisterTest(name, [size](perftest::RepeatState* state) {
+            return SocketWriteRead(state, size);
+        });
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
@@ -0,0 +1,37 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+// The cost of entering and leaving the kernel.
+bool SyscallNull() {
+    return zx_syscall_test_0() == 0;
+}
+
+// The same, with every argument register in use.
+bool SyscallManyArgs() {
+    return zx_syscall_test_8(1, 2, 3, 4, 5, 6, 7, 8) == 36;
+}
+
+// These are answered by the vDSO without entering the kernel.
+bool TicksGet() {
+    return zx_ticks_get() != 0;
+}
+
+bool ClockGetMonotonic() {
+    return zx_clock_get(ZX_CLOCK_MONOTONIC) != 0;
+}
+
+void RegisterTests() {
+    perftest::RegisterSimpleTest<SyscallNull>("Syscall/Null");
+    perftest::RegisterSimpleTest<SyscallManyArgs>("Syscall/ManyArgs");
+    perftest::RegisterSimpleTest<TicksGet>("Vdso/TicksGet");
+    perftest::RegisterSimpleTest<ClockGetMonotonic>("Vdso/ClockGetMonotonic");
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
@@ -0,0 +1,91 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <perftest/perftest.h>
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+constexpr uint32_t kMapFlags = ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE;
+
+// Maps and unmaps pages that are already committed, so only the cost of
+// changing the address space is measured.
+bool VmoMapUnmap(perftest::RepeatState* state, size_t pages) {
+    const size_t size = pages * kPageSize;
+    zx_handle_t vmo;
+    if (zx_vmo_create(size, 0, &vmo) != ZX_OK)
+        return false;
+    bool ok = zx_vmo_op_range(vmo, ZX_VMO_OP_COMMIT, 0, size, nullptr, 0) == ZX_OK;
+    while (ok && state->KeepRunning()) {
+        uintptr_t addr;
+        ok = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, size, kMapFlags, &addr) == ZX_OK &&
+             zx_vmar_unmap(zx_vmar_root_self(), addr, size) == ZX_OK;
+    }
+    zx_handle_close(vmo);
+    return ok;
+}
+
+// Creates a VMO, maps it and writes to every page, so each page is faulted
+// in and zeroed.
+bool VmoMapFault(perftest::RepeatState* state, size_t pages) {
+    const size_t size = pages * kPageSize;
+    state->SetBytesProcessedPerRun(size);
+    bool ok = true;
+    while (ok && state->KeepRunning()) {
+        zx_handle_t vmo;
+        if (zx_vmo_create(size, 0, &vmo) != ZX_OK)
+            return false;
+        uintptr_t addr;
+        ok = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, size, kMapFlags, &addr) == ZX_OK;
+        if (ok) {
+            for (size_t offset = 0; offset < size; offset += kPageSize)
+                *reinterpret_cast<volatile uint8_t*>(addr + offset) = 1;
+            ok = zx_vmar_unmap(zx_vmar_root_self(), addr, size) == ZX_OK;
+        }
+        zx_handle_close(vmo);
+    }
+    return ok;
+}
+
+// Makes a copy-on-write clone of a committed VMO and closes it.
+bool VmoCloneClose(perftest::RepeatState* state, size_t pages) {
+    const size_t size = pages * kPageSize;
+    zx_handle_t vmo;
+    if (zx_vmo_create(size, 0, &vmo) != ZX_OK)
+        return false;
+    bool ok = zx_vmo_op_range(vmo, ZX_VMO_OP_COMMIT, 0, size, nullptr, 0) == ZX_OK;
+    while (ok && state->KeepRunning()) {
+        zx_handle_t clone;
+        ok = zx_vmo_clone(vmo, ZX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone) == ZX_OK &&
+             zx_handle_close(clone) == ZX_OK;
+    }
+    zx_handle_close(vmo);
+    return ok;
+}
+
+void RegisterTests() {
+    static const size_t kPages[] = {1, 64};
+    for (size_t pages : kPages) {
+        char name[64];
+        snprintf(name, sizeof(name), "Vmo/MapUnmap/%zupages", pages);
+        perftest::RegisterTest(name, [pages](perftest::RepeatState* state) {
+            return VmoMapUnmap(state, pages);
+        });
+        snprintf(name, sizeof(name), "Vmo/MapFault/%zupages", pages);
+        perftest::RegisterTest(name, [pages](perftest::RepeatState* state) {
+            return VmoMapFault(state, pages);
+        });
+        snprintf(name, sizeof(name), "Vmo/CloneClose/%zupages", pages);
+        perftest::RegisterTest(name, [pages](perftest::RepeatState* state) {
+            return VmoCloneClose(state, pages);
+        });
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+} // namespace
@@ -0,0 +1,133 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <perftest/perftest.h>
+#include <unittest/unittest.h>
+
+namespace {
+
+bool summary_statistics_test() {
+    BEGIN_TEST;
+
+    perftest::TestCaseResults results("test", "nanoseconds");
+    // Out of order, to check that they are sorted.
+    static const double kValues[] = {10, 1, 9, 2, 8, 3, 7, 4, 6, 5};
+    for (double value : kValues)
+        results.AppendValue(value);
+
+    perftest::SummaryStatistics stats = results.GetSummaryStatistics();
+    EXPECT_EQ(1.0, stats.min);
+    EXPECT_EQ(10.0, stats.max);
+    EXPECT_EQ(5.5, stats.mean);
+    EXPECT_EQ(5.5, stats.median);
+    EXPECT_EQ(9.0, stats.p90);
+    EXPECT_EQ(10.0, stats.p99);
+    EXPECT_TRUE(fabs(stats.std_dev - sqrt(8.25)) < 1e-9);
+
+    END_TEST;
+}
+
+bool repeat_state_test() {
+    BEGIN_TEST;
+
+    perftest::RepeatState state(2, 5);
+    uint32_t runs = 0;
+    while (state.KeepRunning())
+        runs++;
+    EXPECT_EQ(7u, runs);
+    EXPECT_TRUE(state.finished());
+    EXPECT_FALSE(state.KeepRunning());
+
+    perftest::TestCaseResults results("test", "nanoseconds");
+    state.SetBytesProcessedPerRun(100);
+    state.GetResults(&results);
+    ASSERT_EQ(5u, results.values().size());
+    for (double value : results.values())
+        EXPECT_GE(value, 0.0);
+    EXPECT_EQ(100u, results.bytes_per_run());
+
+    END_TEST;
+}
+
+bool run_tests_test() {
+    BEGIN_TEST;
+
+    perftest::RegisterTest("RunTestsTest/Passes", [](perftest::RepeatState* state) {
+        while (state->KeepRunning()) {}
+        return true;
+    });
+    perftest::RegisterTest("RunTestsTest/StopsEarly", [](perftest::RepeatState* state) {
+        state->KeepRunning();
+        return true;
+    });
+    perftest::RegisterTest("RunTestsTest/Fails", [](perftest::RepeatState* state) {
+        return false;
+    });
+
+    FILE* log = tmpfile();
+    ASSERT_NONNULL(log);
+    perftest::RunOptions options;
+    options.warm_up_runs = 1;
+    options.runs = 3;
+
+    options.filter = "RunTestsTest/Passes";
+    perftest::ResultsSet passed;
+    EXPECT_TRUE(perftest::RunTests(options, log, &passed));
+    ASSERT_EQ(1u, passed.results().size());
+    const char* label = passed.results()[0].label().c_str();
+    EXPECT_STR_EQ("RunTestsTest/Passes", label, sizeof("RunTestsTest/Passes"), "");
+    EXPECT_EQ(3u, passed.results()[0].values().size());
+
+    // Only the results of tests that pass are kept.
+    options.filter = "RunTestsTest/";
+    perftest::ResultsSet all;
+    EXPECT_FALSE(perftest::RunTests(options, log, &all));
+    EXPECT_EQ(1u, all.results().size());
+
+    fclose(log);
+    END_TEST;
+}
+
+bool json_test() {
+    BEGIN_TEST;
+
+    perftest::ResultsSet set;
+    perftest::TestCaseResults* results = set.AddTestCase("a\"b", "nanoseconds");
+    results->AppendValue(1.5);
+    results->AppendValue(2);
+    results = set.AddTestCase("c", "bytes");
+    results->AppendValue(3);
+    results->set_bytes_per_run(64);
+
+    FILE* out = tmpfile();
+    ASSERT_NONNULL(out);
+    set.WriteJSON(out);
+    char buffer[256] = {};
+    rewind(out);
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, out);
+    fclose(out);
+    buffer[size] = '\0';
+
+    const char expected[] =
+        "[\n"
+        "{\"label\":\"a\\\"b\",\"unit\":\"nanoseconds\",\"values\":[1.5,2]},\n"
+        "{\"label\":\"c\",\"unit\":\"bytes\",\"values\":[3],\"bytes_per_run\":64}\n"
+        "]\n";
+    EXPECT_STR_EQ(expected, buffer, sizeof(expected), "");
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(perftest_tests)
+RUN_TEST(summary_statistics_test)
+RUN_TEST(repeat_state_test)
+RUN_TEST(run_tests_test)
+RUN_TEST(json_test)
+END_TEST_CASE(perftest_tests)
@@ -16,6 +16,7 @@ MODULE_NAME := ramdisk-test
 
 MODULE_STATIC_LIBS := \
     system/ulib/block-client \
+    system/ulib/shared-fifo \
     system/ulib/sync \
     system/ulib/zxcpp \
     system/ulib/fbl \
@@ -0,0 +1,205 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <trace-reader/indexed_reader.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/vector.h>
+#include <trace-engine/fields.h>
+#include <unittest/unittest.h>
+
+namespace {
+
+constexpr trace_ticks_t kTicksPerSecond = 1000000000u;
+constexpr trace_ticks_t kFirstTimestamp = 1000u;
+constexpr size_t kNumEvents = 4096u;
+constexpr size_t kNumDefinitions = 4u;
+
+const trace::ProcessThread kFirstThread(1u, 2u);
+const trace::ProcessThread kSecondThread(1u, 3u);
+
+void AppendString(fbl::Vector<uint64_t>* words, trace_string_index_t index,
+                  const char* string) {
+    const size_t length = strlen(string);
+    uint64_t header = trace::StringRecordFields::Type::Make(
+                          trace::ToUnderlyingType(trace::RecordType::kString)) |
+                      trace::StringRecordFields::RecordSize::Make(2u) |
+                      trace::StringRecordFields::StringIndex::Make(index) |
+                      trace::StringRecordFields::StringLength::Make(length);
+    uint64_t data = 0u;
+    memcpy(&data, string, length);
+    words->push_back(header);
+    words->push_back(data);
+}
+
+// Writes a trace whose first half is events on |kFirstThread| in category
+// "a" and whose second half is events on |kSecondThread| in category "b".
+bool WriteTrace(char* path) {
+    fbl::Vector<uint64_t> words;
+    words.push_back(trace::RecordFields::Type::Make(
+                        trace::ToUnderlyingType(trace::RecordType::kInitialization)) |
+                    trace::RecordFields::RecordSize::Make(2u));
+    words.push_back(kTicksPerSecond);
+    AppendString(&words, 1u, "a");
+    AppendString(&words, 2u, "b");
+    AppendString(&words, 3u, "name");
+    for (size_t i = 0; i < kNumEvents; i++) {
+        const bool first_half = i < kNumEvents / 2;
+        const trace::ProcessThread& thread = first_half ? kFirstThread : kSecondThread;
+        words.push_back(trace::EventRecordFields::Type::Make(
+                            trace::ToUnderlyingType(trace::RecordType::kEvent)) |
+                        trace::EventRecordFields::RecordSize::Make(4u) |
+                        trace::EventRecordFields::EventType::Make(
+                            trace::ToUnderlyingType(trace::EventType::kDurationBegin)) |
+                        trace::EventRecordFields::CategoryStringRef::Make(first_half ? 1u : 2u) |
+                        trace::EventRecordFields::NameStringRef::Make(3u));
+        words.push_back(kFirstTimestamp + i);
+        words.push_back(thread.process_koid());
+        words.push_back(thread.thread_koid());
+    }
+
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    const size_t num_bytes = words.size() * sizeof(uint64_t);
+    bool ok = write(fd, words.get(), num_bytes) == static_cast<ssize_t>(num_bytes);
+    close(fd);
+    return ok;
+}
+
+fbl::unique_ptr<trace::IndexedTraceReader> OpenTrace(char* path, fbl::String* out_error) {
+    if (!WriteTrace(path))
+        return nullptr;
+    return trace::IndexedTraceReader::Open(path, [out_error](fbl::String error) {
+        *out_error = fbl::move(error);
+    });
+}
+
+// Reads the records |query| selects and returns their timestamps.
+fbl::Vector<trace_ticks_t> ReadTimestamps(const trace::IndexedTraceReader& reader,
+                                          const trace::IndexedTraceReader::Query& query) {
+    fbl::Vector<trace_ticks_t> timestamps;
+    fbl::Vector<uint32_t> blocks = reader.FindBlocks(query);
+    reader.ReadBlocks(query, blocks.get(), blocks.size(), [&timestamps](trace::Record record) {
+        timestamps.push_back(record.GetEvent().timestamp);
+    });
+    return timestamps;
+}
+
+bool index_test() {
+    BEGIN_TEST;
+
+    char path[] = "/tmp/trace-reader-test.XXXXXX";
+    fbl::String error;
+    auto reader = OpenTrace(path, &error);
+    ASSERT_NONNULL(reader, error.c_str());
+    unlink(path);
+
+    EXPECT_EQ(kNumDefinitions + kNumEvents, reader->num_records());
+    EXPECT_EQ((kNumDefinitions + kNumEvents + trace::IndexedTraceReader::kRecordsPerBlock - 1) /
+                  trace::IndexedTraceReader::kRecordsPerBlock,
+              reader->num_blocks());
+    EXPECT_EQ(kFirstTimestamp, reader->min_timestamp());
+    EXPECT_EQ(kFirstTimestamp + kNumEvents - 1, reader->max_timestamp());
+    EXPECT_EQ(kTicksPerSecond, reader->ticks_per_second());
+
+    size_t num_strings = 0u;
+    EXPECT_TRUE(reader->ReadDefinitions([&num_strings](trace::Record record) {
+        if (record.type() == trace::RecordType::kString)
+            num_strings++;
+    }));
+    EXPECT_EQ(3u, num_strings);
+    EXPECT_TRUE(error.empty());
+
+    END_TEST;
+}
+
+bool query_test() {
+    BEGIN_TEST;
+
+    char path[] = "/tmp/trace-reader-test.XXXXXX";
+    fbl::String error;
+    auto reader = OpenTrace(path, &error);
+    ASSERT_NONNULL(reader, error.c_str());
+    unlink(path);
+
+    trace::IndexedTraceReader::Query all;
+    EXPECT_EQ(reader->num_blocks(), reader->FindBlocks(all).size());
+    EXPECT_EQ(kNumEvents, ReadTimestamps(*reader, all).size());
+
+    // The second thread's events are in the last blocks only.
+    trace::IndexedTraceReader::Query thread;
+    thread.thread = kSecondThread;
+    EXPECT_LT(reader->FindBlocks(thread).size(), reader->num_blocks());
+    auto timestamps = ReadTimestamps(*reader, thread);
+    ASSERT_EQ(kNumEvents / 2, timestamps.size());
+    EXPECT_EQ(kFirstTimestamp + kNumEvents / 2, timestamps[0]);
+
+    trace::IndexedTraceReader::Query category;
+    category.category = "a";
+    EXPECT_LT(reader->FindBlocks(category).size(), reader->num_blocks());
+    timestamps = ReadTimestamps(*reader, category);
+    ASSERT_EQ(kNumEvents / 2, timestamps.size());
+    EXPECT_EQ(kFirstTimestamp, timestamps[0]);
+
+    trace::IndexedTraceReader::Query range;
+    range.begin = kFirstTimestamp + 100u;
+    range.end = kFirstTimestamp + 200u;
+    EXPECT_EQ(1u, reader->FindBlocks(range).size());
+    timestamps = ReadTimestamps(*reader, range);
+    ASSERT_EQ(100u, timestamps.size());
+    EXPECT_EQ(range.begin, timestamps[0]);
+
+    trace::IndexedTraceReader::Query none;
+    none.category = "c";
+    EXPECT_EQ(0u, reader->FindBlocks(none).size());
+    EXPECT_TRUE(error.empty());
+
+    END_TEST;
+}
+
+bool parallel_test() {
+    BEGIN_TEST;
+
+    char path[] = "/tmp/trace-reader-test.XXXXXX";
+    fbl::String error;
+    auto reader = OpenTrace(path, &error);
+    ASSERT_NONNULL(reader, error.c_str());
+    unlink(path);
+
+    trace::IndexedTraceReader::Query all;
+    fbl::Vector<uint32_t> blocks = reader->FindBlocks(all);
+    const size_t num_slices = blocks.size();
+    fbl::Vector<trace_ticks_t> slices[8];
+    ASSERT_LE(num_slices, fbl::count_of(slices));
+    EXPECT_TRUE(reader->ReadBlocksParallel(
+        all, blocks.get(), blocks.size(), num_slices, 3u,
+        [&slices](size_t slice, trace::Record record) {
+            slices[slice].push_back(record.GetEvent().timestamp);
+        }));
+
+    // The slices in order give the records in order.
+    trace_ticks_t expected = kFirstTimestamp;
+    for (size_t i = 0; i < num_slices; i++) {
+        for (trace_ticks_t timestamp : slices[i])
+            EXPECT_EQ(expected++, timestamp);
+    }
+    EXPECT_EQ(kFirstTimestamp + kNumEvents, expected);
+    EXPECT_TRUE(error.empty());
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(indexed_reader_tests)
+RUN_TEST(index_test)
+RUN_TEST(query_test)
+RUN_TEST(parallel_test)
+END_TEST_CASE(indexed_reader_tests)
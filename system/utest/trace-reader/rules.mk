@@ -5,6 +5,7 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
 reader_tests := \
+    $(LOCAL_DIR)/indexed_reader_tests.cpp \
     $(LOCAL_DIR)/main.c \
     $(LOCAL_DIR)/reader_tests.cpp \
     $(LOCAL_DIR)/records_tests.cpp
@@ -56,6 +57,8 @@ MODULE_COMPILEFLAGS := \
     -Isystem/ulib/fbl/include \
     -Isystem/ulib/unittest/include \
 
+MODULE_HOST_SYSLIBS := -lpthread
+
 include make/module.mk
 
 # Clear out local variables.
@@ -11,6 +11,7 @@
 #include <fbl/string_printf.h>
 #include <fbl/vector.h>
 #include <zx/event.h>
+#include <trace-engine/handler.h>
 #include <trace-engine/instrumentation.h>
 
 namespace {
@@ -203,7 +204,7 @@ bool test_register_current_thread_multiple_threads() {
     ASSERT_RECORDS(R"X(String(index: 1, "process")
 KernelObject(koid: <>, type: thread, name: "initial-thread", {process: koid(<>)})
 Thread(index: 1, <>)
-String(index: 2, "process")
+String(index: 17, "process")
 KernelObject(koid: <>, type: thread, name: "thrd_t:<>/TLS=<>", {process: koid(<>)})
 Thread(index: 2, <>)
 )X",
@@ -297,14 +298,14 @@ bool test_register_string_literal_multiple_threads() {
     EXPECT_NE(a1.encoded_value, a2.encoded_value);
     EXPECT_NE(b1.encoded_value, b2.encoded_value);
 
-    // Each thread has its own string pool.
+    // Each thread has its own string pool, with its own block of indexes.
     EXPECT_NE(a1.encoded_value, b1.encoded_value);
     EXPECT_NE(a2.encoded_value, b2.encoded_value);
 
     ASSERT_RECORDS(R"X(String(index: 1, "string1")
 String(index: 2, "string2")
-String(index: 3, "string1")
-String(index: 4, "string2")
+String(index: 17, "string1")
+String(index: 18, "string2")
 )X",
                    "");
 
@@ -387,6 +388,200 @@ bool test_event_with_inline_everything() {
     END_TRACE_TEST;
 }
 
+bool test_events_from_multiple_threads() {
+    BEGIN_TRACE_TEST;
+
+    fixture_start_tracing();
+
+    // Each thread writes into its own chunks of the buffer, so its events
+    // are not interleaved with those of other threads, but the buffer must
+    // still read back cleanly.
+    constexpr size_t kNumThreads = 4;
+    constexpr int64_t kNumEventsPerThread = 1000;
+    thrd_t threads[kNumThreads];
+    for (auto& thread : threads) {
+        int result = thrd_create(&thread, [](void*) {
+            auto context = trace::TraceContext::Acquire();
+            trace_string_ref_t cat = trace_make_inline_c_string_ref("cat");
+            trace_string_ref_t name = trace_make_inline_c_string_ref("name");
+            trace_thread_ref_t thread_ref;
+            trace_context_register_current_thread(context.get(), &thread_ref);
+            for (int64_t i = 0; i < kNumEventsPerThread; i++) {
+                trace_context_write_instant_event_record(context.get(), zx_ticks_get(),
+                                                         &thread_ref, &cat, &name,
+                                                         TRACE_SCOPE_THREAD, nullptr, 0u);
+            }
+            return 0;
+        }, nullptr);
+        ASSERT_EQ(thrd_success, result);
+    }
+    for (auto& thread : threads) {
+        int result = thrd_join(thread, nullptr);
+        ASSERT_EQ(thrd_success, result);
+    }
+
+    fbl::Vector<trace::Record> records;
+    ASSERT_TRUE(fixture_read_records(&records));
+    EXPECT_EQ(ZX_OK, fixture_get_disposition());
+
+    size_t num_events = 0u;
+    for (const auto& record : records) {
+        if (record.type() == trace::RecordType::kEvent)
+            num_events++;
+    }
+    EXPECT_EQ(kNumThreads * kNumEventsPerThread, num_events);
+
+    END_TRACE_TEST;
+}
+
+bool test_circular_mode() {
+    BEGIN_TRACE_TEST;
+
+    fixture_start_tracing_with_mode(TRACE_BUFFERING_MODE_CIRCULAR);
+
+    // Write enough events to wrap the rolling buffers a few times.
+    constexpr int64_t kNumEvents = 50000;
+    {
+        auto context = trace::TraceContext::Acquire();
+
+        trace_string_ref_t cat;
+        trace_string_ref_t name;
+        trace_thread_ref_t thread;
+        trace_context_register_string_literal(context.get(), "+cat", &cat);
+        trace_context_register_string_literal(context.get(), "name", &name);
+        trace_context_register_current_thread(context.get(), &thread);
+        for (int64_t i = 0; i < kNumEvents; i++) {
+            trace_arg_t args[] = {
+                trace_make_arg(trace_make_inline_c_string_ref("i"),
+                               trace_make_int64_arg_value(i))};
+            trace_context_write_instant_event_record(context.get(), zx_ticks_get(),
+                                                     &thread, &cat, &name,
+                                                     TRACE_SCOPE_THREAD,
+                                                     args, fbl::count_of(args));
+        }
+    }
+
+    fbl::Vector<trace::Record> records;
+    ASSERT_TRUE(fixture_read_records(&records));
+    EXPECT_EQ(ZX_OK, fixture_get_disposition());
+
+    // The durable records survive, followed by an unbroken run of the
+    // most recent events.
+    ASSERT_GE(records.size(), 1u);
+    EXPECT_EQ(trace::RecordType::kInitialization, records[0].type());
+    int64_t expected = -1;
+    for (const auto& record : records) {
+        if (record.type() != trace::RecordType::kEvent)
+            continue;
+        int64_t i = record.GetEvent().arguments[0].value().GetInt64();
+        if (expected < 0) {
+            EXPECT_GT(i, 0, "oldest events should have been overwritten");
+        } else {
+            EXPECT_EQ(expected, i);
+        }
+        expected = i + 1;
+    }
+    EXPECT_EQ(kNumEvents, expected);
+
+    END_TRACE_TEST;
+}
+
+bool test_streaming_mode() {
+    BEGIN_TRACE_TEST;
+
+    fixture_start_tracing_with_mode(TRACE_BUFFERING_MODE_STREAMING);
+
+    // The fixture does not save buffers by itself, so once both rolling
+    // buffers are full writing pauses until one is marked saved.
+    constexpr int64_t kMaxEvents = 1000000;
+    constexpr int64_t kNumPausedEvents = 100;
+    constexpr int64_t kNumResumedEvents = 100;
+    fbl::Vector<BufferFullNotification> notifications;
+    int64_t first_switch = -1; // The event that filled rolling buffer 0.
+    int64_t pause = -1;        // The event that filled rolling buffer 1.
+    int64_t resume;            // The first event after buffer 0 was saved.
+    {
+        auto context = trace::TraceContext::Acquire();
+
+        trace_string_ref_t cat;
+        trace_string_ref_t name;
+        trace_thread_ref_t thread;
+        trace_context_register_string_literal(context.get(), "+cat", &cat);
+        trace_context_register_string_literal(context.get(), "name", &name);
+        trace_context_register_current_thread(context.get(), &thread);
+        auto write_event = [&](int64_t i) {
+            trace_arg_t args[] = {
+                trace_make_arg(trace_make_inline_c_string_ref("i"),
+                               trace_make_int64_arg_value(i))};
+            trace_context_write_instant_event_record(context.get(), zx_ticks_get(),
+                                                     &thread, &cat, &name,
+                                                     TRACE_SCOPE_THREAD,
+                                                     args, fbl::count_of(args));
+        };
+
+        // The engine notifies the handler on the writing thread, so the
+        // notification for a full buffer is in before the write returns.
+        int64_t i = 0;
+        for (; i < kMaxEvents && pause < 0; i++) {
+            write_event(i);
+            notifications.reset();
+            fixture_get_buffer_full_notifications(&notifications);
+            if (notifications.size() == 1u && first_switch < 0)
+                first_switch = i;
+            if (notifications.size() == 2u)
+                pause = i;
+        }
+        ASSERT_GE(first_switch, 0, "rolling buffer 0 never filled");
+        ASSERT_GE(pause, 0, "rolling buffer 1 never filled");
+        ASSERT_EQ(2u, notifications.size());
+        EXPECT_EQ(0u, notifications[0].wrapped_count);
+        EXPECT_EQ(1u, notifications[1].wrapped_count);
+        EXPECT_GT(notifications[0].durable_data_end, 0u);
+
+        // Both buffers are waiting to be saved, so these are dropped without
+        // asking again.
+        for (int64_t j = 0; j < kNumPausedEvents; j++, i++)
+            write_event(i);
+        notifications.reset();
+        fixture_get_buffer_full_notifications(&notifications);
+        EXPECT_EQ(2u, notifications.size(), "notified while paused");
+
+        EXPECT_EQ(ZX_ERR_BAD_STATE, trace_engine_mark_buffer_saved(2u),
+                  "buffer 2 was never full");
+        EXPECT_EQ(ZX_OK, trace_engine_mark_buffer_saved(0u));
+        EXPECT_EQ(ZX_ERR_BAD_STATE, trace_engine_mark_buffer_saved(0u), "saved twice");
+
+        // Writing carries on in rolling buffer 0.
+        resume = i;
+        for (int64_t j = 0; j < kNumResumedEvents; j++, i++)
+            write_event(i);
+        notifications.reset();
+        fixture_get_buffer_full_notifications(&notifications);
+        EXPECT_EQ(2u, notifications.size());
+    }
+
+    fbl::Vector<trace::Record> records;
+    ASSERT_TRUE(fixture_read_records(&records));
+    EXPECT_EQ(ZX_OK, fixture_get_disposition());
+
+    // Buffer 1 holds the events from the one that filled buffer 0 up to
+    // the one before the pause. Buffer 0, which was saved and reused, holds
+    // the events written since.
+    ASSERT_GE(records.size(), 1u);
+    EXPECT_EQ(trace::RecordType::kInitialization, records[0].type());
+    int64_t expected = first_switch;
+    for (const auto& record : records) {
+        if (record.type() != trace::RecordType::kEvent)
+            continue;
+        int64_t i = record.GetEvent().arguments[0].value().GetInt64();
+        EXPECT_EQ(expected, i);
+        expected = (i + 1 == pause) ? resume : i + 1;
+    }
+    EXPECT_EQ(resume + kNumResumedEvents, expected);
+
+    END_TRACE_TEST;
+}
+
 // NOTE: The functions for writing trace records are exercised by other trace tests.
 
 } // namespace
@@ -406,4 +601,7 @@ RUN_TEST(test_register_string_literal_multiple_threads)
 RUN_TEST(test_register_string_literal_table_overflow)
 RUN_TEST(test_maximum_record_length)
 RUN_TEST(test_event_with_inline_everything)
+RUN_TEST(test_events_from_multiple_threads)
+RUN_TEST(test_circular_mode)
+RUN_TEST(test_streaming_mode)
 END_TEST_CASE(engine_tests)
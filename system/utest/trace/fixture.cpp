@@ -15,6 +15,8 @@
 #include <zx/event.h>
 #include <fbl/algorithm.h>
 #include <fbl/array.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
 #include <fbl/string.h>
 #include <fbl/string_buffer.h>
 #include <fbl/vector.h>
@@ -38,7 +40,7 @@ public:
         StopTracing(false);
     }
 
-    void StartTracing() {
+    void StartTracing(trace_buffering_mode_t buffering_mode) {
         if (trace_running_)
             return;
 
@@ -46,8 +48,8 @@ public:
         loop_.StartThread("trace test");
 
         // Asynchronously start the engine.
-        zx_status_t status = trace_start_engine(loop_.async(), this,
-                                                buffer_.get(), buffer_.size());
+        zx_status_t status = trace_start_engine_with_mode(loop_.async(), this, buffering_mode,
+                                                          buffer_.get(), buffer_.size());
         ZX_DEBUG_ASSERT(status == ZX_OK);
     }
 
@@ -80,17 +82,18 @@ public:
         return disposition_;
     }
 
+    void GetBufferFullNotifications(fbl::Vector<BufferFullNotification>* out) {
+        fbl::AutoLock lock(&mutex_);
+        for (const auto& notification : buffer_full_notifications_)
+            out->push_back(notification);
+    }
+
     bool ReadRecords(fbl::Vector<trace::Record>* out_records,
                      fbl::Vector<fbl::String>* out_errors) {
         trace::TraceReader reader(
             [out_records](trace::Record record) { out_records->push_back(fbl::move(record)); },
             [out_errors](fbl::String error) { out_errors->push_back(fbl::move(error)); });
-        trace::Chunk chunk(reinterpret_cast<uint64_t*>(buffer_.get()),
-                           buffer_bytes_written_ / 8u);
-        if (buffer_bytes_written_ & 7u) {
-            out_errors->push_back(fbl::String("Buffer contains extraneous bytes"));
-        }
-        if (!reader.ReadRecords(chunk)) {
+        if (!reader.ReadBuffer(buffer_.get(), buffer_bytes_written_)) {
             out_errors->push_back(fbl::String("Trace data is corrupted"));
         }
         return out_errors->is_empty();
@@ -114,6 +117,13 @@ private:
         trace_stopped_.signal(0u, ZX_EVENT_SIGNALED);
     }
 
+    // Only records the request. Tests decide when the buffer is saved by
+    // calling trace_engine_mark_buffer_saved() themselves.
+    void NotifyBufferFull(uint32_t wrapped_count, uint64_t durable_data_end) override {
+        fbl::AutoLock lock(&mutex_);
+        buffer_full_notifications_.push_back({wrapped_count, durable_data_end});
+    }
+
     async::Loop loop_;
     fbl::Array<uint8_t> buffer_;
     bool trace_running_ = false;
@@ -121,6 +131,9 @@ private:
     size_t buffer_bytes_written_ = 0u;
     zx::event trace_stopped_;
     bool observed_stopped_callback_ = false;
+
+    fbl::Mutex mutex_;
+    fbl::Vector<BufferFullNotification> buffer_full_notifications_ __TA_GUARDED(mutex_);
 };
 
 Fixture* g_fixture{nullptr};
@@ -139,8 +152,12 @@ void fixture_tear_down(void) {
 }
 
 void fixture_start_tracing() {
+    fixture_start_tracing_with_mode(TRACE_BUFFERING_MODE_ONESHOT);
+}
+
+void fixture_start_tracing_with_mode(trace_buffering_mode_t buffering_mode) {
     ZX_DEBUG_ASSERT(g_fixture);
-    g_fixture->StartTracing();
+    g_fixture->StartTracing(buffering_mode);
 }
 
 void fixture_stop_tracing() {
@@ -158,6 +175,27 @@ zx_status_t fixture_get_disposition(void) {
     return g_fixture->disposition();
 }
 
+void fixture_get_buffer_full_notifications(fbl::Vector<BufferFullNotification>* out) {
+    ZX_DEBUG_ASSERT(g_fixture);
+    g_fixture->GetBufferFullNotifications(out);
+}
+
+bool fixture_read_records(fbl::Vector<trace::Record>* out_records) {
+    ZX_DEBUG_ASSERT(g_fixture);
+    BEGIN_HELPER;
+
+    g_fixture->StopTracing(false);
+
+    fbl::Vector<fbl::String> errors;
+    EXPECT_TRUE(g_fixture->ReadRecords(out_records, &errors), "read error");
+
+    for (const auto& error : errors)
+        printf("error: %s\n", error.c_str());
+    ASSERT_EQ(0u, errors.size(), "errors encountered");
+
+    END_HELPER;
+}
+
 bool fixture_compare_records(const char* expected) {
     ZX_DEBUG_ASSERT(g_fixture);
     BEGIN_HELPER;
@@ -10,13 +10,20 @@
 #pragma once
 
 #include <zircon/compiler.h>
+#include <trace-engine/types.h>
 #include <unittest/unittest.h>
 
+#ifdef __cplusplus
+#include <fbl/vector.h>
+#include <trace-reader/records.h>
+#endif
+
 __BEGIN_CDECLS
 
 void fixture_set_up(void);
 void fixture_tear_down(void);
 void fixture_start_tracing(void);
+void fixture_start_tracing_with_mode(trace_buffering_mode_t buffering_mode);
 void fixture_stop_tracing(void);
 void fixture_stop_tracing_hard(void);
 zx_status_t fixture_get_disposition(void);
@@ -49,3 +56,19 @@ inline void fixture_scope_cleanup(bool* scope) {
 #endif // NTRACE
 
 __END_CDECLS
+
+#ifdef __cplusplus
+// Stops tracing and reads back all the records, including the
+// initialization record.
+bool fixture_read_records(fbl::Vector<trace::Record>* out_records);
+
+// The arguments of a call to the handler's |notify_buffer_full()|.
+struct BufferFullNotification {
+    uint32_t wrapped_count;
+    uint64_t durable_data_end;
+};
+
+// Appends the streaming mode buffer full notifications received so far,
+// oldest first, to |out|.
+void fixture_get_buffer_full_notifications(fbl::Vector<BufferFullNotification>* out);
+#endif
@@ -95,6 +95,76 @@ bool vmo_read_write_test() {
     END_TEST;
 }
 
+bool vmo_read_write_vector_test() {
+    BEGIN_TEST;
+
+    zx_status_t status;
+    size_t size;
+    zx_handle_t vmo;
+
+    const size_t len = PAGE_SIZE * 2;
+    status = zx_vmo_create(len, 0, &vmo);
+    EXPECT_EQ(status, ZX_OK, "vm_object_create");
+
+    uint8_t src[len];
+    for (size_t i = 0; i < len; i++)
+        src[i] = static_cast<uint8_t>(i * 7);
+
+    // gather a header, a buffer straddling the page boundary, and an
+    // empty buffer into one write
+    uint8_t header[100];
+    uint8_t body[len - 100 - 1];
+    memcpy(header, src, sizeof(header));
+    memcpy(body, src + sizeof(header), sizeof(body));
+    zx_iovec_t out[3] = {
+        {header, sizeof(header)},
+        {nullptr, 0},
+        {body, sizeof(body)},
+    };
+    status = zx_vmo_writev(vmo, out, 3, 1, &size);
+    EXPECT_EQ(status, ZX_OK, "vm_object_writev");
+    EXPECT_EQ(len - 1, size, "vm_object_writev");
+
+    uint8_t check[len];
+    status = zx_vmo_read(vmo, check, 0, len, &size);
+    EXPECT_EQ(status, ZX_OK, "vm_object_read");
+    EXPECT_EQ(0, check[0], "untouched byte");
+    EXPECT_BYTES_EQ(src, check + 1, len - 1, "gathered write");
+
+    // scatter it back out; the read is trimmed at the end of the vmo
+    uint8_t first[PAGE_SIZE + 3];
+    uint8_t second[PAGE_SIZE];
+    memset(second, 0xff, sizeof(second));
+    zx_iovec_t in[2] = {
+        {first, sizeof(first)},
+        {second, sizeof(second)},
+    };
+    status = zx_vmo_readv(vmo, in, 2, 1, &size);
+    EXPECT_EQ(status, ZX_OK, "vm_object_readv");
+    EXPECT_EQ(len - 1, size, "vm_object_readv");
+    EXPECT_BYTES_EQ(src, first, sizeof(first), "first buffer");
+    EXPECT_BYTES_EQ(src + sizeof(first), second, len - 1 - sizeof(first), "second buffer");
+    EXPECT_EQ(0xff, second[len - 1 - sizeof(first)], "past the end of the vmo");
+
+    // too many buffers
+    zx_iovec_t many[ZX_VMO_MAX_IOVECS + 1] = {};
+    status = zx_vmo_readv(vmo, many, ZX_VMO_MAX_IOVECS + 1, 0, &size);
+    EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, status, "too many vectors");
+
+    // buffers whose sizes overflow
+    zx_iovec_t huge[2] = {
+        {first, SIZE_MAX},
+        {second, 2},
+    };
+    status = zx_vmo_readv(vmo, huge, 2, 0, &size);
+    EXPECT_EQ(ZX_ERR_INVALID_ARGS, status, "overflowing vectors");
+
+    status = zx_handle_close(vmo);
+    EXPECT_EQ(ZX_OK, status, "handle_close");
+
+    END_TEST;
+}
+
 bool vmo_map_test() {
     BEGIN_TEST;
 
@@ -1410,6 +1480,7 @@ bool vmo_unmap_coherency() {
 BEGIN_TEST_CASE(vmo_tests)
 RUN_TEST(vmo_create_test);
 RUN_TEST(vmo_read_write_test);
+RUN_TEST(vmo_read_write_vector_test);
 RUN_TEST(vmo_map_test);
 RUN_TEST(vmo_read_only_map_test);
 RUN_TEST(vmo_no_perm_map_test);